@@ -0,0 +1,458 @@
+/*******************************************************************************
+ * @file               acl.c
+ * @brief              ACL rule management and decision tree compiler.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Rules are turned into boxes in the 5-dimensional tuple
+ *                     space and split recursively: at every step the
+ *                     dimension and point that most evenly divide the rules
+ *                     of the current box are chosen, rules straddling the
+ *                     point are copied to both sides.  Once a box holds no
+ *                     more rules than one AVX2 compare covers it becomes a
+ *                     leaf.  Rules behind one that covers the whole box can
+ *                     never win and are dropped, which also bounds the
+ *                     replication of wide rules.
+ *
+ *                     The compiled tree is position independent (indices,
+ *                     not pointers) and is copied into a huge page mapping
+ *                     on each node, then published like the route tables.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "acl.h"
+
+#define ACL_MAX_DEPTH           128
+
+/* a rule as inclusive ranges, the form the compiler works on */
+struct acl_box
+{
+    uint32_t lo[NDP_ACL_DIMS];
+    uint32_t hi[NDP_ACL_DIMS];
+    uint32_t priority;
+    uint32_t action;
+    uint32_t id;
+};
+
+struct acl_build
+{
+    const struct acl_box *rules;
+    struct ndp_acl_node *nodes;
+    uint32_t num_nodes;
+    uint32_t cap_nodes;
+    struct ndp_acl_leaf *leaves;
+    uint32_t num_leaves;
+    uint32_t cap_leaves;
+    uint32_t *lo;
+    uint32_t *hi;
+};
+
+
+struct ndp_acl *ndp_acl_create(const int *nodes, int num_nodes, uint32_t max_rules,
+                               struct ndp_qsbr *qsbr)
+{
+    struct ndp_acl *acl;
+    int max_node = numa_max_node();
+
+    if (num_nodes <= 0 || num_nodes > NDP_ACL_MAX_NODES || !max_rules)
+        return NULL;
+    if (!(acl = calloc(1, sizeof(*acl))))
+        return NULL;
+
+    acl->qsbr = qsbr;
+    acl->num_nodes = num_nodes;
+    acl->max_rules = max_rules;
+    pthread_mutex_init(&acl->lock, NULL);
+    acl->rules = calloc(max_rules, sizeof(*acl->rules));
+    acl->live = calloc(max_rules, sizeof(*acl->live));
+    if (!acl->rules || !acl->live)
+        goto acl_fail;
+
+    for (int i = 0; i < num_nodes; i++) {
+        if (nodes[i] < 0 || nodes[i] >= NDP_ACL_MAX_NODES)
+            goto acl_fail;
+        acl->nodes[i] = nodes[i];
+    }
+    for (int n = 0; n < NDP_ACL_MAX_NODES; n++) {
+        int best = 0;
+        for (int i = 1; n <= max_node && i < num_nodes; i++) {
+            if (numa_distance(n, nodes[i]) < numa_distance(n, nodes[best]))
+                best = i;
+        }
+        acl->replica_of[n] = best;
+    }
+
+    // start from an empty rule set so lookups never see a NULL table
+    if (ndp_acl_commit(acl) != 0)
+        goto acl_fail;
+    return acl;
+
+acl_fail:
+    ndp_acl_destroy(acl);
+    return NULL;
+}
+
+void ndp_acl_destroy(struct ndp_acl *acl)
+{
+    if (!acl)
+        return;
+    for (int i = 0; i < acl->num_nodes; i++) {
+        if (acl->active[i])
+            ndp_mempool_unmap(acl->active[i], acl->active[i]->map_size);
+    }
+    pthread_mutex_destroy(&acl->lock);
+    free(acl->rules);
+    free(acl->live);
+    free(acl);
+}
+
+int ndp_acl_add(struct ndp_acl *acl, const struct ndp_acl_rule *rule)
+{
+    int id = -1;
+
+    if (rule->src_depth > 32 || rule->dst_depth > 32 ||
+        rule->sport_lo > rule->sport_hi || rule->dport_lo > rule->dport_hi)
+        return -1;
+
+    pthread_mutex_lock(&acl->lock);
+    for (uint32_t i = 0; i < acl->max_rules; i++) {
+        if (acl->live[i])
+            continue;
+        acl->rules[i] = *rule;
+        acl->live[i] = true;
+        if (i >= acl->num_slots)
+            acl->num_slots = i + 1;
+        id = i;
+        break;
+    }
+    pthread_mutex_unlock(&acl->lock);
+    return id;
+}
+
+int ndp_acl_delete(struct ndp_acl *acl, int id)
+{
+    int rc = -1;
+
+    pthread_mutex_lock(&acl->lock);
+    if (id >= 0 && (uint32_t)id < acl->max_rules && acl->live[id]) {
+        acl->live[id] = false;
+        rc = 0;
+    }
+    pthread_mutex_unlock(&acl->lock);
+    return rc;
+}
+
+static void rule_to_box(const struct ndp_acl_rule *r, uint32_t id, struct acl_box *b)
+{
+    uint32_t smask = r->src_depth ? ~0U << (32 - r->src_depth) : 0;
+    uint32_t dmask = r->dst_depth ? ~0U << (32 - r->dst_depth) : 0;
+
+    b->lo[NDP_ACL_SRC] = r->src & smask;
+    b->hi[NDP_ACL_SRC] = (r->src & smask) | ~smask;
+    b->lo[NDP_ACL_DST] = r->dst & dmask;
+    b->hi[NDP_ACL_DST] = (r->dst & dmask) | ~dmask;
+    b->lo[NDP_ACL_SPORT] = r->sport_lo;
+    b->hi[NDP_ACL_SPORT] = r->sport_hi;
+    b->lo[NDP_ACL_DPORT] = r->dport_lo;
+    b->hi[NDP_ACL_DPORT] = r->dport_hi;
+    b->lo[NDP_ACL_PROTO] = r->proto;
+    b->hi[NDP_ACL_PROTO] = r->proto ? r->proto : 0xff;
+    b->priority = r->priority;
+    b->action = r->action;
+    b->id = id;
+}
+
+/* descending priority, ties broken by insertion slot */
+static int box_cmp(const void *a, const void *b)
+{
+    const struct acl_box *x = a, *y = b;
+
+    if (x->priority != y->priority)
+        return x->priority > y->priority ? -1 : 1;
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+static int u32_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* number of sorted values <= v */
+static uint32_t count_le(const uint32_t *v, uint32_t n, uint32_t key)
+{
+    uint32_t lo = 0, hi = n;
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (v[mid] <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int64_t node_alloc(struct acl_build *b, uint32_t count)
+{
+    if (b->num_nodes + count > b->cap_nodes) {
+        uint32_t cap = b->cap_nodes ? b->cap_nodes * 2 : 256;
+        struct ndp_acl_node *n = realloc(b->nodes, sizeof(*n) * cap);
+        if (!n)
+            return -1;
+        b->nodes = n;
+        b->cap_nodes = cap;
+    }
+    b->num_nodes += count;
+    return b->num_nodes - count;
+}
+
+static int64_t leaf_alloc(struct acl_build *b, uint32_t count)
+{
+    while (b->num_leaves + count > b->cap_leaves) {
+        uint32_t cap = b->cap_leaves ? b->cap_leaves * 2 : 64;
+        struct ndp_acl_leaf *l = aligned_alloc(NDP_CACHE_LINE, sizeof(*l) * cap);
+        if (!l)
+            return -1;
+        if (b->leaves)
+            memcpy(l, b->leaves, sizeof(*l) * b->num_leaves);
+        free(b->leaves);
+        b->leaves = l;
+        b->cap_leaves = cap;
+    }
+    b->num_leaves += count;
+    return b->num_leaves - count;
+}
+
+static int make_leaf(struct acl_build *b, uint32_t at, const uint32_t *list, uint32_t n)
+{
+    uint32_t blocks = n ? (n + NDP_ACL_LANES - 1) / NDP_ACL_LANES : 1;
+    int64_t first = leaf_alloc(b, blocks);
+
+    if (first < 0)
+        return -1;
+
+    for (uint32_t k = 0; k < blocks; k++) {
+        struct ndp_acl_leaf *l = &b->leaves[first + k];
+
+        for (int lane = 0; lane < NDP_ACL_LANES; lane++) {
+            uint32_t i = k * NDP_ACL_LANES + lane;
+            for (int d = 0; d < NDP_ACL_DIMS; d++) {
+                // an empty lane has lo > hi and cannot match
+                l->lo[d][lane] = (i < n ? b->rules[list[i]].lo[d] : UINT32_MAX) ^ NDP_ACL_BIAS;
+                l->hi[d][lane] = (i < n ? b->rules[list[i]].hi[d] : 0) ^ NDP_ACL_BIAS;
+            }
+            l->action[lane] = i < n ? b->rules[list[i]].action : NDP_ACL_NO_MATCH;
+        }
+        l->next = k + 1 < blocks ? first + k + 1 : 0;
+    }
+
+    b->nodes[at].value = first;
+    b->nodes[at].child = 0;
+    b->nodes[at].dim = NDP_ACL_LEAF_DIM;
+    return 0;
+}
+
+static bool box_covers(const struct acl_box *r, const uint32_t *lo, const uint32_t *hi)
+{
+    for (int d = 0; d < NDP_ACL_DIMS; d++) {
+        if (r->lo[d] > lo[d] || r->hi[d] < hi[d])
+            return false;
+    }
+    return true;
+}
+
+/**
+ *  pick the split minimising the larger side; every candidate is a rule
+ *  edge inside the box, tested with two binary searches over the sorted
+ *  clipped bounds.
+ */
+static uint32_t best_split(struct acl_build *b, const uint32_t *list, uint32_t n,
+                           const uint32_t *lo, const uint32_t *hi, int *dim, uint32_t *at)
+{
+    uint32_t best = n, best_sum = 2 * n;
+
+    for (int d = 0; d < NDP_ACL_DIMS; d++) {
+        for (uint32_t i = 0; i < n; i++) {
+            const struct acl_box *r = &b->rules[list[i]];
+            b->lo[i] = r->lo[d] > lo[d] ? r->lo[d] : lo[d];
+            b->hi[i] = r->hi[d] < hi[d] ? r->hi[d] : hi[d];
+        }
+        qsort(b->lo, n, sizeof(*b->lo), u32_cmp);
+        qsort(b->hi, n, sizeof(*b->hi), u32_cmp);
+
+        for (uint32_t i = 0; i < 2 * n; i++) {
+            uint32_t s;
+            if (i < n) {
+                if (b->hi[i] >= hi[d])
+                    continue;
+                s = b->hi[i];
+            } else {
+                if (b->lo[i - n] <= lo[d])
+                    continue;
+                s = b->lo[i - n] - 1;
+            }
+
+            uint32_t left = count_le(b->lo, n, s);
+            uint32_t right = n - count_le(b->hi, n, s);
+            uint32_t worst = left > right ? left : right;
+
+            if (worst < best || (worst == best && left + right < best_sum)) {
+                best = worst;
+                best_sum = left + right;
+                *dim = d;
+                *at = s;
+            }
+        }
+    }
+    return best;
+}
+
+static int build(struct acl_build *b, uint32_t at, const uint32_t *list, uint32_t n,
+                 uint32_t *lo, uint32_t *hi, int depth)
+{
+    int dim = 0;
+    uint32_t split = 0;
+
+    // rules behind one spanning the whole box are unreachable here
+    for (uint32_t i = 0; i < n; i++) {
+        if (box_covers(&b->rules[list[i]], lo, hi)) {
+            n = i + 1;
+            break;
+        }
+    }
+
+    if (n <= NDP_ACL_LANES || depth >= ACL_MAX_DEPTH ||
+        best_split(b, list, n, lo, hi, &dim, &split) >= n)
+        return make_leaf(b, at, list, n);
+
+    int64_t child = node_alloc(b, 2);
+    uint32_t *sub = malloc(sizeof(*sub) * n);
+    uint32_t nsub = 0, save;
+    int rc = -1;
+
+    if (child < 0 || !sub)
+        goto build_done;
+    b->nodes[at].value = split;
+    b->nodes[at].child = child;
+    b->nodes[at].dim = dim;
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (b->rules[list[i]].lo[dim] <= split)
+            sub[nsub++] = list[i];
+    }
+    save = hi[dim];
+    hi[dim] = split;
+    rc = build(b, child, sub, nsub, lo, hi, depth + 1);
+    hi[dim] = save;
+    if (rc != 0)
+        goto build_done;
+
+    nsub = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (b->rules[list[i]].hi[dim] > split)
+            sub[nsub++] = list[i];
+    }
+    save = lo[dim];
+    lo[dim] = split + 1;
+    rc = build(b, child + 1, sub, nsub, lo, hi, depth + 1);
+    lo[dim] = save;
+
+build_done:
+    free(sub);
+    return rc;
+}
+
+static struct ndp_acl_tbl *tbl_copy(const struct acl_build *b, uint32_t num_rules, int node)
+{
+    size_t head = align_up(sizeof(struct ndp_acl_tbl), NDP_CACHE_LINE);
+    size_t leaves = sizeof(*b->leaves) * b->num_leaves;
+    size_t size = head + leaves + sizeof(*b->nodes) * b->num_nodes;
+    uint8_t *map = ndp_mempool_map_huge(size, node);
+    struct ndp_acl_tbl *t = (struct ndp_acl_tbl *)map;
+
+    if (!map)
+        return NULL;
+    memcpy(map + head, b->leaves, leaves);
+    memcpy(map + head + leaves, b->nodes, sizeof(*b->nodes) * b->num_nodes);
+    t->leaves = (const struct ndp_acl_leaf *)(map + head);
+    t->nodes = (const struct ndp_acl_node *)(map + head + leaves);
+    t->num_leaves = b->num_leaves;
+    t->num_nodes = b->num_nodes;
+    t->num_rules = num_rules;
+    t->map_size = size;
+    t->node = node;
+    return t;
+}
+
+int ndp_acl_commit(struct ndp_acl *acl)
+{
+    struct acl_build b = { 0 };
+    struct acl_box *boxes = NULL;
+    struct ndp_acl_tbl *fresh[NDP_ACL_MAX_NODES] = { NULL }, *old[NDP_ACL_MAX_NODES];
+    uint32_t *list = NULL, n = 0;
+    uint32_t lo[NDP_ACL_DIMS] = { 0 };
+    uint32_t hi[NDP_ACL_DIMS] = { UINT32_MAX, UINT32_MAX, 0xffff, 0xffff, 0xff };
+    int rc = -1;
+
+    pthread_mutex_lock(&acl->lock);
+
+    boxes = malloc(sizeof(*boxes) * (acl->num_slots + 1));
+    list = malloc(sizeof(*list) * (acl->num_slots + 1));
+    b.lo = malloc(sizeof(*b.lo) * (acl->num_slots + 1));
+    b.hi = malloc(sizeof(*b.hi) * (acl->num_slots + 1));
+    if (!boxes || !list || !b.lo || !b.hi)
+        goto commit_free;
+
+    for (uint32_t i = 0; i < acl->num_slots; i++) {
+        if (acl->live[i])
+            rule_to_box(&acl->rules[i], i, &boxes[n++]);
+    }
+    qsort(boxes, n, sizeof(*boxes), box_cmp);
+    for (uint32_t i = 0; i < n; i++)
+        list[i] = i;
+    b.rules = boxes;
+
+    if (node_alloc(&b, 1) < 0 || build(&b, 0, list, n, lo, hi, 0) != 0)
+        goto commit_free;
+
+    for (int i = 0; i < acl->num_nodes; i++) {
+        if (!(fresh[i] = tbl_copy(&b, n, acl->nodes[i])))
+            goto commit_free;
+    }
+
+    for (int i = 0; i < acl->num_nodes; i++) {
+        old[i] = acl->active[i];
+        acl->active[i] = fresh[i];
+        fresh[i] = NULL;
+    }
+    for (int node = 0; node < NDP_ACL_MAX_NODES; node++)
+        __atomic_store_n(&acl->tbl_of[node], acl->active[acl->replica_of[node]],
+                         __ATOMIC_RELEASE);
+
+    // no domain: the caller guarantees no lookup is running
+    if (acl->qsbr)
+        ndp_qsbr_synchronize(acl->qsbr);
+    for (int i = 0; i < acl->num_nodes; i++) {
+        if (old[i])
+            ndp_mempool_unmap(old[i], old[i]->map_size);
+    }
+    rc = 0;
+
+commit_free:
+    for (int i = 0; i < acl->num_nodes; i++) {
+        if (fresh[i])
+            ndp_mempool_unmap(fresh[i], fresh[i]->map_size);
+    }
+    pthread_mutex_unlock(&acl->lock);
+    free(boxes);
+    free(list);
+    free(b.lo);
+    free(b.hi);
+    free(b.nodes);
+    free(b.leaves);
+    return rc;
+}
@@ -0,0 +1,471 @@
+/*******************************************************************************
+ * @file               async.c
+ * @brief              Per-node executors and completion based async operations.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Control-plane services written against coroutines need
+ *                     to suspend rather than block: on an empty pool, on a
+ *                     large copy, on file I/O.  Every operation here takes a
+ *                     completion callback and a context pointer, which is all
+ *                     a C++20 awaiter needs to suspend a coroutine and resume
+ *                     it later.
+ *
+ *                     Completions run on a per-node executor: one thread bound
+ *                     to the node's CPUs that owns an io_uring.  Resuming work
+ *                     on the executor of the node that owns the data keeps the
+ *                     continuation next to its memory without parking a thread
+ *                     per request.  Operation records are taken from an object
+ *                     pool on the executor's node, so posting never mallocs.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "async.h"
+
+#include <sys/eventfd.h>
+
+
+static struct ndp_async_op *op_get(struct ndp_executor *ex)
+{
+    struct ndp_async_op *op = ndp_objpool_get(ex->ops);
+    if (!op)
+        return NULL;
+
+    memset(op, 0, sizeof(*op));
+    op->owner = ex->ops;
+    return op;
+}
+
+static inline void op_put(struct ndp_async_op *op)
+{
+    ndp_objpool_put(op->owner, op);
+}
+
+/* complete an op whose executor is stopping, on the calling thread */
+static void op_cancel(struct ndp_async_op *op)
+{
+    op->cb(op->ctx, -ECANCELED);
+    op_put(op);
+}
+
+/**
+ *  queue an op on an executor and kick its eventfd if the executor has not
+ *  been signalled since it last drained the queue.  Fails once STOP has
+ *  been queued: the thread may already be past its last drain, and an op
+ *  behind STOP would never run.
+ */
+static int exec_push(struct ndp_executor *ex, struct ndp_async_op *op)
+{
+    bool kick;
+
+    op->next = NULL;
+    pthread_mutex_lock(&ex->lock);
+    if (ex->stopping) {
+        pthread_mutex_unlock(&ex->lock);
+        return -1;
+    }
+    if (op->kind == NDP_ASYNC_STOP)
+        ex->stopping = true;
+    if (ex->tail)
+        ex->tail->next = op;
+    else
+        ex->head = op;
+    ex->tail = op;
+    kick = !ex->signalled;
+    ex->signalled = true;
+    pthread_mutex_unlock(&ex->lock);
+
+    if (kick) {
+        uint64_t one = 1;
+        if (write(ex->efd, &one, sizeof(one)) != sizeof(one))
+            perror("executor eventfd write");
+    }
+    return 0;
+}
+
+static struct io_uring_sqe *exec_sqe(struct ndp_executor *ex)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&ex->ring);
+    if (!sqe) {
+        io_uring_submit(&ex->ring);
+        sqe = io_uring_get_sqe(&ex->ring);
+    }
+    return sqe;
+}
+
+static void exec_arm_eventfd(struct ndp_executor *ex)
+{
+    struct io_uring_sqe *sqe = exec_sqe(ex);
+    if (!sqe) {
+        fprintf(stderr, "executor %d: no sqe to re-arm eventfd\n", ex->node);
+        return;
+    }
+    io_uring_prep_read(sqe, ex->efd, &ex->efd_buf, sizeof(ex->efd_buf), 0);
+    io_uring_sqe_set_data(sqe, NULL);
+}
+
+static void exec_run(struct ndp_executor *ex, struct ndp_async_op *op)
+{
+    struct io_uring_sqe *sqe;
+
+    switch (op->kind) {
+    case NDP_ASYNC_CALL:
+        op->cb(op->ctx, op->res);
+        op_put(op);
+        break;
+
+    case NDP_ASYNC_COPY:
+        memcpy(op->dst, op->src, op->len);
+        op->kind = NDP_ASYNC_CALL;
+        op->res = (intptr_t)op->len;
+        if (op->done == ex) {
+            op->cb(op->ctx, op->res);
+            op_put(op);
+        } else if (exec_push(op->done, op) != 0) {
+            op_cancel(op);
+        }
+        break;
+
+    case NDP_ASYNC_READ:
+    case NDP_ASYNC_WRITE:
+        if (!(sqe = exec_sqe(ex))) {
+            op->cb(op->ctx, -EBUSY);
+            op_put(op);
+            break;
+        }
+        if (op->kind == NDP_ASYNC_READ)
+            io_uring_prep_read(sqe, op->fd, op->dst, op->len, op->off);
+        else
+            io_uring_prep_write(sqe, op->fd, op->src, op->len, op->off);
+        io_uring_sqe_set_data(sqe, op);
+        ex->inflight++;
+        break;
+
+    case NDP_ASYNC_STOP:
+        ex->running = false;
+        op_put(op);
+        break;
+    }
+}
+
+static void exec_drain(struct ndp_executor *ex)
+{
+    struct ndp_async_op *op, *next;
+
+    pthread_mutex_lock(&ex->lock);
+    op = ex->head;
+    ex->head = ex->tail = NULL;
+    ex->signalled = false;
+    pthread_mutex_unlock(&ex->lock);
+
+    for (; op; op = next) {
+        next = op->next;
+        exec_run(ex, op);
+    }
+}
+
+static void *ndp_executor_thread(void *args)
+{
+    struct ndp_executor *ex = args;
+    struct io_uring_cqe *cqe;
+
+    if (ndp_bind_thread_to_node(ex->node) < 0)
+        goto executor_fail;
+
+    // the ring is created after binding so the kernel places the
+    // submission and completion queues on this node as well
+    if (io_uring_queue_init(ex->depth, &ex->ring, 0) < 0)
+        goto executor_fail;
+
+    ex->running = true;
+    exec_arm_eventfd(ex);
+    ex->status = 0;
+    sem_post(&ex->ready);
+
+    while (ex->running || ex->inflight) {
+        io_uring_submit_and_wait(&ex->ring, 1);
+
+        while (io_uring_peek_cqe(&ex->ring, &cqe) == 0) {
+            struct ndp_async_op *op = io_uring_cqe_get_data(cqe);
+            int res = cqe->res;
+            io_uring_cqe_seen(&ex->ring, cqe);
+
+            if (!op) {
+                exec_drain(ex);
+                exec_arm_eventfd(ex);
+                continue;
+            }
+            ex->inflight--;
+            op->cb(op->ctx, res);
+            op_put(op);
+        }
+    }
+
+    io_uring_queue_exit(&ex->ring);
+    return NULL;
+
+executor_fail:
+    ex->status = -1;
+    sem_post(&ex->ready);
+    return NULL;
+}
+
+static struct ndp_executor *executor_start(struct mempool_sys *mem, int node,
+                                           unsigned int depth)
+{
+    struct ndp_executor *ex = ndp_mempool_alloc(mem, node, sizeof(*ex), NDP_CACHE_LINE);
+    if (!ex)
+        return NULL;
+
+    memset(ex, 0, sizeof(*ex));
+    ex->node = node;
+    ex->depth = depth;
+    ex->status = -1;
+    ex->ops = ndp_objpool_create(mem, node, sizeof(struct ndp_async_op), depth);
+    if (!ex->ops)
+        return NULL;
+
+    if ((ex->efd = eventfd(0, EFD_CLOEXEC)) < 0)
+        return NULL;
+
+    pthread_mutex_init(&ex->lock, NULL);
+    sem_init(&ex->ready, 0, 0);
+
+    if (pthread_create(&ex->thread, NULL, ndp_executor_thread, ex) != 0)
+        goto start_fail;
+
+    sem_wait(&ex->ready);
+    if (ex->status != 0) {
+        pthread_join(ex->thread, NULL);
+        goto start_fail;
+    }
+    return ex;
+
+start_fail:
+    close(ex->efd);
+    sem_destroy(&ex->ready);
+    pthread_mutex_destroy(&ex->lock);
+    return NULL;
+}
+
+static void executor_stop(struct ndp_executor *ex)
+{
+    struct ndp_async_op *op;
+
+    // the STOP record may have to wait for a free slot if the executor is
+    // saturated; spinning here is fine, teardown is not a hot path
+    while (!(op = op_get(ex)))
+        sched_yield();
+
+    op->kind = NDP_ASYNC_STOP;
+    if (exec_push(ex, op) != 0) {
+        op_put(op);
+        return;
+    }
+    pthread_join(ex->thread, NULL);
+
+    close(ex->efd);
+    sem_destroy(&ex->ready);
+    pthread_mutex_destroy(&ex->lock);
+}
+
+int ndp_executor_sys_init(struct ndp_executor_sys *es, struct mempool_sys *mem,
+                          unsigned int depth)
+{
+    es->mem = mem;
+    es->num_nodes = mem->num_nodes;
+    es->execs = calloc(es->num_nodes, sizeof(*es->execs));
+    if (!es->execs)
+        return -1;
+
+    for (int node = 0; node < es->num_nodes; node++) {
+        if (!mem->pools[node].base)
+            continue;
+        if (!(es->execs[node] = executor_start(mem, node, depth))) {
+            fprintf(stderr, "executor for node %d failed to start\n", node);
+            ndp_executor_sys_destroy(es);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void ndp_executor_sys_destroy(struct ndp_executor_sys *es)
+{
+    if (!es->execs)
+        return;
+
+    for (int node = 0; node < es->num_nodes; node++) {
+        if (es->execs[node])
+            executor_stop(es->execs[node]);
+    }
+    free(es->execs);
+    es->execs = NULL;
+    es->num_nodes = 0;
+}
+
+struct ndp_executor *ndp_executor_of_node(struct ndp_executor_sys *es, int node)
+{
+    if (node < 0 || node >= es->num_nodes)
+        return NULL;
+    return es->execs[node];
+}
+
+struct ndp_executor *ndp_executor_of_addr(struct ndp_executor_sys *es, const void *addr)
+{
+    int node = ndp_mempool_node_of(es->mem, addr);
+
+    if (node < 0 && get_mempolicy(&node, NULL, 0, (void *)addr,
+                                  MPOL_F_NODE | MPOL_F_ADDR) != 0)
+        node = numa_node_of_cpu(sched_getcpu());
+
+    struct ndp_executor *ex = ndp_executor_of_node(es, node);
+    return ex ? ex : ndp_executor_of_node(es, 0);
+}
+
+int ndp_async_post(struct ndp_executor *ex, ndp_async_cb cb, void *ctx, intptr_t res)
+{
+    struct ndp_async_op *op = op_get(ex);
+    if (!op)
+        return -1;
+
+    op->kind = NDP_ASYNC_CALL;
+    op->cb = cb;
+    op->ctx = ctx;
+    op->res = res;
+    if (exec_push(ex, op) != 0) {
+        op_put(op);
+        return -1;
+    }
+    return 0;
+}
+
+int ndp_async_copy(struct ndp_executor_sys *es, void *dst, const void *src, size_t len,
+                   struct ndp_executor *done, ndp_async_cb cb, void *ctx)
+{
+    struct ndp_executor *ex = ndp_executor_of_addr(es, dst);
+    if (!ex)
+        return -1;
+
+    struct ndp_async_op *op = op_get(ex);
+    if (!op)
+        return -1;
+
+    op->kind = NDP_ASYNC_COPY;
+    op->dst = dst;
+    op->src = src;
+    op->len = len;
+    op->done = done ? done : ex;
+    op->cb = cb;
+    op->ctx = ctx;
+    if (exec_push(ex, op) != 0) {
+        op_put(op);
+        return -1;
+    }
+    return 0;
+}
+
+static int async_rw(struct ndp_executor *ex, enum ndp_async_kind kind, int fd,
+                    void *dst, const void *src, size_t len, off_t off,
+                    ndp_async_cb cb, void *ctx)
+{
+    struct ndp_async_op *op = op_get(ex);
+    if (!op)
+        return -1;
+
+    op->kind = kind;
+    op->fd = fd;
+    op->dst = dst;
+    op->src = src;
+    op->len = len;
+    op->off = off;
+    op->cb = cb;
+    op->ctx = ctx;
+    if (exec_push(ex, op) != 0) {
+        op_put(op);
+        return -1;
+    }
+    return 0;
+}
+
+int ndp_async_read(struct ndp_executor *ex, int fd, void *buf, size_t len, off_t off,
+                   ndp_async_cb cb, void *ctx)
+{
+    return async_rw(ex, NDP_ASYNC_READ, fd, buf, NULL, len, off, cb, ctx);
+}
+
+int ndp_async_write(struct ndp_executor *ex, int fd, const void *buf, size_t len,
+                    off_t off, ndp_async_cb cb, void *ctx)
+{
+    return async_rw(ex, NDP_ASYNC_WRITE, fd, NULL, buf, len, off, cb, ctx);
+}
+
+int ndp_async_pool_init(struct ndp_async_pool *ap, struct ndp_objpool *pool)
+{
+    memset(ap, 0, sizeof(*ap));
+    ap->pool = pool;
+    return pthread_mutex_init(&ap->lock, NULL) == 0 ? 0 : -1;
+}
+
+void ndp_async_pool_destroy(struct ndp_async_pool *ap)
+{
+    pthread_mutex_destroy(&ap->lock);
+}
+
+int ndp_async_alloc(struct ndp_async_pool *ap, struct ndp_executor *ex, void **obj,
+                    ndp_async_cb cb, void *ctx)
+{
+    struct ndp_async_op *op;
+
+    // the pool and the waiter list are checked under the same lock as
+    // ndp_async_free() so an object cannot be returned between the failed
+    // get and the waiter being queued
+    pthread_mutex_lock(&ap->lock);
+    if ((*obj = ndp_objpool_get(ap->pool))) {
+        pthread_mutex_unlock(&ap->lock);
+        return 0;
+    }
+
+    if (!(op = op_get(ex))) {
+        pthread_mutex_unlock(&ap->lock);
+        return -1;
+    }
+    op->kind = NDP_ASYNC_CALL;
+    op->cb = cb;
+    op->ctx = ctx;
+    op->done = ex;
+
+    if (ap->tail)
+        ap->tail->next = op;
+    else
+        ap->head = op;
+    ap->tail = op;
+    ap->waits++;
+    pthread_mutex_unlock(&ap->lock);
+
+    return 1;
+}
+
+void ndp_async_free(struct ndp_async_pool *ap, void *obj)
+{
+    struct ndp_async_op *op;
+
+    pthread_mutex_lock(&ap->lock);
+    if (!(op = ap->head)) {
+        ndp_objpool_put(ap->pool, obj);
+        pthread_mutex_unlock(&ap->lock);
+        return;
+    }
+    if (!(ap->head = op->next))
+        ap->tail = NULL;
+    pthread_mutex_unlock(&ap->lock);
+
+    op->res = (intptr_t)obj;
+    if (exec_push(op->done, op) != 0) {
+        // the waiter's executor is going away: keep the object, cancel it
+        ndp_objpool_put(ap->pool, obj);
+        op_cancel(op);
+    }
+}
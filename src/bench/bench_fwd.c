@@ -0,0 +1,368 @@
+/*******************************************************************************
+ * @file               bench_fwd.c
+ * @brief              l2fwd/l3fwd forwarding benchmark harness.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Traffic workers (generator and sink of one queue each)
+ *                     face forwarder workers across a pair of ports:
+ *
+ *                         pktgen -> A.tx ==> B.rx -> fwd -> B.tx ==> A.rx -> sink
+ *
+ *                     where A and B are two connected loopback ports or the
+ *                     two ends of a veth pair driven through AF_PACKET.  For
+ *                     every worker count the harness runs N traffic and N
+ *                     forwarder workers, with the forwarders on the node of
+ *                     the traffic side (local) or on another node (remote),
+ *                     and reports offered and forwarded Mpps, forwarder
+ *                     cycles per packet and latency percentiles.
+ *
+ *                     usage: bench_fwd [-m l2|l3] [-b loopback|veth:IF_A,IF_B]
+ *                                      [-w 1,2,4] [-p local|remote] [-t secs]
+ *                                      [-r Mpps per generator] [-i]
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "fwd.h"
+#include "pktgen.h"
+#include "worker.h"
+
+#include <getopt.h>
+#include <net/if.h>
+
+#define BENCH_MAX_WORKERS       32
+#define BENCH_NUM_BUFS          32768
+#define BENCH_RING_SIZE         1024
+#define BENCH_WARMUP_US         200000
+
+struct bench
+{
+    struct mempool_sys sys;
+    struct ndp_topology topo;
+    struct ndp_qsbr qsbr;
+    struct ndp_lpm *lpm;
+    struct ndp_buf_pool *traffic_pool;
+    struct ndp_buf_pool *fwd_pool;
+    struct ndp_pktgen_profile prof;
+    struct ndp_idle_policy policy;
+
+    bool l3;
+    bool remote;
+    const char *if_a;           /* NULL for loopback */
+    const char *if_b;
+    double secs;
+    int traffic_node;
+    int fwd_node;
+    int fwd_pool_node;          /* if_b's device node, fwd_node when unknown */
+};
+
+struct bench_result
+{
+    double tx_mpps;
+    double rx_mpps;
+    double cycles_per_pkt;
+    uint64_t drops;
+    struct ndp_hist latency;
+};
+
+
+/* primary hardware threads of `node`, at most `max` */
+static int node_cpus(const struct ndp_topology *topo, int node, int *cpus, int max)
+{
+    int n = 0;
+
+    for (int i = 0; i < topo->num_cpus && n < max; i++) {
+        if (topo->cpus[i].node == node && topo->cpus[i].primary)
+            cpus[n++] = topo->cpus[i].cpu;
+    }
+    return n;
+}
+
+static int setup_lpm(struct bench *bb)
+{
+    int nodes[2] = { bb->traffic_node, bb->fwd_node };
+    uint32_t net = bb->prof.dst_ip & 0xffff0000;
+
+    bb->lpm = ndp_lpm_create(nodes, bb->fwd_node == bb->traffic_node ? 1 : 2, 4096, 256,
+                             &bb->qsbr);
+    if (!bb->lpm)
+        return -1;
+
+    // one covering /16 and host routes for every destination, so lookups
+    // go through both tbl24 and tbl8
+    if (ndp_lpm_add(bb->lpm, net, 16, 0))
+        return -1;
+    for (uint32_t i = 0; i < bb->prof.num_dsts; i++) {
+        if (ndp_lpm_add(bb->lpm, bb->prof.dst_ip + i, 32, 0))
+            return -1;
+    }
+    return ndp_lpm_commit(bb->lpm);
+}
+
+static struct ndp_port *bench_port(struct bench *bb, bool traffic_side, uint16_t nq)
+{
+    if (bb->if_a)
+        return ndp_port_afpacket_create(&bb->sys, traffic_side ? bb->traffic_pool : bb->fwd_pool,
+                                        traffic_side ? bb->if_a : bb->if_b, nq);
+    return ndp_port_loopback_create(&bb->sys, traffic_side ? bb->traffic_node : bb->fwd_node,
+                                    traffic_side ? "A" : "B", nq, BENCH_RING_SIZE);
+}
+
+static void *bench_forwarder(struct bench *bb, struct ndp_port *b, uint16_t q)
+{
+    struct ndp_l3fwd *l3;
+
+    if (!bb->l3)
+        return ndp_l2fwd_create(&bb->sys, bb->fwd_node, b, q, b, q);
+    if (!(l3 = ndp_l3fwd_create(&bb->sys, bb->fwd_node, bb->lpm, b, q)))
+        return NULL;
+    // back towards the generator: its source MAC is the next hop
+    if (ndp_l3fwd_add_hop(l3, b, q, bb->prof.src_mac, bb->prof.dst_mac) < 0)
+        return NULL;
+    return l3;
+}
+
+static int run(struct bench *bb, int nw, struct bench_result *res)
+{
+    int traffic_cpus[BENCH_MAX_WORKERS * 2], fwd_cpus[BENCH_MAX_WORKERS * 2];
+    struct ndp_worker *traffic_w[BENCH_MAX_WORKERS], *fwd_w[BENCH_MAX_WORKERS];
+    struct ndp_pktgen *gen[BENCH_MAX_WORKERS];
+    struct ndp_sink *sink[BENCH_MAX_WORKERS];
+    uint64_t sent0 = 0, sent1 = 0, rx = 0, busy0 = 0, busy1 = 0, work0 = 0, work1 = 0;
+    struct ndp_port_queue_stats st;
+    struct ndp_port *a, *b;
+    int ntc, nfc, started = 0;
+    uint64_t t0, t1;
+
+    ntc = node_cpus(&bb->topo, bb->traffic_node, traffic_cpus, BENCH_MAX_WORKERS * 2);
+    nfc = node_cpus(&bb->topo, bb->fwd_node, fwd_cpus, BENCH_MAX_WORKERS * 2);
+    if (!ntc || !nfc)
+        return -1;
+
+    if (!(a = bench_port(bb, true, nw)) || !(b = bench_port(bb, false, nw)))
+        return -1;
+    if (!bb->if_a && ndp_port_loopback_connect(a, b))
+        return -1;
+
+    // traffic workers take the first cpus of their node, local forwarders
+    // the ones after; cpus are shared only when the node runs out
+    for (int i = 0; i < nw; i++) {
+        int tcpu = traffic_cpus[i % ntc];
+        int fcpu = bb->remote ? fwd_cpus[i % nfc] : fwd_cpus[(nw + i) % nfc];
+        void *fwd;
+
+        gen[i] = ndp_pktgen_create(&bb->sys, bb->traffic_pool, a, i, &bb->prof);
+        sink[i] = ndp_sink_create(&bb->sys, a, i);
+        fwd = bench_forwarder(bb, b, i);
+        traffic_w[i] = ndp_worker_create(&bb->sys, i, tcpu, &bb->policy);
+        fwd_w[i] = ndp_worker_create(&bb->sys, nw + i, fcpu, &bb->policy);
+        if (!gen[i] || !sink[i] || !fwd || !traffic_w[i] || !fwd_w[i])
+            goto fail;
+
+        if (ndp_worker_add_poll(traffic_w[i], ndp_pktgen_poll, gen[i]) ||
+            ndp_worker_add_poll(traffic_w[i], ndp_sink_poll, sink[i]) ||
+            ndp_worker_add_poll(fwd_w[i], bb->l3 ? ndp_l3fwd_poll : ndp_l2fwd_poll, fwd) ||
+            (bb->l3 && ndp_worker_set_qsbr(fwd_w[i], &bb->qsbr)))
+            goto fail;
+    }
+
+    for (started = 0; started < nw; started++) {
+        if (ndp_worker_start(fwd_w[started]))
+            goto fail;
+        if (ndp_worker_start(traffic_w[started])) {
+            ndp_worker_stop(fwd_w[started]);
+            goto fail;
+        }
+    }
+
+    usleep(BENCH_WARMUP_US);
+    for (int i = 0; i < nw; i++) {
+        ndp_sink_reset(sink[i]);
+        sent0 += __atomic_load_n(&gen[i]->sent, __ATOMIC_RELAXED);
+        busy0 += __atomic_load_n(&fwd_w[i]->stats.busy_cycles, __ATOMIC_RELAXED);
+        work0 += __atomic_load_n(&fwd_w[i]->stats.work, __ATOMIC_RELAXED);
+    }
+    t0 = ndp_rdtsc();
+    usleep((useconds_t)(bb->secs * 1e6));
+    t1 = ndp_rdtsc();
+    for (int i = 0; i < nw; i++) {
+        sent1 += __atomic_load_n(&gen[i]->sent, __ATOMIC_RELAXED);
+        rx += __atomic_load_n(&sink[i]->packets, __ATOMIC_RELAXED);
+        busy1 += __atomic_load_n(&fwd_w[i]->stats.busy_cycles, __ATOMIC_RELAXED);
+        work1 += __atomic_load_n(&fwd_w[i]->stats.work, __ATOMIC_RELAXED);
+    }
+
+    for (int i = 0; i < nw; i++) {
+        ndp_worker_stop(traffic_w[i]);
+        ndp_worker_stop(fwd_w[i]);
+    }
+
+    ndp_hist_reset(&res->latency);
+    for (int i = 0; i < nw; i++)
+        ndp_hist_merge(&res->latency, &sink[i]->latency);
+    ndp_port_stats(b, &st);
+    res->drops = st.oerrors + st.ierrors;
+    res->tx_mpps = (double)(sent1 - sent0) * (double)ndp_tsc_hz() / (double)(t1 - t0) / 1e6;
+    res->rx_mpps = (double)rx * (double)ndp_tsc_hz() / (double)(t1 - t0) / 1e6;
+    res->cycles_per_pkt = work1 > work0 ? (double)(busy1 - busy0) / (double)(work1 - work0) : 0;
+
+    ndp_port_close(a);
+    ndp_port_close(b);
+    return 0;
+
+fail:
+    fprintf(stderr, "bench_fwd: setup of %d workers failed\n", nw);
+    for (int i = 0; i < started; i++) {
+        ndp_worker_stop(traffic_w[i]);
+        ndp_worker_stop(fwd_w[i]);
+    }
+    ndp_port_close(a);
+    ndp_port_close(b);
+    return -1;
+}
+
+static int pick_nodes(struct bench *bb)
+{
+    int cpus[1];
+
+    // the traffic side sits next to the device its frames come in on
+    bb->traffic_node = bb->topo.cpus[0].node;
+    if (bb->if_a)
+        bb->traffic_node = ndp_dev_node(bb->if_a, bb->traffic_node);
+    bb->fwd_node = bb->traffic_node;
+    if (bb->remote) {
+        for (int n = 0; n < numa_num_configured_nodes(); n++) {
+            if (n != bb->traffic_node && node_cpus(&bb->topo, n, cpus, 1)) {
+                bb->fwd_node = n;
+                break;
+            }
+        }
+        if (bb->fwd_node == bb->traffic_node) {
+            fprintf(stderr, "bench_fwd: single node, remote placement runs local\n");
+            bb->remote = false;
+        }
+    }
+
+    // and the buffers B receives into next to B's device
+    bb->fwd_pool_node = bb->fwd_node;
+    if (bb->if_b)
+        bb->fwd_pool_node = ndp_dev_node(bb->if_b, bb->fwd_node);
+    return 0;
+}
+
+static int parse_args(struct bench *bb, int argc, char **argv, int *counts, int *num_counts)
+{
+    static char ifs[2 * IF_NAMESIZE];
+    char *list = NULL, *tok, *save;
+    double rate = 0;
+    bool imix = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:b:w:p:t:r:i")) != -1) {
+        switch (opt) {
+        case 'm':
+            bb->l3 = !strcmp(optarg, "l3");
+            break;
+        case 'b':
+            if (!strncmp(optarg, "veth:", 5)) {
+                snprintf(ifs, sizeof(ifs), "%s", optarg + 5);
+                if (!(tok = strchr(ifs, ',')))
+                    return -1;
+                *tok = '\0';
+                bb->if_a = ifs;
+                bb->if_b = tok + 1;
+            } else if (strcmp(optarg, "loopback")) {
+                return -1;
+            }
+            break;
+        case 'w':
+            list = optarg;
+            break;
+        case 'p':
+            bb->remote = !strcmp(optarg, "remote");
+            break;
+        case 't':
+            bb->secs = strtod(optarg, NULL);
+            break;
+        case 'r':
+            rate = strtod(optarg, NULL);
+            break;
+        case 'i':
+            imix = true;
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    *num_counts = 0;
+    for (tok = strtok_r(list, ",", &save); tok && *num_counts < BENCH_MAX_WORKERS;
+         tok = strtok_r(NULL, ",", &save)) {
+        int n = atoi(tok);
+        if (n < 1 || n > BENCH_MAX_WORKERS)
+            return -1;
+        counts[(*num_counts)++] = n;
+    }
+    if (!*num_counts)
+        counts[(*num_counts)++] = 1;
+
+    ndp_pktgen_profile_default(&bb->prof);
+    if (imix)
+        ndp_pktgen_profile_imix(&bb->prof);
+    bb->prof.num_flows = 1024;
+    bb->prof.num_dsts = 256;
+    bb->prof.rate_pps = (uint64_t)(rate * 1e6);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static struct bench bb = { .secs = 1.0 };
+    static struct bench_result res;
+    int counts[BENCH_MAX_WORKERS], num_counts;
+
+    if (parse_args(&bb, argc, argv, counts, &num_counts)) {
+        fprintf(stderr, "usage: %s [-m l2|l3] [-b loopback|veth:IF_A,IF_B] [-w 1,2,4] "
+                        "[-p local|remote] [-t secs] [-r Mpps] [-i]\n", argv[0]);
+        return 1;
+    }
+    if (ndp_mempool_init(&bb.sys) || ndp_topology_init(&bb.topo) || pick_nodes(&bb)) {
+        fprintf(stderr, "bench_fwd: init failed\n");
+        return 1;
+    }
+
+    ndp_qsbr_init(&bb.qsbr);
+    ndp_idle_policy_default(&bb.policy);
+    bb.policy.never_sleep = true;
+    bb.policy.use_umwait = false;
+
+    bb.traffic_pool = ndp_buf_pool_create(&bb.sys, bb.traffic_node, 2048, BENCH_NUM_BUFS);
+    bb.fwd_pool = bb.if_a ? ndp_buf_pool_create(&bb.sys, bb.fwd_pool_node, 2048,
+                                                BENCH_NUM_BUFS)
+                          : bb.traffic_pool;
+    if (!bb.traffic_pool || !bb.fwd_pool || (bb.l3 && setup_lpm(&bb))) {
+        fprintf(stderr, "bench_fwd: setup failed\n");
+        return 1;
+    }
+
+    printf("%s over %s%s%s, traffic node %d, forwarders node %d, %s frames, %.1fs per run\n",
+           bb.l3 ? "l3fwd" : "l2fwd", bb.if_a ? bb.if_a : "loopback", bb.if_a ? "<->" : "",
+           bb.if_a ? bb.if_b : "", bb.traffic_node, bb.fwd_node,
+           bb.prof.num_sizes > 1 ? "imix" : "64B", bb.secs);
+    printf("%8s %10s %10s %10s %10s %10s %10s %10s\n", "workers", "tx Mpps", "fwd Mpps",
+           "cyc/pkt", "p50 ns", "p99 ns", "p99.9 ns", "drops");
+
+    for (int c = 0; c < num_counts; c++) {
+        if (run(&bb, counts[c], &res))
+            return 1;
+        printf("%8d %10.2f %10.2f %10.1f %10lu %10lu %10lu %10lu\n", counts[c], res.tx_mpps,
+               res.rx_mpps, res.cycles_per_pkt, ndp_hist_percentile(&res.latency, 50.0),
+               ndp_hist_percentile(&res.latency, 99.0), ndp_hist_percentile(&res.latency, 99.9),
+               res.drops);
+    }
+
+    ndp_topology_destroy(&bb.topo);
+    return 0;
+}
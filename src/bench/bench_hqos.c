@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * @file               bench_hqos.c
+ * @brief              Weighted round-robin and tc credit check of the scheduler.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Keeps the four queues of one traffic class backlogged
+ *                     with equal-sized packets, shaped only by the port, and
+ *                     compares the bytes each queue got with its share of
+ *                     the weights; a set of weights that is off by more than
+ *                     1% fails.  Then checks that a class whose rate is far
+ *                     below one frame per tc period still sends.
+ *
+ *                     usage: bench_hqos [packets per weight set]
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "hqos.h"
+
+#define BENCH_NUM_BUFS          8192
+#define BENCH_PKT_LEN           476     /* 500 bytes on the wire */
+#define BENCH_BACKLOG           256     /* per queue */
+#define BENCH_TC                3
+#define BENCH_MAX_ERROR         0.01
+
+static const uint8_t weight_sets[][NDP_HQOS_TC_QUEUES] = {
+    { 1, 2, 4, 8 },
+    { 64, 100, 64, 100 },
+    { 200, 255, 128, 129 },
+    { 1, 255, 17, 3 },
+};
+
+
+/* top every queue of the class up to BENCH_BACKLOG packets */
+static int fill(struct ndp_hqos *h, struct ndp_buf_pool *pool, uint32_t *backlog)
+{
+    for (uint32_t q = 0; q < NDP_HQOS_TC_QUEUES; q++) {
+        while (backlog[q] < BENCH_BACKLOG) {
+            struct ndp_buf *b = ndp_buf_alloc(pool);
+
+            if (!b)
+                return -1;
+            ndp_buf_append(b, BENCH_PKT_LEN);
+            ndp_hqos_classify(h, b, 0, 0, BENCH_TC, q);
+            if (ndp_hqos_enqueue(h, &b, 1) != 1)
+                return -1;
+            backlog[q]++;
+        }
+    }
+    return 0;
+}
+
+static struct ndp_hqos *sched_create(struct mempool_sys *sys, int node,
+                                     const struct ndp_hqos_pipe_params *pp)
+{
+    struct ndp_hqos_params hp = { .rate = 12500000000ULL, .num_subports = 1,
+                                  .pipes_per_subport = 1, .queue_size = 1024 };
+    struct ndp_hqos *h = ndp_hqos_create(sys, node, &hp);
+
+    if (!h || ndp_hqos_pipe_profile_add(h, pp) != 0 || ndp_hqos_pipe_config(h, 0, 0, 0))
+        return NULL;
+    return h;
+}
+
+static int check_wrr(struct mempool_sys *sys, int node, struct ndp_buf_pool *pool,
+                     const uint8_t *w, unsigned long packets)
+{
+    struct ndp_hqos_pipe_params pp = { .rate = 12500000000ULL, .burst = 64 * 1024,
+                                       .tc_period_us = 10000 };
+    uint64_t bytes[NDP_HQOS_TC_QUEUES] = { 0 }, total = 0;
+    uint32_t backlog[NDP_HQOS_TC_QUEUES] = { 0 };
+    struct ndp_buf *out[NDP_HQOS_HOLD];
+    unsigned int wsum = 0;
+    unsigned long sent = 0;
+    int ret = 0;
+
+    for (int q = 0; q < NDP_HQOS_TC_QUEUES; q++) {
+        pp.wrr_weights[BENCH_TC * NDP_HQOS_TC_QUEUES + q] = w[q];
+        wsum += w[q];
+    }
+    struct ndp_hqos *h = sched_create(sys, node, &pp);
+    if (!h)
+        return -1;
+
+    while (sent < packets) {
+        uint16_t n;
+
+        if (fill(h, pool, backlog)) {
+            ndp_hqos_destroy(h);
+            return -1;
+        }
+        n = ndp_hqos_dequeue(h, out, NDP_HQOS_HOLD);
+        for (uint16_t i = 0; i < n; i++) {
+            uint32_t q = out[i]->udata % NDP_HQOS_TC_QUEUES;
+            bytes[q] += out[i]->pkt_len;
+            backlog[q]--;
+        }
+        ndp_buf_free_bulk(out, n);
+        sent += n;
+    }
+
+    for (int q = 0; q < NDP_HQOS_TC_QUEUES; q++)
+        total += bytes[q];
+    printf("  weights %3u %3u %3u %3u   share", w[0], w[1], w[2], w[3]);
+    for (int q = 0; q < NDP_HQOS_TC_QUEUES; q++) {
+        double want = (double)w[q] / wsum, got = (double)bytes[q] / total;
+
+        printf(" %6.2f%% (%6.2f%%)", 100 * got, 100 * want);
+        if (got / want - 1 > BENCH_MAX_ERROR || 1 - got / want > BENCH_MAX_ERROR)
+            ret = -1;
+    }
+    printf("%s\n", ret ? "  FAIL" : "");
+    ndp_hqos_destroy(h);
+    return ret;
+}
+
+/* a class allowed 10 bytes per 10ms period must still pass a frame per period */
+static int check_low_rate(struct mempool_sys *sys, int node, struct ndp_buf_pool *pool)
+{
+    struct ndp_hqos_pipe_params pp = { .rate = 12500000000ULL, .burst = 64 * 1024,
+                                       .tc_period_us = 10000 };
+    uint32_t backlog[NDP_HQOS_TC_QUEUES] = { 0 };
+    struct ndp_buf *out[NDP_HQOS_HOLD];
+    uint64_t end = ndp_rdtsc() + ndp_tsc_hz() / 20;
+    unsigned long sent = 0;
+
+    pp.tc_rate[BENCH_TC] = 1000;
+    struct ndp_hqos *h = sched_create(sys, node, &pp);
+    if (!h || fill(h, pool, backlog))
+        return -1;
+
+    while (ndp_rdtsc() < end) {
+        uint16_t n = ndp_hqos_dequeue(h, out, NDP_HQOS_HOLD);
+        ndp_buf_free_bulk(out, n);
+        sent += n;
+    }
+    printf("  tc rate 1000 B/s, 10ms period: %lu packets in 50ms\n", sent);
+    ndp_hqos_destroy(h);
+    return sent >= 2 ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long packets = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+    struct mempool_sys sys;
+    int node = numa_node_of_cpu(sched_getcpu());
+    int ret = 0;
+
+    if (node < 0)
+        node = 0;
+    if (ndp_mempool_init(&sys)) {
+        fprintf(stderr, "bench_hqos: init failed\n");
+        return 1;
+    }
+    struct ndp_buf_pool *pool = ndp_buf_pool_create(&sys, node, 2048, BENCH_NUM_BUFS);
+    if (!pool || !packets) {
+        fprintf(stderr, "bench_hqos: setup failed\n");
+        return 1;
+    }
+
+    printf("wrr, %d byte packets (expected share)\n", BENCH_PKT_LEN + NDP_HQOS_FRAME_OVERHEAD);
+    for (size_t i = 0; i < sizeof(weight_sets) / sizeof(weight_sets[0]); i++) {
+        if (check_wrr(&sys, node, pool, weight_sets[i], packets))
+            ret = 1;
+    }
+    printf("tc credits\n");
+    if (check_low_rate(&sys, node, pool)) {
+        fprintf(stderr, "bench_hqos: low rate class starved\n");
+        ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,141 @@
+/*******************************************************************************
+ * @file               bench_loopback.c
+ * @brief              Generator to sink rate sweep over a loopback port.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Runs the traffic generator and the sink on two workers
+ *                     of the first node, joined by a loopback port, and steps
+ *                     the offered rate up to line rate of the loopback.  For
+ *                     each step it prints the achieved Mpps and the one-way
+ *                     latency percentiles, i.e. the baseline cost of the
+ *                     port and buffer layers that a forwarding stage adds to.
+ *
+ *                     usage: bench_loopback [imix] [seconds per step]
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "pktgen.h"
+#include "worker.h"
+
+#define BENCH_NUM_BUFS          16384
+#define BENCH_RING_SIZE         4096
+
+static const double rates_mpps[] = { 0.1, 0.5, 1, 2, 4, 8, 0 };     /* 0: unpaced */
+
+
+static int pick_cpus(const struct ndp_topology *topo, int *gen_cpu, int *sink_cpu)
+{
+    *gen_cpu = *sink_cpu = -1;
+    for (int i = 0; i < topo->num_cpus; i++) {
+        const struct ndp_cpu *c = &topo->cpus[i];
+        if (c->node != topo->cpus[0].node || !c->primary)
+            continue;
+        if (*gen_cpu < 0)
+            *gen_cpu = c->cpu;
+        else if (*sink_cpu < 0)
+            *sink_cpu = c->cpu;
+    }
+    if (*gen_cpu < 0)
+        return -1;
+    // a single cpu still runs, generator and sink then share one worker
+    if (*sink_cpu < 0)
+        *sink_cpu = *gen_cpu;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct mempool_sys sys;
+    struct ndp_topology topo;
+    struct ndp_idle_policy policy;
+    struct ndp_pktgen_profile prof;
+    struct ndp_worker *gen_w, *sink_w;
+    bool imix = argc > 1 && !strcmp(argv[1], "imix");
+    double secs = argc > 2 ? strtod(argv[2], NULL) : 1.0;
+    int gen_cpu, sink_cpu, node;
+
+    if (ndp_mempool_init(&sys) || ndp_topology_init(&topo)) {
+        fprintf(stderr, "bench_loopback: init failed\n");
+        return 1;
+    }
+    if (pick_cpus(&topo, &gen_cpu, &sink_cpu)) {
+        fprintf(stderr, "bench_loopback: no usable cpu\n");
+        return 1;
+    }
+    node = ndp_topology_cpu(&topo, gen_cpu)->node;
+
+    struct ndp_buf_pool *pool = ndp_buf_pool_create(&sys, node, 2048, BENCH_NUM_BUFS);
+    struct ndp_port *port = ndp_port_loopback_create(&sys, node, "lo0", 1, BENCH_RING_SIZE);
+    if (!pool || !port) {
+        fprintf(stderr, "bench_loopback: port setup failed\n");
+        return 1;
+    }
+
+    ndp_pktgen_profile_default(&prof);
+    if (imix)
+        ndp_pktgen_profile_imix(&prof);
+    prof.num_flows = 1024;
+    prof.num_dsts = 16;
+
+    struct ndp_pktgen *gen = ndp_pktgen_create(&sys, pool, port, 0, &prof);
+    struct ndp_sink *sink = ndp_sink_create(&sys, port, 0);
+    if (!gen || !sink) {
+        fprintf(stderr, "bench_loopback: generator setup failed\n");
+        return 1;
+    }
+
+    // busy polling only: idle back-off would show up as latency
+    ndp_idle_policy_default(&policy);
+    policy.never_sleep = true;
+    policy.use_umwait = false;
+
+    gen_w = ndp_worker_create(&sys, 0, gen_cpu, &policy);
+    sink_w = sink_cpu == gen_cpu ? gen_w : ndp_worker_create(&sys, 1, sink_cpu, &policy);
+    if (!gen_w || !sink_w || ndp_worker_add_poll(gen_w, ndp_pktgen_poll, gen) ||
+        ndp_worker_add_poll(sink_w, ndp_sink_poll, sink)) {
+        fprintf(stderr, "bench_loopback: worker setup failed\n");
+        return 1;
+    }
+
+    ndp_pktgen_set_rate(gen, 0);
+    if (ndp_worker_start(gen_w) || (sink_w != gen_w && ndp_worker_start(sink_w))) {
+        fprintf(stderr, "bench_loopback: worker start failed\n");
+        return 1;
+    }
+
+    printf("%s frames, generator cpu %d, sink cpu %d, %.1fs per step\n",
+           imix ? "imix" : "64B", gen_cpu, sink_cpu, secs);
+    printf("%10s %10s %10s %10s %10s %10s %10s\n",
+           "offered", "Mpps", "p50 ns", "p99 ns", "p99.9 ns", "max ns", "rejected");
+    for (size_t i = 0; i < sizeof(rates_mpps) / sizeof(rates_mpps[0]); i++) {
+        uint64_t rejected = __atomic_load_n(&gen->rejected, __ATOMIC_RELAXED);
+        char offered[16];
+
+        ndp_pktgen_set_rate(gen, (uint64_t)(rates_mpps[i] * 1e6));
+        usleep(100000);
+        ndp_sink_reset(sink);
+        usleep((useconds_t)(secs * 1e6));
+
+        if (rates_mpps[i] > 0)
+            snprintf(offered, sizeof(offered), "%.1f", rates_mpps[i]);
+        else
+            snprintf(offered, sizeof(offered), "max");
+        printf("%10s %10.2f %10lu %10lu %10lu %10lu %10lu\n", offered, ndp_sink_mpps(sink),
+               ndp_hist_percentile(&sink->latency, 50.0),
+               ndp_hist_percentile(&sink->latency, 99.0),
+               ndp_hist_percentile(&sink->latency, 99.9), sink->latency.max,
+               __atomic_load_n(&gen->rejected, __ATOMIC_RELAXED) - rejected);
+    }
+
+    ndp_worker_stop(gen_w);
+    if (sink_w != gen_w)
+        ndp_worker_stop(sink_w);
+    ndp_sink_report(sink, stdout);
+    ndp_port_stats_report(port, stdout);
+    ndp_port_close(port);
+    ndp_topology_destroy(&topo);
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*******************************************************************************
+ * @file               bench_net.c
+ * @brief              Checksum and header parse kernel benchmark.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Reports cycles per packet of the scalar and AVX2
+ *                     checksum kernels over common frame sizes, and of the
+ *                     scalar and dispatched burst parsers over a traffic mix
+ *                     of untagged IPv4, VLAN tagged IPv4 and IPv6 frames.
+ *                     Each kernel's result is cross-checked before timing,
+ *                     and frames with bad IP length fields must be flagged.
+ *
+ *                     usage: bench_net [iterations]
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "net.h"
+#include "cycles.h"
+
+#define BENCH_MAX_FRAME         9216
+
+static const size_t frame_sizes[] = { 64, 128, 256, 512, 1024, 1518, 4096, 9000 };
+
+
+static double bench_cksum(uint32_t (*fn)(const void *, size_t, uint32_t), const uint8_t *buf,
+                          size_t len, unsigned long iters)
+{
+    volatile uint32_t sink = 0;
+    uint64_t start = ndp_rdtsc();
+
+    for (unsigned long i = 0; i < iters; i++)
+        sink += fn(buf, len, 0);
+    (void)sink;
+    return (double)(ndp_rdtsc() - start) / iters;
+}
+
+/* a frame of `kind`: 0 IPv4/TCP, 1 IPv4/UDP, 2 VLAN IPv4/UDP, 3 IPv6/TCP */
+static uint32_t build_frame(uint8_t *p, int kind, uint32_t seed)
+{
+    struct ndp_ether_hdr *eth = (struct ndp_ether_hdr *)p;
+    uint16_t off = NDP_ETHER_HDR_LEN;
+    uint16_t payload = 64;
+
+    memset(p, 0, 256);
+    eth->type = htons(kind == 3 ? NDP_ETHER_TYPE_IPV6 : NDP_ETHER_TYPE_IPV4);
+    if (kind == 2) {
+        struct ndp_vlan_hdr *vlan = (struct ndp_vlan_hdr *)(p + off);
+        eth->type = htons(NDP_ETHER_TYPE_VLAN);
+        vlan->tci = htons(100);
+        vlan->type = htons(NDP_ETHER_TYPE_IPV4);
+        off += NDP_VLAN_HDR_LEN;
+    }
+
+    if (kind == 3) {
+        struct ndp_ipv6_hdr *ip = (struct ndp_ipv6_hdr *)(p + off);
+        ip->vtc_flow = htonl(6U << 28);
+        ip->payload_len = htons(payload);
+        ip->proto = NDP_IPPROTO_TCP;
+        ip->hop_limit = 64;
+        memcpy(ip->src + 12, &seed, sizeof(seed));
+        return off + sizeof(*ip) + payload;
+    }
+
+    struct ndp_ipv4_hdr *ip = (struct ndp_ipv4_hdr *)(p + off);
+    ip->ver_ihl = 0x45;
+    ip->total_len = htons(sizeof(*ip) + payload);
+    ip->ttl = 64;
+    ip->proto = kind == 0 ? NDP_IPPROTO_TCP : NDP_IPPROTO_UDP;
+    ip->src = htonl(0x0a000000 | seed);
+    ip->dst = htonl(0xc0a80001);
+    ip->cksum = ndp_ipv4_cksum(ip);
+    return off + sizeof(*ip) + payload;
+}
+
+/*
+ * frames whose IP length field is below the header or past the frame end:
+ * both parsers must flag them, and the checksum pass must flag rather than
+ * trust them when handed the offsets a trusting parser would have set
+ */
+static int check_malformed(void)
+{
+    static const uint16_t total_len[] = { 0, sizeof(struct ndp_ipv4_hdr) - 1, 85, 0xffff };
+    static uint8_t frames[5][256];
+    static struct ndp_burst b, ref;
+    uint16_t n = sizeof(total_len) / sizeof(total_len[0]);
+
+    memset(&b, 0, sizeof(b));
+    for (uint16_t i = 0; i < n; i++) {
+        struct ndp_ipv4_hdr *ip = (struct ndp_ipv4_hdr *)(frames[i] + NDP_ETHER_HDR_LEN);
+
+        b.data[i] = frames[i];
+        b.len[i] = build_frame(frames[i], 1, i);
+        ip->total_len = htons(total_len[i]);
+        ip->cksum = 0;
+        ip->cksum = ndp_ipv4_cksum(ip);
+    }
+    b.data[n] = frames[n];
+    b.len[n] = build_frame(frames[n], 3, n) - 1;
+    b.count = n + 1;
+
+    memcpy(&ref, &b, sizeof(ref));
+    ndp_parse_burst_scalar(&ref);
+    ndp_parse_burst(&b);
+    for (uint16_t i = 0; i < b.count; i++) {
+        if (b.flags[i] != ref.flags[i] || !(b.flags[i] & NDP_BUF_F_CKSUM_BAD) ||
+            (b.flags[i] & (NDP_BUF_F_IPV4 | NDP_BUF_F_IPV6)))
+            return -1;
+    }
+
+    for (uint16_t i = 0; i < b.count; i++) {
+        b.flags[i] = i < n ? NDP_BUF_F_IPV4 | NDP_BUF_F_UDP : NDP_BUF_F_IPV6 | NDP_BUF_F_TCP;
+        b.l3_off[i] = NDP_ETHER_HDR_LEN;
+        b.l4_off[i] = NDP_ETHER_HDR_LEN + (i < n ? sizeof(struct ndp_ipv4_hdr)
+                                                 : sizeof(struct ndp_ipv6_hdr));
+    }
+    ndp_cksum_check_burst(&b);
+    for (uint16_t i = 0; i < b.count; i++) {
+        if (!(b.flags[i] & NDP_BUF_F_CKSUM_BAD))
+            return -1;
+    }
+    return 0;
+}
+
+static double bench_parse(void (*fn)(struct ndp_burst *), struct ndp_burst *b,
+                          unsigned long iters)
+{
+    uint64_t start = ndp_rdtsc();
+
+    for (unsigned long i = 0; i < iters; i++)
+        fn(b);
+    return (double)(ndp_rdtsc() - start) / ((double)iters * b->count);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long iters = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+    uint8_t *buf = aligned_alloc(NDP_CACHE_LINE, BENCH_MAX_FRAME);
+    struct ndp_burst *b = aligned_alloc(NDP_CACHE_LINE, sizeof(*b));
+    uint8_t *frames = aligned_alloc(NDP_CACHE_LINE, (size_t)NDP_BURST_MAX * 256);
+    double hz = (double)ndp_tsc_hz();
+
+    if (!buf || !b || !frames || !iters) {
+        fprintf(stderr, "bench_net: allocation failed\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < BENCH_MAX_FRAME; i++)
+        buf[i] = (uint8_t)(i * 131 + 7);
+
+    // the AVX2 kernel is only run where the dispatcher would pick it
+    bool avx2 = __builtin_cpu_supports("avx2");
+
+    printf("checksum (cycles/packet, Gbit/s)%s\n", avx2 ? "" : ", no AVX2 on this cpu");
+    printf("%8s %12s %12s %10s %10s\n", "size", "scalar", "avx2", "scalar", "avx2");
+    for (size_t s = 0; s < sizeof(frame_sizes) / sizeof(frame_sizes[0]); s++) {
+        size_t len = frame_sizes[s];
+        double cs = bench_cksum(ndp_cksum_raw_scalar, buf, len, iters);
+
+        if (!avx2) {
+            printf("%8zu %12.1f %12s %10.1f %10s\n", len, cs, "-", len * 8 * hz / cs / 1e9, "-");
+            continue;
+        }
+        if (ndp_cksum_fold(ndp_cksum_raw_scalar(buf, len, 0)) !=
+            ndp_cksum_fold(ndp_cksum_raw_avx2(buf, len, 0))) {
+            fprintf(stderr, "bench_net: checksum mismatch at %zu bytes\n", len);
+            return 1;
+        }
+        double cv = bench_cksum(ndp_cksum_raw_avx2, buf, len, iters);
+        printf("%8zu %12.1f %12.1f %10.1f %10.1f\n", len, cs, cv,
+               len * 8 * hz / cs / 1e9, len * 8 * hz / cv / 1e9);
+    }
+
+    // 70% plain IPv4, 15% VLAN, 15% IPv6: the vector path handles the first
+    memset(b, 0, sizeof(*b));
+    b->count = NDP_BURST_MAX;
+    for (uint16_t i = 0; i < b->count; i++) {
+        int kind = i % 20 < 14 ? i & 1 : i % 20 < 17 ? 2 : 3;
+        b->data[i] = frames + (size_t)i * 256;
+        b->len[i] = build_frame(b->data[i], kind, i);
+    }
+
+    static struct ndp_burst ref;
+    memcpy(&ref, b, sizeof(ref));
+    ndp_parse_burst_scalar(&ref);
+    ndp_parse_burst(b);
+    if (memcmp(ref.flags, b->flags, sizeof(b->flags)) ||
+        memcmp(ref.l3_off, b->l3_off, sizeof(b->l3_off)) ||
+        memcmp(ref.l4_off, b->l4_off, sizeof(b->l4_off))) {
+        fprintf(stderr, "bench_net: parse mismatch\n");
+        return 1;
+    }
+    if (check_malformed() != 0) {
+        fprintf(stderr, "bench_net: malformed length not flagged\n");
+        return 1;
+    }
+
+    unsigned long bursts = iters / 100 ? iters / 100 : 1;
+    printf("\nparse (cycles/packet, burst of %u)\n", NDP_BURST_MAX);
+    printf("  scalar     %8.2f\n", bench_parse(ndp_parse_burst_scalar, b, bursts));
+    printf("  dispatched %8.2f\n", bench_parse(ndp_parse_burst, b, bursts));
+
+    free(frames);
+    free(b);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * @file               bench_policer.c
+ * @brief              Scalar and AVX2 policer equivalence check and benchmark.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Two policers with the same flows and profiles see the
+ *                     same bursts, one through the scalar kernel and one
+ *                     through the dispatched (AVX2 when available) kernel;
+ *                     the conform masks and every bucket must stay equal.
+ *                     The traffic mixes repeated flows within a step, time
+ *                     jumps past half the stamp range and stamps slightly
+ *                     ahead of the policing clock.  Then both kernels are
+ *                     timed over random flows.
+ *
+ *                     usage: bench_policer [bursts]
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "policer.h"
+#include "cycles.h"
+
+#define BENCH_FLOWS             (1U << 16)
+#define BENCH_BURST             64
+#define BENCH_PROFILES          4
+
+static const uint64_t prof_rate[BENCH_PROFILES] = { 0, 125000, 1250000, 125000000 };
+static const uint64_t prof_burst[BENCH_PROFILES] = { 0, 1500, 15000, 150000 };
+
+
+static uint32_t rnd(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return (uint32_t)(*s >> 16);
+}
+
+static struct ndp_policer *policer_setup(struct mempool_sys *sys, int node, uint64_t tsc)
+{
+    struct ndp_policer *pol = ndp_policer_create(sys, node, BENCH_FLOWS);
+
+    if (!pol)
+        return NULL;
+    for (uint32_t p = 1; p < BENCH_PROFILES; p++) {
+        if (ndp_policer_set_profile(pol, p, prof_rate[p], prof_burst[p]))
+            return NULL;
+    }
+    // every fourth flow stays on the pass-everything profile
+    for (uint32_t f = 0; f < BENCH_FLOWS; f++) {
+        if (ndp_policer_set_flow(pol, f, f % BENCH_PROFILES, tsc))
+            return NULL;
+    }
+    return pol;
+}
+
+/* a burst of random flows, a few of them repeated, over a small hot set */
+static void make_burst(uint64_t *seed, uint32_t *flows, uint32_t *lens, uint32_t range)
+{
+    for (int i = 0; i < BENCH_BURST; i++) {
+        flows[i] = rnd(seed) % range;
+        if (i && rnd(seed) % 8 == 0)
+            flows[i] = flows[i - 1 - rnd(seed) % i];
+        lens[i] = 64 + rnd(seed) % 1455;
+    }
+}
+
+static int check_equal(struct mempool_sys *sys, int node, unsigned long bursts)
+{
+    uint64_t tsc = ndp_rdtsc(), seed = 0x9e3779b97f4a7c15ULL;
+    uint64_t tick = 1ULL << NDP_POLICER_TICK_SHIFT;
+    struct ndp_policer *ref = policer_setup(sys, node, tsc);
+    struct ndp_policer *vec = policer_setup(sys, node, tsc);
+    uint32_t flows[BENCH_BURST], lens[BENCH_BURST];
+
+    if (!ref || !vec)
+        return -1;
+
+    for (unsigned long b = 0; b < bursts; b++) {
+        uint32_t r = rnd(&seed) % 16;
+
+        make_burst(&seed, flows, lens, b % 2 ? 256 : BENCH_FLOWS);
+        if (r == 0) {
+            // idle for more than half the stamp range
+            tsc += (NDP_POLICER_STAMP_MASK / 4 * 3) * tick;
+        } else if (r == 1) {
+            // a flow stamped slightly ahead, as if by another core's tsc
+            uint32_t f = flows[0];
+            ndp_policer_set_flow(ref, f, f % BENCH_PROFILES, tsc + 1000 * tick);
+            ndp_policer_set_flow(vec, f, f % BENCH_PROFILES, tsc + 1000 * tick);
+        } else {
+            tsc += (rnd(&seed) % 4096) * tick;
+        }
+
+        if (ndp_policer_burst_scalar(ref, flows, lens, BENCH_BURST, tsc) !=
+            ndp_policer_burst(vec, flows, lens, BENCH_BURST, tsc) ||
+            memcmp(ref->lines, vec->lines, ref->map_size)) {
+            fprintf(stderr, "bench_policer: kernels differ at burst %lu\n", b);
+            return -1;
+        }
+    }
+
+    // a drained bucket is full again after a long idle gap
+    uint32_t f = 1, len = 1500;
+    ndp_policer_set_flow(ref, f, 1, tsc);
+    while (ndp_policer_check(ref, f, len, tsc))
+        ;
+    if (!ndp_policer_check(ref, f, len, tsc + (NDP_POLICER_STAMP_MASK / 4 * 3) * tick)) {
+        fprintf(stderr, "bench_policer: no refill after a long idle gap\n");
+        return -1;
+    }
+
+    ndp_policer_destroy(ref);
+    ndp_policer_destroy(vec);
+    return 0;
+}
+
+static double bench_kernel(uint64_t (*fn)(struct ndp_policer *, const uint32_t *,
+                                          const uint32_t *, unsigned int, uint64_t),
+                           struct ndp_policer *pol, unsigned long bursts)
+{
+    uint32_t flows[BENCH_BURST], lens[BENCH_BURST];
+    uint64_t seed = 12345, cycles = 0;
+    volatile uint64_t sink = 0;
+
+    for (unsigned long b = 0; b < bursts; b++) {
+        uint64_t t0;
+
+        make_burst(&seed, flows, lens, BENCH_FLOWS);
+        t0 = ndp_rdtsc();
+        sink += fn(pol, flows, lens, BENCH_BURST, t0);
+        cycles += ndp_rdtsc() - t0;
+    }
+    (void)sink;
+    return (double)cycles / ((double)bursts * BENCH_BURST);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long bursts = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+    struct mempool_sys sys;
+    struct ndp_policer *pol;
+    int node = numa_node_of_cpu(sched_getcpu());
+
+    if (node < 0)
+        node = 0;
+    if (!bursts || ndp_mempool_init(&sys)) {
+        fprintf(stderr, "bench_policer: init failed\n");
+        return 1;
+    }
+    if (check_equal(&sys, node, bursts))
+        return 1;
+    printf("scalar and dispatched kernels agree over %lu bursts of %d%s\n", bursts, BENCH_BURST,
+           __builtin_cpu_supports("avx2") ? "" : " (no AVX2 on this cpu)");
+
+    if (!(pol = policer_setup(&sys, node, ndp_rdtsc()))) {
+        fprintf(stderr, "bench_policer: setup failed\n");
+        return 1;
+    }
+    printf("\npolice (cycles/packet, %u flows)\n", BENCH_FLOWS);
+    printf("  scalar     %8.2f\n", bench_kernel(ndp_policer_burst_scalar, pol, bursts));
+    printf("  dispatched %8.2f\n", bench_kernel(ndp_policer_burst, pol, bursts));
+    ndp_policer_destroy(pol);
+    return 0;
+}
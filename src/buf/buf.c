@@ -0,0 +1,112 @@
+/*******************************************************************************
+ * @file               buf.c
+ * @brief              Packet buffers and their node-local pools.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Packet buffers are fixed-size blocks of the A_SPAN and
+ *                     B_SPAN size categories, each carved from an object pool
+ *                     on the node of the worker (or device) that fills it.
+ *                     The descriptor occupies the first cache line(s) of the
+ *                     block and the data room follows, with NDP_BUF_HEADROOM
+ *                     bytes reserved in front of the packet for encapsulation.
+ *
+ *                     A buffer always returns to the pool it was allocated
+ *                     from, which is how memory stays on its node even when a
+ *                     packet is freed by a worker on another socket.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "buf.h"
+
+
+#define FREE_BATCH              64
+
+
+struct ndp_buf_pool *ndp_buf_pool_create(struct mempool_sys *mem, int node, uint16_t span,
+                                         unsigned int count)
+{
+    struct ndp_buf_pool *bp = ndp_mempool_alloc(mem, node, sizeof(*bp), NDP_CACHE_LINE);
+
+    if (!bp || span <= sizeof(struct ndp_buf) + NDP_BUF_HEADROOM)
+        return NULL;
+
+    bp->span = span;
+    bp->node = node;
+    bp->op = ndp_objpool_create(mem, node, span, count);
+    if (!bp->op)
+        return NULL;
+
+    // the descriptor never moves, so buf_addr and buf_len are set once here
+    for (unsigned int i = 0; i < count; i++) {
+        struct ndp_buf *b = (struct ndp_buf *)(bp->op->base + (size_t)i * bp->op->elt_size);
+        b->buf_addr = (uint8_t *)(b + 1);
+        b->buf_len = span - sizeof(*b);
+        b->pool = bp;
+    }
+    return bp;
+}
+
+struct ndp_buf *ndp_buf_alloc(struct ndp_buf_pool *bp)
+{
+    struct ndp_buf *b = ndp_objpool_get(bp->op);
+
+    if (b)
+        ndp_buf_reset(b);
+    return b;
+}
+
+unsigned int ndp_buf_alloc_bulk(struct ndp_buf_pool *bp, struct ndp_buf **bufs, unsigned int n)
+{
+    if (!ndp_objpool_get_bulk(bp->op, (void **)bufs, n))
+        return 0;
+
+    for (unsigned int i = 0; i < n; i++)
+        ndp_buf_reset(bufs[i]);
+    return n;
+}
+
+static inline bool buf_release(struct ndp_buf *b)
+{
+    if (ndp_likely(__atomic_load_n(&b->refcnt, __ATOMIC_RELAXED) == 1))
+        return true;
+    return __atomic_sub_fetch(&b->refcnt, 1, __ATOMIC_ACQ_REL) == 0;
+}
+
+void ndp_buf_free(struct ndp_buf *b)
+{
+    while (b) {
+        struct ndp_buf *next = b->next;
+        if (buf_release(b))
+            ndp_objpool_put(b->pool->op, b);
+        b = next;
+    }
+}
+
+void ndp_buf_free_bulk(struct ndp_buf **bufs, unsigned int n)
+{
+    void *batch[FREE_BATCH];
+    struct ndp_buf_pool *pool = NULL;
+    unsigned int nb = 0;
+
+    for (unsigned int i = 0; i < n; i++) {
+        struct ndp_buf *b = bufs[i];
+
+        if (b->next) {
+            ndp_buf_free(b);
+            continue;
+        }
+        if (!buf_release(b))
+            continue;
+        if (nb && (b->pool != pool || nb == FREE_BATCH)) {
+            ndp_objpool_put_bulk(pool->op, batch, nb);
+            nb = 0;
+        }
+        pool = b->pool;
+        batch[nb++] = b;
+    }
+    if (nb)
+        ndp_objpool_put_bulk(pool->op, batch, nb);
+}
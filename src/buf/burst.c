@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * @file               burst.c
+ * @brief              Structure-of-arrays burst metadata and gather/scatter.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Buffer descriptors are laid out per packet, which is the
+ *                     right shape for the buffer pools but the wrong one for
+ *                     SIMD: a classification stage that wants 8 hashes has to
+ *                     visit 8 descriptors.  A burst descriptor transposes the
+ *                     hot metadata of a whole burst into one array per field
+ *                     in node-local memory.  Stages then run over the arrays
+ *                     with AVX2 and the results are scattered back once.
+ *
+ *                     The AVX2 gather pulls the metadata of four descriptors
+ *                     per instruction using the buffer pointers themselves as
+ *                     gather indices.  Implementations are selected at first
+ *                     use from the CPU features, with a scalar fallback.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "burst.h"
+
+#include <immintrin.h>
+
+
+static void gather_resolve(struct ndp_burst *, struct ndp_buf **, uint16_t);
+static uint16_t select_resolve(const struct ndp_burst *, uint32_t, uint32_t, uint16_t *);
+
+static void (*gather_impl)(struct ndp_burst *, struct ndp_buf **, uint16_t) = gather_resolve;
+static uint16_t (*select_impl)(const struct ndp_burst *, uint32_t, uint32_t,
+                               uint16_t *) = select_resolve;
+
+
+struct ndp_burst *ndp_burst_create(struct mempool_sys *mem, int node)
+{
+    struct ndp_burst *b = ndp_mempool_alloc(mem, node, sizeof(*b), NDP_CACHE_LINE);
+
+    if (b) {
+        b->count = 0;
+        b->node = node;
+    }
+    return b;
+}
+
+static inline void gather_one(struct ndp_burst *b, uint16_t i, struct ndp_buf *m)
+{
+    b->bufs[i] = m;
+    b->data[i] = m->buf_addr + m->data_off;
+    b->len[i] = m->pkt_len;
+    b->hash[i] = m->hash;
+    b->flags[i] = m->flags;
+    b->next_hop[i] = (uint32_t)m->udata;
+    b->port[i] = m->port;
+    b->l3_off[i] = 0;
+    b->l4_off[i] = 0;
+}
+
+static void gather_scalar(struct ndp_burst *b, struct ndp_buf **bufs, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        gather_one(b, i, bufs[i]);
+}
+
+/**
+ *  four descriptors per step: each 64-bit gather lane reads 8 bytes at a
+ *  fixed offset of one descriptor, e.g. pkt_len|data_off|data_len at once.
+ */
+__attribute__((target("avx2")))
+static void gather_avx2(struct ndp_burst *b, struct ndp_buf **bufs, uint16_t n)
+{
+    const __m256i lo32 = _mm256_set1_epi64x(0xffffffff);
+    const __m256i lo16 = _mm256_set1_epi64x(0xffff);
+    const __m256i pick = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    uint16_t i = 0;
+
+    memcpy(b->bufs, bufs, sizeof(*bufs) * n);
+    memset(b->l3_off, 0, sizeof(b->l3_off[0]) * n);
+    memset(b->l4_off, 0, sizeof(b->l4_off[0]) * n);
+
+    for (; i + 4 <= n; i += 4) {
+        __m256i ptr = _mm256_loadu_si256((const __m256i *)&bufs[i]);
+
+        __m256i addr = _mm256_i64gather_epi64(
+            (const long long *)offsetof(struct ndp_buf, buf_addr), ptr, 1);
+        __m256i lens = _mm256_i64gather_epi64(
+            (const long long *)offsetof(struct ndp_buf, pkt_len), ptr, 1);
+        __m256i hf = _mm256_i64gather_epi64(
+            (const long long *)offsetof(struct ndp_buf, hash), ptr, 1);
+        __m256i ud = _mm256_i64gather_epi64(
+            (const long long *)offsetof(struct ndp_buf, udata), ptr, 1);
+
+        // data = buf_addr + data_off; data_off is bits 32..47 of lens
+        __m256i off = _mm256_and_si256(_mm256_srli_epi64(lens, 32), lo16);
+        _mm256_storeu_si256((__m256i *)&b->data[i], _mm256_add_epi64(addr, off));
+
+        // narrow the low dword of each lane to 4 packed 32-bit values
+        __m128i len32 = _mm256_castsi256_si128(
+            _mm256_permutevar8x32_epi32(_mm256_and_si256(lens, lo32), pick));
+        __m128i hash32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(hf, pick));
+        __m128i flag32 = _mm256_castsi256_si128(
+            _mm256_permutevar8x32_epi32(_mm256_srli_epi64(hf, 32), pick));
+        __m128i nh32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(ud, pick));
+
+        _mm_storeu_si128((__m128i *)&b->len[i], len32);
+        _mm_storeu_si128((__m128i *)&b->hash[i], hash32);
+        _mm_storeu_si128((__m128i *)&b->flags[i], flag32);
+        _mm_storeu_si128((__m128i *)&b->next_hop[i], nh32);
+
+        for (int k = 0; k < 4; k++)
+            b->port[i + k] = bufs[i + k]->port;
+    }
+    for (; i < n; i++)
+        gather_one(b, i, bufs[i]);
+}
+
+static void gather_resolve(struct ndp_burst *b, struct ndp_buf **bufs, uint16_t n)
+{
+    gather_impl = __builtin_cpu_supports("avx2") ? gather_avx2 : gather_scalar;
+    gather_impl(b, bufs, n);
+}
+
+void ndp_burst_gather(struct ndp_burst *b, struct ndp_buf **bufs, uint16_t n)
+{
+    if (n > NDP_BURST_MAX)
+        n = NDP_BURST_MAX;
+    gather_impl(b, bufs, n);
+    b->count = n;
+}
+
+void ndp_burst_scatter(const struct ndp_burst *b)
+{
+    for (uint16_t i = 0; i < b->count; i++) {
+        struct ndp_buf *m = b->bufs[i];
+
+        m->hash = b->hash[i];
+        m->flags = b->flags[i];
+        m->udata = b->next_hop[i];
+    }
+}
+
+static uint16_t select_scalar(const struct ndp_burst *b, uint32_t mask, uint32_t value,
+                              uint16_t *idx)
+{
+    uint16_t n = 0;
+
+    for (uint16_t i = 0; i < b->count; i++) {
+        if ((b->flags[i] & mask) == value)
+            idx[n++] = i;
+    }
+    return n;
+}
+
+__attribute__((target("avx2")))
+static uint16_t select_avx2(const struct ndp_burst *b, uint32_t mask, uint32_t value,
+                            uint16_t *idx)
+{
+    const __m256i vmask = _mm256_set1_epi32((int)mask);
+    const __m256i vval = _mm256_set1_epi32((int)value);
+    uint16_t i = 0, n = 0;
+
+    for (; i + 8 <= b->count; i += 8) {
+        __m256i f = _mm256_load_si256((const __m256i *)&b->flags[i]);
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_and_si256(f, vmask), vval);
+        unsigned int bits = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(eq));
+
+        while (bits) {
+            idx[n++] = i + __builtin_ctz(bits);
+            bits &= bits - 1;
+        }
+    }
+    for (; i < b->count; i++) {
+        if ((b->flags[i] & mask) == value)
+            idx[n++] = i;
+    }
+    return n;
+}
+
+static uint16_t select_resolve(const struct ndp_burst *b, uint32_t mask, uint32_t value,
+                               uint16_t *idx)
+{
+    select_impl = __builtin_cpu_supports("avx2") ? select_avx2 : select_scalar;
+    return select_impl(b, mask, value, idx);
+}
+
+uint16_t ndp_burst_select(const struct ndp_burst *b, uint32_t mask, uint32_t value,
+                          uint16_t *idx)
+{
+    return select_impl(b, mask, value, idx);
+}
+
+void ndp_burst_compact(struct ndp_burst *b, const uint16_t *idx, uint16_t n)
+{
+    // idx is ascending, so moving element idx[k] down to k never overwrites
+    // an element that is still to be moved
+    for (uint16_t k = 0; k < n; k++) {
+        uint16_t i = idx[k];
+        if (i == k)
+            continue;
+        b->bufs[k] = b->bufs[i];
+        b->data[k] = b->data[i];
+        b->len[k] = b->len[i];
+        b->hash[k] = b->hash[i];
+        b->next_hop[k] = b->next_hop[i];
+        b->flags[k] = b->flags[i];
+        b->l3_off[k] = b->l3_off[i];
+        b->l4_off[k] = b->l4_off[i];
+        b->port[k] = b->port[i];
+    }
+    b->count = n;
+}
@@ -0,0 +1,50 @@
+/*******************************************************************************
+ * @file               cycles.c
+ * @brief              TSC calibration for data path time keeping.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            The data path measures time in TSC cycles: rdtsc is a
+ *                     few nanoseconds and never enters the kernel.  The cycle
+ *                     to wall-clock ratio is measured once against
+ *                     CLOCK_MONOTONIC_RAW; on CPUs with an invariant TSC it
+ *                     does not change afterwards.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "cycles.h"
+
+#include <time.h>
+
+
+#define CALIBRATE_NS            20000000UL
+
+static uint64_t tsc_hz;
+
+
+static uint64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000UL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t ndp_tsc_hz(void)
+{
+    uint64_t hz = __atomic_load_n(&tsc_hz, __ATOMIC_RELAXED);
+    if (ndp_likely(hz))
+        return hz;
+
+    struct timespec req = { 0, CALIBRATE_NS };
+    uint64_t ns0 = mono_ns();
+    uint64_t c0 = ndp_rdtsc();
+    nanosleep(&req, NULL);
+    uint64_t c1 = ndp_rdtsc();
+    uint64_t ns1 = mono_ns();
+
+    hz = (uint64_t)((double)(c1 - c0) * 1e9 / (double)(ns1 - ns0));
+    __atomic_store_n(&tsc_hz, hz, __ATOMIC_RELAXED);
+    return hz;
+}
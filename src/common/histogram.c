@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * @file               histogram.c
+ * @brief              Log-linear histogram for latency percentiles.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Recording is a bucket index computed from the position
+ *                     of the top bit plus an increment, cheap enough for every
+ *                     packet.  Percentiles walk the table once.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "histogram.h"
+
+
+static uint64_t bucket_low(unsigned int b)
+{
+    if (b < NDP_HIST_SUB)
+        return b;
+
+    unsigned int e = b / NDP_HIST_SUB + NDP_HIST_SUB_BITS - 1;
+    return (uint64_t)(NDP_HIST_SUB + b % NDP_HIST_SUB) << (e - NDP_HIST_SUB_BITS);
+}
+
+void ndp_hist_reset(struct ndp_hist *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void ndp_hist_merge(struct ndp_hist *dst, const struct ndp_hist *src)
+{
+    for (unsigned int b = 0; b < NDP_HIST_BUCKETS; b++)
+        dst->buckets[b] += src->buckets[b];
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min)
+        dst->min = src->min;
+    if (src->max > dst->max)
+        dst->max = src->max;
+}
+
+uint64_t ndp_hist_percentile(const struct ndp_hist *h, double p)
+{
+    uint64_t rank, seen = 0;
+
+    if (!h->count)
+        return 0;
+    rank = (uint64_t)(p / 100.0 * (double)h->count);
+    if (rank >= h->count)
+        return h->max;
+
+    for (unsigned int b = 0; b < NDP_HIST_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen > rank) {
+            if (b + 1 == NDP_HIST_BUCKETS)
+                return h->max;
+            // middle of the bucket, clamped to what was actually seen
+            uint64_t lo = bucket_low(b);
+            uint64_t mid = lo + (bucket_low(b + 1) - lo) / 2;
+            if (mid < h->min)
+                return h->min;
+            return mid > h->max ? h->max : mid;
+        }
+    }
+    return h->max;
+}
+
+void ndp_hist_report(const struct ndp_hist *h, FILE *out, const char *unit)
+{
+    if (!h->count) {
+        fprintf(out, "no samples\n");
+        return;
+    }
+    fprintf(out, "n %lu min %lu avg %lu p50 %lu p90 %lu p99 %lu p99.9 %lu max %lu %s\n",
+            h->count, h->min, h->sum / h->count, ndp_hist_percentile(h, 50),
+            ndp_hist_percentile(h, 90), ndp_hist_percentile(h, 99),
+            ndp_hist_percentile(h, 99.9), h->max, unit);
+}
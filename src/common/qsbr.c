@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * @file               qsbr.c
+ * @brief              Quiescent-state based reclamation for read-mostly tables.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Lookup tables (routes, ACLs) are rebuilt off the hot path
+ *                     and published with a single pointer store.  Readers take
+ *                     no locks and no reference counts; instead every worker
+ *                     reports a quiescent state from its poll loop.  The
+ *                     writer bumps the epoch after unpublishing a table and
+ *                     waits for every online reader to report that epoch,
+ *                     after which the old table is unreachable.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "qsbr.h"
+
+#include <sched.h>
+
+
+void ndp_qsbr_init(struct ndp_qsbr *q)
+{
+    memset(q, 0, sizeof(*q));
+    q->epoch = 1;
+    for (int i = 0; i < NDP_QSBR_MAX_READERS; i++)
+        q->readers[i].seen = NDP_QSBR_OFFLINE;
+}
+
+int ndp_qsbr_register(struct ndp_qsbr *q)
+{
+    unsigned int id = __atomic_fetch_add(&q->num_readers, 1, __ATOMIC_ACQ_REL);
+
+    if (id >= NDP_QSBR_MAX_READERS)
+        return -1;
+    ndp_qsbr_online(q, id);
+    return id;
+}
+
+void ndp_qsbr_synchronize(struct ndp_qsbr *q)
+{
+    uint64_t target = __atomic_add_fetch(&q->epoch, 1, __ATOMIC_SEQ_CST);
+    unsigned int n = __atomic_load_n(&q->num_readers, __ATOMIC_ACQUIRE);
+
+    if (n > NDP_QSBR_MAX_READERS)
+        n = NDP_QSBR_MAX_READERS;
+
+    for (unsigned int i = 0; i < n; i++) {
+        // offline readers compare as UINT64_MAX and never hold us up
+        while (__atomic_load_n(&q->readers[i].seen, __ATOMIC_ACQUIRE) < target)
+            sched_yield();
+    }
+}
@@ -0,0 +1,109 @@
+/*******************************************************************************
+ * @file               cptr.c
+ * @brief              Compressed pointer bases and hash chains.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            A compressed pointer is only meaningful with the base
+ *                     of the node pool it points into, so every structure
+ *                     built from them lives on that node and holds (or is
+ *                     handed) the base.  Decoding is a shift and an add off
+ *                     a base kept next to the data being walked.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "cptr.h"
+
+int ndp_cbase_init(struct ndp_cbase *cb, const struct mempool_sys *mem, int node,
+                   unsigned int shift)
+{
+    const struct mempool_node *p;
+    size_t unit = (size_t)1 << shift;
+
+    if (node < 0 || node >= mem->num_nodes || shift > NDP_CPTR_MAX_SHIFT)
+        return -1;
+    p = &mem->pools[node];
+    if (!p->base || ((uintptr_t)p->base & (unit - 1)))
+        return -1;
+    // the last unit of the pool must still encode below 2^32
+    if ((p->size >> shift) + 1 > UINT32_MAX) {
+        fprintf(stderr, "cptr: node %d pool of %zu bytes needs a shift above %u\n",
+                node, p->size, shift);
+        return -1;
+    }
+
+    cb->base = p->base - unit;
+    cb->shift = shift;
+    cb->node = node;
+    return 0;
+}
+
+bool ndp_cptr_valid(const struct ndp_cbase *cb, const struct mempool_sys *mem, const void *p)
+{
+    if (!p)
+        return true;
+    return ndp_mempool_node_of(mem, p) == cb->node &&
+           !((uintptr_t)p & (((uintptr_t)1 << cb->shift) - 1));
+}
+
+int ndp_chash_init(struct ndp_chash *h, struct mempool_sys *mem, const struct ndp_cbase *cb,
+                   uint32_t buckets)
+{
+    uint32_t n = 1;
+
+    if (!buckets || buckets > (1U << 31))
+        return -1;
+    while (n < buckets)
+        n <<= 1;
+
+    h->buckets = ndp_mempool_alloc(mem, cb->node, sizeof(*h->buckets) * n, NDP_CACHE_LINE);
+    if (!h->buckets)
+        return -1;
+    memset(h->buckets, 0, sizeof(*h->buckets) * n);
+    h->cb = *cb;
+    h->mask = n - 1;
+    h->count = 0;
+    return 0;
+}
+
+void ndp_chash_insert(struct ndp_chash *h, struct ndp_chash_node *n, uint32_t hash)
+{
+    ndp_cptr_t *head = &h->buckets[hash & h->mask];
+
+    n->hash = hash;
+    n->next = *head;
+    *head = ndp_cptr_encode(&h->cb, n);
+    h->count++;
+}
+
+int ndp_chash_remove(struct ndp_chash *h, struct ndp_chash_node *n)
+{
+    ndp_cptr_t c = ndp_cptr_encode(&h->cb, n);
+    ndp_cptr_t *link = &h->buckets[n->hash & h->mask];
+
+    while (*link) {
+        if (*link == c) {
+            *link = n->next;
+            n->next = NDP_CPTR_NULL;
+            h->count--;
+            return 0;
+        }
+        link = &((struct ndp_chash_node *)ndp_cptr_deref(&h->cb, *link))->next;
+    }
+    return -1;
+}
+
+void ndp_chash_walk(struct ndp_chash *h, void (*fn)(struct ndp_chash_node *, void *), void *arg)
+{
+    for (uint32_t i = 0; i <= h->mask; i++) {
+        ndp_cptr_t c = h->buckets[i];
+
+        while (c) {
+            struct ndp_chash_node *n = ndp_cptr_deref(&h->cb, c);
+            c = n->next;
+            fn(n, arg);
+        }
+    }
+}
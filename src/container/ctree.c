@@ -0,0 +1,237 @@
+/*******************************************************************************
+ * @file               ctree.c
+ * @brief              AVL tree linked by compressed pointers.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Nodes have no parent link.  Insert and remove record
+ *                     the links they walk through (the address of the cptr
+ *                     that points at each node on the path) and rebalance
+ *                     back up that path, storing each new subtree root
+ *                     through its link.  An AVL tree of 2^32 nodes is less
+ *                     than NDP_CTREE_MAX_DEPTH deep, so the path fits on
+ *                     the stack.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "cptr.h"
+
+static inline struct ndp_ctree_node *node_at(const struct ndp_ctree *t, ndp_cptr_t c)
+{
+    return (struct ndp_ctree_node *)ndp_cptr_decode(&t->cb, c);
+}
+
+static inline int32_t height(const struct ndp_ctree *t, ndp_cptr_t c)
+{
+    return c ? node_at(t, c)->height : 0;
+}
+
+static inline void fix_height(const struct ndp_ctree *t, struct ndp_ctree_node *n)
+{
+    int32_t l = height(t, n->left), r = height(t, n->right);
+
+    n->height = (l > r ? l : r) + 1;
+}
+
+static ndp_cptr_t rotate_right(const struct ndp_ctree *t, ndp_cptr_t c)
+{
+    struct ndp_ctree_node *n = node_at(t, c);
+    ndp_cptr_t lc = n->left;
+    struct ndp_ctree_node *l = node_at(t, lc);
+
+    n->left = l->right;
+    l->right = c;
+    fix_height(t, n);
+    fix_height(t, l);
+    return lc;
+}
+
+static ndp_cptr_t rotate_left(const struct ndp_ctree *t, ndp_cptr_t c)
+{
+    struct ndp_ctree_node *n = node_at(t, c);
+    ndp_cptr_t rc = n->right;
+    struct ndp_ctree_node *r = node_at(t, rc);
+
+    n->right = r->left;
+    r->left = c;
+    fix_height(t, n);
+    fix_height(t, r);
+    return rc;
+}
+
+/* restore the AVL property at c, whose subtrees are balanced; the new subtree root */
+static ndp_cptr_t rebalance(const struct ndp_ctree *t, ndp_cptr_t c)
+{
+    struct ndp_ctree_node *n = node_at(t, c);
+    int32_t bal = height(t, n->left) - height(t, n->right);
+
+    if (bal > 1) {
+        struct ndp_ctree_node *l = node_at(t, n->left);
+        if (height(t, l->left) < height(t, l->right))
+            n->left = rotate_left(t, n->left);
+        return rotate_right(t, c);
+    }
+    if (bal < -1) {
+        struct ndp_ctree_node *r = node_at(t, n->right);
+        if (height(t, r->right) < height(t, r->left))
+            n->right = rotate_right(t, n->right);
+        return rotate_left(t, c);
+    }
+    fix_height(t, n);
+    return c;
+}
+
+/* rebalance the nodes behind path[0..depth) from the bottom up */
+static void retrace(struct ndp_ctree *t, ndp_cptr_t **path, int depth)
+{
+    while (depth--) {
+        ndp_cptr_t c = *path[depth];
+        int32_t old = node_at(t, c)->height;
+
+        *path[depth] = rebalance(t, c);
+        // nothing above changes once a subtree keeps its height
+        if (node_at(t, *path[depth])->height == old)
+            break;
+    }
+}
+
+void ndp_ctree_init(struct ndp_ctree *t, const struct ndp_cbase *cb, ndp_ctree_cmp_fn cmp)
+{
+    t->cb = *cb;
+    t->cmp = cmp;
+    t->root = NDP_CPTR_NULL;
+    t->count = 0;
+}
+
+int ndp_ctree_insert(struct ndp_ctree *t, struct ndp_ctree_node *n, const void *key)
+{
+    ndp_cptr_t *path[NDP_CTREE_MAX_DEPTH];
+    ndp_cptr_t *link = &t->root;
+    int depth = 0;
+
+    while (*link) {
+        struct ndp_ctree_node *p = node_at(t, *link);
+        int d = t->cmp(p, key);
+
+        if (!d)
+            return -1;
+        path[depth++] = link;
+        link = d > 0 ? &p->left : &p->right;
+    }
+
+    n->left = n->right = NDP_CPTR_NULL;
+    n->height = 1;
+    *link = ndp_cptr_encode(&t->cb, n);
+    t->count++;
+    retrace(t, path, depth);
+    return 0;
+}
+
+struct ndp_ctree_node *ndp_ctree_remove(struct ndp_ctree *t, const void *key)
+{
+    ndp_cptr_t *path[NDP_CTREE_MAX_DEPTH];
+    ndp_cptr_t *link = &t->root;
+    struct ndp_ctree_node *n = NULL;
+    int depth = 0, at;
+
+    while (*link) {
+        int d;
+
+        n = node_at(t, *link);
+        d = t->cmp(n, key);
+        if (!d)
+            break;
+        path[depth++] = link;
+        link = d > 0 ? &n->left : &n->right;
+    }
+    if (!*link)
+        return NULL;
+
+    at = depth;
+    path[depth++] = link;
+    if (!n->right) {
+        *link = n->left;
+        depth--;
+    } else {
+        // take the successor out of the right subtree and put it in n's place
+        struct ndp_ctree_node *s;
+        ndp_cptr_t *slink = &n->right;
+
+        path[depth++] = slink;
+        while ((s = node_at(t, *slink))->left) {
+            slink = &s->left;
+            path[depth++] = slink;
+        }
+        *slink = s->right;
+        depth--;
+
+        s->left = n->left;
+        s->right = n->right;
+        s->height = n->height;
+        *link = ndp_cptr_encode(&t->cb, s);
+        // the link below n now lives in s
+        path[at + 1] = &s->right;
+    }
+
+    t->count--;
+    n->left = n->right = NDP_CPTR_NULL;
+    retrace(t, path, depth);
+    return n;
+}
+
+struct ndp_ctree_node *ndp_ctree_find(const struct ndp_ctree *t, const void *key)
+{
+    ndp_cptr_t c = t->root;
+
+    while (c) {
+        struct ndp_ctree_node *n = ndp_cptr_deref(&t->cb, c);
+        int d = t->cmp(n, key);
+
+        if (!d)
+            return n;
+        c = d > 0 ? n->left : n->right;
+    }
+    return NULL;
+}
+
+struct ndp_ctree_node *ndp_ctree_lower_bound(const struct ndp_ctree *t, const void *key)
+{
+    struct ndp_ctree_node *best = NULL;
+    ndp_cptr_t c = t->root;
+
+    while (c) {
+        struct ndp_ctree_node *n = ndp_cptr_deref(&t->cb, c);
+        int d = t->cmp(n, key);
+
+        if (!d)
+            return n;
+        if (d > 0) {
+            best = n;
+            c = n->left;
+        } else {
+            c = n->right;
+        }
+    }
+    return best;
+}
+
+void ndp_ctree_walk(const struct ndp_ctree *t, void (*fn)(struct ndp_ctree_node *, void *),
+                    void *arg)
+{
+    struct ndp_ctree_node *stack[NDP_CTREE_MAX_DEPTH];
+    ndp_cptr_t c = t->root;
+    int depth = 0;
+
+    while (c || depth) {
+        while (c) {
+            struct ndp_ctree_node *n = ndp_cptr_deref(&t->cb, c);
+            stack[depth++] = n;
+            c = n->left;
+        }
+        struct ndp_ctree_node *n = stack[--depth];
+        fn(n, arg);
+        c = n->right;
+    }
+}
@@ -0,0 +1,177 @@
+/*******************************************************************************
+ * @file               sarray.c
+ * @brief              Large arrays striped across the memory of every node.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            A table that is bigger than one node's pool, or that is
+ *                     scanned by every socket, is best spread over all memory
+ *                     controllers.  The array reserves one contiguous, huge
+ *                     page aligned virtual range and binds fixed-size stripes
+ *                     of it to nodes with mbind(), either round-robin or by
+ *                     weight.  The stripe table is kept so that callers can
+ *                     ask which node owns an index and schedule the work on
+ *                     that node instead of pulling the stripe across QPI/UPI.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "sarray.h"
+
+
+static int stripe_bind(void *addr, size_t len, int node)
+{
+    unsigned long mask[(NUMA_NUM_NODES + 8 * sizeof(unsigned long) - 1) /
+                       (8 * sizeof(unsigned long))] = { 0 };
+
+    mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    return mbind(addr, len, MPOL_BIND, mask, NUMA_NUM_NODES, 0);
+}
+
+/**
+ *  smooth weighted round-robin: every stripe goes to the node with the
+ *  largest running credit, which interleaves heavy nodes with light ones
+ *  instead of handing out long runs.
+ */
+static void stripe_assign(struct ndp_sarray *a, const int *nodes,
+                          const unsigned int *weights, int num_nodes)
+{
+    long credit[num_nodes];
+    long total = 0;
+
+    for (int i = 0; i < num_nodes; i++) {
+        credit[i] = 0;
+        total += weights ? weights[i] : 1;
+    }
+
+    for (unsigned int s = 0; s < a->num_stripes; s++) {
+        int best = 0;
+        for (int i = 0; i < num_nodes; i++) {
+            credit[i] += weights ? weights[i] : 1;
+            if (credit[i] > credit[best])
+                best = i;
+        }
+        credit[best] -= total;
+        a->stripe_node[s] = nodes[best];
+    }
+}
+
+int ndp_sarray_init(struct ndp_sarray *a, size_t elem_size, size_t n, size_t stripe_size,
+                    const int *nodes, const unsigned int *weights, int num_nodes,
+                    unsigned int flags)
+{
+    long total_weight = 0;
+    int max_node = numa_max_node();
+
+    memset(a, 0, sizeof(*a));
+    if (!elem_size || !n || num_nodes <= 0)
+        return -1;
+    for (int i = 0; i < num_nodes; i++) {
+        // stripe_bind() sets the node's bit in a mask sized for NUMA_NUM_NODES
+        if (nodes[i] < 0 || nodes[i] > max_node || nodes[i] >= NUMA_NUM_NODES)
+            return -1;
+        total_weight += weights ? weights[i] : 1;
+    }
+    if (!total_weight)
+        return -1;
+
+    if (!stripe_size)
+        stripe_size = NDP_SARRAY_STRIPE_MIN;
+    a->elem_size = elem_size;
+    a->n = n;
+    a->stripe_size = align_up(stripe_size, NDP_SARRAY_STRIPE_MIN);
+    if (elem_size > a->stripe_size)
+        return -1;
+    a->stripe_elems = a->stripe_size / elem_size;
+    a->num_stripes = (n + a->stripe_elems - 1) / a->stripe_elems;
+    a->stripe_node = calloc(a->num_stripes, sizeof(*a->stripe_node));
+    if (!a->stripe_node)
+        return -1;
+
+    // over-reserve by one stripe so the base can be aligned to a huge page
+    size_t len = (size_t)a->num_stripes * a->stripe_size;
+    a->map_size = len + NDP_SARRAY_STRIPE_MIN;
+    a->map = mmap(NULL, a->map_size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (a->map == MAP_FAILED)
+        goto sarray_fail;
+    a->base = (uint8_t *)align_up((uintptr_t)a->map, NDP_SARRAY_STRIPE_MIN);
+
+    if (!(flags & NDP_SARRAY_NOHUGE))
+        madvise(a->base, len, MADV_HUGEPAGE);
+
+    stripe_assign(a, nodes, weights, num_nodes);
+    for (unsigned int s = 0; s < a->num_stripes; s++) {
+        if (stripe_bind(a->base + (size_t)s * a->stripe_size, a->stripe_size,
+                        a->stripe_node[s]) != 0) {
+            perror("mbind stripe");
+            goto sarray_fail;
+        }
+    }
+
+    if (flags & NDP_SARRAY_PREFAULT) {
+        long page = sysconf(_SC_PAGESIZE);
+        volatile uint8_t *p = a->base;
+        for (size_t off = 0; off < len; off += page)
+            p[off] = 0;
+    }
+    return 0;
+
+sarray_fail:
+    ndp_sarray_destroy(a);
+    return -1;
+}
+
+void ndp_sarray_destroy(struct ndp_sarray *a)
+{
+    if (a->map && a->map != MAP_FAILED)
+        munmap(a->map, a->map_size);
+    free(a->stripe_node);
+    a->map = NULL;
+    a->base = NULL;
+    a->stripe_node = NULL;
+}
+
+int ndp_sarray_runs(const struct ndp_sarray *a, struct ndp_par_run **out)
+{
+    struct ndp_par_run *runs = malloc(sizeof(*runs) * a->num_stripes);
+    int nruns = 0;
+
+    if (!runs)
+        return -1;
+
+    for (unsigned int s = 0; s < a->num_stripes; s++) {
+        size_t begin = (size_t)s * a->stripe_elems;
+        size_t end = begin + a->stripe_elems < a->n ? begin + a->stripe_elems : a->n;
+
+        if (nruns && runs[nruns - 1].node == a->stripe_node[s]) {
+            runs[nruns - 1].end = end;
+            continue;
+        }
+        runs[nruns].begin = begin;
+        runs[nruns].end = end;
+        runs[nruns].node = a->stripe_node[s];
+        nruns++;
+    }
+    *out = runs;
+    return nruns;
+}
+
+int ndp_sarray_parallel_for(struct ndp_tsched *s, const struct ndp_sarray *a, size_t grain,
+                            ndp_range_fn fn, void *arg)
+{
+    struct ndp_par_run *runs;
+    int nruns = ndp_sarray_runs(a, &runs);
+
+    if (nruns < 0)
+        return -1;
+
+    // a stripe is the unit of placement, so it is also the default task size
+    if (!grain)
+        grain = a->stripe_elems;
+
+    int rc = ndp_parallel_for_runs(s, runs, nruns, grain, fn, arg);
+    free(runs);
+    return rc;
+}
@@ -0,0 +1,160 @@
+/*******************************************************************************
+ * @file               delegate.c
+ * @brief              Delegation of operations to the node that owns the data.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Contended shared state bounces between sockets when
+ *                     every thread locks it and touches it directly.  With
+ *                     delegation (after ffwd, Roghanchi et al., SOSP '17) only
+ *                     a server on the owning node ever touches the state;
+ *                     clients ship a function pointer and its arguments
+ *                     instead of pulling the cache lines.
+ *
+ *                     Every client owns one request line.  Posting a request
+ *                     fills it and flips the client's toggle bit.  The server
+ *                     polls the request lines, runs every pending request of
+ *                     a group of NDP_DELEGATE_GROUP clients and publishes all
+ *                     of their return values with a single response line
+ *                     write, so one cache line transfer answers up to seven
+ *                     clients.  No locks and no atomic read-modify-writes are
+ *                     used on the fast path.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "delegate.h"
+
+
+static void *ndp_delegate_thread(void *args)
+{
+    struct ndp_delegate_server *srv = args;
+
+    if (ndp_bind_thread_to_cpu(srv->cpu) < 0)
+        return NULL;
+
+    while (__atomic_load_n(&srv->running, __ATOMIC_ACQUIRE)) {
+        if (!ndp_delegate_serve(srv))
+            __builtin_ia32_pause();
+    }
+    return NULL;
+}
+
+int ndp_delegate_server_init(struct ndp_delegate_server *srv, struct mempool_sys *mem,
+                             int node, void *state, unsigned int max_clients, int cpu)
+{
+    unsigned int groups = (max_clients + NDP_DELEGATE_GROUP - 1) / NDP_DELEGATE_GROUP;
+
+    memset(srv, 0, sizeof(*srv));
+    if (!max_clients)
+        return -1;
+
+    srv->reqs = ndp_mempool_alloc(mem, node, sizeof(*srv->reqs) * max_clients,
+                                  NDP_CACHE_LINE);
+    srv->resps = ndp_mempool_alloc(mem, node, sizeof(*srv->resps) * groups,
+                                   NDP_CACHE_LINE);
+    srv->seen = ndp_mempool_alloc(mem, node, sizeof(*srv->seen) * groups, NDP_CACHE_LINE);
+    if (!srv->reqs || !srv->resps || !srv->seen)
+        return -1;
+
+    memset(srv->reqs, 0, sizeof(*srv->reqs) * max_clients);
+    memset(srv->resps, 0, sizeof(*srv->resps) * groups);
+    memset(srv->seen, 0, sizeof(*srv->seen) * groups);
+    srv->max_clients = max_clients;
+    srv->state = state;
+    srv->node = node;
+    srv->cpu = cpu;
+
+    if (cpu < 0)
+        return 0;
+
+    srv->running = true;
+    if (pthread_create(&srv->thread, NULL, ndp_delegate_thread, srv) != 0) {
+        srv->running = false;
+        return -1;
+    }
+    return 0;
+}
+
+void ndp_delegate_server_destroy(struct ndp_delegate_server *srv)
+{
+    if (srv->cpu < 0 || !srv->running)
+        return;
+
+    __atomic_store_n(&srv->running, false, __ATOMIC_RELEASE);
+    pthread_join(srv->thread, NULL);
+}
+
+int ndp_delegate_serve(struct ndp_delegate_server *srv)
+{
+    unsigned int n = __atomic_load_n(&srv->num_clients, __ATOMIC_ACQUIRE);
+    int served = 0;
+
+    for (unsigned int first = 0, g = 0; first < n; first += NDP_DELEGATE_GROUP, g++) {
+        struct ndp_delegate_resp *resp = &srv->resps[g];
+        uint64_t toggles = srv->seen[g];
+        unsigned int last = first + NDP_DELEGATE_GROUP < n ? first + NDP_DELEGATE_GROUP : n;
+
+        for (unsigned int c = first; c < last; c++) {
+            struct ndp_delegate_req *req = &srv->reqs[c];
+            unsigned int bit = c - first;
+            uint64_t t = __atomic_load_n(&req->toggle, __ATOMIC_ACQUIRE);
+
+            if (t == ((toggles >> bit) & 1))
+                continue;
+
+            // the client does not look at ret[] until its toggle bit flips,
+            // so results can be written in place before the line is published
+            resp->ret[bit] = req->fn(srv->state, req->args);
+            toggles ^= 1ULL << bit;
+            served++;
+        }
+
+        if (toggles != srv->seen[g]) {
+            __atomic_store_n(&resp->toggles, toggles, __ATOMIC_RELEASE);
+            srv->seen[g] = toggles;
+            srv->batches++;
+        }
+    }
+
+    srv->served += served;
+    return served;
+}
+
+int ndp_delegate_poll(void *arg)
+{
+    return ndp_delegate_serve(arg);
+}
+
+int ndp_delegate_client_init(struct ndp_delegate_server *srv, struct ndp_delegate_client *cl)
+{
+    unsigned int slot = __atomic_load_n(&srv->num_clients, __ATOMIC_RELAXED);
+
+    // claim the slot with a CAS so a full server never publishes a slot
+    // index beyond max_clients to its scan loop
+    do {
+        if (slot >= srv->max_clients)
+            return -1;
+    } while (!__atomic_compare_exchange_n(&srv->num_clients, &slot, slot + 1, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    cl->req = &srv->reqs[slot];
+    cl->resp = &srv->resps[slot / NDP_DELEGATE_GROUP];
+    cl->bit = slot % NDP_DELEGATE_GROUP;
+    cl->toggle = 0;
+    return 0;
+}
+
+void ndp_delegate_post(struct ndp_delegate_client *cl, ndp_delegate_fn fn,
+                       const uint64_t *args, int nargs)
+{
+    struct ndp_delegate_req *req = cl->req;
+
+    req->fn = fn;
+    for (int i = 0; i < nargs && i < NDP_DELEGATE_ARGS; i++)
+        req->args[i] = args[i];
+
+    cl->toggle ^= 1;
+    __atomic_store_n(&req->toggle, cl->toggle, __ATOMIC_RELEASE);
+}
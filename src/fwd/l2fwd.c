@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * @file               l2fwd.c
+ * @brief              MAC swap forwarder.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Reference workload for the port and buffer layers:
+ *                     every received frame goes back out with its MAC
+ *                     addresses swapped.  What the tx queue does not take
+ *                     is freed, as a NIC driver drops on a full ring.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "fwd.h"
+
+
+struct ndp_l2fwd *ndp_l2fwd_create(struct mempool_sys *mem, int node, struct ndp_port *rx_port,
+                                   uint16_t rx_queue, struct ndp_port *tx_port, uint16_t tx_queue)
+{
+    struct ndp_l2fwd *f;
+
+    if (rx_queue >= rx_port->num_queues || tx_queue >= tx_port->num_queues)
+        return NULL;
+    if (!(f = ndp_mempool_alloc(mem, node, sizeof(*f), NDP_CACHE_LINE)))
+        return NULL;
+
+    memset(f, 0, sizeof(*f));
+    f->rx_port = rx_port;
+    f->rx_queue = rx_queue;
+    f->tx_port = tx_port;
+    f->tx_queue = tx_queue;
+    return f;
+}
+
+static inline void mac_swap(struct ndp_buf *b)
+{
+    struct ndp_ether_hdr *eth = ndp_buf_mtod(b, struct ndp_ether_hdr *);
+    uint8_t tmp[NDP_ETHER_ADDR_LEN];
+
+    memcpy(tmp, eth->dst, NDP_ETHER_ADDR_LEN);
+    memcpy(eth->dst, eth->src, NDP_ETHER_ADDR_LEN);
+    memcpy(eth->src, tmp, NDP_ETHER_ADDR_LEN);
+}
+
+int ndp_l2fwd_poll(void *arg)
+{
+    struct ndp_l2fwd *f = arg;
+    struct ndp_buf *bufs[NDP_FWD_BURST];
+    uint16_t n, sent;
+
+    if (!(n = ndp_port_rx_burst(f->rx_port, f->rx_queue, bufs, NDP_FWD_BURST)))
+        return 0;
+
+    for (uint16_t i = 0; i < n; i++) {
+        if (i + 2 < n)
+            __builtin_prefetch(ndp_buf_mtod(bufs[i + 2], void *), 1);
+        mac_swap(bufs[i]);
+    }
+
+    sent = ndp_port_tx_burst_free(f->tx_port, f->tx_queue, bufs, n);
+    f->dropped += n - sent;
+    return n;
+}
@@ -0,0 +1,272 @@
+/*******************************************************************************
+ * @file               graph.c
+ * @brief              Vector packet processing graph for the worker runtime.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Forwarding logic is composed as a graph of small nodes
+ *                     (parse, classify, rewrite, output) in the style of VPP.
+ *                     A node is called once per frame of up to NDP_GRAPH_FRAME
+ *                     buffers instead of once per packet, so its instructions
+ *                     stay in the i-cache for the whole vector and fixed
+ *                     per-call costs are amortised across it.
+ *
+ *                     Every node owns an input frame.  A node sorts its input
+ *                     into the frames of its next nodes, which are queued to
+ *                     run after it; when every buffer goes to the same next
+ *                     node the frame itself is handed over without touching
+ *                     the buffer pointers.  A graph instance belongs to one
+ *                     worker and is walked from its poll loop, and all frames
+ *                     live on that worker's node.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "graph.h"
+
+
+static uint16_t drop_node(struct ndp_graph *g, struct ndp_graph_node *n,
+                          struct ndp_buf **bufs, uint16_t count)
+{
+    (void)g;
+    (void)n;
+    ndp_buf_free_bulk(bufs, count);
+    return count;
+}
+
+static struct ndp_buf **frame_alloc(struct ndp_graph *g)
+{
+    return ndp_mempool_alloc(g->mem, g->node, sizeof(struct ndp_buf *) * NDP_GRAPH_FRAME,
+                             NDP_CACHE_LINE);
+}
+
+struct ndp_graph *ndp_graph_create(struct mempool_sys *mem, int node, uint16_t max_nodes)
+{
+    struct ndp_graph *g = ndp_mempool_alloc(mem, node, sizeof(*g), NDP_CACHE_LINE);
+
+    if (!g || !max_nodes)
+        return NULL;
+
+    memset(g, 0, sizeof(*g));
+    g->mem = mem;
+    g->node = node;
+    g->max_nodes = max_nodes;
+    g->nodes = ndp_mempool_alloc(mem, node, sizeof(*g->nodes) * max_nodes, NDP_CACHE_LINE);
+    g->pending = ndp_mempool_alloc(mem, node, sizeof(*g->pending) * (max_nodes + 1), 0);
+    g->spares = ndp_mempool_alloc(mem, node, sizeof(*g->spares) * max_nodes, 0);
+    if (!g->nodes || !g->pending || !g->spares)
+        return NULL;
+
+    if (ndp_graph_add_node(g, "drop", drop_node, NULL, 0) != NDP_GRAPH_DROP)
+        return NULL;
+    return g;
+}
+
+int ndp_graph_add_node(struct ndp_graph *g, const char *name, ndp_node_fn fn, void *ctx,
+                       unsigned int flags)
+{
+    if (g->num_nodes >= g->max_nodes || ndp_graph_lookup(g, name) >= 0)
+        return -1;
+
+    struct ndp_graph_node *n = &g->nodes[g->num_nodes];
+    struct ndp_buf **spare = frame_alloc(g);
+
+    memset(n, 0, sizeof(*n));
+    if (!(n->frame = frame_alloc(g)) || !spare)
+        return -1;
+
+    // every node brings a spare frame: a frame is detached from its node
+    // while it is being processed, nested flushes included.  The graph has
+    // no cycles, so a node is on the flush stack at most once and a spare
+    // per node is always enough.
+    g->spares[g->num_spares++] = spare;
+
+    n->fn = fn;
+    n->ctx = ctx;
+    n->flags = flags;
+    n->id = g->num_nodes;
+    snprintf(n->name, sizeof(n->name), "%s", name);
+    return g->num_nodes++;
+}
+
+/* 1 when `to` is reachable from `from` over next edges, 0 when not, -1 on failure */
+static int reachable(const struct ndp_graph *g, uint16_t from, uint16_t to)
+{
+    uint16_t *stack = malloc(sizeof(*stack) * g->num_nodes);
+    bool *seen = calloc(g->num_nodes, sizeof(*seen));
+    uint16_t depth = 0;
+    int found = 0;
+
+    if (!stack || !seen) {
+        found = -1;
+        goto reachable_done;
+    }
+
+    // every node is pushed at most once, so num_nodes entries suffice
+    stack[depth++] = from;
+    seen[from] = true;
+    while (depth && !found) {
+        const struct ndp_graph_node *n = &g->nodes[stack[--depth]];
+
+        for (uint16_t i = 0; i < n->num_next; i++) {
+            uint16_t v = n->next[i];
+
+            if (v == to) {
+                found = 1;
+                break;
+            }
+            if (!seen[v]) {
+                seen[v] = true;
+                stack[depth++] = v;
+            }
+        }
+    }
+
+reachable_done:
+    free(seen);
+    free(stack);
+    return found;
+}
+
+int ndp_graph_add_edge(struct ndp_graph *g, uint16_t from, uint16_t to)
+{
+    if (from >= g->num_nodes || to >= g->num_nodes || from == to)
+        return -1;
+
+    struct ndp_graph_node *n = &g->nodes[from];
+    for (uint16_t i = 0; i < n->num_next; i++) {
+        if (n->next[i] == to)
+            return i;
+    }
+    if (n->num_next >= NDP_GRAPH_MAX_NEXT)
+        return -1;
+    // a cycle would let flushes nest without bound and run out of spare frames
+    if (reachable(g, to, from) != 0)
+        return -1;
+
+    n->next[n->num_next] = to;
+    return n->num_next++;
+}
+
+int ndp_graph_lookup(const struct ndp_graph *g, const char *name)
+{
+    for (uint16_t i = 0; i < g->num_nodes; i++) {
+        if (!strncmp(g->nodes[i].name, name, NDP_GRAPH_NAME))
+            return i;
+    }
+    return -1;
+}
+
+/**
+ *  detach the node's frame, give it a spare one for anything enqueued to
+ *  it while it runs, and recycle the old frame unless the node handed it
+ *  to a successor with ndp_graph_move_frame().
+ */
+static uint16_t node_run(struct ndp_graph *g, struct ndp_graph_node *n)
+{
+    struct ndp_buf **in = n->frame;
+    struct ndp_buf **outer_in = g->in;
+    struct ndp_buf **moved = g->moved;
+    uint16_t count = n->count;
+    uint64_t t0 = ndp_rdtsc();
+
+    n->frame = g->spares[--g->num_spares];
+    n->count = 0;
+    g->in = in;
+    g->moved = NULL;
+
+    uint16_t done = n->fn(g, n, in, count);
+
+    if (g->moved != in)
+        g->spares[g->num_spares++] = in;
+    g->in = outer_in;
+    g->moved = moved;
+
+    n->calls++;
+    n->bufs += done;
+    n->cycles += ndp_rdtsc() - t0;
+    return done;
+}
+
+void ndp_graph_flush(struct ndp_graph *g, struct ndp_graph_node *n)
+{
+    if (n->count)
+        node_run(g, n);
+}
+
+void ndp_graph_enqueue_burst(struct ndp_graph *g, struct ndp_graph_node *n, uint16_t next,
+                             struct ndp_buf **bufs, uint16_t count)
+{
+    struct ndp_graph_node *to = ndp_graph_next_node(g, n, next);
+
+    while (count) {
+        uint16_t room = NDP_GRAPH_FRAME - to->count;
+        if (!room) {
+            ndp_graph_flush(g, to);
+            continue;
+        }
+        if (room > count)
+            room = count;
+        memcpy(&to->frame[to->count], bufs, sizeof(*bufs) * room);
+        to->count += room;
+        bufs += room;
+        count -= room;
+    }
+    ndp_graph_schedule(g, to);
+}
+
+void ndp_graph_move_frame(struct ndp_graph *g, struct ndp_graph_node *n, uint16_t next,
+                          struct ndp_buf **bufs, uint16_t count)
+{
+    struct ndp_graph_node *to = ndp_graph_next_node(g, n, next);
+
+    // only the frame being processed can be handed over, and only once
+    if (to->count || bufs != g->in || g->moved) {
+        ndp_graph_enqueue_burst(g, n, next, bufs, count);
+        return;
+    }
+
+    // swap: the successor takes the frame, its empty frame becomes a spare
+    g->spares[g->num_spares++] = to->frame;
+    to->frame = bufs;
+    to->count = count;
+    g->moved = bufs;
+    ndp_graph_schedule(g, to);
+}
+
+int ndp_graph_poll(void *arg)
+{
+    struct ndp_graph *g = arg;
+    int work = 0;
+
+    for (uint16_t i = 0; i < g->num_nodes; i++) {
+        if (g->nodes[i].flags & NDP_NODE_SOURCE)
+            work += node_run(g, &g->nodes[i]);
+    }
+
+    while (g->head != g->tail) {
+        struct ndp_graph_node *n = &g->nodes[g->pending[g->head]];
+
+        g->head = (g->head + 1) % (g->max_nodes + 1);
+        n->queued = false;
+        if (n->count)
+            work += node_run(g, n);
+    }
+    return work;
+}
+
+void ndp_graph_stats_report(const struct ndp_graph *g, FILE *out)
+{
+    fprintf(out, "%-32s %12s %14s %12s %10s\n", "node", "calls", "bufs", "bufs/call",
+            "cyc/buf");
+    for (uint16_t i = 0; i < g->num_nodes; i++) {
+        const struct ndp_graph_node *n = &g->nodes[i];
+        if (!n->calls)
+            continue;
+        fprintf(out, "%-32s %12lu %14lu %12.1f %10.1f\n", n->name,
+                (unsigned long)n->calls, (unsigned long)n->bufs,
+                (double)n->bufs / (double)n->calls,
+                n->bufs ? (double)n->cycles / (double)n->bufs : 0.0);
+    }
+}
@@ -0,0 +1,138 @@
+
+#ifndef INCLUDE_ACL_H
+#define INCLUDE_ACL_H
+
+#include "burst.h"
+#include "qsbr.h"
+
+#define NDP_ACL_DIMS            5       /* src, dst, sport, dport, proto */
+#define NDP_ACL_LANES           8       /* rules evaluated per AVX2 compare */
+#define NDP_ACL_MAX_NODES       64
+#define NDP_ACL_LEAF_DIM        0xff
+#define NDP_ACL_NO_MATCH        UINT32_MAX
+#define NDP_ACL_BIAS            0x80000000U
+
+enum ndp_acl_dim
+{
+    NDP_ACL_SRC,
+    NDP_ACL_DST,
+    NDP_ACL_SPORT,
+    NDP_ACL_DPORT,
+    NDP_ACL_PROTO,
+};
+
+/* IPv4 5-tuple rule; addresses in host order, proto 0 matches any */
+struct ndp_acl_rule
+{
+    uint32_t src;
+    uint32_t dst;
+    uint8_t src_depth;
+    uint8_t dst_depth;
+    uint8_t proto;
+    uint16_t sport_lo;
+    uint16_t sport_hi;
+    uint16_t dport_lo;
+    uint16_t dport_hi;
+    uint32_t priority;          /* higher wins */
+    uint32_t action;
+};
+
+/**
+ * decision tree node
+ *
+ * @brief inner nodes split one dimension at `value`: keys <= value go to
+ *        `child`, larger keys to child + 1.  A leaf (dim NDP_ACL_LEAF_DIM)
+ *        holds the index of its first leaf block in `value`.
+ */
+struct ndp_acl_node
+{
+    uint32_t value;
+    uint32_t child;
+    uint8_t dim;
+};
+
+/**
+ * leaf block: up to eight rules in structure-of-arrays form
+ *
+ * @brief bounds are stored xor 0x80000000 so signed AVX2 compares give
+ *        unsigned order; lanes are in descending priority and blocks of a
+ *        leaf chain through `next`, so the first matching lane wins.
+ */
+struct ndp_acl_leaf
+{
+    uint32_t lo[NDP_ACL_DIMS][NDP_ACL_LANES];
+    uint32_t hi[NDP_ACL_DIMS][NDP_ACL_LANES];
+    uint32_t action[NDP_ACL_LANES];
+    uint32_t next;
+} __ndp_cache_aligned;
+
+/* a compiled rule set in one node-local huge page mapping */
+struct ndp_acl_tbl
+{
+    const struct ndp_acl_node *nodes;
+    const struct ndp_acl_leaf *leaves;
+    uint32_t num_nodes;
+    uint32_t num_leaves;
+    uint32_t num_rules;
+    size_t map_size;
+    int node;
+};
+
+/**
+ * ACL classifier
+ *
+ * @brief rules are edited on the control plane; ndp_acl_commit() compiles
+ *        them into a decision tree (HyperSplit style: binary range splits
+ *        on the dimension that best divides the rules, until a leaf holds
+ *        at most NDP_ACL_LANES of them), copies it to every node and swaps
+ *        it in behind a QSBR grace period.  The hot path walks a handful
+ *        of nodes and compares the packet against a leaf with a few vector
+ *        instructions, independent of the total rule count.
+ */
+struct ndp_acl
+{
+    struct ndp_acl_tbl *tbl_of[NDP_ACL_MAX_NODES];
+
+    struct ndp_acl_tbl *active[NDP_ACL_MAX_NODES];
+    int nodes[NDP_ACL_MAX_NODES];
+    int replica_of[NDP_ACL_MAX_NODES];
+    int num_nodes;
+    struct ndp_qsbr *qsbr;
+
+    pthread_mutex_t lock;
+    struct ndp_acl_rule *rules;
+    bool *live;
+    uint32_t max_rules;
+    uint32_t num_slots;
+};
+
+/**
+ * replicas on `nodes`, other nodes read the nearest.  Without a QSBR domain
+ * a commit unmaps the old tables as soon as the new ones are published, so
+ * the caller must keep every lookup out of commits.
+ */
+struct ndp_acl *ndp_acl_create(const int *, int, uint32_t, struct ndp_qsbr *);
+void ndp_acl_destroy(struct ndp_acl *);
+
+/* returns the rule id, -1 when full; edits apply at the next commit */
+int ndp_acl_add(struct ndp_acl *, const struct ndp_acl_rule *);
+int ndp_acl_delete(struct ndp_acl *, int);
+
+/* compile and publish, then retire the old tables; they stay active on failure */
+int ndp_acl_commit(struct ndp_acl *);
+
+static inline const struct ndp_acl_tbl *ndp_acl_table(const struct ndp_acl *acl, int node)
+{
+    return __atomic_load_n(&acl->tbl_of[node], __ATOMIC_ACQUIRE);
+}
+
+/* action of the highest priority rule matching a host order key, or NDP_ACL_NO_MATCH */
+uint32_t ndp_acl_classify(const struct ndp_acl_tbl *, const uint32_t *);
+
+/**
+ * classify a parsed burst into actions[]; packets other than IPv4 get
+ * NDP_ACL_NO_MATCH, non TCP/UDP packets match with ports 0.
+ */
+void ndp_acl_classify_burst(const struct ndp_acl_tbl *, const struct ndp_burst *, uint32_t *);
+
+#endif  /* INCLUDE_ACL_H */
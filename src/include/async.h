@@ -0,0 +1,143 @@
+
+#ifndef INCLUDE_ASYNC_H
+#define INCLUDE_ASYNC_H
+
+#include "objpool.h"
+
+#include <semaphore.h>
+#include <liburing.h>
+
+/**
+ * completion callback
+ *
+ * @brief every asynchronous operation finishes by calling cb(ctx, res) on
+ *        an executor thread.  A C++20 awaiter passes its coroutine handle
+ *        address as ctx and a trampoline that stores res and resumes the
+ *        handle as cb; plain C callers use it as an ordinary callback.
+ */
+typedef void (*ndp_async_cb)(void *ctx, intptr_t res);
+
+enum ndp_async_kind
+{
+    NDP_ASYNC_CALL,
+    NDP_ASYNC_COPY,
+    NDP_ASYNC_READ,
+    NDP_ASYNC_WRITE,
+    NDP_ASYNC_STOP,
+};
+
+/* one pending operation; records come from the posting executor's node */
+struct ndp_async_op
+{
+    struct ndp_async_op *next;
+    struct ndp_objpool *owner;
+    enum ndp_async_kind kind;
+    ndp_async_cb cb;
+    void *ctx;
+    intptr_t res;
+
+    void *dst;
+    const void *src;
+    size_t len;
+    int fd;
+    off_t off;
+    struct ndp_executor *done;
+};
+
+/**
+ * per-node executor
+ *
+ * @brief a single thread bound to the node that runs posted callbacks and
+ *        owns an io_uring.  The thread only ever sleeps in the ring: posts
+ *        from other threads are signalled through an eventfd whose read is
+ *        kept armed in the ring, so I/O completions and cross-thread posts
+ *        share one wait.
+ */
+struct ndp_executor
+{
+    pthread_mutex_t lock;
+    struct ndp_async_op *head;
+    struct ndp_async_op *tail;
+    bool signalled;
+    bool stopping;              /* STOP queued, no further posts */
+    int efd;
+
+    pthread_t thread;
+    struct io_uring ring;
+    uint64_t efd_buf;
+    unsigned int depth;
+    unsigned int inflight;
+    bool running;
+    int status;
+    sem_t ready;
+
+    struct ndp_objpool *ops;
+    int node;
+} __ndp_cache_aligned;
+
+struct ndp_executor_sys
+{
+    struct ndp_executor **execs;
+    int num_nodes;
+    struct mempool_sys *mem;
+};
+
+/**
+ * pool with waiters
+ *
+ * @brief wraps an object pool so that an allocation that finds the pool
+ *        empty suspends instead of failing.  Frees hand the object straight
+ *        to the oldest waiter, which is resumed on its own executor.
+ */
+struct ndp_async_pool
+{
+    pthread_mutex_t lock;
+    struct ndp_objpool *pool;
+    struct ndp_async_op *head;
+    struct ndp_async_op *tail;
+    unsigned long waits;
+};
+
+/* start one executor per node, each with `depth` ring entries and op records */
+int ndp_executor_sys_init(struct ndp_executor_sys *, struct mempool_sys *, unsigned int);
+void ndp_executor_sys_destroy(struct ndp_executor_sys *);
+
+struct ndp_executor *ndp_executor_of_node(struct ndp_executor_sys *, int);
+
+/* executor of the node that backs addr; pool memory first, then the kernel */
+struct ndp_executor *ndp_executor_of_addr(struct ndp_executor_sys *, const void *);
+
+/**
+ * run cb(ctx, res) on ex.  Like every post, fails with -1 when ex is out of
+ * op records or is being stopped.  A copy or pool waiter whose completion
+ * executor is stopping completes on the calling thread with res = -ECANCELED.
+ */
+int ndp_async_post(struct ndp_executor *, ndp_async_cb, void *, intptr_t);
+
+/**
+ * copy len bytes on the executor local to dst, then complete on `done`
+ * with res = len.
+ */
+int ndp_async_copy(struct ndp_executor_sys *, void *, const void *, size_t,
+                   struct ndp_executor *, ndp_async_cb, void *);
+
+/* io_uring read/write on ex; res is the cqe result (bytes or -errno) */
+int ndp_async_read(struct ndp_executor *, int, void *, size_t, off_t,
+                   ndp_async_cb, void *);
+int ndp_async_write(struct ndp_executor *, int, const void *, size_t, off_t,
+                    ndp_async_cb, void *);
+
+int ndp_async_pool_init(struct ndp_async_pool *, struct ndp_objpool *);
+void ndp_async_pool_destroy(struct ndp_async_pool *);
+
+/**
+ * allocate from an async pool
+ *
+ * @return 0 and *obj set when the pool had an object, 1 when the caller
+ *         was queued (cb later runs on ex with res = object), -1 on error.
+ */
+int ndp_async_alloc(struct ndp_async_pool *, struct ndp_executor *, void **,
+                    ndp_async_cb, void *);
+void ndp_async_free(struct ndp_async_pool *, void *);
+
+#endif  /* INCLUDE_ASYNC_H */
@@ -0,0 +1,164 @@
+
+#ifndef INCLUDE_BUF_H
+#define INCLUDE_BUF_H
+
+#include "objpool.h"
+
+#define NDP_BUF_HEADROOM        128
+
+/* buf flags */
+#define NDP_BUF_F_IPV4          0x0001
+#define NDP_BUF_F_IPV6          0x0002
+#define NDP_BUF_F_TCP           0x0004
+#define NDP_BUF_F_UDP           0x0008
+#define NDP_BUF_F_VLAN          0x0010
+#define NDP_BUF_F_FRAG          0x0020
+#define NDP_BUF_F_CKSUM_BAD     0x0040
+#define NDP_BUF_F_HASH          0x0080
+#define NDP_BUF_F_GRO           0x0100  /* coalesced, one segment per original payload */
+
+struct ndp_buf_pool;
+
+/**
+ * packet buffer
+ *
+ * @brief the descriptor sits at the start of an A_SPAN or B_SPAN element and
+ *        the data room follows it, so a buffer is a single allocation from a
+ *        node-local pool.  Large packets chain segments through `next`.
+ */
+struct ndp_buf
+{
+    uint8_t *buf_addr;
+    struct ndp_buf *next;
+    struct ndp_buf_pool *pool;
+    uint32_t pkt_len;       /* total over the chain, valid in the first segment */
+    uint16_t data_off;
+    uint16_t data_len;      /* this segment */
+    uint16_t buf_len;
+    uint16_t nb_segs;
+    uint16_t refcnt;
+    uint16_t port;
+    uint32_t hash;
+    uint32_t flags;
+    uint64_t tsc;
+    uint64_t udata;
+} __ndp_cache_aligned;
+
+struct ndp_buf_pool
+{
+    struct ndp_objpool *op;
+    uint16_t span;
+    int node;
+};
+
+/* `count` buffers of `span` bytes (A_SPAN or B_SPAN) on `node` */
+struct ndp_buf_pool *ndp_buf_pool_create(struct mempool_sys *, int, uint16_t, unsigned int);
+
+struct ndp_buf *ndp_buf_alloc(struct ndp_buf_pool *);
+unsigned int ndp_buf_alloc_bulk(struct ndp_buf_pool *, struct ndp_buf **, unsigned int);
+
+/* drop a reference to every segment of the chain */
+void ndp_buf_free(struct ndp_buf *);
+
+/* free a burst, batching the puts of consecutive buffers from the same pool */
+void ndp_buf_free_bulk(struct ndp_buf **, unsigned int);
+
+static inline void ndp_buf_reset(struct ndp_buf *b)
+{
+    b->next = NULL;
+    b->pkt_len = 0;
+    b->data_off = NDP_BUF_HEADROOM;
+    b->data_len = 0;
+    b->nb_segs = 1;
+    b->refcnt = 1;
+    b->port = 0;
+    b->hash = 0;
+    b->flags = 0;
+    b->tsc = 0;
+    b->udata = 0;
+}
+
+#define ndp_buf_mtod(b, type)           ((type)((b)->buf_addr + (b)->data_off))
+#define ndp_buf_mtod_offset(b, type, o) ((type)((b)->buf_addr + (b)->data_off + (o)))
+
+static inline uint16_t ndp_buf_headroom(const struct ndp_buf *b)
+{
+    return b->data_off;
+}
+
+static inline uint16_t ndp_buf_tailroom(const struct ndp_buf *b)
+{
+    return b->buf_len - b->data_off - b->data_len;
+}
+
+static inline struct ndp_buf *ndp_buf_last(struct ndp_buf *b)
+{
+    while (b->next)
+        b = b->next;
+    return b;
+}
+
+/* grow at the front, NULL without headroom */
+static inline void *ndp_buf_prepend(struct ndp_buf *b, uint16_t len)
+{
+    if (len > b->data_off)
+        return NULL;
+    b->data_off -= len;
+    b->data_len += len;
+    b->pkt_len += len;
+    return b->buf_addr + b->data_off;
+}
+
+/* grow at the end of the last segment, NULL without tailroom */
+static inline void *ndp_buf_append(struct ndp_buf *b, uint16_t len)
+{
+    struct ndp_buf *last = ndp_buf_last(b);
+    void *tail;
+
+    if (len > ndp_buf_tailroom(last))
+        return NULL;
+    tail = last->buf_addr + last->data_off + last->data_len;
+    last->data_len += len;
+    b->pkt_len += len;
+    return tail;
+}
+
+/* trim from the front of the first segment */
+static inline void *ndp_buf_adj(struct ndp_buf *b, uint16_t len)
+{
+    if (len > b->data_len)
+        return NULL;
+    b->data_off += len;
+    b->data_len -= len;
+    b->pkt_len -= len;
+    return b->buf_addr + b->data_off;
+}
+
+/* cut from the end of the last segment, -1 if it is shorter */
+static inline int ndp_buf_trim(struct ndp_buf *b, uint16_t len)
+{
+    struct ndp_buf *last = ndp_buf_last(b);
+
+    if (len > last->data_len)
+        return -1;
+    last->data_len -= len;
+    b->pkt_len -= len;
+    return 0;
+}
+
+/* link seg after the last segment of head */
+static inline void ndp_buf_chain(struct ndp_buf *head, struct ndp_buf *seg)
+{
+    ndp_buf_last(head)->next = seg;
+    head->nb_segs += seg->nb_segs;
+    head->pkt_len += seg->pkt_len;
+}
+
+/* take a reference to every segment, matching ndp_buf_free() */
+static inline void ndp_buf_ref(struct ndp_buf *b)
+{
+    for (; b; b = b->next)
+        __atomic_add_fetch(&b->refcnt, 1, __ATOMIC_RELAXED);
+}
+
+#endif  /* INCLUDE_BUF_H */
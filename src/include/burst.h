@@ -0,0 +1,54 @@
+
+#ifndef INCLUDE_BURST_H
+#define INCLUDE_BURST_H
+
+#include "buf.h"
+
+#define NDP_BURST_MAX           256
+
+/**
+ * structure-of-arrays burst metadata
+ *
+ * @brief one array per field, each cache-line aligned, so a stage that
+ *        looks at a single field (lengths, hashes, flags) streams through
+ *        it with full-width vector loads instead of chasing one buffer
+ *        descriptor per packet.  Offsets are relative to the packet start.
+ */
+struct ndp_burst
+{
+    uint16_t count;
+    int node;
+
+    struct ndp_buf *bufs[NDP_BURST_MAX] __ndp_cache_aligned;
+    uint8_t *data[NDP_BURST_MAX] __ndp_cache_aligned;
+    uint32_t len[NDP_BURST_MAX] __ndp_cache_aligned;
+    uint32_t hash[NDP_BURST_MAX] __ndp_cache_aligned;
+    uint32_t next_hop[NDP_BURST_MAX] __ndp_cache_aligned;
+    uint32_t flags[NDP_BURST_MAX] __ndp_cache_aligned;
+    uint16_t l3_off[NDP_BURST_MAX] __ndp_cache_aligned;
+    uint16_t l4_off[NDP_BURST_MAX] __ndp_cache_aligned;
+    uint16_t port[NDP_BURST_MAX] __ndp_cache_aligned;
+};
+
+/* allocate a burst descriptor from `node`'s pool */
+struct ndp_burst *ndp_burst_create(struct mempool_sys *, int);
+
+/**
+ * load per-packet metadata from the buffer descriptors into the arrays;
+ * offsets are reset, next_hop is taken from udata.
+ */
+void ndp_burst_gather(struct ndp_burst *, struct ndp_buf **, uint16_t);
+
+/* write hash, flags and next_hop (as udata) back to the buffers */
+void ndp_burst_scatter(const struct ndp_burst *);
+
+/**
+ * collect the indices of packets with (flags & mask) == value into idx;
+ * returns how many matched.
+ */
+uint16_t ndp_burst_select(const struct ndp_burst *, uint32_t, uint32_t, uint16_t *);
+
+/* keep only the packets listed in idx, in order, compacting every array */
+void ndp_burst_compact(struct ndp_burst *, const uint16_t *, uint16_t);
+
+#endif  /* INCLUDE_BURST_H */
@@ -0,0 +1,123 @@
+
+#ifndef INCLUDE_CAPTURE_H
+#define INCLUDE_CAPTURE_H
+
+#include "buf.h"
+#include "ring.h"
+#include "cycles.h"
+
+#include <liburing.h>
+#include <sys/uio.h>
+
+#define NDP_CAPTURE_BATCH       128     /* packets per write */
+#define NDP_CAPTURE_MAX_SEGS    4       /* segments captured per packet */
+#define NDP_CAPTURE_IOV         (NDP_CAPTURE_BATCH * (NDP_CAPTURE_MAX_SEGS + 2))
+
+#define NDP_PCAPNG_SHB          0x0a0d0d0a
+#define NDP_PCAPNG_IDB          0x00000001
+#define NDP_PCAPNG_EPB          0x00000006
+#define NDP_PCAPNG_MAGIC        0x1a2b3c4d
+#define NDP_PCAPNG_LINK_ETHER   1
+
+/* enhanced packet block framing around the packet bytes */
+struct ndp_pcapng_epb
+{
+    uint32_t type;
+    uint32_t total_len;
+    uint32_t iface;
+    uint32_t ts_high;
+    uint32_t ts_low;
+    uint32_t cap_len;
+    uint32_t orig_len;
+};
+
+struct ndp_capture_rec
+{
+    struct ndp_pcapng_epb epb;
+    uint8_t pad[4];             /* the data is padded to 32 bits from here */
+    uint32_t total_len;
+};
+
+/**
+ * one vectored write in flight
+ *
+ * @brief the iovecs point at the packet segments themselves; the buffers
+ *        hold a reference until the write completes, only the block
+ *        framing lives in the batch.
+ */
+struct ndp_capture_batch
+{
+    struct ndp_capture *cap;
+    struct ndp_buf *bufs[NDP_CAPTURE_BATCH];
+    struct ndp_capture_rec recs[NDP_CAPTURE_BATCH];
+    struct iovec iov[NDP_CAPTURE_IOV];
+    uint16_t count;
+    uint16_t iovcnt;
+    uint16_t iov_first;
+    size_t bytes;
+    off_t offset;
+};
+
+struct ndp_capture_stats
+{
+    uint64_t packets;           /* written */
+    uint64_t bytes;             /* handed to the file */
+    uint64_t batches;
+    uint64_t dropped_queue;     /* capture queue full at enqueue */
+    uint64_t dropped_io;        /* after a write error */
+};
+
+/**
+ * per-node pcapng capture
+ *
+ * @brief forwarding workers hand packets to ndp_capture_burst(), which
+ *        takes a reference and enqueues the pointer: no copy and no system
+ *        call on the forwarding path.  A writer (ndp_capture_poll() as a
+ *        worker hook on the same node) turns queued packets into batches
+ *        of enhanced packet blocks and writes each with one io_uring
+ *        writev on the registered file.  Memory is bounded by the queue
+ *        size and the number of batches; overload drops and counts.
+ */
+struct ndp_capture
+{
+    struct ndp_ring *queue;
+    uint64_t dropped_queue __ndp_cache_aligned;
+
+    struct io_uring ring __ndp_cache_aligned;
+    int fd;
+    off_t offset;
+    uint32_t snaplen;
+    uint64_t epoch_ns;
+    uint64_t epoch_tsc;
+    int error;
+
+    struct ndp_capture_batch *batches;
+    struct ndp_capture_batch **free;
+    unsigned int num_batches;
+    unsigned int num_free;
+    struct ndp_capture_batch *open;
+
+    struct ndp_capture_stats stats;
+    size_t map_size;
+    int node;
+};
+
+/**
+ * create `path` and write the section and interface headers; queue_size
+ * (power of two) bounds queued packets, max_batches the writes in flight.
+ */
+struct ndp_capture *ndp_capture_open(int, const char *, uint32_t, uint32_t, unsigned int);
+
+/* producers must have stopped; flushes everything queued and closes */
+void ndp_capture_close(struct ndp_capture *);
+
+/* reference and queue packets for capture, returns how many were queued */
+unsigned int ndp_capture_burst(struct ndp_capture *, struct ndp_buf **, unsigned int);
+
+/* writer hook: reap completions, build and submit batches */
+int ndp_capture_poll(void *);
+
+/* drop counters include the producer side */
+void ndp_capture_get_stats(const struct ndp_capture *, struct ndp_capture_stats *);
+
+#endif  /* INCLUDE_CAPTURE_H */
@@ -2,9 +2,24 @@
 #ifndef INCLUDE_COMMON_H
 #define INCLUDE_COMMON_H
 
+/* before any libc header, or it has no effect */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#define NDP_CACHE_LINE              64
+#define __ndp_cache_aligned         __attribute__((aligned(NDP_CACHE_LINE)))
+
+#define ndp_likely(x)               __builtin_expect(!!(x), 1)
+#define ndp_unlikely(x)             __builtin_expect(!!(x), 0)
 
 #endif /* INCLUDE_COMMON_H */
\ No newline at end of file
@@ -0,0 +1,242 @@
+
+#ifndef INCLUDE_CPTR_H
+#define INCLUDE_CPTR_H
+
+#include "mempool.h"
+
+#define NDP_CPTR_NULL           0
+#define NDP_CPTR_MAX_SHIFT      6       /* units up to a cache line */
+
+#define ndp_container_of(p, type, member)       \
+    ((type *)((uint8_t *)(p) - offsetof(type, member)))
+
+/**
+ * compressed pointer
+ *
+ * @brief a 32-bit offset into one node pool in units of 1 << shift bytes,
+ *        so a pool of up to 4GB << shift is addressed with half the bytes
+ *        of a pointer.  0 is NULL: the base is set one unit below the pool
+ *        so that no object in it encodes to 0.
+ */
+typedef uint32_t ndp_cptr_t;
+
+struct ndp_cbase
+{
+    uint8_t *base;              /* pool base - (1 << shift) */
+    unsigned int shift;
+    int node;
+};
+
+/**
+ * base for pointers into the pool of `node`, to objects aligned to
+ * 1 << shift bytes; -1 when the pool is too large for the shift.
+ */
+int ndp_cbase_init(struct ndp_cbase *, const struct mempool_sys *, int, unsigned int);
+
+static inline ndp_cptr_t ndp_cptr_encode(const struct ndp_cbase *cb, const void *p)
+{
+    return p ? (ndp_cptr_t)(((const uint8_t *)p - cb->base) >> cb->shift) : NDP_CPTR_NULL;
+}
+
+/* c must not be NULL: a shift and an add */
+static inline void *ndp_cptr_deref(const struct ndp_cbase *cb, ndp_cptr_t c)
+{
+    return cb->base + ((size_t)c << cb->shift);
+}
+
+static inline void *ndp_cptr_decode(const struct ndp_cbase *cb, ndp_cptr_t c)
+{
+    return c ? ndp_cptr_deref(cb, c) : NULL;
+}
+
+/* p is pool memory that encodes exactly */
+bool ndp_cptr_valid(const struct ndp_cbase *, const struct mempool_sys *, const void *);
+
+/**
+ * intrusive doubly linked list of compressed pointers
+ *
+ * @brief 8 bytes of links per element instead of 16.  The list does not
+ *        keep its base: every call takes the one its elements were
+ *        encoded with, so the head stays 12 bytes and can be embedded in
+ *        flow entries.
+ */
+struct ndp_clist_node
+{
+    ndp_cptr_t next;
+    ndp_cptr_t prev;
+};
+
+struct ndp_clist
+{
+    ndp_cptr_t first;
+    ndp_cptr_t last;
+    uint32_t count;
+};
+
+static inline void ndp_clist_init(struct ndp_clist *l)
+{
+    l->first = l->last = NDP_CPTR_NULL;
+    l->count = 0;
+}
+
+static inline struct ndp_clist_node *ndp_clist_at(const struct ndp_cbase *cb, ndp_cptr_t c)
+{
+    return (struct ndp_clist_node *)ndp_cptr_decode(cb, c);
+}
+
+static inline void ndp_clist_push_back(const struct ndp_cbase *cb, struct ndp_clist *l,
+                                       struct ndp_clist_node *n)
+{
+    ndp_cptr_t c = ndp_cptr_encode(cb, n);
+
+    n->next = NDP_CPTR_NULL;
+    n->prev = l->last;
+    if (l->last)
+        ((struct ndp_clist_node *)ndp_cptr_deref(cb, l->last))->next = c;
+    else
+        l->first = c;
+    l->last = c;
+    l->count++;
+}
+
+static inline void ndp_clist_push_front(const struct ndp_cbase *cb, struct ndp_clist *l,
+                                        struct ndp_clist_node *n)
+{
+    ndp_cptr_t c = ndp_cptr_encode(cb, n);
+
+    n->prev = NDP_CPTR_NULL;
+    n->next = l->first;
+    if (l->first)
+        ((struct ndp_clist_node *)ndp_cptr_deref(cb, l->first))->prev = c;
+    else
+        l->last = c;
+    l->first = c;
+    l->count++;
+}
+
+static inline void ndp_clist_remove(const struct ndp_cbase *cb, struct ndp_clist *l,
+                                    struct ndp_clist_node *n)
+{
+    if (n->prev)
+        ((struct ndp_clist_node *)ndp_cptr_deref(cb, n->prev))->next = n->next;
+    else
+        l->first = n->next;
+    if (n->next)
+        ((struct ndp_clist_node *)ndp_cptr_deref(cb, n->next))->prev = n->prev;
+    else
+        l->last = n->prev;
+    n->next = n->prev = NDP_CPTR_NULL;
+    l->count--;
+}
+
+static inline struct ndp_clist_node *ndp_clist_pop_front(const struct ndp_cbase *cb,
+                                                         struct ndp_clist *l)
+{
+    struct ndp_clist_node *n = ndp_clist_at(cb, l->first);
+
+    if (n)
+        ndp_clist_remove(cb, l, n);
+    return n;
+}
+
+/* n is unlinked by the body only after it is done with `tmp` */
+#define ndp_clist_foreach(cb, l, n, tmp)                                    \
+    for ((n) = ndp_clist_at(cb, (l)->first),                                \
+         (tmp) = (n) ? ndp_clist_at(cb, (n)->next) : NULL;                  \
+         (n);                                                               \
+         (n) = (tmp), (tmp) = (n) ? ndp_clist_at(cb, (n)->next) : NULL)
+
+/**
+ * hash chains of compressed pointers
+ *
+ * @brief buckets are 4 bytes and each element carries 8 bytes of link and
+ *        full hash, compared before the caller's key.  The table does not
+ *        resize; size it for the flows expected.
+ */
+struct ndp_chash_node
+{
+    ndp_cptr_t next;
+    uint32_t hash;
+};
+
+struct ndp_chash
+{
+    struct ndp_cbase cb;
+    uint32_t mask;
+    uint32_t count;
+    ndp_cptr_t *buckets;
+};
+
+/* table of at least `buckets` buckets (rounded to a power of two) on the node of cb */
+int ndp_chash_init(struct ndp_chash *, struct mempool_sys *, const struct ndp_cbase *, uint32_t);
+
+void ndp_chash_insert(struct ndp_chash *, struct ndp_chash_node *, uint32_t);
+
+/* unlink n; -1 when it is not in the table */
+int ndp_chash_remove(struct ndp_chash *, struct ndp_chash_node *);
+
+/* first element after `from` (or in the bucket when NULL) with this hash */
+static inline struct ndp_chash_node *ndp_chash_next(const struct ndp_chash *h,
+                                                    const struct ndp_chash_node *from,
+                                                    uint32_t hash)
+{
+    ndp_cptr_t c = from ? from->next : h->buckets[hash & h->mask];
+
+    while (c) {
+        struct ndp_chash_node *n = (struct ndp_chash_node *)ndp_cptr_deref(&h->cb, c);
+        if (n->hash == hash)
+            return n;
+        c = n->next;
+    }
+    return NULL;
+}
+
+#define ndp_chash_foreach_hash(h, n, hash)                                  \
+    for ((n) = ndp_chash_next(h, NULL, hash); (n); (n) = ndp_chash_next(h, n, hash))
+
+/* call fn on every element; fn may remove the one it is given */
+void ndp_chash_walk(struct ndp_chash *, void (*)(struct ndp_chash_node *, void *), void *);
+
+/**
+ * AVL tree of compressed pointers
+ *
+ * @brief no parent links: updates keep the path on the stack, so a node
+ *        is 12 bytes against 24 or more for a pointer tree with parents.
+ *        cmp orders an element against a key the way memcmp() would.
+ */
+#define NDP_CTREE_MAX_DEPTH     48      /* AVL height bound for 2^32 nodes */
+
+struct ndp_ctree_node
+{
+    ndp_cptr_t left;
+    ndp_cptr_t right;
+    int32_t height;
+};
+
+typedef int (*ndp_ctree_cmp_fn)(const struct ndp_ctree_node *, const void *);
+
+struct ndp_ctree
+{
+    struct ndp_cbase cb;
+    ndp_ctree_cmp_fn cmp;
+    ndp_cptr_t root;
+    uint32_t count;
+};
+
+void ndp_ctree_init(struct ndp_ctree *, const struct ndp_cbase *, ndp_ctree_cmp_fn);
+
+/* link n under key; -1 when an element with that key is already there */
+int ndp_ctree_insert(struct ndp_ctree *, struct ndp_ctree_node *, const void *);
+
+/* unlink and return the element with this key, or NULL */
+struct ndp_ctree_node *ndp_ctree_remove(struct ndp_ctree *, const void *);
+
+struct ndp_ctree_node *ndp_ctree_find(const struct ndp_ctree *, const void *);
+
+/* first element not below the key, or NULL */
+struct ndp_ctree_node *ndp_ctree_lower_bound(const struct ndp_ctree *, const void *);
+
+/* in order; fn must not change the tree */
+void ndp_ctree_walk(const struct ndp_ctree *, void (*)(struct ndp_ctree_node *, void *), void *);
+
+#endif  /* INCLUDE_CPTR_H */
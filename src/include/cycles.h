@@ -0,0 +1,27 @@
+
+#ifndef INCLUDE_CYCLES_H
+#define INCLUDE_CYCLES_H
+
+#include "common.h"
+
+#include <x86intrin.h>
+
+static inline uint64_t ndp_rdtsc(void)
+{
+    return __rdtsc();
+}
+
+/* TSC frequency, calibrated against CLOCK_MONOTONIC_RAW on first use */
+uint64_t ndp_tsc_hz(void);
+
+static inline uint64_t ndp_tsc_to_ns(uint64_t cycles)
+{
+    return (uint64_t)((double)cycles * 1e9 / (double)ndp_tsc_hz());
+}
+
+static inline uint64_t ndp_ns_to_tsc(uint64_t ns)
+{
+    return (uint64_t)((double)ns * (double)ndp_tsc_hz() / 1e9);
+}
+
+#endif  /* INCLUDE_CYCLES_H */
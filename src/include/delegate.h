@@ -0,0 +1,96 @@
+
+#ifndef INCLUDE_DELEGATE_H
+#define INCLUDE_DELEGATE_H
+
+#include "mempool.h"
+#include "topology.h"
+
+#define NDP_DELEGATE_ARGS       6
+#define NDP_DELEGATE_GROUP      7   /* clients sharing one response line */
+
+/* runs on the server, next to `state`; the return value goes back to the client */
+typedef uint64_t (*ndp_delegate_fn)(void *state, const uint64_t *args);
+
+/* written by one client, read by the server: one cache line */
+struct ndp_delegate_req
+{
+    ndp_delegate_fn fn;
+    uint64_t args[NDP_DELEGATE_ARGS];
+    uint64_t toggle;
+} __ndp_cache_aligned;
+
+/* written by the server for a whole group of clients at once */
+struct ndp_delegate_resp
+{
+    uint64_t toggles;
+    uint64_t ret[NDP_DELEGATE_GROUP];
+} __ndp_cache_aligned;
+
+struct ndp_delegate_server
+{
+    struct ndp_delegate_req *reqs;
+    struct ndp_delegate_resp *resps;
+    uint64_t *seen;
+    unsigned int max_clients;
+    unsigned int num_clients;
+
+    void *state;
+    int node;
+    int cpu;
+    pthread_t thread;
+    bool running;
+
+    unsigned long served;
+    unsigned long batches;
+};
+
+struct ndp_delegate_client
+{
+    struct ndp_delegate_req *req;
+    struct ndp_delegate_resp *resp;
+    unsigned int bit;
+    uint64_t toggle;
+};
+
+/**
+ * create a server for `state` with its slots in `node`'s pool.  With
+ * cpu >= 0 a dedicated server thread is pinned there; with cpu < 0 the
+ * owner drives it with ndp_delegate_serve() from a worker loop.
+ */
+int ndp_delegate_server_init(struct ndp_delegate_server *, struct mempool_sys *, int,
+                             void *, unsigned int, int);
+void ndp_delegate_server_destroy(struct ndp_delegate_server *);
+
+/* one pass over every client slot; returns the number of requests executed */
+int ndp_delegate_serve(struct ndp_delegate_server *);
+
+/* poll hook form of ndp_delegate_serve() */
+int ndp_delegate_poll(void *);
+
+int ndp_delegate_client_init(struct ndp_delegate_server *, struct ndp_delegate_client *);
+
+/* post without waiting; at most one request per client is in flight */
+void ndp_delegate_post(struct ndp_delegate_client *, ndp_delegate_fn, const uint64_t *, int);
+
+static inline bool ndp_delegate_done(const struct ndp_delegate_client *cl)
+{
+    uint64_t t = __atomic_load_n(&cl->resp->toggles, __ATOMIC_ACQUIRE);
+    return ((t >> cl->bit) & 1) == cl->toggle;
+}
+
+static inline uint64_t ndp_delegate_wait(const struct ndp_delegate_client *cl)
+{
+    while (!ndp_delegate_done(cl))
+        __builtin_ia32_pause();
+    return cl->resp->ret[cl->bit];
+}
+
+/* ship fn to the server and wait for its result */
+static inline uint64_t ndp_delegate_call(struct ndp_delegate_client *cl, ndp_delegate_fn fn,
+                                         const uint64_t *args, int nargs)
+{
+    ndp_delegate_post(cl, fn, args, nargs);
+    return ndp_delegate_wait(cl);
+}
+
+#endif  /* INCLUDE_DELEGATE_H */
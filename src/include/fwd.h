@@ -0,0 +1,76 @@
+
+#ifndef INCLUDE_FWD_H
+#define INCLUDE_FWD_H
+
+#include "port.h"
+#include "lpm.h"
+#include "net.h"
+
+#define NDP_FWD_BURST           32
+#define NDP_L3FWD_MAX_HOPS      16
+
+/**
+ * L2 forwarder
+ *
+ * @brief receives a burst on one port queue, swaps source and destination
+ *        MAC and sends it on another (or the same) port queue.  The
+ *        minimal per-packet work: one header touch, no lookup.
+ */
+struct ndp_l2fwd
+{
+    struct ndp_port *rx_port;
+    struct ndp_port *tx_port;
+    uint16_t rx_queue;
+    uint16_t tx_queue;
+    uint64_t dropped;
+};
+
+struct ndp_l2fwd *ndp_l2fwd_create(struct mempool_sys *, int, struct ndp_port *, uint16_t,
+                                   struct ndp_port *, uint16_t);
+
+/* worker poll hook, returns packets received */
+int ndp_l2fwd_poll(void *);
+
+struct ndp_l3fwd_hop
+{
+    struct ndp_port *port;
+    uint16_t queue;
+    uint8_t dst_mac[NDP_ETHER_ADDR_LEN];
+    uint8_t src_mac[NDP_ETHER_ADDR_LEN];
+};
+
+/**
+ * L3 forwarder
+ *
+ * @brief routes untagged IPv4 by longest prefix match.  The LPM next hop
+ *        indexes the forwarder's hop table, which gives the output port
+ *        queue and the MAC rewrite; TTL is decremented with an incremental
+ *        checksum update.  Packets without a route, with an expiring TTL
+ *        or that are not IPv4 are dropped and counted.
+ */
+struct ndp_l3fwd
+{
+    struct ndp_port *rx_port;
+    uint16_t rx_queue;
+    int node;
+    const struct ndp_lpm *lpm;
+    struct ndp_l3fwd_hop hops[NDP_L3FWD_MAX_HOPS];
+    uint32_t num_hops;
+
+    uint64_t no_route;
+    uint64_t ttl_expired;
+    uint64_t not_ipv4;
+};
+
+/* forwarder on `node`, which also selects the LPM replica it reads */
+struct ndp_l3fwd *ndp_l3fwd_create(struct mempool_sys *, int, const struct ndp_lpm *,
+                                   struct ndp_port *, uint16_t);
+
+/* returns the hop id to use as LPM next hop, -1 when full */
+int ndp_l3fwd_add_hop(struct ndp_l3fwd *, struct ndp_port *, uint16_t, const uint8_t *,
+                      const uint8_t *);
+
+/* worker poll hook, returns packets received; the worker must be a QSBR reader of the LPM */
+int ndp_l3fwd_poll(void *);
+
+#endif  /* INCLUDE_FWD_H */
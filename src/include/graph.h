@@ -0,0 +1,133 @@
+
+#ifndef INCLUDE_GRAPH_H
+#define INCLUDE_GRAPH_H
+
+#include "buf.h"
+#include "cycles.h"
+
+#define NDP_GRAPH_FRAME         256     /* buffers per frame */
+#define NDP_GRAPH_MAX_NEXT      16
+#define NDP_GRAPH_NAME          32
+
+#define NDP_GRAPH_DROP          0       /* node id of the built-in drop node */
+
+/* node flags */
+#define NDP_NODE_SOURCE         0x1     /* called every walk with an empty frame */
+
+struct ndp_graph;
+struct ndp_graph_node;
+
+/**
+ * process a frame
+ *
+ * @brief bufs holds `count` buffers (none for a source node); the node
+ *        hands every buffer to one of its next nodes with
+ *        ndp_graph_enqueue() or moves the whole frame with
+ *        ndp_graph_move_frame().  Returns the number of buffers handled.
+ */
+typedef uint16_t (*ndp_node_fn)(struct ndp_graph *g, struct ndp_graph_node *n,
+                                struct ndp_buf **bufs, uint16_t count);
+
+struct ndp_graph_node
+{
+    struct ndp_buf **frame;
+    uint16_t count;
+    uint16_t num_next;
+    uint16_t next[NDP_GRAPH_MAX_NEXT];
+    bool queued;
+
+    ndp_node_fn fn;
+    void *ctx;
+    unsigned int flags;
+    uint16_t id;
+
+    uint64_t calls;
+    uint64_t bufs;
+    uint64_t cycles;
+    char name[NDP_GRAPH_NAME];
+} __ndp_cache_aligned;
+
+/**
+ * vector processing graph
+ *
+ * @brief one instance per worker, built before the worker starts.  A walk
+ *        runs the source nodes, then every node with a pending frame until
+ *        no frame is left, each node seeing the whole vector at once.
+ */
+struct ndp_graph
+{
+    struct ndp_graph_node *nodes;
+    uint16_t num_nodes;
+    uint16_t max_nodes;
+    uint16_t *pending;
+    uint16_t head;
+    uint16_t tail;
+    struct ndp_buf ***spares;
+    uint16_t num_spares;
+    struct ndp_buf **in;
+    struct ndp_buf **moved;
+    int node;
+    struct mempool_sys *mem;
+};
+
+struct ndp_graph *ndp_graph_create(struct mempool_sys *, int, uint16_t);
+
+/* returns the node id, -1 on failure */
+int ndp_graph_add_node(struct ndp_graph *, const char *, ndp_node_fn, void *, unsigned int);
+
+/**
+ * returns the next index of `to` in `from`, -1 on failure.  The graph must
+ * stay acyclic: self-edges and edges that close a cycle are refused.
+ */
+int ndp_graph_add_edge(struct ndp_graph *, uint16_t, uint16_t);
+
+int ndp_graph_lookup(const struct ndp_graph *, const char *);
+
+/* process a node's frame right away, used when the frame fills up */
+void ndp_graph_flush(struct ndp_graph *, struct ndp_graph_node *);
+
+static inline struct ndp_graph_node *ndp_graph_next_node(struct ndp_graph *g,
+                                                         struct ndp_graph_node *n,
+                                                         uint16_t next)
+{
+    return &g->nodes[n->next[next]];
+}
+
+static inline void ndp_graph_schedule(struct ndp_graph *g, struct ndp_graph_node *to)
+{
+    if (!to->queued) {
+        to->queued = true;
+        g->pending[g->tail] = to->id;
+        g->tail = (g->tail + 1) % (g->max_nodes + 1);
+    }
+}
+
+/* hand one buffer to next node `next` of n */
+static inline void ndp_graph_enqueue(struct ndp_graph *g, struct ndp_graph_node *n,
+                                     uint16_t next, struct ndp_buf *b)
+{
+    struct ndp_graph_node *to = ndp_graph_next_node(g, n, next);
+
+    if (ndp_unlikely(to->count == NDP_GRAPH_FRAME))
+        ndp_graph_flush(g, to);
+    to->frame[to->count++] = b;
+    ndp_graph_schedule(g, to);
+}
+
+/* hand a run of buffers to next node `next` of n */
+void ndp_graph_enqueue_burst(struct ndp_graph *, struct ndp_graph_node *, uint16_t,
+                             struct ndp_buf **, uint16_t);
+
+/**
+ * move n's whole input frame to next node `next`; when the target frame is
+ * empty the frames are swapped instead of copied.
+ */
+void ndp_graph_move_frame(struct ndp_graph *, struct ndp_graph_node *, uint16_t,
+                          struct ndp_buf **, uint16_t);
+
+/* one walk of the graph; worker poll hook */
+int ndp_graph_poll(void *);
+
+void ndp_graph_stats_report(const struct ndp_graph *, FILE *);
+
+#endif  /* INCLUDE_GRAPH_H */
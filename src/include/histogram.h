@@ -0,0 +1,60 @@
+
+#ifndef INCLUDE_HISTOGRAM_H
+#define INCLUDE_HISTOGRAM_H
+
+#include "common.h"
+
+#include <stdio.h>
+
+#define NDP_HIST_SUB_BITS       4
+#define NDP_HIST_SUB            (1 << NDP_HIST_SUB_BITS)
+#define NDP_HIST_BUCKETS        ((64 - NDP_HIST_SUB_BITS + 1) * NDP_HIST_SUB)
+
+/**
+ * log-linear histogram
+ *
+ * @brief every power of two is split into 16 linear buckets, so any
+ *        recorded value is reported within 1/16 (6%) of its true value
+ *        from 0 to 2^64 with a fixed 7.8KB table.  Single writer; merge
+ *        per-worker histograms for a global view.
+ */
+struct ndp_hist
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[NDP_HIST_BUCKETS];
+};
+
+static inline unsigned int ndp_hist_bucket(uint64_t v)
+{
+    if (v < NDP_HIST_SUB)
+        return (unsigned int)v;
+
+    unsigned int e = 63 - __builtin_clzll(v);
+    return (e - NDP_HIST_SUB_BITS + 1) * NDP_HIST_SUB +
+           (unsigned int)((v >> (e - NDP_HIST_SUB_BITS)) & (NDP_HIST_SUB - 1));
+}
+
+static inline void ndp_hist_record(struct ndp_hist *h, uint64_t v)
+{
+    h->buckets[ndp_hist_bucket(v)]++;
+    h->count++;
+    h->sum += v;
+    if (v < h->min)
+        h->min = v;
+    if (v > h->max)
+        h->max = v;
+}
+
+void ndp_hist_reset(struct ndp_hist *);
+void ndp_hist_merge(struct ndp_hist *, const struct ndp_hist *);
+
+/* value at percentile p (0..100), 0 when empty */
+uint64_t ndp_hist_percentile(const struct ndp_hist *, double);
+
+/* one line: count, min, avg, p50, p90, p99, p99.9, max */
+void ndp_hist_report(const struct ndp_hist *, FILE *, const char *);
+
+#endif  /* INCLUDE_HISTOGRAM_H */
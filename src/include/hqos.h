@@ -0,0 +1,194 @@
+
+#ifndef INCLUDE_HQOS_H
+#define INCLUDE_HQOS_H
+
+#include "port.h"
+#include "cycles.h"
+
+#define NDP_HQOS_TCS            4       /* strict priority, 0 highest */
+#define NDP_HQOS_TC_QUEUES      4       /* weighted round-robin within a class */
+#define NDP_HQOS_PIPE_QUEUES    (NDP_HQOS_TCS * NDP_HQOS_TC_QUEUES)
+#define NDP_HQOS_MAX_SUBPORTS   64
+#define NDP_HQOS_MAX_PIPES      (1U << 16)
+#define NDP_HQOS_MAX_PROFILES   256
+#define NDP_HQOS_MAX_QUEUE      4096
+#define NDP_HQOS_PIPE_BURST     8       /* packets from one pipe before the next gets a turn */
+#define NDP_HQOS_FRAME_OVERHEAD 24      /* preamble, inter-frame gap and FCS */
+#define NDP_HQOS_MAX_FRAME      1518    /* default max_frame: tagged 1500 MTU frame */
+#define NDP_HQOS_TICK_SHIFT     8       /* token bucket time in 256 TSC cycles */
+#define NDP_HQOS_FRAC_BITS      16      /* token bucket credits in 1/65536 byte */
+#define NDP_HQOS_HOLD           32
+
+/**
+ * rates in bytes per second, bursts in bytes; a tc rate of 0 is the parent
+ * rate.  Every burst must hold a max_frame packet, and a class's credits
+ * per tc period are raised to one such packet, or it could never leave.
+ */
+struct ndp_hqos_params
+{
+    uint64_t rate;              /* the link */
+    uint32_t num_subports;
+    uint32_t pipes_per_subport;
+    uint32_t queue_size;        /* power of two */
+    uint32_t max_frame;         /* largest pkt_len queued, 0 for NDP_HQOS_MAX_FRAME */
+};
+
+struct ndp_hqos_subport_params
+{
+    uint64_t rate;
+    uint64_t burst;
+    uint64_t tc_rate[NDP_HQOS_TCS];
+    uint32_t tc_period_us;
+};
+
+struct ndp_hqos_pipe_params
+{
+    uint64_t rate;
+    uint64_t burst;
+    uint64_t tc_rate[NDP_HQOS_TCS];
+    uint32_t tc_period_us;
+    uint8_t wrr_weights[NDP_HQOS_PIPE_QUEUES];      /* 1..255, 0 counts as 1 */
+};
+
+struct ndp_hqos_tb
+{
+    uint64_t rate;              /* credit units per tick */
+    uint64_t cap;               /* ticks to fill from empty */
+    uint64_t burst;             /* credit units */
+};
+
+struct ndp_hqos_profile
+{
+    struct ndp_hqos_tb tb;
+    uint64_t tc_credits[NDP_HQOS_TCS];      /* bytes per period */
+    uint64_t tc_period;                     /* ticks */
+    uint32_t wrr_cost[NDP_HQOS_PIPE_QUEUES];
+};
+
+struct ndp_hqos_subport
+{
+    struct ndp_hqos_tb tb;
+    uint64_t tokens;
+    uint64_t stamp;
+    uint64_t tc_credits[NDP_HQOS_TCS];
+    uint64_t tc_credits_per_period[NDP_HQOS_TCS];
+    uint64_t tc_period;
+    uint64_t tc_time;
+} __ndp_cache_aligned;
+
+struct ndp_hqos_pipe
+{
+    uint64_t tokens;
+    uint64_t stamp;
+    uint64_t tc_credits[NDP_HQOS_TCS];
+    uint64_t tc_time;
+    uint32_t profile;
+    uint32_t head[NDP_HQOS_PIPE_QUEUES];
+    uint32_t tail[NDP_HQOS_PIPE_QUEUES];
+    uint64_t wrr_tokens[NDP_HQOS_PIPE_QUEUES];
+} __ndp_cache_aligned;
+
+struct ndp_hqos_stats
+{
+    uint64_t enq_pkts;
+    uint64_t drops;
+    uint64_t tc_pkts[NDP_HQOS_TCS];
+    uint64_t tc_bytes[NDP_HQOS_TCS];
+};
+
+/**
+ * hierarchical egress scheduler
+ *
+ * @brief port -> subport -> pipe -> traffic class -> queue.  The port,
+ *        every subport and every pipe shape with a token bucket; subports
+ *        and pipes also cap each traffic class with credits renewed every
+ *        tc period.  Within a pipe the classes are served by strict
+ *        priority and the four queues of a class by byte-weighted
+ *        round-robin; active pipes take turns of up to NDP_HQOS_PIPE_BURST
+ *        packets, found by a two-level bitmap of non-empty queues.
+ *
+ *        One thread, normally the port's tx worker, enqueues and dequeues.
+ *        Queue storage and all scheduler state live on that worker's node.
+ */
+struct ndp_hqos
+{
+    struct ndp_hqos_tb port_tb;
+    uint64_t port_tokens;
+    uint64_t port_stamp;
+    bool port_blocked;
+
+    uint32_t num_subports;
+    uint32_t pipes_per_subport;
+    uint32_t num_pipes;
+    uint32_t queue_size;
+    uint32_t max_frame;
+    int node;
+
+    // grinder: the pipe being served and where the scan resumes
+    int64_t cur_pipe;
+    uint32_t cur_pkts;
+    uint32_t next_qid;
+
+    struct ndp_hqos_pipe *pipes;
+    struct ndp_buf **slots;     /* queue_size per queue */
+    uint64_t *bm0;              /* a bit per queue */
+    uint64_t *bm1;              /* a bit per non-zero bm0 word */
+    uint32_t bm0_words;
+    uint32_t bm1_words;
+    void *map;
+    size_t map_size;
+
+    struct ndp_hqos_subport subports[NDP_HQOS_MAX_SUBPORTS];
+    struct ndp_hqos_profile profiles[NDP_HQOS_MAX_PROFILES];
+    uint32_t num_profiles;
+
+    // attached tx side, see ndp_hqos_poll
+    struct ndp_ring *in;
+    struct ndp_port *port;
+    uint16_t queue;
+    uint16_t num_hold;
+    struct ndp_buf *hold[NDP_HQOS_HOLD];
+
+    struct ndp_hqos_stats stats;
+};
+
+/* scheduler on `node`, the node of the tx worker; every subport starts at the port rate */
+struct ndp_hqos *ndp_hqos_create(struct mempool_sys *, int, const struct ndp_hqos_params *);
+void ndp_hqos_destroy(struct ndp_hqos *);
+
+int ndp_hqos_subport_config(struct ndp_hqos *, uint32_t, const struct ndp_hqos_subport_params *);
+
+/* returns the profile id, -1 when full or invalid */
+int ndp_hqos_pipe_profile_add(struct ndp_hqos *, const struct ndp_hqos_pipe_params *);
+
+/* pipes start on profile 0, which must exist before traffic */
+int ndp_hqos_pipe_config(struct ndp_hqos *, uint32_t, uint32_t, uint32_t);
+
+/* record the queue of a packet in its udata, ahead of enqueue */
+static inline void ndp_hqos_classify(const struct ndp_hqos *h, struct ndp_buf *b,
+                                     uint32_t subport, uint32_t pipe, uint32_t tc, uint32_t queue)
+{
+    b->udata = (uint64_t)(subport * h->pipes_per_subport + pipe) * NDP_HQOS_PIPE_QUEUES +
+               tc * NDP_HQOS_TC_QUEUES + queue;
+}
+
+/**
+ * queue a burst, tail dropping (and freeing) what does not fit or is longer
+ * than max_frame; returns the queued
+ */
+uint16_t ndp_hqos_enqueue(struct ndp_hqos *, struct ndp_buf **, uint16_t);
+
+/* up to n packets the hierarchy allows to leave now */
+uint16_t ndp_hqos_dequeue(struct ndp_hqos *, struct ndp_buf **, uint16_t);
+
+/**
+ * run the scheduler as the tx stage of a port queue: classified packets
+ * from other workers arrive on `in` (multi-producer), scheduled packets go
+ * to the port, and what the port refuses is held and retried first.
+ */
+int ndp_hqos_attach(struct ndp_hqos *, struct ndp_ring *, struct ndp_port *, uint16_t);
+int ndp_hqos_poll(void *);
+
+void ndp_hqos_stats_report(const struct ndp_hqos *, FILE *);
+
+#endif  /* INCLUDE_HQOS_H */
@@ -0,0 +1,153 @@
+
+#ifndef INCLUDE_LPM_H
+#define INCLUDE_LPM_H
+
+#include "burst.h"
+#include "qsbr.h"
+
+#define NDP_LPM_TBL24_SIZE      (1U << 24)
+#define NDP_LPM_TBL8_GROUP      256
+#define NDP_LPM_MAX_NODES       64
+
+/* table entry: valid bit, extended bit (tbl24 only), next hop or group */
+#define NDP_LPM_VALID           0x80000000U
+#define NDP_LPM_EXT             0x40000000U
+#define NDP_LPM_NH_MASK         0x3fffffffU
+#define NDP_LPM_NO_ROUTE        UINT32_MAX
+
+#define NDP_LPM6_STRIDE         4
+#define NDP_LPM6_LEVELS         (128 / NDP_LPM6_STRIDE + 1)
+
+/**
+ * IPv6 tree bitmap node
+ *
+ * @brief one node per 4-bit stride.  `internal` has a bit for every prefix
+ *        of length 0..3 that ends inside the node, `external` a bit for
+ *        every child; children and results are stored contiguously, so a
+ *        popcount over the bitmap gives the array index.
+ */
+struct ndp_lpm6_node
+{
+    uint16_t internal;
+    uint16_t external;
+    uint32_t child;
+    uint32_t result;
+};
+
+/**
+ * one node-local replica of the route table
+ *
+ * @brief IPv4 uses DIR-24-8: a 16M entry tbl24 indexed by the top 24 bits
+ *        resolves every prefix up to /24 in one access; longer prefixes
+ *        extend the entry into a 256 entry tbl8 group.  All arrays live in
+ *        huge pages on `node`, so a lookup touches at most two TLB entries
+ *        and never leaves the node.
+ */
+struct ndp_lpm_tbl
+{
+    uint32_t *tbl24;
+    uint32_t *tbl8;
+    uint32_t num_tbl8;
+    uint32_t tbl8_used;
+
+    struct ndp_lpm6_node *v6_nodes;
+    uint32_t *v6_results;
+    uint32_t v6_num_nodes;
+    uint32_t v6_num_results;
+    void *v6_map;
+    size_t v6_map_size;
+
+    int node;
+};
+
+enum ndp_lpm_rule_state
+{
+    NDP_LPM_RULE_EMPTY,
+    NDP_LPM_RULE_LIVE,
+    NDP_LPM_RULE_DEAD,
+};
+
+struct ndp_lpm_rule
+{
+    uint8_t addr[16];           /* IPv4 in the first four bytes, big endian */
+    uint8_t depth;
+    uint8_t v6;
+    uint8_t state;
+    uint32_t next_hop;
+};
+
+/**
+ * route table replicated per node
+ *
+ * @brief the control plane edits a rule set and calls ndp_lpm_commit(),
+ *        which rebuilds a spare replica on every node (from a thread
+ *        bound to that node), publishes them with one pointer store each
+ *        and waits a QSBR grace period before the old replicas become the
+ *        next spares.  Readers resolve ndp_lpm_table() once per burst and
+ *        must be QSBR readers (workers with ndp_worker_set_qsbr()).
+ */
+struct ndp_lpm
+{
+    struct ndp_lpm_tbl *tbl_of[NDP_LPM_MAX_NODES];
+
+    struct ndp_lpm_tbl *active[NDP_LPM_MAX_NODES];
+    struct ndp_lpm_tbl *spare[NDP_LPM_MAX_NODES];
+    int nodes[NDP_LPM_MAX_NODES];
+    int replica_of[NDP_LPM_MAX_NODES];
+    int num_nodes;
+    uint32_t num_tbl8;
+    struct ndp_qsbr *qsbr;
+
+    pthread_mutex_t lock;
+    struct ndp_lpm_rule *rules;
+    uint32_t rule_cap;
+    uint32_t max_rules;
+    uint32_t num_rules;
+    uint32_t used;
+};
+
+/**
+ * create replicas on `nodes`; other nodes read the replica nearest to them.
+ * num_tbl8 bounds the number of distinct /24s carrying longer prefixes.
+ * Without a QSBR domain the caller must keep lookups out of commits.
+ */
+struct ndp_lpm *ndp_lpm_create(const int *, int, uint32_t, uint32_t, struct ndp_qsbr *);
+void ndp_lpm_destroy(struct ndp_lpm *);
+
+/* rule set edits, visible to lookups after the next commit */
+int ndp_lpm_add(struct ndp_lpm *, uint32_t, uint8_t, uint32_t);
+int ndp_lpm_delete(struct ndp_lpm *, uint32_t, uint8_t);
+int ndp_lpm6_add(struct ndp_lpm *, const uint8_t *, uint8_t, uint32_t);
+int ndp_lpm6_delete(struct ndp_lpm *, const uint8_t *, uint8_t);
+
+/* rebuild and publish every replica; returns -1 and keeps the old tables on failure */
+int ndp_lpm_commit(struct ndp_lpm *);
+
+static inline const struct ndp_lpm_tbl *ndp_lpm_table(const struct ndp_lpm *lpm, int node)
+{
+    return __atomic_load_n(&lpm->tbl_of[node], __ATOMIC_ACQUIRE);
+}
+
+/* next hop for a host order address, NDP_LPM_NO_ROUTE on a miss */
+static inline uint32_t ndp_lpm_lookup(const struct ndp_lpm_tbl *t, uint32_t ip)
+{
+    uint32_t e = t->tbl24[ip >> 8];
+
+    if (ndp_unlikely(e & NDP_LPM_EXT))
+        e = t->tbl8[(e & NDP_LPM_NH_MASK) * NDP_LPM_TBL8_GROUP + (ip & 0xff)];
+    return e & NDP_LPM_VALID ? e & NDP_LPM_NH_MASK : NDP_LPM_NO_ROUTE;
+}
+
+uint32_t ndp_lpm6_lookup(const struct ndp_lpm_tbl *, const uint8_t *);
+
+/* n lookups with the tbl24 entries prefetched a few addresses ahead */
+void ndp_lpm_lookup_bulk(const struct ndp_lpm_tbl *, const uint32_t *, uint32_t *,
+                         unsigned int);
+
+/**
+ * route a parsed burst: next_hop of every IPv4/IPv6 packet is set from its
+ * destination address, other packets get NDP_LPM_NO_ROUTE.
+ */
+void ndp_lpm_lookup_burst(const struct ndp_lpm_tbl *, struct ndp_burst *);
+
+#endif  /* INCLUDE_LPM_H */
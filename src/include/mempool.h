@@ -4,7 +4,6 @@
 
 #include "common.h"
 
-#define _GNU_SOURCE
 #include <sched.h>
 #include <numa.h>
 #include <numaif.h>
@@ -40,9 +39,46 @@ struct thread_args
 };
 
 #define align_up(x, a)              \
-    ((x + a - 1) & ~(a - 1))
+    (((x) + (a) - 1) & ~((a) - 1))
 
 
+/* create one pinned, pre-faulted pool per NUMA node */
+int ndp_mempool_init(struct mempool_sys *);
+
+/* release every node pool back to the system */
+void mempool_system_destroy(struct mempool_sys *);
+
+/* bind the calling thread to the CPUs of a NUMA node */
+int ndp_bind_thread_to_node(int);
+int ndp_bind_worker_node(int);
+
+void *ndp_mempool_alloc_on_node(struct mempool_sys *, int, size_t);
+
+/**
+ * carve `size` bytes aligned to `align` out of a node pool
+ *
+ * @brief safe to call from several threads on the same node; memory is
+ *        never returned to the pool, long-lived structures only.
+ */
+void *ndp_mempool_alloc(struct mempool_sys *, int, size_t, size_t);
+
+/* node whose pool contains addr, or -1 when addr is not pool memory */
+int ndp_mempool_node_of(const struct mempool_sys *, const void *);
+
+#define NDP_HUGE_PAGE           (2UL << 20)
+
+/**
+ * map a private region backed by 2MB pages and bound to a node
+ *
+ * @brief for large tables that are replaced as a whole (route and ACL
+ *        tables) and so cannot come from the bump pool.  Falls back to
+ *        transparent huge pages when no hugetlbfs pages are reserved.
+ *        The size is rounded up to NDP_HUGE_PAGE; free with
+ *        ndp_mempool_unmap() and the same size.
+ */
+void *ndp_mempool_map_huge(size_t, int);
+void ndp_mempool_unmap(void *, size_t);
+
 /* generate a number of fixed-sized blocks for size categories A, B, C */
 static void ndp_allocate_fixed_blocks(unsigned int, unsigned int, unsigned int);
 
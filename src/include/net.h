@@ -0,0 +1,164 @@
+
+#ifndef INCLUDE_NET_H
+#define INCLUDE_NET_H
+
+#include "burst.h"
+
+#include <arpa/inet.h>
+
+#define NDP_ETHER_ADDR_LEN      6
+#define NDP_ETHER_HDR_LEN       14
+#define NDP_VLAN_HDR_LEN        4
+#define NDP_VLAN_MAX_TAGS       2
+
+#define NDP_ETHER_TYPE_IPV4     0x0800
+#define NDP_ETHER_TYPE_IPV6     0x86dd
+#define NDP_ETHER_TYPE_VLAN     0x8100
+#define NDP_ETHER_TYPE_QINQ     0x88a8
+
+#define NDP_IPPROTO_TCP         6
+#define NDP_IPPROTO_UDP         17
+#define NDP_IPPROTO_FRAG6       44
+
+#define NDP_IPV4_MF             0x2000
+#define NDP_IPV4_OFF_MASK       0x1fff
+
+/* on-wire headers; multi-byte fields are big endian */
+struct ndp_ether_hdr
+{
+    uint8_t dst[NDP_ETHER_ADDR_LEN];
+    uint8_t src[NDP_ETHER_ADDR_LEN];
+    uint16_t type;
+} __attribute__((packed));
+
+struct ndp_vlan_hdr
+{
+    uint16_t tci;
+    uint16_t type;
+} __attribute__((packed));
+
+struct ndp_ipv4_hdr
+{
+    uint8_t ver_ihl;
+    uint8_t tos;
+    uint16_t total_len;
+    uint16_t id;
+    uint16_t frag_off;
+    uint8_t ttl;
+    uint8_t proto;
+    uint16_t cksum;
+    uint32_t src;
+    uint32_t dst;
+} __attribute__((packed));
+
+struct ndp_ipv6_hdr
+{
+    uint32_t vtc_flow;
+    uint16_t payload_len;
+    uint8_t proto;
+    uint8_t hop_limit;
+    uint8_t src[16];
+    uint8_t dst[16];
+} __attribute__((packed));
+
+struct ndp_ipv6_frag_hdr
+{
+    uint8_t proto;
+    uint8_t reserved;
+    uint16_t frag_off;
+    uint32_t id;
+} __attribute__((packed));
+
+struct ndp_tcp_hdr
+{
+    uint16_t sport;
+    uint16_t dport;
+    uint32_t seq;
+    uint32_t ack;
+    uint8_t off;
+    uint8_t flags;
+    uint16_t window;
+    uint16_t cksum;
+    uint16_t urp;
+} __attribute__((packed));
+
+struct ndp_udp_hdr
+{
+    uint16_t sport;
+    uint16_t dport;
+    uint16_t len;
+    uint16_t cksum;
+} __attribute__((packed));
+
+/**
+ * one's complement sum of a buffer, unfolded
+ *
+ * @brief the sum is kept in memory byte order (RFC 1071), so folded and
+ *        inverted it can be stored into a header as is.  `sum` chains
+ *        partial sums; AVX2 is used when the CPU has it.
+ */
+uint32_t ndp_cksum_raw(const void *, size_t, uint32_t);
+
+/* the two kernels behind ndp_cksum_raw(), for benchmarks */
+uint32_t ndp_cksum_raw_scalar(const void *, size_t, uint32_t);
+uint32_t ndp_cksum_raw_avx2(const void *, size_t, uint32_t);
+
+static inline uint16_t ndp_cksum_fold(uint32_t sum)
+{
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)sum;
+}
+
+static inline uint16_t ndp_ipv4_cksum(const struct ndp_ipv4_hdr *ip)
+{
+    return ~ndp_cksum_fold(ndp_cksum_raw(ip, (ip->ver_ihl & 0xf) * 4, 0));
+}
+
+/* TCP/UDP checksum over pseudo header and `l4_len` bytes at l4 */
+uint16_t ndp_ipv4_l4_cksum(const struct ndp_ipv4_hdr *, const void *, uint16_t);
+uint16_t ndp_ipv6_l4_cksum(const struct ndp_ipv6_hdr *, const void *, uint16_t);
+
+/**
+ * incremental update, RFC 1624 eqn. 3: HC' = ~(~HC + ~m + m')
+ *
+ * @brief all three values in memory byte order, as read from the header.
+ */
+static inline uint16_t ndp_cksum_adjust(uint16_t cksum, uint16_t old, uint16_t new)
+{
+    uint32_t sum = (uint16_t)~cksum + (uint16_t)~old + (uint32_t)new;
+
+    return ~ndp_cksum_fold(sum);
+}
+
+static inline uint16_t ndp_cksum_adjust32(uint16_t cksum, uint32_t old, uint32_t new)
+{
+    cksum = ndp_cksum_adjust(cksum, (uint16_t)old, (uint16_t)new);
+    return ndp_cksum_adjust(cksum, (uint16_t)(old >> 16), (uint16_t)(new >> 16));
+}
+
+/* forwarding TTL decrement; returns the new TTL, the checksum follows along */
+static inline uint8_t ndp_ipv4_dec_ttl(struct ndp_ipv4_hdr *ip)
+{
+    uint16_t old, new;
+
+    memcpy(&old, &ip->ttl, sizeof(old));
+    ip->ttl--;
+    memcpy(&new, &ip->ttl, sizeof(new));
+    ip->cksum = ndp_cksum_adjust(ip->cksum, old, new);
+    return ip->ttl;
+}
+
+/**
+ * parse Ethernet (up to two VLAN tags), IPv4/IPv6 and TCP/UDP headers of a
+ * gathered burst, setting l3_off, l4_off and the protocol flags.  Headers
+ * that do not fit in the first segment are left unparsed.  Untagged IPv4
+ * TCP/UDP packets are classified 4 at a time with AVX2.
+ */
+void ndp_parse_burst(struct ndp_burst *);
+void ndp_parse_burst_scalar(struct ndp_burst *);
+
+/* verify IPv4 header and TCP/UDP checksums of a parsed burst, flag failures */
+void ndp_cksum_check_burst(struct ndp_burst *);
+
+#endif  /* INCLUDE_NET_H */
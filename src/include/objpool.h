@@ -0,0 +1,48 @@
+
+#ifndef INCLUDE_OBJPOOL_H
+#define INCLUDE_OBJPOOL_H
+
+#include "mempool.h"
+
+/**
+ * fixed-size object pool
+ *
+ * @brief objects and the free stack are carved once from a node pool, so
+ *        every object handed out is local to `node`.  Unlike the node pool
+ *        itself, objects can be returned and reused, which makes the
+ *        object pool the building block for anything with a lifetime
+ *        shorter than the process (tasks, timers, buffers).
+ */
+struct ndp_objpool
+{
+    pthread_spinlock_t lock;
+    unsigned int avail;
+    void **stack;
+    unsigned int count;
+    size_t elt_size;
+    uint8_t *base;
+    int node;
+} __ndp_cache_aligned;
+
+/* create a pool of `count` objects of `elt_size` bytes on `node` */
+struct ndp_objpool *ndp_objpool_create(struct mempool_sys *, int, size_t, unsigned int);
+
+void *ndp_objpool_get(struct ndp_objpool *);
+void ndp_objpool_put(struct ndp_objpool *, void *);
+
+/* all-or-nothing bulk get, returns n or 0 */
+unsigned int ndp_objpool_get_bulk(struct ndp_objpool *, void **, unsigned int);
+void ndp_objpool_put_bulk(struct ndp_objpool *, void *const *, unsigned int);
+
+static inline unsigned int ndp_objpool_avail(const struct ndp_objpool *op)
+{
+    return __atomic_load_n(&op->avail, __ATOMIC_RELAXED);
+}
+
+static inline bool ndp_objpool_owns(const struct ndp_objpool *op, const void *obj)
+{
+    const uint8_t *o = obj;
+    return o >= op->base && o < op->base + op->elt_size * op->count;
+}
+
+#endif  /* INCLUDE_OBJPOOL_H */
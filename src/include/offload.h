@@ -0,0 +1,131 @@
+
+#ifndef INCLUDE_OFFLOAD_H
+#define INCLUDE_OFFLOAD_H
+
+#include "net.h"
+
+#define NDP_GRO_MAX_FLOWS       32      /* flows open at once within a burst */
+#define NDP_GRO_MAX_SEGS        64      /* payloads per coalesced packet */
+#define NDP_GRO_MAX_LEN         65535   /* IP datagram limit */
+
+/* unfolded pseudo header sum for the IPv4 or IPv6 header at l3 */
+static inline uint32_t ndp_l4_pseudo_sum(const void *l3, uint8_t proto, uint32_t l4_len)
+{
+    const uint8_t *p = l3;
+    bool v4 = (p[0] >> 4) == 4;
+    const uint8_t *addr = p + (v4 ? offsetof(struct ndp_ipv4_hdr, src)
+                                  : offsetof(struct ndp_ipv6_hdr, src));
+    uint64_t sum = htons(proto) + htons(l4_len);
+    uint32_t w;
+
+    for (int i = 0; i < (v4 ? 2 : 8); i++) {
+        memcpy(&w, addr + 4 * i, sizeof(w));
+        sum += w;
+    }
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    return (uint32_t)((sum & 0xffffffff) + (sum >> 32));
+}
+
+/* what ndp_gro_create() coalesces */
+#define NDP_GRO_TCP             0x1
+#define NDP_GRO_UDP             0x2
+
+struct ndp_gro_flow
+{
+    uint32_t hash;
+    uint16_t idx;               /* head packet in the burst */
+    uint16_t segs;
+    uint16_t hdr_len;           /* L2 through L4 header */
+    uint16_t seg_len;           /* payload of the head, no later one may be larger */
+    uint32_t len;               /* payload so far */
+    uint32_t sum;               /* payload checksum so far, unfolded */
+    uint32_t next_seq;          /* TCP, host order */
+    uint16_t ip_id;             /* IPv4, host order */
+    bool closed;
+};
+
+struct ndp_gro_stats
+{
+    uint64_t pkts;              /* candidates seen */
+    uint64_t merged;            /* absorbed into a head */
+    uint64_t coalesced;         /* heads that absorbed something */
+};
+
+/**
+ * generic receive offload
+ *
+ * @brief coalesces consecutive TCP segments (and, when asked for, same-size
+ *        UDP datagrams) of a flow within one parsed burst into a single
+ *        packet: the later payloads are cut from their headers and chained
+ *        behind the first packet, zero-copy.  The new L4 checksum is built
+ *        from the checksums the packets arrived with, so no payload byte is
+ *        read; a corrupt input therefore yields a corrupt output rather
+ *        than being laundered.
+ *
+ *        Coalesced packets carry NDP_BUF_F_GRO and keep one chain segment
+ *        per original payload, which is how UDP datagram boundaries survive.
+ */
+struct ndp_gro
+{
+    uint32_t types;
+    uint32_t max_len;
+    int node;
+    uint16_t num_flows;
+    struct ndp_gro_flow flows[NDP_GRO_MAX_FLOWS];
+    uint16_t keep[NDP_BURST_MAX];
+    struct ndp_gro_stats stats;
+};
+
+/* context for one worker on `node`; max_len caps the coalesced IP datagram */
+struct ndp_gro *ndp_gro_create(struct mempool_sys *, int, uint32_t, uint32_t);
+
+/**
+ * coalesce a burst that went through ndp_parse_burst(), compacting it in
+ * place; returns the new count.  Packets flagged NDP_BUF_F_CKSUM_BAD are
+ * passed through untouched.
+ */
+uint16_t ndp_gro_burst(struct ndp_gro *, struct ndp_burst *);
+
+void ndp_gro_stats_report(const struct ndp_gro *, FILE *);
+
+struct ndp_gso_stats
+{
+    uint64_t pkts;              /* segmented */
+    uint64_t segs;              /* produced */
+    uint64_t no_bufs;
+    uint64_t invalid;
+};
+
+/**
+ * generic segmentation offload
+ *
+ * @brief splits TCP packets into mss-sized segments and UDP packets into
+ *        mss-sized datagrams, copying into buffers from `pool` (B_SPAN
+ *        buffers take jumbo segments).  The source may be any chain, a
+ *        coalesced one included.  IP headers are adjusted incrementally
+ *        from the original, and the L4 checksum of each segment is the
+ *        precomputed header sum plus the payload sum taken while the
+ *        payload is hot from the copy.
+ */
+struct ndp_gso
+{
+    struct ndp_buf_pool *pool;
+    uint16_t mss;
+    struct ndp_gso_stats stats;
+};
+
+/* mss is the payload per segment; NULL if header and mss do not fit a pool buffer */
+struct ndp_gso *ndp_gso_create(struct mempool_sys *, struct ndp_buf_pool *, uint16_t);
+
+/**
+ * segment the packet whose IP header starts at l3_off into at most max
+ * buffers.  Returns how many were written to out, and the packet is
+ * consumed (a packet within mss is passed through as out[0]); -1 leaves it
+ * with the caller, when it does not fit out, buffers ran out or the headers
+ * are not TCP/UDP over IPv4/IPv6 in the first segment.
+ */
+int ndp_gso_segment(struct ndp_gso *, struct ndp_buf *, uint16_t, struct ndp_buf **, uint16_t);
+
+void ndp_gso_stats_report(const struct ndp_gso *, FILE *);
+
+#endif  /* INCLUDE_OFFLOAD_H */
@@ -0,0 +1,52 @@
+
+#ifndef INCLUDE_PARALLEL_H
+#define INCLUDE_PARALLEL_H
+
+#include "task.h"
+
+/* granularity at which page ownership is sampled */
+#define NDP_PAR_SEGMENT         (2UL << 20)
+
+typedef void (*ndp_range_fn)(size_t begin, size_t end, void *arg);
+
+/* fold elements [begin, end) into partial */
+typedef void (*ndp_reduce_fn)(size_t begin, size_t end, void *partial, void *arg);
+
+/* acc = acc (+) partial */
+typedef void (*ndp_combine_fn)(void *acc, const void *partial, void *arg);
+
+/* a contiguous index range whose memory lives on `node` */
+struct ndp_par_run
+{
+    size_t begin;
+    size_t end;
+    int node;
+};
+
+/**
+ * split [0, n) of the array at base by the node that owns each page and run
+ * fn on the CPUs of that node.  grain is the maximum elements per task,
+ * 0 sizes tasks from the number of workers on the node.
+ */
+int ndp_parallel_for(struct ndp_tsched *, const void *, size_t, size_t, size_t,
+                     ndp_range_fn, void *);
+
+/**
+ * node-partitioned reduction; each task folds into its own copy of
+ * identity and the partials are combined into result in index order, so
+ * the result does not depend on scheduling.
+ */
+int ndp_parallel_reduce(struct ndp_tsched *, const void *, size_t, size_t, size_t,
+                        void *, size_t, const void *, ndp_reduce_fn, ndp_combine_fn, void *);
+
+/* same as above over caller supplied runs, for containers that know their layout */
+int ndp_parallel_for_runs(struct ndp_tsched *, const struct ndp_par_run *, int, size_t,
+                          ndp_range_fn, void *);
+int ndp_parallel_reduce_runs(struct ndp_tsched *, const struct ndp_par_run *, int, size_t,
+                             void *, size_t, const void *, ndp_reduce_fn, ndp_combine_fn,
+                             void *);
+
+/* page ownership of an array as runs; caller frees *runs */
+int ndp_parallel_runs(const void *, size_t, size_t, struct ndp_par_run **);
+
+#endif  /* INCLUDE_PARALLEL_H */
@@ -0,0 +1,129 @@
+
+#ifndef INCLUDE_PKTGEN_H
+#define INCLUDE_PKTGEN_H
+
+#include "port.h"
+#include "net.h"
+#include "cycles.h"
+#include "histogram.h"
+
+#define NDP_PKTGEN_MAX_SIZES    8
+#define NDP_PKTGEN_MAX_FRAME    1518
+#define NDP_PKTGEN_MAGIC        0x4e445047      /* "NDPG" */
+
+/* written right after the L4 header of every generated packet */
+struct ndp_pktgen_sig
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t tsc;
+} __attribute__((packed));
+
+/**
+ * traffic profile
+ *
+ * @brief IPv4 UDP or TCP frames; flows walk src/dst addresses and source
+ *        ports from the bases, sizes (frame length without FCS) are drawn
+ *        by weight, e.g. IMIX 60:7, 590:4, 1514:1.  rate_pps 0 sends as
+ *        fast as the port accepts.
+ */
+struct ndp_pktgen_profile
+{
+    uint8_t src_mac[NDP_ETHER_ADDR_LEN];
+    uint8_t dst_mac[NDP_ETHER_ADDR_LEN];
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t sport;
+    uint16_t dport;
+    uint8_t proto;
+    uint32_t num_flows;
+    uint32_t num_dsts;
+
+    uint16_t sizes[NDP_PKTGEN_MAX_SIZES];
+    uint8_t weights[NDP_PKTGEN_MAX_SIZES];
+    unsigned int num_sizes;
+
+    uint64_t rate_pps;
+    uint16_t burst;
+    uint64_t count;             /* 0 for unlimited */
+};
+
+/**
+ * generator bound to one tx queue
+ *
+ * @brief frames are copied from per-size templates, then only the fields
+ *        that vary per flow are patched, with the IPv4 checksum adjusted
+ *        incrementally.  Sending is paced by the TSC in bursts.
+ */
+struct ndp_pktgen
+{
+    struct ndp_pktgen_profile prof;
+    struct ndp_buf_pool *pool;
+    struct ndp_port *port;
+    uint16_t queue;
+
+    uint8_t templates[NDP_PKTGEN_MAX_SIZES][NDP_PKTGEN_MAX_FRAME];
+    uint8_t size_sched[256];
+    uint8_t size_pos;
+    uint32_t flow;
+    uint32_t seq;
+
+    uint64_t interval;          /* cycles per burst */
+    uint64_t next_tsc;
+
+    uint64_t sent;
+    uint64_t rejected;
+    uint64_t alloc_fail;
+    bool done;
+};
+
+/* 64 byte UDP, one flow, unpaced bursts of 32 */
+void ndp_pktgen_profile_default(struct ndp_pktgen_profile *);
+
+/* the simple IMIX mix: 60, 590 and 1514 byte frames at 7:4:1 */
+void ndp_pktgen_profile_imix(struct ndp_pktgen_profile *);
+
+struct ndp_pktgen *ndp_pktgen_create(struct mempool_sys *, struct ndp_buf_pool *,
+                                     struct ndp_port *, uint16_t,
+                                     const struct ndp_pktgen_profile *);
+
+/* change the rate of a running generator; takes effect at the next burst */
+void ndp_pktgen_set_rate(struct ndp_pktgen *, uint64_t);
+
+/* worker hook */
+int ndp_pktgen_poll(void *);
+
+/**
+ * packet sink on one rx queue
+ *
+ * @brief frees what it receives and records throughput and, for packets
+ *        carrying a generator signature, TSC latency and sequence gaps.
+ */
+struct ndp_sink
+{
+    struct ndp_port *port;
+    uint16_t queue;
+
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t unsigned_pkts;
+    uint64_t first_tsc;
+    uint64_t last_tsc;
+    uint32_t next_seq;
+    uint64_t seq_gaps;
+    bool reset;
+
+    struct ndp_hist latency;    /* ns */
+};
+
+struct ndp_sink *ndp_sink_create(struct mempool_sys *, struct ndp_port *, uint16_t);
+
+/* clear the counters from the polling thread; waits until it has */
+void ndp_sink_reset(struct ndp_sink *);
+int ndp_sink_poll(void *);
+
+/* achieved rate between the first and last packet */
+double ndp_sink_mpps(const struct ndp_sink *);
+void ndp_sink_report(const struct ndp_sink *, FILE *);
+
+#endif  /* INCLUDE_PKTGEN_H */
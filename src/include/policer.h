@@ -0,0 +1,109 @@
+
+#ifndef INCLUDE_POLICER_H
+#define INCLUDE_POLICER_H
+
+#include "buf.h"
+
+#define NDP_POLICER_MAX_PROFILES    1024
+#define NDP_POLICER_MAX_FLOWS       (1U << 28)
+#define NDP_POLICER_LINE_FLOWS      4
+#define NDP_POLICER_TICK_SHIFT      8           /* stamps count 256 TSC cycles */
+#define NDP_POLICER_FRAC_BITS       16          /* tokens in 1/65536 byte */
+#define NDP_POLICER_STAMP_BITS      48
+#define NDP_POLICER_STAMP_MASK      ((1ULL << NDP_POLICER_STAMP_BITS) - 1)
+#define NDP_POLICER_SKEW_TICKS      (1ULL << 24)    /* a stamp this far ahead is not a wrap */
+
+/**
+ * four flows of bucket state, SoA within one cache line: policing a packet
+ * reads and writes exactly one line.  meta holds the 48 bit stamp of the
+ * last refill and the profile id above it.
+ */
+struct ndp_policer_line
+{
+    uint64_t tokens[NDP_POLICER_LINE_FLOWS];
+    uint64_t meta[NDP_POLICER_LINE_FLOWS];
+} __ndp_cache_aligned;
+
+/**
+ * per-flow token bucket policer
+ *
+ * @brief a flow's bucket is refilled lazily when one of its packets is
+ *        policed, by the ticks elapsed since the last one times the rate
+ *        of its profile, capped at the burst.  No timers run.  Rates and
+ *        bursts are per profile, in small SoA tables that stay in L1
+ *        next to the bulk of flow state.
+ *
+ *        A flow must be policed by one thread at a time, which RSS gives
+ *        for free; flows sharing a line on different threads only cost
+ *        false sharing.  Profiles are set up before traffic uses them.
+ */
+struct ndp_policer
+{
+    uint64_t rate[NDP_POLICER_MAX_PROFILES] __ndp_cache_aligned;   /* token units per tick */
+    uint64_t cap[NDP_POLICER_MAX_PROFILES];     /* ticks to fill an empty bucket */
+    uint64_t burst[NDP_POLICER_MAX_PROFILES];   /* token units */
+
+    struct ndp_policer_line *lines;
+    size_t map_size;
+    uint32_t num_flows;
+    int node;
+};
+
+/* `num_flows` flows on `node`, all on the pass-everything profile 0 */
+struct ndp_policer *ndp_policer_create(struct mempool_sys *, int, uint32_t);
+void ndp_policer_destroy(struct ndp_policer *);
+
+/* rate in bytes per second, burst in bytes; profile 0 may be redefined too */
+int ndp_policer_set_profile(struct ndp_policer *, uint32_t, uint64_t, uint64_t);
+
+/* move a flow to a profile with a full bucket; from the thread policing it */
+int ndp_policer_set_flow(struct ndp_policer *, uint32_t, uint32_t, uint64_t);
+
+static inline bool ndp_policer_check(struct ndp_policer *pol, uint32_t flow, uint32_t len,
+                                     uint64_t tsc)
+{
+    struct ndp_policer_line *line = &pol->lines[flow / NDP_POLICER_LINE_FLOWS];
+    uint32_t lane = flow % NDP_POLICER_LINE_FLOWS;
+    uint64_t meta = line->meta[lane];
+    uint64_t now = (tsc >> NDP_POLICER_TICK_SHIFT) & NDP_POLICER_STAMP_MASK;
+    uint32_t prof = meta >> NDP_POLICER_STAMP_BITS;
+    uint64_t dt = (now - meta) & NDP_POLICER_STAMP_MASK;
+    uint64_t need = (uint64_t)len << NDP_POLICER_FRAC_BITS;
+    uint64_t tokens;
+
+    // a stamp slightly ahead (tsc of another core) refills nothing; any
+    // other gap is idle time, and past the cap it just fills the bucket
+    if (ndp_unlikely(dt > NDP_POLICER_STAMP_MASK - NDP_POLICER_SKEW_TICKS)) {
+        dt = 0;
+        now = meta & NDP_POLICER_STAMP_MASK;
+    }
+    if (dt > pol->cap[prof])
+        dt = pol->cap[prof];
+    tokens = line->tokens[lane] + dt * pol->rate[prof];
+    if (tokens > pol->burst[prof])
+        tokens = pol->burst[prof];
+
+    line->meta[lane] = (meta & ~NDP_POLICER_STAMP_MASK) | now;
+    if (tokens < need) {
+        line->tokens[lane] = tokens;
+        return false;
+    }
+    line->tokens[lane] = tokens - need;
+    return true;
+}
+
+/**
+ * police up to 64 packets at once, four flows per AVX2 step (scalar when
+ * the CPU lacks AVX2 or a step holds the same flow twice); returns the
+ * mask of conforming packets.
+ */
+uint64_t ndp_policer_burst(struct ndp_policer *, const uint32_t *, const uint32_t *,
+                           unsigned int, uint64_t);
+uint64_t ndp_policer_burst_scalar(struct ndp_policer *, const uint32_t *, const uint32_t *,
+                                  unsigned int, uint64_t);
+
+/* police bufs by pkt_len, free the exceeding ones and compact; returns the kept */
+uint16_t ndp_policer_filter(struct ndp_policer *, struct ndp_buf **, const uint32_t *, uint16_t,
+                            uint64_t);
+
+#endif  /* INCLUDE_POLICER_H */
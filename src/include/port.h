@@ -0,0 +1,136 @@
+
+#ifndef INCLUDE_PORT_H
+#define INCLUDE_PORT_H
+
+#include "buf.h"
+#include "ring.h"
+#include "topology.h"
+
+#define NDP_PORT_MAX_QUEUES     64
+#define NDP_PORT_NAME           32
+#define NDP_PORT_NODE_DEVICE    -1      /* place on the node of the device */
+
+struct ndp_port;
+
+/**
+ * port backend
+ *
+ * @brief a backend moves buffers between the wire (or whatever stands in
+ *        for it) and the data path.  Every queue is driven by one thread,
+ *        so backends need no locking per queue.  tx takes ownership of the
+ *        buffers it accepts; the caller keeps the rest.
+ */
+struct ndp_port_ops
+{
+    const char *kind;
+    uint16_t (*rx_burst)(struct ndp_port *, uint16_t, struct ndp_buf **, uint16_t);
+    uint16_t (*tx_burst)(struct ndp_port *, uint16_t, struct ndp_buf **, uint16_t);
+    void (*close)(struct ndp_port *);
+};
+
+struct ndp_port_queue_stats
+{
+    uint64_t ipackets;
+    uint64_t ibytes;
+    uint64_t ierrors;           /* dropped by the backend on rx */
+    uint64_t opackets;
+    uint64_t obytes;
+    uint64_t oerrors;           /* rejected by tx, left to the caller */
+} __ndp_cache_aligned;
+
+struct ndp_port
+{
+    const struct ndp_port_ops *ops;
+    void *priv;
+    uint16_t id;
+    uint16_t num_queues;
+    int node;
+    struct ndp_buf_pool *pool;  /* rx buffers, on `node` */
+    struct ndp_dev_locality dev;        /* of the device behind the port */
+    char name[NDP_PORT_NAME];
+    struct ndp_port_queue_stats stats[NDP_PORT_MAX_QUEUES];
+};
+
+static inline uint16_t ndp_port_rx_burst(struct ndp_port *p, uint16_t q, struct ndp_buf **bufs,
+                                         uint16_t n)
+{
+    uint16_t got = p->ops->rx_burst(p, q, bufs, n);
+
+    p->stats[q].ipackets += got;
+    for (uint16_t i = 0; i < got; i++)
+        p->stats[q].ibytes += bufs[i]->pkt_len;
+    return got;
+}
+
+static inline uint16_t ndp_port_tx_burst(struct ndp_port *p, uint16_t q, struct ndp_buf **bufs,
+                                         uint16_t n)
+{
+    uint64_t bytes = 0;
+    uint16_t sent;
+
+    // count before handing over: sent buffers may be recycled at once
+    for (uint16_t i = 0; i < n; i++)
+        bytes += bufs[i]->pkt_len;
+    sent = p->ops->tx_burst(p, q, bufs, n);
+    for (uint16_t i = sent; i < n; i++)
+        bytes -= bufs[i]->pkt_len;
+
+    p->stats[q].opackets += sent;
+    p->stats[q].obytes += bytes;
+    p->stats[q].oerrors += n - sent;
+    return sent;
+}
+
+/* tx, freeing whatever the port did not take; returns how many were sent */
+uint16_t ndp_port_tx_burst_free(struct ndp_port *, uint16_t, struct ndp_buf **, uint16_t);
+
+/* allocate and fill the common part of a port on `node` */
+struct ndp_port *ndp_port_alloc(struct mempool_sys *, int, const char *, uint16_t,
+                                const struct ndp_port_ops *);
+
+void ndp_port_close(struct ndp_port *);
+
+/**
+ * cpus for the workers polling a port, at most max: those local to its
+ * device (see ndp_topology_dev_cpus()), or those of the port's node when
+ * the device does not say
+ */
+int ndp_port_worker_cpus(const struct ndp_port *, const struct ndp_topology *, int *, int);
+
+/* totals over every queue */
+void ndp_port_stats(const struct ndp_port *, struct ndp_port_queue_stats *);
+void ndp_port_stats_report(const struct ndp_port *, FILE *);
+
+/**
+ * in-process loopback port
+ *
+ * @brief what is sent on queue q is received on queue q of `peer`, or of
+ *        the port itself when peer is NULL.  Buffers move by pointer
+ *        through one ring per queue on the port's node.  For running
+ *        pipelines and benchmarks without a NIC.
+ */
+struct ndp_port *ndp_port_loopback_create(struct mempool_sys *, int, const char *, uint16_t,
+                                          uint32_t);
+int ndp_port_loopback_connect(struct ndp_port *, struct ndp_port *);
+
+/**
+ * AF_PACKET port on a kernel interface (veth pairs, taps, NICs without a
+ * backend of their own)
+ *
+ * @brief one socket with mmapped TPACKET_V2 rx and tx rings per queue;
+ *        with several queues the kernel spreads received flows over them
+ *        by hash.  Frames are copied between the rings and buffers from
+ *        `pool`, and the port lives on the pool's node.
+ */
+struct ndp_port *ndp_port_afpacket_create(struct mempool_sys *, struct ndp_buf_pool *,
+                                          const char *, uint16_t);
+
+/**
+ * same, creating a pool of `count` buffers of `span` bytes for it on
+ * `node`; NDP_PORT_NODE_DEVICE takes the node of the interface's device,
+ * or the caller's when it has none
+ */
+struct ndp_port *ndp_port_afpacket_open(struct mempool_sys *, int, const char *, uint16_t,
+                                        uint16_t, unsigned int);
+
+#endif  /* INCLUDE_PORT_H */
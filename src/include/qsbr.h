@@ -0,0 +1,57 @@
+
+#ifndef INCLUDE_QSBR_H
+#define INCLUDE_QSBR_H
+
+#include "common.h"
+
+#define NDP_QSBR_MAX_READERS    128
+
+#define NDP_QSBR_OFFLINE        UINT64_MAX
+
+struct ndp_qsbr_reader
+{
+    uint64_t seen;
+} __ndp_cache_aligned;
+
+/**
+ * quiescent-state based reclamation
+ *
+ * @brief readers (data path workers) announce a quiescent state once per
+ *        loop iteration, when they hold no reference to shared tables.  A
+ *        writer that swapped a table out calls ndp_qsbr_synchronize(); once
+ *        it returns, no reader can still see the old table and it can be
+ *        freed.  Readers that block (sleeping workers) go offline first.
+ */
+struct ndp_qsbr
+{
+    uint64_t epoch __ndp_cache_aligned;
+    unsigned int num_readers;
+    struct ndp_qsbr_reader readers[NDP_QSBR_MAX_READERS];
+};
+
+void ndp_qsbr_init(struct ndp_qsbr *);
+
+/* returns a reader id, online; -1 when full */
+int ndp_qsbr_register(struct ndp_qsbr *);
+
+static inline void ndp_qsbr_quiescent(struct ndp_qsbr *q, int id)
+{
+    __atomic_store_n(&q->readers[id].seen, __atomic_load_n(&q->epoch, __ATOMIC_ACQUIRE),
+                     __ATOMIC_RELEASE);
+}
+
+static inline void ndp_qsbr_offline(struct ndp_qsbr *q, int id)
+{
+    __atomic_store_n(&q->readers[id].seen, NDP_QSBR_OFFLINE, __ATOMIC_RELEASE);
+}
+
+static inline void ndp_qsbr_online(struct ndp_qsbr *q, int id)
+{
+    ndp_qsbr_quiescent(q, id);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/* wait until every online reader has passed a quiescent state */
+void ndp_qsbr_synchronize(struct ndp_qsbr *);
+
+#endif  /* INCLUDE_QSBR_H */
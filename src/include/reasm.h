@@ -0,0 +1,113 @@
+
+#ifndef INCLUDE_REASM_H
+#define INCLUDE_REASM_H
+
+#include "net.h"
+#include "timer.h"
+
+#define NDP_REASM_MAX_FRAGS     8       /* per datagram, more drops it */
+#define NDP_REASM_DEATH_ROW     128
+
+/* addresses of either family; IPv4 uses the first word */
+struct ndp_reasm_key
+{
+    uint32_t src[4];
+    uint32_t dst[4];
+    uint32_t id;
+    uint8_t proto;
+    uint8_t version;
+    uint16_t pad;
+};
+
+struct ndp_reasm_frag
+{
+    struct ndp_buf *b;
+    uint16_t off;               /* payload offset in the datagram */
+    uint16_t len;               /* payload bytes */
+    uint16_t l3;                /* IP header offset */
+    uint16_t hdr;               /* bytes in front of the payload */
+};
+
+struct ndp_reasm;
+
+struct ndp_reasm_entry
+{
+    struct ndp_reasm_key key;
+    uint32_t total;             /* payload bytes, 0 until the last fragment arrived */
+    uint32_t received;
+    uint16_t num_frags;
+    struct ndp_reasm_frag frags[NDP_REASM_MAX_FRAGS];
+    struct ndp_timer timer;
+    struct ndp_reasm *owner;
+    uint32_t next_free;
+} __ndp_cache_aligned;
+
+struct ndp_reasm_stats
+{
+    uint64_t frags;
+    uint64_t reassembled;
+    uint64_t timeouts;
+    uint64_t invalid;           /* malformed, overlapping or too many fragments */
+    uint64_t duplicates;
+    uint64_t table_full;
+};
+
+/**
+ * IPv4 and IPv6 fragment reassembly
+ *
+ * @brief one table per worker, on the worker's node: a fixed array of
+ *        datagram entries indexed by an open-addressing hash of the key.
+ *        Fragments are held as they arrived and, once complete, linked
+ *        through their next pointers behind the first one, with only the
+ *        fragments' own headers cut off: nothing is copied.  Incomplete
+ *        datagrams expire through the worker's timer wheel, and every
+ *        buffer given up goes to a death row freed in bulk.
+ *
+ *        IPv6 fragments are recognised when the fragment header directly
+ *        follows the fixed header.
+ */
+struct ndp_reasm
+{
+    uint64_t *slots;            /* hash << 32 | entry index + 1, 0 if empty */
+    uint32_t mask;
+    uint64_t seed;
+
+    struct ndp_reasm_entry *entries;
+    uint32_t max_entries;
+    uint32_t num_entries;
+    uint32_t free_head;         /* index + 1, 0 when none is free */
+
+    struct ndp_timer_wheel *wheel;
+    uint64_t timeout;           /* TSC cycles */
+    int node;
+
+    uint32_t num_dead;
+    struct ndp_buf *death_row[NDP_REASM_DEATH_ROW];
+
+    struct ndp_reasm_stats stats;
+};
+
+/**
+ * table for up to max_entries datagrams in flight on `node`; incomplete ones
+ * are dropped timeout_ms after their first fragment by `wheel`, which must be
+ * polled by the same worker.
+ */
+struct ndp_reasm *ndp_reasm_create(struct mempool_sys *, int, uint32_t, uint32_t,
+                                   struct ndp_timer_wheel *);
+
+/**
+ * feed one packet whose IP header starts at l3_off.  Returns the packet
+ * itself if it is not a fragment, the reassembled datagram if it completed
+ * one, and NULL if it was kept or dropped.
+ */
+struct ndp_buf *ndp_reasm_packet(struct ndp_reasm *, struct ndp_buf *, uint16_t);
+
+/* the same over Ethernet frames, compacting the burst; flushes the death row */
+uint16_t ndp_reasm_burst(struct ndp_reasm *, struct ndp_buf **, uint16_t);
+
+/* free what the death row holds */
+void ndp_reasm_flush(struct ndp_reasm *);
+
+void ndp_reasm_stats_report(const struct ndp_reasm *, FILE *);
+
+#endif  /* INCLUDE_REASM_H */
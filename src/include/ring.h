@@ -0,0 +1,63 @@
+
+#ifndef INCLUDE_RING_H
+#define INCLUDE_RING_H
+
+#include "mempool.h"
+
+/* ring flags */
+#define NDP_RING_SP_ENQ         0x1     /* single producer */
+#define NDP_RING_SC_DEQ         0x2     /* single consumer */
+
+struct ndp_ring_headtail
+{
+    uint32_t head;
+    uint32_t tail;
+    bool single;
+} __ndp_cache_aligned;
+
+/**
+ * bounded pointer ring
+ *
+ * @brief lock-free multi/single producer and consumer ring of pointers.
+ *        Producers reserve a range by moving head, fill it, then publish it
+ *        by moving tail in reservation order; consumers do the same on
+ *        their side.  Indices are free-running 32-bit counters.
+ */
+struct ndp_ring
+{
+    uint32_t size;
+    uint32_t mask;
+    int node;
+    struct ndp_ring_headtail prod;
+    struct ndp_ring_headtail cons;
+    void *slots[] __ndp_cache_aligned;
+};
+
+/* count must be a power of two; the ring holds count - 1 entries */
+struct ndp_ring *ndp_ring_create(struct mempool_sys *, int, uint32_t, unsigned int);
+
+/* for rings embedded in memory the caller frees: size, then init in place */
+static inline size_t ndp_ring_memsize(uint32_t count)
+{
+    return sizeof(struct ndp_ring) + sizeof(void *) * count;
+}
+
+int ndp_ring_init(struct ndp_ring *, int, uint32_t, unsigned int);
+
+/* enqueue/dequeue as many as possible up to n, return how many */
+unsigned int ndp_ring_enqueue_burst(struct ndp_ring *, void *const *, unsigned int);
+unsigned int ndp_ring_dequeue_burst(struct ndp_ring *, void **, unsigned int);
+
+static inline unsigned int ndp_ring_count(const struct ndp_ring *r)
+{
+    uint32_t prod = __atomic_load_n(&r->prod.tail, __ATOMIC_ACQUIRE);
+    uint32_t cons = __atomic_load_n(&r->cons.tail, __ATOMIC_ACQUIRE);
+    return (prod - cons) & r->mask;
+}
+
+static inline unsigned int ndp_ring_free_count(const struct ndp_ring *r)
+{
+    return r->mask - ndp_ring_count(r);
+}
+
+#endif  /* INCLUDE_RING_H */
@@ -0,0 +1,218 @@
+
+#ifndef INCLUDE_RSS_H
+#define INCLUDE_RSS_H
+
+#include "burst.h"
+#include "ring.h"
+#include "worker.h"
+
+#define NDP_RSS_KEY_LEN         40
+#define NDP_RSS_V4_LEN          12      /* src, dst, sport, dport */
+#define NDP_RSS_V6_LEN          36
+#define NDP_RSS_RETA_SIZE       512
+#define NDP_RSS_MAX_WORKERS     128
+#define NDP_RSS_RETA_HOLD       0xffff  /* bucket being moved: packets are held */
+
+/* IPv4 flow tuple, network byte order, in Toeplitz input order */
+struct ndp_rss_v4
+{
+    uint32_t src;
+    uint32_t dst;
+    uint16_t sport;
+    uint16_t dport;
+};
+
+/**
+ * expanded Toeplitz key
+ *
+ * @brief tbl[p][v] is the hash contribution of byte value v at input byte
+ *        position p, so a hash is one lookup and xor per input byte.
+ */
+struct ndp_rss_key
+{
+    uint8_t key[NDP_RSS_KEY_LEN];
+    uint32_t tbl[NDP_RSS_V6_LEN][256] __ndp_cache_aligned;
+};
+
+/* the key most NICs ship with, for hashes that match hardware RSS */
+extern const uint8_t ndp_rss_default_key[NDP_RSS_KEY_LEN];
+
+void ndp_rss_key_init(struct ndp_rss_key *, const uint8_t *);
+
+/* bit-by-bit reference Toeplitz hash over len input bytes */
+uint32_t ndp_toeplitz_ref(const uint8_t *, const uint8_t *, unsigned int);
+
+static inline uint32_t ndp_toeplitz(const struct ndp_rss_key *k, const uint8_t *in,
+                                    unsigned int len)
+{
+    uint32_t h = 0;
+    for (unsigned int p = 0; p < len; p++)
+        h ^= k->tbl[p][in[p]];
+    return h;
+}
+
+/* hash n IPv4 tuples, vectorised 8 flows at a time where AVX2 is available */
+void ndp_rss_hash_v4_bulk(const struct ndp_rss_key *, const struct ndp_rss_v4 *,
+                          uint32_t *, unsigned int);
+
+/**
+ * hash a parsed burst: IPv4 TCP/UDP packets (l3_off/l4_off set) get the
+ * 4-tuple hash, other IPv4 packets the 2-tuple hash, everything else 0.
+ */
+void ndp_rss_hash_burst(const struct ndp_rss_key *, struct ndp_burst *);
+
+static inline uint32_t ndp_rss_bucket(uint32_t hash)
+{
+    return hash & (NDP_RSS_RETA_SIZE - 1);
+}
+
+/**
+ * flow-to-worker dispatcher
+ *
+ * @brief the RETA maps a bucket (low hash bits, as on a NIC) to a worker.
+ *        Flow state tables are partitioned by bucket and each partition is
+ *        allocated on bucket_node[b], so the RETA is filled with workers of
+ *        that node and a flow is always handled next to its state.
+ */
+struct ndp_rss_dispatch
+{
+    const struct ndp_rss_key *key;
+    uint16_t reta[NDP_RSS_RETA_SIZE];
+    int16_t bucket_node[NDP_RSS_RETA_SIZE];
+    uint64_t bucket_pkts[NDP_RSS_RETA_SIZE];
+
+    unsigned int num_workers;
+    struct ndp_worker *workers[NDP_RSS_MAX_WORKERS];
+    struct ndp_ring *rings[NDP_RSS_MAX_WORKERS];
+    uint64_t enqueued[NDP_RSS_MAX_WORKERS];
+    uint64_t dropped[NDP_RSS_MAX_WORKERS];
+
+    struct ndp_ring *hold;      /* packets of NDP_RSS_RETA_HOLD buckets */
+    uint64_t held;
+    uint64_t hold_dropped;
+};
+
+/**
+ * workers[i] consumes rings[i].  bucket_node may be NULL, in which case
+ * buckets are spread over the nodes of the workers.
+ */
+int ndp_rss_dispatch_init(struct ndp_rss_dispatch *, const struct ndp_rss_key *,
+                          struct ndp_worker **, struct ndp_ring **, unsigned int,
+                          const int16_t *);
+
+/* point every bucket at a worker on its node, round-robin within the node */
+void ndp_rss_dispatch_fill_reta(struct ndp_rss_dispatch *);
+
+/**
+ * hash (if not done already) and hand every packet of the burst to the
+ * worker owning its bucket, or to the hold ring while the bucket moves;
+ * packets whose ring is full are freed.  Returns the number of packets
+ * enqueued.
+ */
+unsigned int ndp_rss_dispatch_burst(struct ndp_rss_dispatch *, struct ndp_burst *);
+
+#define NDP_RSS_BAL_MAX_MOVES   16
+#define NDP_RSS_HOLD_SIZE       4096
+
+/**
+ * hand a bucket's flows from one worker to another
+ *
+ * @brief called once the old worker has finished every packet of the
+ *        bucket and before the new one sees any, so flow state can be
+ *        moved (or rehomed to to->node) without locking.  Non-zero keeps
+ *        the bucket where it was.
+ */
+typedef int (*ndp_rss_migrate_fn)(uint32_t, struct ndp_worker *, struct ndp_worker *, void *);
+
+/**
+ * rebalancing policy
+ *
+ * @brief a worker's load is its busy share over the period plus
+ *        depth_weight times the fill of its ring, smoothed with alpha.
+ *        Buckets move when the busiest worker is above `high` and more
+ *        than `margin` (cross_margin for another node) above the target,
+ *        for `settle` periods in a row.  A moved bucket stays put for
+ *        `cooldown` periods.
+ */
+struct ndp_rss_bal_params
+{
+    uint32_t period_ms;
+    uint32_t settle;
+    uint32_t cooldown;
+    uint32_t max_moves;
+    double alpha;
+    double high;
+    double margin;
+    double cross_margin;
+    double depth_weight;
+    bool cross_node;
+};
+
+struct ndp_rss_bal_stats
+{
+    uint64_t rounds;
+    uint64_t triggers;
+    uint64_t moves;
+    uint64_t cross_moves;
+    uint64_t vetoed;
+};
+
+/**
+ * load-driven RETA rebalancer
+ *
+ * @brief samples worker utilization, ring depth and per-bucket packet
+ *        rates every period and moves the buckets that best even out the
+ *        busiest and least busy workers, preferring the same node.  A
+ *        move holds the bucket's packets, waits for the old worker to
+ *        drain what it already has, migrates and releases the held
+ *        packets to the new worker, so flows are never reordered or
+ *        handled by two workers at once.
+ */
+struct ndp_rss_balancer
+{
+    struct ndp_rss_dispatch *d;
+    struct ndp_rss_bal_params p;
+    ndp_rss_migrate_fn migrate;
+    void *arg;
+    struct ndp_burst *burst;
+
+    uint64_t period;            /* cycles */
+    uint64_t next_tsc;
+    uint64_t last_tsc;
+    uint32_t round;
+    uint32_t over;              /* periods in a row out of balance */
+
+    uint64_t last_busy[NDP_RSS_MAX_WORKERS];
+    uint64_t last_idle[NDP_RSS_MAX_WORKERS];
+    double load[NDP_RSS_MAX_WORKERS];
+    uint64_t last_pkts[NDP_RSS_RETA_SIZE];
+    double rate[NDP_RSS_RETA_SIZE];     /* packets per second */
+    uint32_t frozen_until[NDP_RSS_RETA_SIZE];
+
+    /* moves in flight */
+    uint32_t num_moves;
+    uint16_t move_bucket[NDP_RSS_BAL_MAX_MOVES];
+    uint16_t move_from[NDP_RSS_BAL_MAX_MOVES];
+    uint16_t move_to[NDP_RSS_BAL_MAX_MOVES];
+    uint8_t drain[NDP_RSS_MAX_WORKERS];
+    uint32_t fence[NDP_RSS_MAX_WORKERS];
+    uint64_t fence_loops[NDP_RSS_MAX_WORKERS];
+
+    struct ndp_rss_bal_stats stats;
+};
+
+/* every 100ms, settle 3, cooldown 20, 8 moves, alpha 0.5, high 0.8, margins 0.15/0.3 */
+void ndp_rss_bal_params_default(struct ndp_rss_bal_params *);
+
+/* balancer for d on `node`; params and migrate may be NULL */
+struct ndp_rss_balancer *ndp_rss_balancer_create(struct mempool_sys *, int,
+                                                 struct ndp_rss_dispatch *,
+                                                 const struct ndp_rss_bal_params *,
+                                                 ndp_rss_migrate_fn, void *);
+
+/* worker hook; must run on the thread that calls ndp_rss_dispatch_burst() */
+int ndp_rss_balancer_poll(void *);
+
+void ndp_rss_balancer_stats_report(const struct ndp_rss_balancer *, FILE *);
+
+#endif  /* INCLUDE_RSS_H */
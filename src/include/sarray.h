@@ -0,0 +1,71 @@
+
+#ifndef INCLUDE_SARRAY_H
+#define INCLUDE_SARRAY_H
+
+#include "parallel.h"
+
+#define NDP_SARRAY_STRIPE_MIN   (2UL << 20)
+
+/* flags */
+#define NDP_SARRAY_PREFAULT     0x1     /* fault every stripe in at init */
+#define NDP_SARRAY_NOHUGE       0x2     /* do not ask for transparent huge pages */
+
+/**
+ * node-striped array
+ *
+ * @brief one contiguous virtual range, split in fixed-size stripes that are
+ *        each mbind()'ed to a single node.  Elements never straddle a
+ *        stripe, so index -> address and index -> node are a shift and a
+ *        table lookup.
+ */
+struct ndp_sarray
+{
+    uint8_t *base;
+    size_t elem_size;
+    size_t n;
+    size_t stripe_size;
+    size_t stripe_elems;
+    unsigned int num_stripes;
+    int16_t *stripe_node;
+
+    void *map;
+    size_t map_size;
+};
+
+/**
+ * create an array of n elements striped over nodes[0..num_nodes).  Stripes
+ * go round-robin when weights is NULL, otherwise in proportion to weights.
+ * stripe_size is rounded up to NDP_SARRAY_STRIPE_MIN and must hold at least
+ * one element; every entry of nodes must be a node of this machine.
+ */
+int ndp_sarray_init(struct ndp_sarray *, size_t, size_t, size_t, const int *,
+                    const unsigned int *, int, unsigned int);
+void ndp_sarray_destroy(struct ndp_sarray *);
+
+static inline void *ndp_sarray_at(const struct ndp_sarray *a, size_t i)
+{
+    size_t stripe = i / a->stripe_elems;
+    return a->base + stripe * a->stripe_size + (i - stripe * a->stripe_elems) * a->elem_size;
+}
+
+static inline int ndp_sarray_node_of(const struct ndp_sarray *a, size_t i)
+{
+    return a->stripe_node[i / a->stripe_elems];
+}
+
+/* index range [*begin, *end) of the stripe holding element i */
+static inline void ndp_sarray_stripe_range(const struct ndp_sarray *a, size_t i,
+                                           size_t *begin, size_t *end)
+{
+    *begin = i - i % a->stripe_elems;
+    *end = *begin + a->stripe_elems < a->n ? *begin + a->stripe_elems : a->n;
+}
+
+/* index -> node layout as runs for the parallel primitives; caller frees */
+int ndp_sarray_runs(const struct ndp_sarray *, struct ndp_par_run **);
+
+/* run fn over the array with every range executed on its stripe's node */
+int ndp_sarray_parallel_for(struct ndp_tsched *, const struct ndp_sarray *, size_t,
+                            ndp_range_fn, void *);
+
+#endif  /* INCLUDE_SARRAY_H */
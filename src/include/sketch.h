@@ -0,0 +1,199 @@
+
+#ifndef INCLUDE_SKETCH_H
+#define INCLUDE_SKETCH_H
+
+#include "burst.h"
+#include "cycles.h"
+
+#define NDP_HH_ROWS             4       /* count-min depth */
+#define NDP_HH_MAX_TOP          256
+#define NDP_HH_INDEX            (2 * NDP_HH_MAX_TOP)
+#define NDP_HH_MAX_WORKERS      64
+#define NDP_HH_VIEW_MAGIC       0x4e445048      /* "NDPH" */
+
+/* what a talker is */
+#define NDP_HH_KEY_FLOW         0       /* addresses, ports and protocol */
+#define NDP_HH_KEY_SRC          1       /* source address */
+
+/* addresses of either family; IPv4 uses the first word */
+struct ndp_hh_key
+{
+    uint32_t src[4];
+    uint32_t dst[4];
+    uint16_t sport;
+    uint16_t dport;
+    uint8_t proto;
+    uint8_t version;
+    uint16_t pad;
+};
+
+/* per-row hash functions, shared by every worker and the merger */
+static const uint32_t ndp_hh_seed[NDP_HH_ROWS] = {
+    0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c
+};
+static const uint32_t ndp_hh_mul[NDP_HH_ROWS] = {
+    0x9e3779b1, 0x85ebca77, 0xc2b2ae3d, 0x27d4eb2f
+};
+
+/* counter of a key hash in a sketch row; shift is 32 - log2(width) */
+static inline uint32_t ndp_hh_row(uint32_t hash, int row, uint32_t shift)
+{
+    return ((hash ^ ndp_hh_seed[row]) * ndp_hh_mul[row]) >> shift;
+}
+
+struct ndp_hh_entry
+{
+    struct ndp_hh_key key;
+    uint32_t hash;
+    uint32_t count;             /* sketch estimate, bytes */
+    uint16_t slot;              /* in the index */
+};
+
+/**
+ * one window of a worker's traffic
+ *
+ * @brief a count-min sketch of bytes per key with NDP_HH_ROWS rows, and the
+ *        k keys with the largest estimates as a min-heap, found through a
+ *        small linear-probing index.  Like space-saving, the table holds a
+ *        fixed number of keys and evicts the smallest; the counts come from
+ *        the sketch, so no state is kept per flow outside the table.
+ */
+struct ndp_hh_bank
+{
+    uint32_t *cm;               /* NDP_HH_ROWS rows of width counters */
+    uint64_t total;
+    uint32_t num_top;
+    struct ndp_hh_entry top[NDP_HH_MAX_TOP];
+    uint32_t index[NDP_HH_INDEX];       /* hash high bits, heap position + 1 */
+} __ndp_cache_aligned;
+
+/**
+ * per-worker heavy-hitter sketch
+ *
+ * @brief the worker updates bank `cur` from its bursts.  The merger reads
+ *        and clears the other one, then asks for a switch through `req`;
+ *        the worker switches at its next burst and says so in `cur`.  The
+ *        handshake is two flags, each with one writer, so neither side
+ *        ever waits on the other.
+ */
+struct ndp_hh
+{
+    uint32_t req __ndp_cache_aligned;   /* merger */
+
+    uint32_t cur __ndp_cache_aligned;   /* worker */
+    uint32_t width;
+    uint32_t shift;             /* 32 - log2(width) */
+    uint32_t k;
+    int mode;
+    int node;
+    struct ndp_hh_bank *bank;   /* the one cur selects */
+    struct ndp_hh_bank banks[2];
+    void *map;
+    size_t map_size;
+
+    struct ndp_hh_key keys[NDP_BURST_MAX];
+    uint32_t hashes[NDP_BURST_MAX];
+    uint32_t rows[NDP_HH_ROWS][NDP_BURST_MAX];
+};
+
+/**
+ * sketch of `width` (power of two) counters per row keeping the top k on
+ * `node`; every worker feeding one merger must use the same width.
+ */
+struct ndp_hh *ndp_hh_create(struct mempool_sys *, int, uint32_t, uint32_t, int);
+void ndp_hh_destroy(struct ndp_hh *);
+
+/* count the IP packets of a parsed burst */
+void ndp_hh_burst(struct ndp_hh *, const struct ndp_burst *);
+
+/* the hashing kernels behind ndp_hh_burst(), for benchmarks */
+void ndp_hh_hash_scalar(struct ndp_hh *, uint16_t);
+void ndp_hh_hash_avx2(struct ndp_hh *, uint16_t);
+
+struct ndp_hh_talker
+{
+    struct ndp_hh_key key;
+    uint64_t bytes;
+};
+
+/**
+ * merged top talkers, as published
+ *
+ * @brief written by the merger under a sequence count (odd while writing),
+ *        read by anyone mapping the segment: ndp_hh_view_read() copies a
+ *        consistent snapshot without taking a lock.
+ */
+struct ndp_hh_view
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t stamp_ns;          /* CLOCK_REALTIME of the last merge */
+    uint64_t window_ns;         /* time covered by the last merge */
+    uint64_t total;             /* bytes counted in the window */
+    uint32_t num_workers;       /* that contributed */
+    uint32_t num;
+    struct ndp_hh_talker top[NDP_HH_MAX_TOP];
+};
+
+struct ndp_hh_cand
+{
+    struct ndp_hh_key key;
+    uint32_t hash;
+    uint64_t bytes;
+};
+
+/**
+ * folds the windows of all workers into the view every period: sums their
+ * sketches (the sketch is linear, so the sum is the sketch of all traffic),
+ * re-estimates every key any worker had in its table against the sum and
+ * publishes the k largest.  A worker that has not switched banks since
+ * the last request is skipped and counted in the next window.
+ */
+struct ndp_hh_merger
+{
+    struct ndp_hh *workers[NDP_HH_MAX_WORKERS];
+    unsigned int num_workers;
+    uint32_t width;
+    uint32_t shift;
+    uint32_t k;
+    int node;
+
+    uint32_t *cm;               /* the sum */
+    struct ndp_hh_cand *cands;
+    uint32_t *cand_index;
+    uint32_t cand_mask;
+    void *map;
+    size_t map_size;
+
+    uint64_t period;            /* cycles */
+    uint64_t next_tsc;
+    uint64_t last_tsc;
+
+    struct ndp_hh_view *view;
+    size_t view_size;
+};
+
+/**
+ * merger on `node` for workers of the given width and k, publishing every
+ * period_ms to the POSIX shared memory object `name` (created or reused,
+ * world readable), or to private memory when NULL.
+ */
+struct ndp_hh_merger *ndp_hh_merger_create(struct mempool_sys *, int, const char *, uint32_t,
+                                           uint32_t, uint32_t);
+void ndp_hh_merger_destroy(struct ndp_hh_merger *);
+
+int ndp_hh_merger_add(struct ndp_hh_merger *, struct ndp_hh *);
+
+/* worker hook: merges once per period */
+int ndp_hh_merger_poll(void *);
+
+/* map a published view read-only, from any process */
+const struct ndp_hh_view *ndp_hh_view_open(const char *);
+void ndp_hh_view_close(const struct ndp_hh_view *);
+
+/* consistent copy of a view being written */
+void ndp_hh_view_read(const struct ndp_hh_view *, struct ndp_hh_view *);
+
+void ndp_hh_view_report(const struct ndp_hh_view *, unsigned int, FILE *);
+
+#endif  /* INCLUDE_SKETCH_H */
@@ -0,0 +1,113 @@
+
+#ifndef INCLUDE_TASK_H
+#define INCLUDE_TASK_H
+
+#include "objpool.h"
+#include "topology.h"
+
+typedef void (*ndp_task_fn)(void *arg);
+
+/* completion counter for a set of tasks; zero-initialise before use */
+struct ndp_task_group
+{
+    unsigned long pending;
+};
+
+struct ndp_task
+{
+    ndp_task_fn fn;
+    void *arg;
+    struct ndp_task_group *group;
+    struct ndp_objpool *owner;
+    struct ndp_task *next;
+};
+
+/* Chase-Lev deque, fixed capacity; the owner pushes and takes at bottom */
+struct ndp_deque
+{
+    long top __ndp_cache_aligned;
+    long bottom __ndp_cache_aligned;
+    struct ndp_task **buf;
+    long mask;
+};
+
+enum ndp_steal_tier
+{
+    NDP_STEAL_L3,
+    NDP_STEAL_NODE,
+    NDP_STEAL_REMOTE,
+    NDP_STEAL_TIERS,
+};
+
+struct ndp_tsched;
+
+struct ndp_tworker
+{
+    struct ndp_deque dq;
+
+    struct ndp_tsched *s;
+    pthread_t thread;
+    int id;
+    int cpu;
+    int node;
+
+    /* victims ordered same L3, same node, remote by distance */
+    int *victims;
+    int tier_end[NDP_STEAL_TIERS];
+    uint64_t seed;
+
+    unsigned long executed;
+    unsigned long steals[NDP_STEAL_TIERS];
+} __ndp_cache_aligned;
+
+/* tasks submitted from outside the scheduler, consumed by that node only */
+struct ndp_tinject
+{
+    pthread_mutex_t lock;
+    struct ndp_task *head;
+    struct ndp_task *tail;
+} __ndp_cache_aligned;
+
+struct ndp_tsched
+{
+    struct ndp_tworker **workers;
+    int num_workers;
+    struct ndp_tinject *inject;
+    struct ndp_objpool **task_pools;
+    int *node_workers;
+    int num_nodes;
+
+    struct mempool_sys *mem;
+    const struct ndp_topology *topo;
+    bool running;
+
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    int sleepers;
+};
+
+/**
+ * start one worker per physical core, pinned, with `deque_size` (power of
+ * two) deque slots per worker and `tasks_per_node` task records per node.
+ */
+int ndp_tsched_init(struct ndp_tsched *, struct mempool_sys *, const struct ndp_topology *,
+                    unsigned int, unsigned int);
+void ndp_tsched_destroy(struct ndp_tsched *);
+
+/**
+ * spawn a task; from a worker it goes on that worker's deque with its
+ * record taken from the worker's node, otherwise it is submitted to the
+ * caller's node.
+ */
+void ndp_task_spawn(struct ndp_tsched *, struct ndp_task_group *, ndp_task_fn, void *);
+
+/* queue a task for the workers of a specific node */
+void ndp_task_submit(struct ndp_tsched *, int, struct ndp_task_group *, ndp_task_fn, void *);
+
+/* wait for a group to drain; workers keep executing tasks while they wait */
+void ndp_task_group_wait(struct ndp_tsched *, struct ndp_task_group *);
+
+/* worker the calling thread runs as, NULL outside the scheduler */
+struct ndp_tworker *ndp_tworker_self(void);
+
+#endif  /* INCLUDE_TASK_H */
@@ -0,0 +1,73 @@
+
+#ifndef INCLUDE_TIMER_H
+#define INCLUDE_TIMER_H
+
+#include "objpool.h"
+#include "cycles.h"
+
+#define NDP_TIMER_LEVELS        4
+#define NDP_TIMER_BITS          8
+#define NDP_TIMER_SLOTS         (1 << NDP_TIMER_BITS)
+#define NDP_TIMER_MASK          (NDP_TIMER_SLOTS - 1)
+
+struct ndp_timer;
+typedef void (*ndp_timer_fn)(struct ndp_timer *t, void *arg);
+
+struct ndp_timer
+{
+    struct ndp_timer *next;
+    struct ndp_timer **pprev;
+    uint64_t expires;           /* in wheel ticks */
+    uint64_t period;            /* in wheel ticks, 0 for one-shot */
+    ndp_timer_fn fn;
+    void *arg;
+};
+
+/**
+ * hierarchical timing wheel
+ *
+ * @brief four levels of 256 slots; level n slots are 256^n ticks wide and
+ *        cascade into the level below when the wheel wraps.  Add and cancel
+ *        are O(1) list operations, expiry is amortised O(1) per timer.  The
+ *        wheel is single-threaded: it belongs to the worker that polls it.
+ */
+struct ndp_timer_wheel
+{
+    struct ndp_timer *slots[NDP_TIMER_LEVELS][NDP_TIMER_SLOTS];
+    uint64_t now;
+    uint64_t tsc_base;
+    unsigned int tick_shift;
+    unsigned long pending;
+    unsigned long fired;
+    struct ndp_objpool *pool;
+    int node;
+};
+
+/**
+ * create a wheel on `node` ticking every tick_ns (rounded down to a power
+ * of two TSC cycles) with room for max_timers pooled timers.
+ */
+struct ndp_timer_wheel *ndp_timer_wheel_create(struct mempool_sys *, int, uint64_t,
+                                               unsigned int);
+
+/* pooled timers from the wheel's node; embedded timers need no allocation */
+struct ndp_timer *ndp_timer_alloc(struct ndp_timer_wheel *);
+void ndp_timer_free(struct ndp_timer_wheel *, struct ndp_timer *);
+
+/* (re)arm t to fire after delay TSC cycles, then every period cycles if non-zero */
+void ndp_timer_arm(struct ndp_timer_wheel *, struct ndp_timer *, uint64_t, uint64_t,
+                   ndp_timer_fn, void *);
+void ndp_timer_cancel(struct ndp_timer_wheel *, struct ndp_timer *);
+
+static inline bool ndp_timer_pending(const struct ndp_timer *t)
+{
+    return t->pprev != NULL;
+}
+
+/* expire everything due at `tsc`; returns the number of timers fired */
+int ndp_timer_wheel_advance(struct ndp_timer_wheel *, uint64_t);
+
+/* worker poll hook: advance to the current TSC */
+int ndp_timer_wheel_poll(void *);
+
+#endif  /* INCLUDE_TIMER_H */
@@ -0,0 +1,92 @@
+
+#ifndef INCLUDE_TOPOLOGY_H
+#define INCLUDE_TOPOLOGY_H
+
+#include "common.h"
+
+#include <sched.h>
+#include <numa.h>
+#include <pthread.h>
+
+#define NDP_SYSFS_ROOT          "/sys"
+#define NDP_SYSFS_CPU           "devices/system/cpu"     /* relative to the sysfs root */
+#define NDP_PCI_ADDR_LEN        16
+
+struct ndp_cpu
+{
+    int cpu;
+    int node;
+    int pkg;
+    int core;       /* core id, unique within a package */
+    int l3;         /* id of the L3 shared by this cpu, -1 if unknown */
+    bool primary;   /* first hardware thread of its core */
+};
+
+struct ndp_topology
+{
+    struct ndp_cpu *cpus;
+    int num_cpus;
+    int num_nodes;
+};
+
+/* discover the online cpus, their node, core and last level cache */
+int ndp_topology_init(struct ndp_topology *);
+void ndp_topology_destroy(struct ndp_topology *);
+
+const struct ndp_cpu *ndp_topology_cpu(const struct ndp_topology *, int);
+
+/* pin the calling thread to a single cpu */
+int ndp_bind_thread_to_cpu(int);
+
+/**
+ * where sysfs is read from: NDP_SYSFS_ROOT, or $NDP_SYSFS_ROOT when set,
+ * until changed.  Pointing it at a copied or hand-made tree lets
+ * discovery run against machines other than this one.  Set it before
+ * any discovery, from one thread.
+ */
+void ndp_sysfs_set_root(const char *);
+const char *ndp_sysfs_root(void);
+
+/**
+ * where a device sits
+ *
+ * @brief the node of the host bridge a PCI device hangs off and the CPUs
+ *        the platform reports as local to it.  DMA from the device lands
+ *        fastest in memory of that node, so that is where its buffers
+ *        belong, and the workers touching them next to it.  node is -1
+ *        and cpus empty when the platform does not say, as for virtual
+ *        interfaces or single-node machines.
+ */
+struct ndp_dev_locality
+{
+    int node;
+    int num_cpus;
+    cpu_set_t cpus;
+    char pci[NDP_PCI_ADDR_LEN]; /* domain:bus:dev.fn, empty when not PCI */
+};
+
+/* locality of a PCI device by address, -1 when there is no such device */
+int ndp_dev_locality_pci(const char *, struct ndp_dev_locality *);
+
+/* locality of the device behind a network interface, -1 when there is no such interface */
+int ndp_dev_locality_netdev(const char *, struct ndp_dev_locality *);
+
+/* node of the device behind a network interface, or fallback when unknown */
+int ndp_dev_node(const char *, int);
+
+/**
+ * cpus to run a device's workers on, at most max: the primary threads of
+ * its local cpus, then their siblings; the cpus of its node when it lists
+ * none, and every cpu when its node is unknown too.
+ */
+int ndp_topology_dev_cpus(const struct ndp_topology *, const struct ndp_dev_locality *, int *,
+                          int);
+
+static inline bool ndp_cpu_share_l3(const struct ndp_cpu *a, const struct ndp_cpu *b)
+{
+    if (a->l3 < 0 || b->l3 < 0)
+        return a->node == b->node;
+    return a->l3 == b->l3 && a->pkg == b->pkg;
+}
+
+#endif  /* INCLUDE_TOPOLOGY_H */
@@ -0,0 +1,126 @@
+
+#ifndef INCLUDE_WORKER_H
+#define INCLUDE_WORKER_H
+
+#include "mempool.h"
+#include "topology.h"
+#include "cycles.h"
+#include "qsbr.h"
+
+#define NDP_WORKER_MAX_POLLS    16
+#define NDP_WAKE_BUCKETS        32      /* log2(ns) wake-up latency histogram */
+
+/* a poll hook returns the amount of work it found, 0 when idle */
+typedef int (*ndp_poll_fn)(void *arg);
+
+enum ndp_worker_state
+{
+    NDP_WORKER_RUNNING,
+    NDP_WORKER_UMWAIT,
+    NDP_WORKER_SLEEPING,
+    NDP_WORKER_WAKING,
+};
+
+/**
+ * idle policy
+ *
+ * @brief an idle worker spins for `spin_polls` empty polls, then backs off
+ *        with exponentially growing runs of pause (or umwait when the CPU
+ *        has WAITPKG) and finally sleeps on its eventfd once it has been
+ *        idle for `sleep_after_us`.  A sleep lasts at most `sleep_max_us`
+ *        so that hooks with deadlines (timers) still get polled.
+ */
+struct ndp_idle_policy
+{
+    uint32_t spin_polls;
+    uint32_t pause_max;
+    uint32_t umwait_us;
+    uint32_t sleep_after_us;
+    uint32_t sleep_max_us;
+    bool use_umwait;
+    bool never_sleep;
+};
+
+struct ndp_worker_stats
+{
+    uint64_t busy_cycles;
+    uint64_t idle_cycles;
+    uint64_t polls;
+    uint64_t work;
+    uint64_t umwaits;
+    uint64_t sleeps;
+    uint64_t wakeups;
+    uint64_t wake_min_ns;
+    uint64_t wake_max_ns;
+    uint64_t wake_sum_ns;
+    uint64_t wake_hist[NDP_WAKE_BUCKETS];
+};
+
+struct ndp_worker
+{
+    /* written by wakers, monitored by umwait: keep on its own line */
+    int state __ndp_cache_aligned;
+    uint64_t wake_tsc;
+
+    ndp_poll_fn polls[NDP_WORKER_MAX_POLLS] __ndp_cache_aligned;
+    void *poll_args[NDP_WORKER_MAX_POLLS];
+    int num_polls;
+
+    int id;
+    int cpu;
+    int node;
+    int efd;
+    pthread_t thread;
+    bool running;
+    uint64_t loops;             /* poll rounds, release-published by the worker */
+
+    struct ndp_idle_policy policy;
+    uint64_t spin_cycles;
+    uint64_t umwait_cycles;
+    uint64_t sleep_after_cycles;
+
+    struct ndp_qsbr *qsbr;
+    int qsbr_id;
+
+    struct ndp_worker_stats stats;
+};
+
+/* defaults: 64 spins, pause up to 1024, 20us umwait, sleep after 1ms for 10ms */
+void ndp_idle_policy_default(struct ndp_idle_policy *);
+
+/* create a worker for `cpu`, allocated on the cpu's node; policy may be NULL */
+struct ndp_worker *ndp_worker_create(struct mempool_sys *, int, int,
+                                     const struct ndp_idle_policy *);
+
+int ndp_worker_add_poll(struct ndp_worker *, ndp_poll_fn, void *);
+int ndp_worker_start(struct ndp_worker *);
+
+/**
+ * make the worker a QSBR reader: it reports a quiescent state after every
+ * round of polls and goes offline while it waits.  Call before start.
+ */
+int ndp_worker_set_qsbr(struct ndp_worker *, struct ndp_qsbr *);
+void ndp_worker_stop(struct ndp_worker *);
+
+void ndp_worker_wake_slow(struct ndp_worker *);
+
+/**
+ * called by producers after handing work to a worker; cheap when the worker
+ * is running (one load), otherwise it ends the umwait or the sleep and
+ * stamps the TSC so the worker can account its wake-up latency.
+ */
+static inline void ndp_worker_wake(struct ndp_worker *w)
+{
+    // order the producer's enqueue before reading the worker state; pairs
+    // with the fence the worker issues after publishing an idle state
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (ndp_unlikely(__atomic_load_n(&w->state, __ATOMIC_RELAXED) != NDP_WORKER_RUNNING))
+        ndp_worker_wake_slow(w);
+}
+
+/* share of cycles spent in polls that found work, 0..1 */
+double ndp_worker_utilization(const struct ndp_worker *);
+
+void ndp_worker_stats_report(const struct ndp_worker *, FILE *);
+
+#endif  /* INCLUDE_WORKER_H */
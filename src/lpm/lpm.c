@@ -0,0 +1,640 @@
+/*******************************************************************************
+ * @file               lpm.c
+ * @brief              Longest prefix match route tables replicated per node.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Route lookups are the hottest read-only structure on the
+ *                     forwarding path, so every node gets its own copy in huge
+ *                     pages instead of all workers pulling one table over the
+ *                     interconnect.  IPv4 uses DIR-24-8 (one access for /24
+ *                     and shorter, two for longer prefixes), IPv6 a tree
+ *                     bitmap with a 4-bit stride.
+ *
+ *                     Tables are never edited in place.  The rule set lives
+ *                     in a hash on the control plane; a commit rebuilds the
+ *                     spare replica of each node from a thread bound to it,
+ *                     swaps the pointers and waits one QSBR grace period
+ *                     before the old replicas are reused.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "lpm.h"
+
+#include <arpa/inet.h>
+
+#define LPM_PREFETCH            8
+
+/**
+ *  internal bitmap positions of the prefixes of length 3, 2, 1 and 0 that
+ *  cover a nibble; the highest set bit of (internal & mask) is the longest
+ *  match inside a node.
+ */
+static const uint16_t lpm6_cover[16] = {
+#define LPM6_COVER(n)   (1U << 0 | 1U << (1 + ((n) >> 3)) | 1U << (3 + ((n) >> 2)) | \
+                         1U << (7 + ((n) >> 1)))
+    LPM6_COVER(0),  LPM6_COVER(1),  LPM6_COVER(2),  LPM6_COVER(3),
+    LPM6_COVER(4),  LPM6_COVER(5),  LPM6_COVER(6),  LPM6_COVER(7),
+    LPM6_COVER(8),  LPM6_COVER(9),  LPM6_COVER(10), LPM6_COVER(11),
+    LPM6_COVER(12), LPM6_COVER(13), LPM6_COVER(14), LPM6_COVER(15),
+#undef LPM6_COVER
+};
+
+static inline unsigned int nibble(const uint8_t *addr, unsigned int k)
+{
+    return (addr[k >> 1] >> (k & 1 ? 0 : 4)) & 0xf;
+}
+
+/* temporary pointer trie, serialised breadth first into a replica */
+struct lpm6_tmp
+{
+    struct lpm6_tmp *child[16];
+    uint32_t next_hop[15];
+    uint16_t internal;
+};
+
+struct lpm_build
+{
+    struct ndp_lpm_tbl *t;
+    const struct ndp_lpm_rule **v4;
+    uint32_t num_v4;
+    const struct ndp_lpm6_node *v6_nodes;
+    const uint32_t *v6_results;
+    uint32_t v6_num_nodes;
+    uint32_t v6_num_results;
+    int rc;
+};
+
+
+static uint32_t rule_hash(const uint8_t *addr, uint8_t depth, uint8_t v6)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    for (int i = 0; i < 16; i++)
+        h = (h ^ addr[i]) * 0x100000001b3ULL;
+    h = (h ^ depth) * 0x100000001b3ULL;
+    h = (h ^ v6) * 0x100000001b3ULL;
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static void prefix_mask(uint8_t *addr, unsigned int depth)
+{
+    for (unsigned int i = 0; i < 16; i++) {
+        unsigned int bits = depth > i * 8 ? depth - i * 8 : 0;
+        if (bits < 8)
+            addr[i] &= bits ? (uint8_t)(0xff << (8 - bits)) : 0;
+    }
+}
+
+/**
+ *  open addressing with tombstones; with `insert` set, returns the live
+ *  match or the first reusable slot on the probe path.
+ */
+static struct ndp_lpm_rule *rule_find(struct ndp_lpm *lpm, const uint8_t *addr,
+                                      uint8_t depth, uint8_t v6, bool insert)
+{
+    uint32_t mask = lpm->rule_cap - 1;
+    struct ndp_lpm_rule *tomb = NULL;
+
+    for (uint32_t i = rule_hash(addr, depth, v6) & mask;; i = (i + 1) & mask) {
+        struct ndp_lpm_rule *r = &lpm->rules[i];
+
+        if (r->state == NDP_LPM_RULE_EMPTY)
+            return insert ? (tomb ? tomb : r) : NULL;
+        if (r->state == NDP_LPM_RULE_DEAD) {
+            if (!tomb)
+                tomb = r;
+            continue;
+        }
+        if (r->depth == depth && r->v6 == v6 && !memcmp(r->addr, addr, 16))
+            return r;
+    }
+}
+
+/* drop tombstones once they make probe chains long */
+static int rule_rehash(struct ndp_lpm *lpm)
+{
+    struct ndp_lpm_rule *old = lpm->rules;
+
+    if (!(lpm->rules = calloc(lpm->rule_cap, sizeof(*lpm->rules)))) {
+        lpm->rules = old;
+        return -1;
+    }
+    for (uint32_t i = 0; i < lpm->rule_cap; i++) {
+        if (old[i].state != NDP_LPM_RULE_LIVE)
+            continue;
+        *rule_find(lpm, old[i].addr, old[i].depth, old[i].v6, true) = old[i];
+    }
+    lpm->used = lpm->num_rules;
+    free(old);
+    return 0;
+}
+
+static int rule_set(struct ndp_lpm *lpm, const uint8_t *prefix, uint8_t depth, uint8_t v6,
+                    uint32_t next_hop)
+{
+    uint8_t addr[16];
+    int rc = 0;
+
+    memcpy(addr, prefix, 16);
+    prefix_mask(addr, depth);
+
+    pthread_mutex_lock(&lpm->lock);
+    struct ndp_lpm_rule *r = rule_find(lpm, addr, depth, v6, true);
+
+    if (r->state == NDP_LPM_RULE_LIVE) {
+        r->next_hop = next_hop;
+        goto rule_unlock;
+    }
+    if (lpm->num_rules >= lpm->max_rules) {
+        rc = -1;
+        goto rule_unlock;
+    }
+    if (r->state == NDP_LPM_RULE_EMPTY)
+        lpm->used++;
+    memcpy(r->addr, addr, 16);
+    r->depth = depth;
+    r->v6 = v6;
+    r->next_hop = next_hop;
+    r->state = NDP_LPM_RULE_LIVE;
+    lpm->num_rules++;
+
+    // a failed rehash only costs probe length
+    if (lpm->used > lpm->rule_cap / 4 * 3)
+        rule_rehash(lpm);
+
+rule_unlock:
+    pthread_mutex_unlock(&lpm->lock);
+    return rc;
+}
+
+static int rule_del(struct ndp_lpm *lpm, const uint8_t *prefix, uint8_t depth, uint8_t v6)
+{
+    uint8_t addr[16];
+    int rc = -1;
+
+    memcpy(addr, prefix, 16);
+    prefix_mask(addr, depth);
+
+    pthread_mutex_lock(&lpm->lock);
+    struct ndp_lpm_rule *r = rule_find(lpm, addr, depth, v6, false);
+    if (r) {
+        r->state = NDP_LPM_RULE_DEAD;
+        lpm->num_rules--;
+        rc = 0;
+    }
+    pthread_mutex_unlock(&lpm->lock);
+    return rc;
+}
+
+int ndp_lpm_add(struct ndp_lpm *lpm, uint32_t ip, uint8_t depth, uint32_t next_hop)
+{
+    uint8_t addr[16] = { 0 };
+    uint32_t be = htonl(ip);
+
+    if (depth > 32 || next_hop > NDP_LPM_NH_MASK)
+        return -1;
+    memcpy(addr, &be, 4);
+    return rule_set(lpm, addr, depth, 0, next_hop);
+}
+
+int ndp_lpm_delete(struct ndp_lpm *lpm, uint32_t ip, uint8_t depth)
+{
+    uint8_t addr[16] = { 0 };
+    uint32_t be = htonl(ip);
+
+    if (depth > 32)
+        return -1;
+    memcpy(addr, &be, 4);
+    return rule_del(lpm, addr, depth, 0);
+}
+
+int ndp_lpm6_add(struct ndp_lpm *lpm, const uint8_t *ip, uint8_t depth, uint32_t next_hop)
+{
+    if (depth > 128 || next_hop > NDP_LPM_NH_MASK)
+        return -1;
+    return rule_set(lpm, ip, depth, 1, next_hop);
+}
+
+int ndp_lpm6_delete(struct ndp_lpm *lpm, const uint8_t *ip, uint8_t depth)
+{
+    if (depth > 128)
+        return -1;
+    return rule_del(lpm, ip, depth, 1);
+}
+
+static struct ndp_lpm_tbl *tbl_alloc(int node, uint32_t num_tbl8)
+{
+    struct ndp_lpm_tbl *t = numa_alloc_onnode(sizeof(*t), node);
+
+    if (!t)
+        return NULL;
+    memset(t, 0, sizeof(*t));
+    t->node = node;
+    t->num_tbl8 = num_tbl8;
+
+    // fresh mappings read as zero: an unbuilt replica misses every lookup
+    t->tbl24 = ndp_mempool_map_huge(NDP_LPM_TBL24_SIZE * sizeof(uint32_t), node);
+    t->tbl8 = ndp_mempool_map_huge((size_t)num_tbl8 * NDP_LPM_TBL8_GROUP *
+                                   sizeof(uint32_t), node);
+    if (!t->tbl24 || !t->tbl8) {
+        ndp_mempool_unmap(t->tbl24, NDP_LPM_TBL24_SIZE * sizeof(uint32_t));
+        ndp_mempool_unmap(t->tbl8, (size_t)num_tbl8 * NDP_LPM_TBL8_GROUP * sizeof(uint32_t));
+        numa_free(t, sizeof(*t));
+        return NULL;
+    }
+    return t;
+}
+
+static void tbl_free(struct ndp_lpm_tbl *t)
+{
+    if (!t)
+        return;
+    ndp_mempool_unmap(t->tbl24, NDP_LPM_TBL24_SIZE * sizeof(uint32_t));
+    ndp_mempool_unmap(t->tbl8, (size_t)t->num_tbl8 * NDP_LPM_TBL8_GROUP * sizeof(uint32_t));
+    ndp_mempool_unmap(t->v6_map, t->v6_map_size);
+    numa_free(t, sizeof(*t));
+}
+
+struct ndp_lpm *ndp_lpm_create(const int *nodes, int num_nodes, uint32_t max_rules,
+                               uint32_t num_tbl8, struct ndp_qsbr *qsbr)
+{
+    struct ndp_lpm *lpm;
+    int max_node = numa_max_node();
+
+    if (num_nodes <= 0 || num_nodes > NDP_LPM_MAX_NODES || !max_rules ||
+        !num_tbl8 || num_tbl8 > NDP_LPM_NH_MASK)
+        return NULL;
+    if (!(lpm = calloc(1, sizeof(*lpm))))
+        return NULL;
+
+    lpm->qsbr = qsbr;
+    lpm->num_nodes = num_nodes;
+    lpm->num_tbl8 = num_tbl8;
+    lpm->max_rules = max_rules;
+    lpm->rule_cap = 16;
+    while (lpm->rule_cap < 2 * max_rules)
+        lpm->rule_cap <<= 1;
+    pthread_mutex_init(&lpm->lock, NULL);
+    if (!(lpm->rules = calloc(lpm->rule_cap, sizeof(*lpm->rules))))
+        goto lpm_fail;
+
+    for (int i = 0; i < num_nodes; i++) {
+        if (nodes[i] < 0 || nodes[i] >= NDP_LPM_MAX_NODES)
+            goto lpm_fail;
+        lpm->nodes[i] = nodes[i];
+        lpm->active[i] = tbl_alloc(nodes[i], num_tbl8);
+        lpm->spare[i] = tbl_alloc(nodes[i], num_tbl8);
+        if (!lpm->active[i] || !lpm->spare[i])
+            goto lpm_fail;
+    }
+
+    // nodes without a replica read the closest one
+    for (int n = 0; n < NDP_LPM_MAX_NODES; n++) {
+        int best = 0;
+        for (int i = 1; n <= max_node && i < num_nodes; i++) {
+            if (numa_distance(n, nodes[i]) < numa_distance(n, nodes[best]))
+                best = i;
+        }
+        lpm->replica_of[n] = best;
+        lpm->tbl_of[n] = lpm->active[best];
+    }
+    return lpm;
+
+lpm_fail:
+    ndp_lpm_destroy(lpm);
+    return NULL;
+}
+
+void ndp_lpm_destroy(struct ndp_lpm *lpm)
+{
+    if (!lpm)
+        return;
+    for (int i = 0; i < lpm->num_nodes; i++) {
+        tbl_free(lpm->active[i]);
+        tbl_free(lpm->spare[i]);
+    }
+    pthread_mutex_destroy(&lpm->lock);
+    free(lpm->rules);
+    free(lpm);
+}
+
+static int rule_depth_cmp(const void *a, const void *b)
+{
+    const struct ndp_lpm_rule *ra = *(const struct ndp_lpm_rule *const *)a;
+    const struct ndp_lpm_rule *rb = *(const struct ndp_lpm_rule *const *)b;
+
+    return (int)ra->depth - (int)rb->depth;
+}
+
+static void lpm6_tmp_free(struct lpm6_tmp *n)
+{
+    if (!n)
+        return;
+    for (int i = 0; i < 16; i++)
+        lpm6_tmp_free(n->child[i]);
+    free(n);
+}
+
+/**
+ *  build the IPv6 tree bitmap once per commit; replicas copy the arrays.
+ *  Children of a node are contiguous because the trie is serialised in
+ *  breadth-first order.
+ */
+static int lpm6_build(struct ndp_lpm *lpm, struct lpm_build *b)
+{
+    struct lpm6_tmp *root = NULL, **queue = NULL;
+    struct ndp_lpm6_node *nodes = NULL;
+    uint32_t *results = NULL;
+    uint32_t count = 0, num_results = 0;
+    int rc = -1;
+
+    for (uint32_t i = 0; i < lpm->rule_cap; i++) {
+        const struct ndp_lpm_rule *r = &lpm->rules[i];
+        if (r->state != NDP_LPM_RULE_LIVE || !r->v6)
+            continue;
+
+        if (!root) {
+            if (!(root = calloc(1, sizeof(*root))))
+                goto lpm6_done;
+            count = 1;
+        }
+
+        struct lpm6_tmp *n = root;
+        unsigned int level = r->depth / NDP_LPM6_STRIDE;
+        unsigned int rem = r->depth % NDP_LPM6_STRIDE;
+
+        for (unsigned int k = 0; k < level; k++) {
+            unsigned int nib = nibble(r->addr, k);
+            if (!n->child[nib]) {
+                if (!(n->child[nib] = calloc(1, sizeof(*n))))
+                    goto lpm6_done;
+                count++;
+            }
+            n = n->child[nib];
+        }
+
+        unsigned int idx = (1U << rem) - 1 + (rem ? nibble(r->addr, level) >> (4 - rem) : 0);
+        if (!(n->internal & (1U << idx)))
+            num_results++;
+        n->internal |= 1U << idx;
+        n->next_hop[idx] = r->next_hop;
+    }
+
+    if (!root) {
+        rc = 0;
+        goto lpm6_done;
+    }
+
+    queue = malloc(sizeof(*queue) * count);
+    nodes = malloc(sizeof(*nodes) * count);
+    results = malloc(sizeof(*results) * num_results);
+    if (!queue || !nodes || !results)
+        goto lpm6_done;
+
+    uint32_t head = 0, tail = 1, res = 0;
+    queue[0] = root;
+    while (head < tail) {
+        struct lpm6_tmp *tn = queue[head];
+        struct ndp_lpm6_node *out = &nodes[head++];
+
+        out->internal = tn->internal;
+        out->result = res;
+        for (int idx = 0; idx < 15; idx++) {
+            if (tn->internal & (1U << idx))
+                results[res++] = tn->next_hop[idx];
+        }
+        out->external = 0;
+        out->child = tail;
+        for (int nib = 0; nib < 16; nib++) {
+            if (tn->child[nib]) {
+                out->external |= 1U << nib;
+                queue[tail++] = tn->child[nib];
+            }
+        }
+    }
+
+    b->v6_nodes = nodes;
+    b->v6_results = results;
+    b->v6_num_nodes = count;
+    b->v6_num_results = num_results;
+    nodes = NULL;
+    results = NULL;
+    rc = 0;
+
+lpm6_done:
+    lpm6_tmp_free(root);
+    free(queue);
+    free(nodes);
+    free(results);
+    return rc;
+}
+
+static int lpm4_build(struct ndp_lpm_tbl *t, const struct ndp_lpm_rule **rules, uint32_t n)
+{
+    memset(t->tbl24, 0, NDP_LPM_TBL24_SIZE * sizeof(uint32_t));
+    t->tbl8_used = 0;
+
+    // ascending depth: a longer prefix always overwrites the shorter ones
+    // it nests in, and every /25../32 sees its final covering /24 entry
+    for (uint32_t i = 0; i < n; i++) {
+        const struct ndp_lpm_rule *r = rules[i];
+        uint32_t ip = ntohl(*(const uint32_t *)r->addr);
+        uint32_t e = NDP_LPM_VALID | r->next_hop;
+
+        if (r->depth <= 24) {
+            uint32_t first = ip >> 8;
+            uint32_t span = 1U << (24 - r->depth);
+            for (uint32_t j = 0; j < span; j++) {
+                uint32_t *slot = &t->tbl24[first + j];
+                if (*slot & NDP_LPM_EXT) {
+                    uint32_t *grp = &t->tbl8[(*slot & NDP_LPM_NH_MASK) * NDP_LPM_TBL8_GROUP];
+                    for (int k = 0; k < NDP_LPM_TBL8_GROUP; k++)
+                        grp[k] = e;
+                } else {
+                    *slot = e;
+                }
+            }
+            continue;
+        }
+
+        uint32_t *slot = &t->tbl24[ip >> 8];
+        if (!(*slot & NDP_LPM_EXT)) {
+            if (t->tbl8_used == t->num_tbl8)
+                return -1;
+            uint32_t g = t->tbl8_used++;
+            uint32_t *grp = &t->tbl8[g * NDP_LPM_TBL8_GROUP];
+            for (int k = 0; k < NDP_LPM_TBL8_GROUP; k++)
+                grp[k] = *slot;
+            *slot = NDP_LPM_VALID | NDP_LPM_EXT | g;
+        }
+
+        uint32_t *grp = &t->tbl8[(*slot & NDP_LPM_NH_MASK) * NDP_LPM_TBL8_GROUP];
+        uint32_t span = 1U << (32 - r->depth);
+        for (uint32_t j = 0; j < span; j++)
+            grp[(ip & 0xff) + j] = e;
+    }
+    return 0;
+}
+
+/* runs on the replica's node so the rebuild writes local memory */
+static void *lpm_build_thread(void *args)
+{
+    struct lpm_build *b = args;
+    struct ndp_lpm_tbl *t = b->t;
+
+    ndp_bind_thread_to_node(t->node);
+
+    if ((b->rc = lpm4_build(t, b->v4, b->num_v4)) != 0)
+        return NULL;
+
+    ndp_mempool_unmap(t->v6_map, t->v6_map_size);
+    t->v6_map = NULL;
+    t->v6_map_size = 0;
+    t->v6_num_nodes = 0;
+    t->v6_num_results = 0;
+    if (!b->v6_num_nodes)
+        return NULL;
+
+    size_t nodes_size = align_up(sizeof(*t->v6_nodes) * b->v6_num_nodes, NDP_CACHE_LINE);
+    t->v6_map_size = nodes_size + sizeof(*t->v6_results) * b->v6_num_results;
+    if (!(t->v6_map = ndp_mempool_map_huge(t->v6_map_size, t->node))) {
+        b->rc = -1;
+        return NULL;
+    }
+    t->v6_nodes = t->v6_map;
+    t->v6_results = (uint32_t *)((uint8_t *)t->v6_map + nodes_size);
+    memcpy(t->v6_nodes, b->v6_nodes, sizeof(*t->v6_nodes) * b->v6_num_nodes);
+    memcpy(t->v6_results, b->v6_results, sizeof(*t->v6_results) * b->v6_num_results);
+    t->v6_num_nodes = b->v6_num_nodes;
+    t->v6_num_results = b->v6_num_results;
+    return NULL;
+}
+
+int ndp_lpm_commit(struct ndp_lpm *lpm)
+{
+    struct lpm_build proto = { 0 }, b[NDP_LPM_MAX_NODES];
+    pthread_t threads[NDP_LPM_MAX_NODES];
+    bool started[NDP_LPM_MAX_NODES] = { false };
+    struct ndp_lpm_tbl *old[NDP_LPM_MAX_NODES];
+    int rc = -1;
+
+    pthread_mutex_lock(&lpm->lock);
+
+    if (!(proto.v4 = malloc(sizeof(*proto.v4) * (lpm->num_rules + 1))))
+        goto commit_unlock;
+    for (uint32_t i = 0; i < lpm->rule_cap; i++) {
+        if (lpm->rules[i].state == NDP_LPM_RULE_LIVE && !lpm->rules[i].v6)
+            proto.v4[proto.num_v4++] = &lpm->rules[i];
+    }
+    qsort(proto.v4, proto.num_v4, sizeof(*proto.v4), rule_depth_cmp);
+
+    if (lpm6_build(lpm, &proto) != 0)
+        goto commit_free;
+
+    for (int i = 0; i < lpm->num_nodes; i++) {
+        b[i] = proto;
+        b[i].t = lpm->spare[i];
+        started[i] = pthread_create(&threads[i], NULL, lpm_build_thread, &b[i]) == 0;
+        if (!started[i])
+            lpm_build_thread(&b[i]);
+    }
+
+    rc = 0;
+    for (int i = 0; i < lpm->num_nodes; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        if (b[i].rc != 0)
+            rc = -1;
+    }
+    if (rc != 0)
+        goto commit_free;
+
+    for (int i = 0; i < lpm->num_nodes; i++) {
+        old[i] = lpm->active[i];
+        lpm->active[i] = lpm->spare[i];
+    }
+    for (int n = 0; n < NDP_LPM_MAX_NODES; n++)
+        __atomic_store_n(&lpm->tbl_of[n], lpm->active[lpm->replica_of[n]], __ATOMIC_RELEASE);
+
+    // after the grace period no reader holds an old replica
+    if (lpm->qsbr)
+        ndp_qsbr_synchronize(lpm->qsbr);
+    for (int i = 0; i < lpm->num_nodes; i++)
+        lpm->spare[i] = old[i];
+
+commit_free:
+    free(proto.v4);
+    free((void *)proto.v6_nodes);
+    free((void *)proto.v6_results);
+commit_unlock:
+    pthread_mutex_unlock(&lpm->lock);
+    return rc;
+}
+
+uint32_t ndp_lpm6_lookup(const struct ndp_lpm_tbl *t, const uint8_t *addr)
+{
+    const struct ndp_lpm6_node *n = t->v6_nodes;
+    uint32_t best = NDP_LPM_NO_ROUTE;
+
+    if (!t->v6_num_nodes)
+        return best;
+
+    for (unsigned int k = 0;; k++) {
+        // the node below the last nibble only holds /128s (bit 0)
+        unsigned int nib = k < 128 / NDP_LPM6_STRIDE ? nibble(addr, k) : 0;
+        uint32_t m = n->internal & lpm6_cover[nib];
+
+        if (m) {
+            unsigned int idx = 31 - __builtin_clz(m);
+            best = t->v6_results[n->result +
+                                 __builtin_popcount(n->internal & ((1U << idx) - 1))];
+        }
+        if (k == 128 / NDP_LPM6_STRIDE || !(n->external & (1U << nib)))
+            break;
+        n = &t->v6_nodes[n->child + __builtin_popcount(n->external & ((1U << nib) - 1))];
+    }
+    return best;
+}
+
+void ndp_lpm_lookup_bulk(const struct ndp_lpm_tbl *t, const uint32_t *ips, uint32_t *next_hop,
+                         unsigned int n)
+{
+    for (unsigned int i = 0; i < n && i < LPM_PREFETCH; i++)
+        __builtin_prefetch(&t->tbl24[ips[i] >> 8]);
+
+    for (unsigned int i = 0; i < n; i++) {
+        if (i + LPM_PREFETCH < n)
+            __builtin_prefetch(&t->tbl24[ips[i + LPM_PREFETCH] >> 8]);
+        next_hop[i] = ndp_lpm_lookup(t, ips[i]);
+    }
+}
+
+void ndp_lpm_lookup_burst(const struct ndp_lpm_tbl *t, struct ndp_burst *b)
+{
+    uint32_t ips[NDP_BURST_MAX], hops[NDP_BURST_MAX];
+    uint16_t idx[NDP_BURST_MAX];
+    unsigned int n4 = 0;
+
+    // gather the v4 destinations first so the bulk pass can run ahead
+    for (uint16_t i = 0; i < b->count; i++) {
+        const uint8_t *l3 = b->data[i] + b->l3_off[i];
+
+        if (b->flags[i] & NDP_BUF_F_IPV4) {
+            uint32_t dst;
+            memcpy(&dst, l3 + 16, sizeof(dst));
+            ips[n4] = ntohl(dst);
+            idx[n4++] = i;
+        } else if (b->flags[i] & NDP_BUF_F_IPV6) {
+            b->next_hop[i] = ndp_lpm6_lookup(t, l3 + 24);
+        } else {
+            b->next_hop[i] = NDP_LPM_NO_ROUTE;
+        }
+    }
+
+    ndp_lpm_lookup_bulk(t, ips, hops, n4);
+    for (unsigned int k = 0; k < n4; k++)
+        b->next_hop[idx[k]] = hops[k];
+}
@@ -242,6 +242,93 @@ void *ndp_mempool_alloc_on_node(struct mempool_sys *sys, int node, size_t align)
     return ptr;
 }
 
+/** Sized Pool Allocation
+ *  Carve an arbitrary sized region out of a node pool
+ *
+ *  @brief the offset is advanced with a CAS loop so workers and control
+ *         threads that share a node can allocate without a lock.
+ *
+ *  @param node  - pool to allocate from
+ *  @param size  - bytes requested
+ *  @param align - power of two alignment, 0 for none
+ *
+ *  @return pointer into the node pool, NULL when the pool is exhausted
+ */
+void *ndp_mempool_alloc(struct mempool_sys *sys, int node, size_t size, size_t align)
+{
+    if (node < 0 || node >= sys->num_nodes)
+        return NULL;
+
+    struct mempool_node *p = &sys->pools[node];
+    size_t a = align ? align : 1;
+    size_t cur = __atomic_load_n(&p->offset, __ATOMIC_RELAXED);
+    size_t off;
+
+    do {
+        off = align_up(cur, a);
+        if (off + size > p->size)
+            return NULL;
+    } while (!__atomic_compare_exchange_n(&p->offset, &cur, off + size, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    return p->base + off;
+}
+
+int ndp_mempool_node_of(const struct mempool_sys *sys, const void *addr)
+{
+    const uint8_t *a = addr;
+
+    for (int node = 0; node < sys->num_nodes; node++) {
+        const struct mempool_node *p = &sys->pools[node];
+        if (p->base && a >= p->base && a < p->base + p->size)
+            return node;
+    }
+    return -1;
+}
+
+void *ndp_mempool_map_huge(size_t size, int node)
+{
+    unsigned long mask[(NUMA_NUM_NODES + 8 * sizeof(unsigned long) - 1) /
+                       (8 * sizeof(unsigned long))] = { 0 };
+    size_t len = align_up(size, NDP_HUGE_PAGE);
+    uint8_t *map, *base;
+
+    map = mmap(NULL, len, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (map != MAP_FAILED) {
+        base = map;
+        goto huge_bind;
+    }
+
+    // no reserved huge pages: over-map, trim to a 2MB boundary and let THP
+    // back the region
+    map = mmap(NULL, len + NDP_HUGE_PAGE, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+    base = (uint8_t *)align_up((uintptr_t)map, NDP_HUGE_PAGE);
+    if (base > map)
+        munmap(map, base - map);
+    if (map + len + NDP_HUGE_PAGE > base + len)
+        munmap(base + len, map + len + NDP_HUGE_PAGE - (base + len));
+    madvise(base, len, MADV_HUGEPAGE);
+
+huge_bind:
+    mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    if (mbind(base, len, MPOL_BIND, mask, NUMA_NUM_NODES, 0) != 0) {
+        perror("mbind huge region");
+        munmap(base, len);
+        return NULL;
+    }
+    return base;
+}
+
+void ndp_mempool_unmap(void *addr, size_t size)
+{
+    if (addr)
+        munmap(addr, align_up(size, NDP_HUGE_PAGE));
+}
+
 void mempool_system_destroy(struct mempool_sys *sys)
 {
     if (!sys->pools)
@@ -0,0 +1,90 @@
+/*******************************************************************************
+ * @file               objpool.c
+ * @brief              Fixed-size object pools carved from the NUMA node pools.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            The node pools handed out by mempool.c are bump allocated
+ *                     and never shrink.  Objects with a shorter lifetime are
+ *                     served from an object pool instead: one contiguous run
+ *                     of equally sized, cache-line aligned elements plus a
+ *                     stack of free element pointers, both taken from the same
+ *                     node pool.  Gets and puts are O(1) and never touch the
+ *                     system allocator, and an object always goes back to the
+ *                     pool (and therefore the node) it came from.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "objpool.h"
+
+
+struct ndp_objpool *ndp_objpool_create(struct mempool_sys *sys, int node,
+                                       size_t elt_size, unsigned int count)
+{
+    if (!count || !elt_size)
+        return NULL;
+
+    struct ndp_objpool *op = ndp_mempool_alloc(sys, node, sizeof(*op), NDP_CACHE_LINE);
+    if (!op)
+        return NULL;
+
+    op->elt_size = align_up(elt_size, (size_t)NDP_CACHE_LINE);
+    op->base = ndp_mempool_alloc(sys, node, op->elt_size * count, NDP_CACHE_LINE);
+    op->stack = ndp_mempool_alloc(sys, node, sizeof(void *) * count, NDP_CACHE_LINE);
+    if (!op->base || !op->stack)
+        return NULL;
+
+    if (pthread_spin_init(&op->lock, PTHREAD_PROCESS_PRIVATE) != 0)
+        return NULL;
+
+    op->count = count;
+    op->node = node;
+    for (unsigned int i = 0; i < count; i++)
+        op->stack[i] = op->base + (size_t)(count - 1 - i) * op->elt_size;
+    op->avail = count;
+
+    return op;
+}
+
+void *ndp_objpool_get(struct ndp_objpool *op)
+{
+    void *obj = NULL;
+
+    pthread_spin_lock(&op->lock);
+    if (op->avail)
+        obj = op->stack[--op->avail];
+    pthread_spin_unlock(&op->lock);
+
+    return obj;
+}
+
+void ndp_objpool_put(struct ndp_objpool *op, void *obj)
+{
+    pthread_spin_lock(&op->lock);
+    op->stack[op->avail++] = obj;
+    pthread_spin_unlock(&op->lock);
+}
+
+unsigned int ndp_objpool_get_bulk(struct ndp_objpool *op, void **objs, unsigned int n)
+{
+    pthread_spin_lock(&op->lock);
+    if (op->avail < n) {
+        pthread_spin_unlock(&op->lock);
+        return 0;
+    }
+    for (unsigned int i = 0; i < n; i++)
+        objs[i] = op->stack[--op->avail];
+    pthread_spin_unlock(&op->lock);
+
+    return n;
+}
+
+void ndp_objpool_put_bulk(struct ndp_objpool *op, void *const *objs, unsigned int n)
+{
+    pthread_spin_lock(&op->lock);
+    for (unsigned int i = 0; i < n; i++)
+        op->stack[op->avail++] = objs[i];
+    pthread_spin_unlock(&op->lock);
+}
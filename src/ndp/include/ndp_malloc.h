@@ -2,8 +2,48 @@
 #ifndef INCLUDE_NDP_NDP_MALLOC
 #define INCLUDE_NDP_NDP_MALLOC
 
-static void *ndp_malloc(const char *type, int no_blocks, int numa_node,
-                                                    const bool trace_alloc);
+#include "mempool.h"
 
+/* requests from this size up are mapped directly instead of carved from a pool */
+#define NDP_MALLOC_LARGE_MIN        (64UL << 20)
+#define NDP_MALLOC_PREFAULT_THREADS 8
+#define NDP_MALLOC_PREFAULT_SLICE   (64UL << 20)        /* least work per thread */
 
-#endif /* INCLUDE_NDP_NDP_MALLOC */
\ No newline at end of file
+/* flags */
+#define NDP_MALLOC_PREFAULT         0x1     /* fault every page in before returning */
+#define NDP_MALLOC_LOCK             0x2     /* mlock() the region, like the node pools */
+
+/**
+ * allocate `size` bytes on `node`
+ *
+ * @brief small requests are carved from the node pool and live as long as
+ *        it does; from NDP_MALLOC_LARGE_MIN up the memory is a fresh
+ *        mapping of its own, so a gigabyte table neither eats into the
+ *        pool nor stays behind once it is freed.
+ */
+void *ndp_malloc_node(struct mempool_sys *, int, size_t, unsigned int);
+
+/**
+ * map `size` bytes for a single object, bound to `node`
+ *
+ * @brief 2MB aligned and backed by huge pages when they are reserved, by
+ *        transparent huge pages otherwise.  With NDP_MALLOC_PREFAULT the
+ *        pages are touched by up to NDP_MALLOC_PREFAULT_THREADS threads
+ *        running on the node, so the zeroing of a large region happens in
+ *        parallel and on local memory bandwidth.  The region is recorded
+ *        in a page map keyed by 2MB page, which is how ndp_free() finds it.
+ */
+void *ndp_malloc_large(size_t, int, unsigned int);
+
+/* release a large region; pool memory is left in its pool */
+void ndp_free(void *);
+
+/* bytes mapped for the large region containing addr, 0 when it is not one */
+size_t ndp_malloc_usable_size(const void *);
+
+/* node of the large region containing addr, -1 when it is not one */
+int ndp_malloc_node_of(const void *);
+
+void ndp_malloc_stats_report(FILE *);
+
+#endif /* INCLUDE_NDP_NDP_MALLOC */
@@ -0,0 +1,241 @@
+/*******************************************************************************
+ * @file               ndp_malloc.c
+ * @brief              Node-bound allocation front end and large-region path.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Large regions are mapped one per request, 2MB aligned,
+ *                     so every 2MB page of the address space belongs to at
+ *                     most one of them.  The page map is a two-level radix
+ *                     table from 2MB page number to region descriptor:
+ *                     lookups are two dependent loads and take no lock,
+ *                     updates are serialised by a mutex and only happen on
+ *                     map and unmap.  Leaves are never released, so a
+ *                     reader can never see one go away.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "ndp_malloc.h"
+
+#define PMAP_SHIFT              21      /* 2MB pages */
+#define PMAP_LEAF_BITS          14
+#define PMAP_TOP_BITS           (48 - PMAP_SHIFT - PMAP_LEAF_BITS)
+#define PMAP_MAX_NODES          64
+
+struct large_region
+{
+    uint8_t *base;
+    size_t len;
+    int node;
+    unsigned int flags;
+};
+
+struct prefault_arg
+{
+    volatile uint8_t *base;
+    size_t len;
+    long page;
+    int node;
+};
+
+static struct large_region **pmap[1UL << PMAP_TOP_BITS];
+static pthread_mutex_t pmap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct
+{
+    uint64_t maps;
+    uint64_t unmaps;
+    uint64_t failed;
+    uint64_t bytes[PMAP_MAX_NODES];
+} large_stats;
+
+static struct large_region *pmap_lookup(const void *addr)
+{
+    uintptr_t page = (uintptr_t)addr >> PMAP_SHIFT;
+    struct large_region **leaf;
+
+    if (page >> PMAP_LEAF_BITS >= (1UL << PMAP_TOP_BITS))
+        return NULL;
+    leaf = __atomic_load_n(&pmap[page >> PMAP_LEAF_BITS], __ATOMIC_ACQUIRE);
+    if (!leaf)
+        return NULL;
+    return __atomic_load_n(&leaf[page & ((1UL << PMAP_LEAF_BITS) - 1)], __ATOMIC_ACQUIRE);
+}
+
+/* point every 2MB page of r at val; pmap_lock held */
+static int pmap_set(const struct large_region *r, struct large_region *val)
+{
+    uintptr_t first = (uintptr_t)r->base >> PMAP_SHIFT;
+    uintptr_t last = ((uintptr_t)r->base + r->len - 1) >> PMAP_SHIFT;
+
+    if (last >> PMAP_LEAF_BITS >= (1UL << PMAP_TOP_BITS))
+        return -1;
+    // allocate the leaves first so a failure leaves nothing half recorded
+    for (uintptr_t top = first >> PMAP_LEAF_BITS; top <= last >> PMAP_LEAF_BITS; top++) {
+        if (pmap[top])
+            continue;
+        struct large_region **leaf = calloc(1UL << PMAP_LEAF_BITS, sizeof(*leaf));
+        if (!leaf)
+            return -1;
+        __atomic_store_n(&pmap[top], leaf, __ATOMIC_RELEASE);
+    }
+    for (uintptr_t page = first; page <= last; page++)
+        __atomic_store_n(&pmap[page >> PMAP_LEAF_BITS][page & ((1UL << PMAP_LEAF_BITS) - 1)],
+                         val, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static void *prefault_thread(void *args)
+{
+    struct prefault_arg *a = args;
+
+    // the pages come from the node whatever CPU faults them (mbind), but
+    // zeroing them from the node keeps the writes off the interconnect
+    ndp_bind_thread_to_node(a->node);
+    for (size_t off = 0; off < a->len; off += a->page)
+        a->base[off] = 0;
+    return NULL;
+}
+
+static void prefault(uint8_t *base, size_t len, int node)
+{
+    struct prefault_arg args[NDP_MALLOC_PREFAULT_THREADS];
+    pthread_t threads[NDP_MALLOC_PREFAULT_THREADS];
+    bool started[NDP_MALLOC_PREFAULT_THREADS] = { false };
+    struct bitmask *cpus = numa_allocate_cpumask();
+    long page = sysconf(_SC_PAGESIZE);
+    size_t n = len / NDP_MALLOC_PREFAULT_SLICE, slice;
+
+    if (page <= 0)
+        page = 4096;
+    if (cpus && numa_node_to_cpus(node, cpus) == 0 && numa_bitmask_weight(cpus) < n)
+        n = numa_bitmask_weight(cpus);
+    if (cpus)
+        numa_free_cpumask(cpus);
+    if (n > NDP_MALLOC_PREFAULT_THREADS)
+        n = NDP_MALLOC_PREFAULT_THREADS;
+    if (!n)
+        n = 1;
+    slice = align_up(len / n, NDP_HUGE_PAGE);
+
+    for (size_t i = 0; i < n; i++) {
+        size_t off = i * slice;
+
+        args[i].base = base + off;
+        args[i].len = off >= len ? 0 : off + slice > len ? len - off : slice;
+        args[i].page = page;
+        args[i].node = node;
+        // the caller's thread takes the last slice
+        if (i + 1 < n)
+            started[i] = pthread_create(&threads[i], NULL, prefault_thread, &args[i]) == 0;
+        if (!started[i]) {
+            volatile uint8_t *p = args[i].base;
+            for (size_t o = 0; o < args[i].len; o += page)
+                p[o] = 0;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+    }
+}
+
+void *ndp_malloc_large(size_t size, int node, unsigned int flags)
+{
+    struct large_region *r;
+
+    if (!size || node < 0 || node >= PMAP_MAX_NODES)
+        return NULL;
+    if (!(r = malloc(sizeof(*r))))
+        return NULL;
+    r->len = align_up(size, NDP_HUGE_PAGE);
+    r->node = node;
+    r->flags = flags;
+    if (!(r->base = ndp_mempool_map_huge(r->len, node)))
+        goto large_fail;
+
+    if ((flags & NDP_MALLOC_LOCK) && mlock(r->base, r->len) != 0) {
+        perror("mlock large region");
+        goto large_unmap;
+    }
+    if (flags & NDP_MALLOC_PREFAULT)
+        prefault(r->base, r->len, node);
+
+    pthread_mutex_lock(&pmap_lock);
+    if (pmap_set(r, r) != 0) {
+        pthread_mutex_unlock(&pmap_lock);
+        fprintf(stderr, "ndp_malloc: cannot record %zu bytes at %p\n", r->len, r->base);
+        goto large_unmap;
+    }
+    pthread_mutex_unlock(&pmap_lock);
+
+    __atomic_fetch_add(&large_stats.maps, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&large_stats.bytes[node], r->len, __ATOMIC_RELAXED);
+    return r->base;
+
+large_unmap:
+    ndp_mempool_unmap(r->base, r->len);
+large_fail:
+    __atomic_fetch_add(&large_stats.failed, 1, __ATOMIC_RELAXED);
+    free(r);
+    return NULL;
+}
+
+void *ndp_malloc_node(struct mempool_sys *mem, int node, size_t size, unsigned int flags)
+{
+    if (size >= NDP_MALLOC_LARGE_MIN)
+        return ndp_malloc_large(size, node, flags);
+    return ndp_mempool_alloc(mem, node, size, NDP_CACHE_LINE);
+}
+
+void ndp_free(void *addr)
+{
+    struct large_region *r;
+
+    if (!addr || !(r = pmap_lookup(addr)))
+        return;
+    if (r->base != addr) {
+        fprintf(stderr, "ndp_free: %p is inside the region at %p\n", addr, r->base);
+        return;
+    }
+
+    pthread_mutex_lock(&pmap_lock);
+    pmap_set(r, NULL);
+    pthread_mutex_unlock(&pmap_lock);
+
+    if (r->flags & NDP_MALLOC_LOCK)
+        munlock(r->base, r->len);
+    ndp_mempool_unmap(r->base, r->len);
+    __atomic_fetch_add(&large_stats.unmaps, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&large_stats.bytes[r->node], r->len, __ATOMIC_RELAXED);
+    free(r);
+}
+
+size_t ndp_malloc_usable_size(const void *addr)
+{
+    const struct large_region *r = pmap_lookup(addr);
+
+    return r ? r->len : 0;
+}
+
+int ndp_malloc_node_of(const void *addr)
+{
+    const struct large_region *r = pmap_lookup(addr);
+
+    return r ? r->node : -1;
+}
+
+void ndp_malloc_stats_report(FILE *out)
+{
+    fprintf(out, "large regions: %lu mapped, %lu unmapped, %lu failed\n",
+            __atomic_load_n(&large_stats.maps, __ATOMIC_RELAXED),
+            __atomic_load_n(&large_stats.unmaps, __ATOMIC_RELAXED),
+            __atomic_load_n(&large_stats.failed, __ATOMIC_RELAXED));
+    for (int n = 0; n < PMAP_MAX_NODES; n++) {
+        uint64_t bytes = __atomic_load_n(&large_stats.bytes[n], __ATOMIC_RELAXED);
+        if (bytes)
+            fprintf(out, "  node %d: %lu MB live\n", n, bytes >> 20);
+    }
+}
@@ -0,0 +1,370 @@
+/*******************************************************************************
+ * @file               gro.c
+ * @brief              Generic receive offload over a parsed burst.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Flows only live for one burst, so the table is a short
+ *                     array scanned with a hash prefilter and then compared
+ *                     against the head packet's own headers.  A packet of an
+ *                     open flow that cannot join it (pure ACK, SYN/FIN/RST,
+ *                     out of order, different options) closes the flow, so
+ *                     nothing of the flow is ever delivered out of order.
+ *
+ *                     Checksums: a packet that arrived valid satisfies
+ *                     pseudo + header + payload == 0xffff, so its payload
+ *                     sum is ~(pseudo + header) without reading the payload.
+ *                     Payload sums are accumulated byte-swapped when they
+ *                     land at an odd offset, and the coalesced header gets
+ *                     ~(pseudo + header + payloads) once, at the end.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "offload.h"
+
+#define TCP_PSH                 0x08
+#define TCP_ACK                 0x10
+
+#define IPV4_DF                 0x4000
+
+
+static inline uint32_t sum_add(uint32_t a, uint32_t b)
+{
+    uint64_t s = (uint64_t)a + b;
+
+    return (uint32_t)((s & 0xffffffff) + (s >> 32));
+}
+
+/* a sum taken at an odd offset of the stream, as seen from an even one */
+static inline uint32_t sum_swap(uint32_t sum)
+{
+    uint16_t s = ndp_cksum_fold(sum);
+
+    return (uint16_t)(s << 8 | s >> 8);
+}
+
+struct ndp_gro *ndp_gro_create(struct mempool_sys *mem, int node, uint32_t types,
+                               uint32_t max_len)
+{
+    struct ndp_gro *g = ndp_mempool_alloc(mem, node, sizeof(*g), NDP_CACHE_LINE);
+
+    if (!g)
+        return NULL;
+    memset(g, 0, sizeof(*g));
+    g->types = types;
+    g->max_len = max_len && max_len < NDP_GRO_MAX_LEN ? max_len : NDP_GRO_MAX_LEN;
+    g->node = node;
+    return g;
+}
+
+/* the layout of one candidate, taken from the parsed offsets */
+struct gro_pkt
+{
+    uint8_t *l3;
+    uint8_t *l4;
+    uint16_t hdr_len;
+    uint16_t l4_hdr;
+    uint32_t len;               /* payload */
+    bool v4;
+    bool tcp;
+};
+
+static bool gro_parse(const struct ndp_gro *g, struct ndp_burst *b, uint16_t i,
+                      struct gro_pkt *pk)
+{
+    struct ndp_buf *m = b->bufs[i];
+    uint32_t f = b->flags[i];
+    uint32_t ip_len;
+
+    if (f & (NDP_BUF_F_FRAG | NDP_BUF_F_CKSUM_BAD))
+        return false;
+    if ((f & NDP_BUF_F_TCP) && (g->types & NDP_GRO_TCP))
+        pk->tcp = true;
+    else if ((f & NDP_BUF_F_UDP) && (g->types & NDP_GRO_UDP))
+        pk->tcp = false;
+    else
+        return false;
+
+    pk->l3 = b->data[i] + b->l3_off[i];
+    pk->l4 = b->data[i] + b->l4_off[i];
+    pk->v4 = f & NDP_BUF_F_IPV4;
+    pk->l4_hdr = pk->tcp ? (((struct ndp_tcp_hdr *)pk->l4)->off >> 4) * 4
+                         : sizeof(struct ndp_udp_hdr);
+    pk->hdr_len = b->l4_off[i] + pk->l4_hdr;
+    // a data offset below 5 would leave the options length negative
+    if ((pk->tcp && pk->l4_hdr < sizeof(struct ndp_tcp_hdr)) || pk->hdr_len > m->data_len)
+        return false;
+
+    if (pk->v4) {
+        struct ndp_ipv4_hdr *ip = (struct ndp_ipv4_hdr *)pk->l3;
+        if ((ip->ver_ihl & 0xf) != 5)
+            return false;
+        ip_len = ntohs(ip->total_len) + b->l3_off[i];
+    } else {
+        ip_len = ntohs(((struct ndp_ipv6_hdr *)pk->l3)->payload_len) +
+                 sizeof(struct ndp_ipv6_hdr) + b->l3_off[i];
+    }
+    if (ip_len < pk->hdr_len || ip_len > m->pkt_len)
+        return false;
+    pk->len = ip_len - pk->hdr_len;
+
+    // without a checksum there is nothing to build the coalesced one from
+    if (!pk->tcp && !((struct ndp_udp_hdr *)pk->l4)->cksum)
+        return false;
+
+    // short frames arrive with Ethernet padding behind the datagram
+    if (m->pkt_len > ip_len) {
+        if (ndp_buf_trim(m, m->pkt_len - ip_len))
+            return false;
+        b->len[i] = m->pkt_len;
+    }
+    return true;
+}
+
+static uint32_t gro_hash(const struct gro_pkt *pk)
+{
+    const uint8_t *addr = pk->l3 + (pk->v4 ? offsetof(struct ndp_ipv4_hdr, src)
+                                           : offsetof(struct ndp_ipv6_hdr, src));
+    uint64_t h = pk->tcp;
+    uint32_t w;
+
+    for (int i = 0; i < (pk->v4 ? 2 : 8); i++) {
+        memcpy(&w, addr + 4 * i, sizeof(w));
+        h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+    }
+    memcpy(&w, pk->l4, sizeof(w));
+    h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+    return (uint32_t)(h >> 32);
+}
+
+/* same flow as the head: addresses, ports and the IP fields that must not change */
+static bool gro_same_flow(const struct gro_pkt *a, const struct gro_pkt *h)
+{
+    if (a->v4 != h->v4 || a->tcp != h->tcp || memcmp(a->l4, h->l4, 4))
+        return false;
+    if (a->v4) {
+        const struct ndp_ipv4_hdr *x = (const struct ndp_ipv4_hdr *)a->l3;
+        const struct ndp_ipv4_hdr *y = (const struct ndp_ipv4_hdr *)h->l3;
+        return x->src == y->src && x->dst == y->dst && x->proto == y->proto;
+    }
+    return ((const struct ndp_ipv6_hdr *)a->l3)->proto ==
+           ((const struct ndp_ipv6_hdr *)h->l3)->proto &&
+           !memcmp(a->l3 + offsetof(struct ndp_ipv6_hdr, src),
+                   h->l3 + offsetof(struct ndp_ipv6_hdr, src), 32);
+}
+
+/* payload sum of a packet that arrived with a valid checksum */
+static uint32_t gro_payload_sum(const struct gro_pkt *pk)
+{
+    uint32_t sum = ndp_l4_pseudo_sum(pk->l3, pk->tcp ? NDP_IPPROTO_TCP : NDP_IPPROTO_UDP,
+                                     pk->l4_hdr + pk->len);
+
+    sum = sum_add(sum, ndp_cksum_raw(pk->l4, pk->l4_hdr, 0));
+    return (uint16_t)~ndp_cksum_fold(sum);
+}
+
+/* can pk follow what the flow holds, given pk is of the same flow */
+static bool gro_fits(const struct ndp_gro *g, const struct ndp_gro_flow *fl,
+                     const struct gro_pkt *h, const struct gro_pkt *pk)
+{
+    if (fl->closed || !pk->len || pk->len > fl->seg_len || fl->segs == NDP_GRO_MAX_SEGS)
+        return false;
+    if ((uint32_t)(h->l4 - h->l3) + h->l4_hdr + fl->len + pk->len > g->max_len)
+        return false;
+
+    if (pk->v4) {
+        const struct ndp_ipv4_hdr *x = (const struct ndp_ipv4_hdr *)pk->l3;
+        const struct ndp_ipv4_hdr *y = (const struct ndp_ipv4_hdr *)h->l3;
+        uint16_t frag = ntohs(x->frag_off);
+        if (x->tos != y->tos || x->ttl != y->ttl || x->frag_off != y->frag_off)
+            return false;
+        if (!(frag & IPV4_DF) && ntohs(x->id) != (uint16_t)(fl->ip_id + 1))
+            return false;
+    } else {
+        const struct ndp_ipv6_hdr *x = (const struct ndp_ipv6_hdr *)pk->l3;
+        const struct ndp_ipv6_hdr *y = (const struct ndp_ipv6_hdr *)h->l3;
+        if (x->vtc_flow != y->vtc_flow || x->hop_limit != y->hop_limit)
+            return false;
+    }
+
+    if (pk->tcp) {
+        const struct ndp_tcp_hdr *x = (const struct ndp_tcp_hdr *)pk->l4;
+        const struct ndp_tcp_hdr *y = (const struct ndp_tcp_hdr *)h->l4;
+        // options (timestamps) must match byte for byte
+        if ((x->flags & ~TCP_PSH) != TCP_ACK || x->ack != y->ack || x->off != y->off ||
+            ntohl(x->seq) != fl->next_seq ||
+            memcmp(x + 1, y + 1, pk->l4_hdr - sizeof(*x)))
+            return false;
+    }
+    return true;
+}
+
+static bool gro_can_head(const struct gro_pkt *pk)
+{
+    if (!pk->len)
+        return false;
+    if (pk->tcp) {
+        uint8_t flags = ((const struct ndp_tcp_hdr *)pk->l4)->flags;
+        return flags == TCP_ACK;
+    }
+    return true;
+}
+
+static void gro_start(struct ndp_gro_flow *fl, uint16_t i, uint32_t hash, const struct gro_pkt *pk)
+{
+    fl->hash = hash;
+    fl->idx = i;
+    fl->segs = 1;
+    fl->hdr_len = pk->hdr_len;
+    fl->seg_len = pk->len;
+    fl->len = pk->len;
+    fl->sum = gro_payload_sum(pk);
+    fl->closed = false;
+    if (pk->v4)
+        fl->ip_id = ntohs(((const struct ndp_ipv4_hdr *)pk->l3)->id);
+    if (pk->tcp)
+        fl->next_seq = ntohl(((const struct ndp_tcp_hdr *)pk->l4)->seq) + pk->len;
+}
+
+static void gro_merge(struct ndp_gro *g, struct ndp_gro_flow *fl, struct ndp_burst *b,
+                      uint16_t i, const struct gro_pkt *pk)
+{
+    struct ndp_buf *head = b->bufs[fl->idx];
+    uint32_t sum = gro_payload_sum(pk);
+
+    fl->sum = sum_add(fl->sum, fl->len & 1 ? sum_swap(sum) : sum);
+    fl->len += pk->len;
+    fl->segs++;
+    if (pk->v4)
+        fl->ip_id = ntohs(((const struct ndp_ipv4_hdr *)pk->l3)->id);
+
+    if (pk->tcp) {
+        const struct ndp_tcp_hdr *x = (const struct ndp_tcp_hdr *)pk->l4;
+        struct ndp_tcp_hdr *y = ndp_buf_mtod_offset(head, struct ndp_tcp_hdr *, b->l4_off[fl->idx]);
+        // the latest window wins, a push ends the flow
+        y->window = x->window;
+        y->flags |= x->flags & TCP_PSH;
+        fl->next_seq += pk->len;
+        if (x->flags & TCP_PSH)
+            fl->closed = true;
+    }
+    if (pk->len < fl->seg_len)
+        fl->closed = true;
+
+    ndp_buf_adj(b->bufs[i], pk->hdr_len);
+    ndp_buf_chain(head, b->bufs[i]);
+    g->stats.merged++;
+}
+
+/* write the headers of a flow that absorbed packets; leaves it a single packet */
+static void gro_finish(struct ndp_gro *g, struct ndp_gro_flow *fl, struct ndp_burst *b)
+{
+    struct ndp_buf *head = b->bufs[fl->idx];
+    uint8_t *l3 = b->data[fl->idx] + b->l3_off[fl->idx];
+    uint8_t *l4 = b->data[fl->idx] + b->l4_off[fl->idx];
+    uint16_t l4_hdr = fl->hdr_len - b->l4_off[fl->idx];
+    uint32_t l4_len = l4_hdr + fl->len;
+    uint8_t *field;
+    uint16_t cksum;
+    uint32_t sum;
+    uint8_t proto;
+
+    b->len[fl->idx] = head->pkt_len;
+    if (fl->segs == 1)
+        return;
+
+    if ((l3[0] >> 4) == 4) {
+        struct ndp_ipv4_hdr *ip = (struct ndp_ipv4_hdr *)l3;
+        uint16_t total = htons(l4_len + sizeof(*ip));
+        ip->cksum = ndp_cksum_adjust(ip->cksum, ip->total_len, total);
+        ip->total_len = total;
+        proto = ip->proto;
+    } else {
+        struct ndp_ipv6_hdr *ip = (struct ndp_ipv6_hdr *)l3;
+        ip->payload_len = htons(l4_len);
+        proto = ip->proto;
+    }
+
+    if (proto == NDP_IPPROTO_TCP) {
+        field = l4 + offsetof(struct ndp_tcp_hdr, cksum);
+    } else {
+        ((struct ndp_udp_hdr *)l4)->len = htons(l4_len);
+        field = l4 + offsetof(struct ndp_udp_hdr, cksum);
+    }
+    memset(field, 0, sizeof(cksum));
+    sum = sum_add(ndp_l4_pseudo_sum(l3, proto, l4_len), ndp_cksum_raw(l4, l4_hdr, 0));
+    cksum = ~ndp_cksum_fold(sum_add(sum, fl->sum));
+    if (!cksum && proto == NDP_IPPROTO_UDP)
+        cksum = 0xffff;
+    memcpy(field, &cksum, sizeof(cksum));
+
+    b->flags[fl->idx] |= NDP_BUF_F_GRO;
+    head->flags |= NDP_BUF_F_GRO;
+    fl->segs = 1;
+    g->stats.coalesced++;
+}
+
+uint16_t ndp_gro_burst(struct ndp_gro *g, struct ndp_burst *b)
+{
+    struct gro_pkt heads[NDP_GRO_MAX_FLOWS];
+    uint16_t kept = 0;
+
+    g->num_flows = 0;
+    for (uint16_t i = 0; i < b->count; i++) {
+        struct ndp_gro_flow *fl = NULL;
+        struct gro_pkt pk;
+        uint32_t hash;
+        uint16_t k;
+
+        if (!gro_parse(g, b, i, &pk)) {
+            g->keep[kept++] = i;
+            continue;
+        }
+        g->stats.pkts++;
+
+        hash = gro_hash(&pk);
+        for (k = 0; k < g->num_flows; k++) {
+            if (g->flows[k].hash == hash && gro_same_flow(&pk, &heads[k])) {
+                fl = &g->flows[k];
+                break;
+            }
+        }
+
+        if (fl && gro_fits(g, fl, &heads[k], &pk)) {
+            gro_merge(g, fl, b, i, &pk);
+            continue;
+        }
+        if (fl) {
+            // the flow ends here; this packet may start its next run
+            gro_finish(g, fl, b);
+            if (gro_can_head(&pk)) {
+                gro_start(fl, i, hash, &pk);
+                heads[k] = pk;
+            } else {
+                fl->closed = true;
+            }
+        } else if (g->num_flows < NDP_GRO_MAX_FLOWS && gro_can_head(&pk)) {
+            fl = &g->flows[g->num_flows];
+            gro_start(fl, i, hash, &pk);
+            heads[g->num_flows++] = pk;
+        }
+        g->keep[kept++] = i;
+    }
+
+    for (uint16_t k = 0; k < g->num_flows; k++)
+        gro_finish(g, &g->flows[k], b);
+    if (kept != b->count)
+        ndp_burst_compact(b, g->keep, kept);
+    return b->count;
+}
+
+void ndp_gro_stats_report(const struct ndp_gro *g, FILE *out)
+{
+    const struct ndp_gro_stats *s = &g->stats;
+
+    fprintf(out, "gro node %d: %lu candidates, %lu merged into %lu packets (%.2f per packet)\n",
+            g->node, s->pkts, s->merged, s->coalesced,
+            s->coalesced ? (double)(s->merged + s->coalesced) / s->coalesced : 0.0);
+}
@@ -0,0 +1,216 @@
+/*******************************************************************************
+ * @file               gso.c
+ * @brief              Generic segmentation offload into pool buffers.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Segments are built by copy: a buffer cannot point into
+ *                     another one, and the copy is what brings the payload
+ *                     into cache for its checksum anyway.  Everything in the
+ *                     L4 checksum that does not change between segments
+ *                     (addresses, ports, ack, options) is summed once; per
+ *                     segment only the length, sequence number and flags
+ *                     word are added to the payload sum.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "offload.h"
+
+#define TCP_FIN                 0x01
+#define TCP_PSH                 0x08
+#define TCP_CWR                 0x80
+
+/* the largest header segmented: two VLAN tags, IPv6 and TCP with full options */
+#define GSO_MAX_HDR             (NDP_ETHER_HDR_LEN + NDP_VLAN_MAX_TAGS * NDP_VLAN_HDR_LEN + \
+                                 sizeof(struct ndp_ipv6_hdr) + 60)
+
+
+static inline uint32_t sum_add(uint32_t a, uint32_t b)
+{
+    uint64_t s = (uint64_t)a + b;
+
+    return (uint32_t)((s & 0xffffffff) + (s >> 32));
+}
+
+struct ndp_gso *ndp_gso_create(struct mempool_sys *mem, struct ndp_buf_pool *pool, uint16_t mss)
+{
+    struct ndp_gso *g;
+
+    if (!mss || GSO_MAX_HDR + mss > pool->span - sizeof(struct ndp_buf) - NDP_BUF_HEADROOM) {
+        fprintf(stderr, "gso: mss %u does not fit %u byte buffers\n", mss, pool->span);
+        return NULL;
+    }
+    if (!(g = ndp_mempool_alloc(mem, pool->node, sizeof(*g), NDP_CACHE_LINE)))
+        return NULL;
+    memset(g, 0, sizeof(*g));
+    g->pool = pool;
+    g->mss = mss;
+    return g;
+}
+
+/* copy len bytes from the chain position (seg, off) on, advancing it */
+static void gso_copy(uint8_t *dst, struct ndp_buf **seg, uint32_t *off, uint32_t len)
+{
+    while (len) {
+        struct ndp_buf *s = *seg;
+        uint32_t n = s->data_len - *off;
+
+        if (!n) {
+            *seg = s->next;
+            *off = 0;
+            continue;
+        }
+        if (n > len)
+            n = len;
+        memcpy(dst, ndp_buf_mtod(s, uint8_t *) + *off, n);
+        dst += n;
+        len -= n;
+        *off += n;
+    }
+}
+
+int ndp_gso_segment(struct ndp_gso *g, struct ndp_buf *b, uint16_t l3, struct ndp_buf **out,
+                    uint16_t max)
+{
+    uint8_t *p = ndp_buf_mtod(b, uint8_t *);
+    uint8_t tmpl[60];
+    uint32_t ip_len, payload, base, off, seq = 0;
+    uint16_t l4, l4_hdr, hdr_len, nseg, id = 0;
+    struct ndp_buf *seg = b;
+    uint8_t proto, flags = 0;
+
+    if (!max)
+        return -1;
+    if ((uint32_t)l3 + sizeof(struct ndp_ipv4_hdr) > b->data_len)
+        goto invalid;
+
+    if ((p[l3] >> 4) == 4) {
+        struct ndp_ipv4_hdr *ip = (struct ndp_ipv4_hdr *)(p + l3);
+        if (ntohs(ip->frag_off) & (NDP_IPV4_MF | NDP_IPV4_OFF_MASK))
+            goto invalid;
+        l4 = l3 + (ip->ver_ihl & 0xf) * 4;
+        proto = ip->proto;
+        ip_len = ntohs(ip->total_len);
+        id = ntohs(ip->id);
+    } else if ((p[l3] >> 4) == 6 && (uint32_t)l3 + sizeof(struct ndp_ipv6_hdr) <= b->data_len) {
+        struct ndp_ipv6_hdr *ip = (struct ndp_ipv6_hdr *)(p + l3);
+        l4 = l3 + sizeof(*ip);
+        proto = ip->proto;
+        ip_len = sizeof(*ip) + ntohs(ip->payload_len);
+    } else {
+        goto invalid;
+    }
+
+    if (proto == NDP_IPPROTO_TCP && (uint32_t)l4 + sizeof(struct ndp_tcp_hdr) <= b->data_len)
+        l4_hdr = (((struct ndp_tcp_hdr *)(p + l4))->off >> 4) * 4;
+    else if (proto == NDP_IPPROTO_UDP)
+        l4_hdr = sizeof(struct ndp_udp_hdr);
+    else
+        goto invalid;
+    hdr_len = l4 + l4_hdr;
+    if ((proto == NDP_IPPROTO_TCP && l4_hdr < sizeof(struct ndp_tcp_hdr)) ||
+        hdr_len > b->data_len || hdr_len > GSO_MAX_HDR ||
+        l3 + ip_len < hdr_len || l3 + ip_len > b->pkt_len)
+        goto invalid;
+
+    payload = l3 + ip_len - hdr_len;
+    if (payload <= g->mss) {
+        out[0] = b;
+        return 1;
+    }
+    nseg = (payload + g->mss - 1) / g->mss;
+    if (nseg > max)
+        return -1;
+    if (!ndp_buf_alloc_bulk(g->pool, out, nseg)) {
+        g->stats.no_bufs++;
+        return -1;
+    }
+
+    // sum the L4 header once with the per-segment fields cleared
+    memcpy(tmpl, p + l4, l4_hdr);
+    if (proto == NDP_IPPROTO_TCP) {
+        struct ndp_tcp_hdr *th = (struct ndp_tcp_hdr *)tmpl;
+        seq = ntohl(th->seq);
+        flags = th->flags;
+        th->seq = 0;
+        th->off = 0;
+        th->flags = 0;
+        th->cksum = 0;
+    } else {
+        struct ndp_udp_hdr *uh = (struct ndp_udp_hdr *)tmpl;
+        uh->len = 0;
+        uh->cksum = 0;
+    }
+    base = sum_add(ndp_l4_pseudo_sum(p + l3, proto, 0), ndp_cksum_raw(tmpl, l4_hdr, 0));
+
+    off = hdr_len;
+    for (uint16_t k = 0; k < nseg; k++) {
+        uint32_t len = k + 1 < nseg ? g->mss : payload - (uint32_t)k * g->mss;
+        uint16_t l4_len = l4_hdr + len;
+        uint8_t *d = ndp_buf_append(out[k], hdr_len + len);
+        uint32_t sum;
+        uint16_t cksum;
+
+        memcpy(d, p, hdr_len);
+        gso_copy(d + hdr_len, &seg, &off, len);
+        sum = sum_add(base, ndp_cksum_raw(d + hdr_len, len, 0));
+        sum = sum_add(sum, htons(l4_len));
+
+        if ((d[l3] >> 4) == 4) {
+            struct ndp_ipv4_hdr *ip = (struct ndp_ipv4_hdr *)(d + l3);
+            uint16_t total = htons(l4 - l3 + l4_len), nid = htons(id + k);
+            ip->cksum = ndp_cksum_adjust(ip->cksum, ip->total_len, total);
+            ip->cksum = ndp_cksum_adjust(ip->cksum, ip->id, nid);
+            ip->total_len = total;
+            ip->id = nid;
+        } else {
+            ((struct ndp_ipv6_hdr *)(d + l3))->payload_len = htons(l4 - l3 -
+                                                                   sizeof(struct ndp_ipv6_hdr) +
+                                                                   l4_len);
+        }
+
+        if (proto == NDP_IPPROTO_TCP) {
+            struct ndp_tcp_hdr *th = (struct ndp_tcp_hdr *)(d + l4);
+            uint16_t word;
+
+            // CWR only on the first segment, FIN and PSH only on the last
+            th->seq = htonl(seq + (uint32_t)k * g->mss);
+            th->flags = flags & ~(k ? TCP_CWR : 0) & ~(k + 1 < nseg ? TCP_FIN | TCP_PSH : 0);
+            memcpy(&word, &th->off, sizeof(word));
+            sum = sum_add(sum, (th->seq & 0xffff) + (th->seq >> 16) + word);
+            th->cksum = ~ndp_cksum_fold(sum);
+        } else {
+            struct ndp_udp_hdr *uh = (struct ndp_udp_hdr *)(d + l4);
+            bool none = !uh->cksum && (d[l3] >> 4) == 4;
+
+            uh->len = htons(l4_len);
+            cksum = ~ndp_cksum_fold(sum_add(sum, uh->len));
+            uh->cksum = none ? 0 : cksum ? cksum : 0xffff;
+        }
+
+        out[k]->port = b->port;
+        out[k]->hash = b->hash;
+        out[k]->flags = b->flags & ~NDP_BUF_F_GRO;
+        out[k]->tsc = b->tsc;
+        out[k]->udata = b->udata;
+    }
+
+    ndp_buf_free(b);
+    g->stats.pkts++;
+    g->stats.segs += nseg;
+    return nseg;
+
+invalid:
+    g->stats.invalid++;
+    return -1;
+}
+
+void ndp_gso_stats_report(const struct ndp_gso *g, FILE *out)
+{
+    const struct ndp_gso_stats *s = &g->stats;
+
+    fprintf(out, "gso mss %u: %lu packets into %lu segments, %lu without buffers, %lu invalid\n",
+            g->mss, s->pkts, s->segs, s->no_bufs, s->invalid);
+}
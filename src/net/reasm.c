@@ -0,0 +1,421 @@
+/*******************************************************************************
+ * @file               reasm.c
+ * @brief              IP fragment reassembly over buffer chains.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Entries sit in a fixed array so the timers embedded in
+ *                     them never move; the hash index over them is linear
+ *                     probing at load factor one half at most, with the
+ *                     hash kept next to the index so probes rarely touch an
+ *                     entry, and backward-shift deletion instead of
+ *                     tombstones.
+ *
+ *                     Overlapping fragments drop the whole datagram (RFC
+ *                     5722 for IPv6, and no teardrop games for IPv4); exact
+ *                     duplicates are dropped on their own.  On completion
+ *                     the fragments are sorted by offset, their headers cut
+ *                     with ndp_buf_adj() and chained behind the first one,
+ *                     whose header is rewritten for the whole datagram.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "reasm.h"
+
+#define REASM_MAX_PAYLOAD       65535
+
+
+static inline uint32_t key_hash(const struct ndp_reasm_key *k, uint64_t seed)
+{
+    uint64_t w[sizeof(*k) / sizeof(uint64_t)];
+    uint64_t h = seed;
+
+    memcpy(w, k, sizeof(w));
+    for (size_t i = 0; i < sizeof(w) / sizeof(w[0]); i++) {
+        h = (h ^ w[i]) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+    return (uint32_t)(h >> 32);
+}
+
+static inline struct ndp_reasm_entry *slot_entry(const struct ndp_reasm *r, uint64_t slot)
+{
+    return &r->entries[(uint32_t)slot - 1];
+}
+
+/* entry for key, or NULL with *pos at the empty slot ending the probe */
+static struct ndp_reasm_entry *table_find(const struct ndp_reasm *r,
+                                          const struct ndp_reasm_key *key, uint32_t hash,
+                                          uint32_t *pos)
+{
+    uint32_t i = hash & r->mask;
+    uint64_t slot;
+
+    while ((slot = r->slots[i])) {
+        if ((uint32_t)(slot >> 32) == hash &&
+            !memcmp(&slot_entry(r, slot)->key, key, sizeof(*key)))
+            return slot_entry(r, slot);
+        i = (i + 1) & r->mask;
+    }
+    *pos = i;
+    return NULL;
+}
+
+static void table_remove(struct ndp_reasm *r, struct ndp_reasm_entry *e)
+{
+    uint32_t idx = e - r->entries + 1;
+    uint32_t i = key_hash(&e->key, r->seed) & r->mask;
+    uint32_t j;
+
+    while ((uint32_t)r->slots[i] != idx)
+        i = (i + 1) & r->mask;
+
+    // shift later members of the cluster back into the hole when their
+    // home slot does not lie between the hole and their position
+    r->slots[i] = 0;
+    for (j = (i + 1) & r->mask; r->slots[j]; j = (j + 1) & r->mask) {
+        uint32_t home = (uint32_t)(r->slots[j] >> 32) & r->mask;
+        if (((j - home) & r->mask) >= ((j - i) & r->mask)) {
+            r->slots[i] = r->slots[j];
+            r->slots[j] = 0;
+            i = j;
+        }
+    }
+
+    e->next_free = r->free_head;
+    r->free_head = idx;
+    r->num_entries--;
+}
+
+void ndp_reasm_flush(struct ndp_reasm *r)
+{
+    if (r->num_dead) {
+        ndp_buf_free_bulk(r->death_row, r->num_dead);
+        r->num_dead = 0;
+    }
+}
+
+static inline void death_row_add(struct ndp_reasm *r, struct ndp_buf *b)
+{
+    if (r->num_dead == NDP_REASM_DEATH_ROW)
+        ndp_reasm_flush(r);
+    r->death_row[r->num_dead++] = b;
+}
+
+static void entry_drop(struct ndp_reasm *r, struct ndp_reasm_entry *e)
+{
+    ndp_timer_cancel(r->wheel, &e->timer);
+    for (uint16_t i = 0; i < e->num_frags; i++)
+        death_row_add(r, e->frags[i].b);
+    table_remove(r, e);
+}
+
+static void entry_expire(struct ndp_timer *t, void *arg)
+{
+    struct ndp_reasm_entry *e = arg;
+
+    (void)t;
+    e->owner->stats.timeouts++;
+    entry_drop(e->owner, e);
+}
+
+struct ndp_reasm *ndp_reasm_create(struct mempool_sys *mem, int node, uint32_t max_entries,
+                                   uint32_t timeout_ms, struct ndp_timer_wheel *wheel)
+{
+    struct ndp_reasm *r;
+    uint32_t cap = 2;
+
+    if (!max_entries || max_entries > (1U << 30) || !wheel)
+        return NULL;
+    while (cap < 2 * max_entries)
+        cap <<= 1;
+
+    if (!(r = ndp_mempool_alloc(mem, node, sizeof(*r), NDP_CACHE_LINE)))
+        return NULL;
+    memset(r, 0, sizeof(*r));
+    r->slots = ndp_mempool_alloc(mem, node, (size_t)cap * sizeof(uint64_t), NDP_CACHE_LINE);
+    r->entries = ndp_mempool_alloc(mem, node, (size_t)max_entries * sizeof(*r->entries),
+                                   NDP_CACHE_LINE);
+    if (!r->slots || !r->entries)
+        return NULL;
+
+    memset(r->slots, 0, (size_t)cap * sizeof(uint64_t));
+    memset(r->entries, 0, (size_t)max_entries * sizeof(*r->entries));
+    for (uint32_t i = 0; i < max_entries; i++) {
+        r->entries[i].owner = r;
+        r->entries[i].next_free = i + 1 < max_entries ? i + 2 : 0;
+    }
+    r->free_head = 1;
+    r->mask = cap - 1;
+    r->max_entries = max_entries;
+    r->seed = ndp_rdtsc() * 0xff51afd7ed558ccdULL;
+    r->wheel = wheel;
+    r->timeout = ndp_ns_to_tsc((uint64_t)timeout_ms * 1000000);
+    r->node = node;
+    return r;
+}
+
+/* link the sorted fragments behind the first and fix up its header */
+static struct ndp_buf *entry_complete(struct ndp_reasm *r, struct ndp_reasm_entry *e)
+{
+    struct ndp_reasm_frag *f = e->frags;
+    struct ndp_buf *head;
+
+    for (uint16_t i = 1; i < e->num_frags; i++) {
+        struct ndp_reasm_frag tmp = f[i];
+        int j = i - 1;
+        for (; j >= 0 && f[j].off > tmp.off; j--)
+            f[j + 1] = f[j];
+        f[j + 1] = tmp;
+    }
+
+    head = f[0].b;
+    for (uint16_t i = 1; i < e->num_frags; i++) {
+        ndp_buf_adj(f[i].b, f[i].hdr);
+        ndp_buf_chain(head, f[i].b);
+    }
+
+    if (e->key.version == 4) {
+        struct ndp_ipv4_hdr *ip = ndp_buf_mtod_offset(head, struct ndp_ipv4_hdr *, f[0].l3);
+        ip->total_len = htons(f[0].hdr - f[0].l3 + e->total);
+        ip->frag_off &= htons(~(NDP_IPV4_MF | NDP_IPV4_OFF_MASK));
+        ip->cksum = 0;
+        ip->cksum = ndp_ipv4_cksum(ip);
+    } else {
+        // slide L2 and the fixed header over the fragment header
+        uint8_t *p = ndp_buf_mtod(head, uint8_t *);
+        struct ndp_ipv6_frag_hdr *fh = (struct ndp_ipv6_frag_hdr *)(p + f[0].l3 +
+                                                                    sizeof(struct ndp_ipv6_hdr));
+        uint8_t next = fh->proto;
+        struct ndp_ipv6_hdr *ip;
+
+        memmove(p + sizeof(*fh), p, f[0].l3 + sizeof(struct ndp_ipv6_hdr));
+        ndp_buf_adj(head, sizeof(*fh));
+        ip = ndp_buf_mtod_offset(head, struct ndp_ipv6_hdr *, f[0].l3);
+        ip->proto = next;
+        ip->payload_len = htons(e->total);
+    }
+
+    head->flags &= ~NDP_BUF_F_FRAG;
+    r->stats.reassembled++;
+    ndp_timer_cancel(r->wheel, &e->timer);
+    table_remove(r, e);
+    return head;
+}
+
+/* parse the fragment at l3; 0 and the key when it is one, 1 for a plain packet, -1 if invalid */
+static int frag_parse(struct ndp_buf *b, uint16_t l3, struct ndp_reasm_key *key,
+                      struct ndp_reasm_frag *f, bool *last)
+{
+    uint8_t *p = ndp_buf_mtod(b, uint8_t *);
+    uint32_t room = b->data_len - l3;
+    uint32_t len;
+
+    memset(key, 0, sizeof(*key));
+    if (room < 1)
+        return 1;
+
+    if ((p[l3] >> 4) == 4) {
+        struct ndp_ipv4_hdr *ip = (struct ndp_ipv4_hdr *)(p + l3);
+        uint16_t frag = ntohs(ip->frag_off);
+        uint16_t ihl = (ip->ver_ihl & 0xf) * 4;
+
+        if (room < sizeof(*ip) || !(frag & (NDP_IPV4_MF | NDP_IPV4_OFF_MASK)))
+            return 1;
+        len = ntohs(ip->total_len);
+        if (ihl < sizeof(*ip) || len <= ihl || len > room)
+            return -1;
+
+        key->src[0] = ip->src;
+        key->dst[0] = ip->dst;
+        key->id = ip->id;
+        key->proto = ip->proto;
+        key->version = 4;
+        f->off = (frag & NDP_IPV4_OFF_MASK) * 8;
+        f->len = len - ihl;
+        f->hdr = l3 + ihl;
+        *last = !(frag & NDP_IPV4_MF);
+    } else if ((p[l3] >> 4) == 6) {
+        struct ndp_ipv6_hdr *ip = (struct ndp_ipv6_hdr *)(p + l3);
+        struct ndp_ipv6_frag_hdr *fh = (struct ndp_ipv6_frag_hdr *)(ip + 1);
+        uint16_t frag;
+
+        if (room < sizeof(*ip) || ip->proto != NDP_IPPROTO_FRAG6)
+            return 1;
+        len = sizeof(*ip) + ntohs(ip->payload_len);
+        if (len <= sizeof(*ip) + sizeof(*fh) || len > room)
+            return -1;
+
+        frag = ntohs(fh->frag_off);
+        memcpy(key->src, ip->src, sizeof(key->src));
+        memcpy(key->dst, ip->dst, sizeof(key->dst));
+        key->id = fh->id;
+        key->proto = fh->proto;
+        key->version = 6;
+        f->off = frag & 0xfff8;
+        f->len = len - sizeof(*ip) - sizeof(*fh);
+        f->hdr = l3 + sizeof(*ip) + sizeof(*fh);
+        *last = !(frag & 1);
+    } else {
+        return 1;
+    }
+
+    // Ethernet padding behind short fragments is not payload
+    if (room > len)
+        ndp_buf_trim(b, room - len);
+    if ((!*last && (f->len & 7)) || f->off + f->len > REASM_MAX_PAYLOAD)
+        return -1;
+    f->b = b;
+    f->l3 = l3;
+    return 0;
+}
+
+/**
+ * largest payload end the fragment allows: the length field of the
+ * reassembled header (IPv4 total length, IPv6 payload length) must also
+ * cover the header bytes it counts
+ */
+static uint32_t frag_max_end(const struct ndp_reasm_frag *f, uint8_t version)
+{
+    uint32_t counted = f->hdr - f->l3;
+
+    if (version == 6)
+        counted -= sizeof(struct ndp_ipv6_hdr) + sizeof(struct ndp_ipv6_frag_hdr);
+    return REASM_MAX_PAYLOAD - counted;
+}
+
+struct ndp_buf *ndp_reasm_packet(struct ndp_reasm *r, struct ndp_buf *b, uint16_t l3)
+{
+    struct ndp_reasm_key key;
+    struct ndp_reasm_frag f;
+    struct ndp_reasm_entry *e;
+    uint32_t hash, pos, end;
+    bool last;
+    int rc;
+
+    // chained input would need its headers found across segments
+    if (b->next || l3 >= b->data_len)
+        return b;
+    if ((rc = frag_parse(b, l3, &key, &f, &last)) > 0)
+        return b;
+    r->stats.frags++;
+    if (rc < 0) {
+        r->stats.invalid++;
+        death_row_add(r, b);
+        return NULL;
+    }
+
+    hash = key_hash(&key, r->seed);
+    if (!(e = table_find(r, &key, hash, &pos))) {
+        if (!r->free_head) {
+            r->stats.table_full++;
+            death_row_add(r, b);
+            return NULL;
+        }
+        e = &r->entries[r->free_head - 1];
+        r->free_head = e->next_free;
+        r->num_entries++;
+        r->slots[pos] = (uint64_t)hash << 32 | (uint32_t)(e - r->entries + 1);
+
+        e->key = key;
+        e->total = 0;
+        e->received = 0;
+        e->num_frags = 0;
+        ndp_timer_arm(r->wheel, &e->timer, r->timeout, 0, entry_expire, e);
+    }
+
+    // later fragments carry at most the options of the first, so their own
+    // header bounds the datagram too
+    end = f.off + f.len;
+    if (end > frag_max_end(&f, key.version))
+        goto invalid;
+    for (uint16_t i = 0; i < e->num_frags; i++) {
+        const struct ndp_reasm_frag *o = &e->frags[i];
+        if (o->off == f.off && o->len == f.len) {
+            r->stats.duplicates++;
+            death_row_add(r, b);
+            return NULL;
+        }
+        if (f.off < o->off + o->len && o->off < end)
+            goto invalid;
+    }
+    if (e->num_frags == NDP_REASM_MAX_FRAGS || (e->total && end > e->total) ||
+        (last && (e->total || e->received + f.len > end)))
+        goto invalid;
+    if (last) {
+        // nothing already held may lie beyond the end
+        for (uint16_t i = 0; i < e->num_frags; i++) {
+            if (e->frags[i].off + e->frags[i].len > end)
+                goto invalid;
+        }
+        e->total = end;
+    }
+
+    e->frags[e->num_frags++] = f;
+    e->received += f.len;
+    if (e->total && e->received == e->total) {
+        for (uint16_t i = 0; i < e->num_frags; i++) {
+            if (!e->frags[i].off && e->total > frag_max_end(&e->frags[i], key.version)) {
+                r->stats.invalid++;
+                entry_drop(r, e);
+                return NULL;
+            }
+        }
+        return entry_complete(r, e);
+    }
+    return NULL;
+
+invalid:
+    r->stats.invalid++;
+    death_row_add(r, b);
+    entry_drop(r, e);
+    return NULL;
+}
+
+/* offset of the IP header behind Ethernet and up to two VLAN tags, 0 if none */
+static uint16_t l3_offset(const struct ndp_buf *b)
+{
+    const uint8_t *p = ndp_buf_mtod(b, const uint8_t *);
+    uint16_t off = NDP_ETHER_HDR_LEN;
+    uint16_t type;
+
+    if (b->data_len < NDP_ETHER_HDR_LEN)
+        return 0;
+    memcpy(&type, p + off - 2, sizeof(type));
+    for (int t = 0; t < NDP_VLAN_MAX_TAGS && (type == htons(NDP_ETHER_TYPE_VLAN) ||
+                                             type == htons(NDP_ETHER_TYPE_QINQ)); t++) {
+        off += NDP_VLAN_HDR_LEN;
+        if (b->data_len < off)
+            return 0;
+        memcpy(&type, p + off - 2, sizeof(type));
+    }
+    return type == htons(NDP_ETHER_TYPE_IPV4) || type == htons(NDP_ETHER_TYPE_IPV6) ? off : 0;
+}
+
+uint16_t ndp_reasm_burst(struct ndp_reasm *r, struct ndp_buf **bufs, uint16_t n)
+{
+    uint16_t kept = 0;
+
+    for (uint16_t i = 0; i < n; i++) {
+        uint16_t l3 = l3_offset(bufs[i]);
+        struct ndp_buf *out = l3 ? ndp_reasm_packet(r, bufs[i], l3) : bufs[i];
+        if (out)
+            bufs[kept++] = out;
+    }
+    ndp_reasm_flush(r);
+    return kept;
+}
+
+void ndp_reasm_stats_report(const struct ndp_reasm *r, FILE *out)
+{
+    const struct ndp_reasm_stats *s = &r->stats;
+
+    fprintf(out, "reasm node %d: %u/%u datagrams pending\n", r->node, r->num_entries,
+            r->max_entries);
+    fprintf(out, "  %lu fragments, %lu reassembled, %lu timed out\n", s->frags, s->reassembled,
+            s->timeouts);
+    fprintf(out, "  dropped: %lu invalid, %lu duplicate, %lu table full\n", s->invalid,
+            s->duplicates, s->table_full);
+}
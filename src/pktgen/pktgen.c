@@ -0,0 +1,338 @@
+/*******************************************************************************
+ * @file               pktgen.c
+ * @brief              In-process traffic generator and measuring sink.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            The generator keeps one ready-made frame per size in
+ *                     the profile.  A packet is a template copy into a fresh
+ *                     node-local buffer plus a few stores: addresses and
+ *                     source port of the flow (IPv4 checksum adjusted per RFC
+ *                     1624, no recomputation), and a signature with sequence
+ *                     number and send TSC right after the L4 header.  L4
+ *                     checksums are left at zero.
+ *
+ *                     The sink finds the signature again and records the
+ *                     one-way latency in a log-linear histogram, so a sweep
+ *                     of generator rates gives Mpps and latency curves over
+ *                     any chain of ports and forwarding stages.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "pktgen.h"
+
+#define PKTGEN_MAX_BURST        64
+#define PKTGEN_CATCHUP          16      /* bursts of lag before the pace resets */
+
+
+void ndp_pktgen_profile_default(struct ndp_pktgen_profile *prof)
+{
+    static const uint8_t src_mac[] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    static const uint8_t dst_mac[] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+
+    memset(prof, 0, sizeof(*prof));
+    memcpy(prof->src_mac, src_mac, sizeof(src_mac));
+    memcpy(prof->dst_mac, dst_mac, sizeof(dst_mac));
+    prof->src_ip = 0x0a000001;          /* 10.0.0.1 */
+    prof->dst_ip = 0x0a010001;          /* 10.1.0.1 */
+    prof->sport = 1024;
+    prof->dport = 5001;
+    prof->proto = NDP_IPPROTO_UDP;
+    prof->num_flows = 1;
+    prof->num_dsts = 1;
+    prof->sizes[0] = 60;
+    prof->weights[0] = 1;
+    prof->num_sizes = 1;
+    prof->burst = 32;
+}
+
+void ndp_pktgen_profile_imix(struct ndp_pktgen_profile *prof)
+{
+    static const uint16_t sizes[] = { 60, 590, 1514 };
+    static const uint8_t weights[] = { 7, 4, 1 };
+
+    memcpy(prof->sizes, sizes, sizeof(sizes));
+    memcpy(prof->weights, weights, sizeof(weights));
+    prof->num_sizes = 3;
+}
+
+static uint16_t l4_hdr_len(uint8_t proto)
+{
+    return proto == NDP_IPPROTO_TCP ? sizeof(struct ndp_tcp_hdr) : sizeof(struct ndp_udp_hdr);
+}
+
+static void build_template(struct ndp_pktgen *g, unsigned int k)
+{
+    const struct ndp_pktgen_profile *prof = &g->prof;
+    uint8_t *p = g->templates[k];
+    uint16_t size = prof->sizes[k];
+    struct ndp_ether_hdr *eth = (struct ndp_ether_hdr *)p;
+    struct ndp_ipv4_hdr *ip = (struct ndp_ipv4_hdr *)(p + NDP_ETHER_HDR_LEN);
+    uint8_t *l4 = (uint8_t *)(ip + 1);
+    uint16_t l4_len = size - NDP_ETHER_HDR_LEN - sizeof(*ip);
+
+    memset(p, 0, NDP_PKTGEN_MAX_FRAME);
+    memcpy(eth->dst, prof->dst_mac, NDP_ETHER_ADDR_LEN);
+    memcpy(eth->src, prof->src_mac, NDP_ETHER_ADDR_LEN);
+    eth->type = htons(NDP_ETHER_TYPE_IPV4);
+
+    ip->ver_ihl = 0x45;
+    ip->total_len = htons(size - NDP_ETHER_HDR_LEN);
+    ip->ttl = 64;
+    ip->proto = prof->proto;
+    ip->src = htonl(prof->src_ip);
+    ip->dst = htonl(prof->dst_ip);
+    ip->cksum = ndp_ipv4_cksum(ip);
+
+    if (prof->proto == NDP_IPPROTO_TCP) {
+        struct ndp_tcp_hdr *tcp = (struct ndp_tcp_hdr *)l4;
+        tcp->sport = htons(prof->sport);
+        tcp->dport = htons(prof->dport);
+        tcp->off = (sizeof(*tcp) / 4) << 4;
+        tcp->flags = 0x10;
+        tcp->window = htons(0xffff);
+    } else {
+        struct ndp_udp_hdr *udp = (struct ndp_udp_hdr *)l4;
+        udp->sport = htons(prof->sport);
+        udp->dport = htons(prof->dport);
+        udp->len = htons(l4_len);
+    }
+
+    for (uint16_t i = l4_hdr_len(prof->proto) + sizeof(struct ndp_pktgen_sig); i < l4_len; i++)
+        l4[i] = (uint8_t)i;
+}
+
+/* smooth weighted round-robin, so sizes interleave instead of running in blocks */
+static void build_size_sched(struct ndp_pktgen *g)
+{
+    int credit[NDP_PKTGEN_MAX_SIZES] = { 0 };
+    int total = 0;
+
+    for (unsigned int k = 0; k < g->prof.num_sizes; k++)
+        total += g->prof.weights[k];
+
+    for (unsigned int s = 0; s < sizeof(g->size_sched); s++) {
+        unsigned int best = 0;
+        for (unsigned int k = 0; k < g->prof.num_sizes; k++) {
+            credit[k] += g->prof.weights[k];
+            if (credit[k] > credit[best])
+                best = k;
+        }
+        credit[best] -= total;
+        g->size_sched[s] = best;
+    }
+}
+
+struct ndp_pktgen *ndp_pktgen_create(struct mempool_sys *mem, struct ndp_buf_pool *pool,
+                                     struct ndp_port *port, uint16_t queue,
+                                     const struct ndp_pktgen_profile *prof)
+{
+    uint16_t min = NDP_ETHER_HDR_LEN + sizeof(struct ndp_ipv4_hdr) + l4_hdr_len(prof->proto) +
+                   sizeof(struct ndp_pktgen_sig);
+    uint16_t room = pool->span - sizeof(struct ndp_buf) - NDP_BUF_HEADROOM;
+    struct ndp_pktgen *g;
+
+    if (!prof->num_sizes || prof->num_sizes > NDP_PKTGEN_MAX_SIZES || !prof->num_flows ||
+        !prof->num_dsts || !prof->burst || prof->burst > PKTGEN_MAX_BURST ||
+        queue >= port->num_queues)
+        return NULL;
+    for (unsigned int k = 0; k < prof->num_sizes; k++) {
+        if (prof->sizes[k] < min || prof->sizes[k] > NDP_PKTGEN_MAX_FRAME ||
+            prof->sizes[k] > room || !prof->weights[k])
+            return NULL;
+    }
+
+    if (!(g = ndp_mempool_alloc(mem, pool->node, sizeof(*g), NDP_CACHE_LINE)))
+        return NULL;
+    memset(g, 0, sizeof(*g));
+    g->prof = *prof;
+    g->pool = pool;
+    g->port = port;
+    g->queue = queue;
+
+    for (unsigned int k = 0; k < prof->num_sizes; k++)
+        build_template(g, k);
+    build_size_sched(g);
+    ndp_pktgen_set_rate(g, prof->rate_pps);
+    return g;
+}
+
+void ndp_pktgen_set_rate(struct ndp_pktgen *g, uint64_t pps)
+{
+    uint64_t interval = pps ? ndp_tsc_hz() * g->prof.burst / pps : 0;
+
+    __atomic_store_n(&g->interval, interval, __ATOMIC_RELAXED);
+    __atomic_store_n(&g->next_tsc, 0, __ATOMIC_RELAXED);
+}
+
+static void pktgen_fill(struct ndp_pktgen *g, struct ndp_buf *b, uint64_t now)
+{
+    const struct ndp_pktgen_profile *prof = &g->prof;
+    unsigned int k = g->size_sched[g->size_pos++];
+    uint16_t size = prof->sizes[k];
+    uint8_t *p = ndp_buf_append(b, size);
+    struct ndp_ipv4_hdr *ip = (struct ndp_ipv4_hdr *)(p + NDP_ETHER_HDR_LEN);
+    uint8_t *l4 = (uint8_t *)(ip + 1);
+    uint32_t f = g->flow;
+    struct ndp_pktgen_sig sig = { NDP_PKTGEN_MAGIC, g->seq++, now };
+
+    if (++g->flow == prof->num_flows)
+        g->flow = 0;
+
+    memcpy(p, g->templates[k], size);
+    if (f) {
+        uint32_t src = htonl(prof->src_ip + f);
+        uint32_t dst = htonl(prof->dst_ip + f % prof->num_dsts);
+        uint16_t sport = htons(prof->sport + (uint16_t)f);
+
+        ip->cksum = ndp_cksum_adjust32(ip->cksum, ip->src, src);
+        ip->cksum = ndp_cksum_adjust32(ip->cksum, ip->dst, dst);
+        ip->src = src;
+        ip->dst = dst;
+        memcpy(l4, &sport, sizeof(sport));
+    }
+    memcpy(l4 + l4_hdr_len(prof->proto), &sig, sizeof(sig));
+    b->tsc = now;
+}
+
+int ndp_pktgen_poll(void *arg)
+{
+    struct ndp_pktgen *g = arg;
+    struct ndp_buf *bufs[PKTGEN_MAX_BURST];
+    uint64_t interval = __atomic_load_n(&g->interval, __ATOMIC_RELAXED);
+    uint64_t now = ndp_rdtsc();
+    uint16_t n = g->prof.burst, sent;
+
+    if (g->done)
+        return 0;
+    if (interval) {
+        uint64_t next = __atomic_load_n(&g->next_tsc, __ATOMIC_RELAXED);
+        if (now < next)
+            return 0;
+        // after a stall, resume the pace instead of bursting to catch up
+        next = next + PKTGEN_CATCHUP * interval < now ? now + interval : next + interval;
+        __atomic_store_n(&g->next_tsc, next, __ATOMIC_RELAXED);
+    }
+    if (g->prof.count && g->prof.count - g->sent < n)
+        n = g->prof.count - g->sent;
+
+    if (!ndp_buf_alloc_bulk(g->pool, bufs, n)) {
+        g->alloc_fail++;
+        return 0;
+    }
+    for (uint16_t i = 0; i < n; i++)
+        pktgen_fill(g, bufs[i], now);
+
+    sent = ndp_port_tx_burst(g->port, g->queue, bufs, n);
+    if (sent < n) {
+        ndp_buf_free_bulk(bufs + sent, n - sent);
+        g->rejected += n - sent;
+    }
+    g->sent += sent;
+    if (g->prof.count && g->sent >= g->prof.count)
+        g->done = true;
+    return sent;
+}
+
+struct ndp_sink *ndp_sink_create(struct mempool_sys *mem, struct ndp_port *port, uint16_t queue)
+{
+    struct ndp_sink *s;
+
+    if (queue >= port->num_queues)
+        return NULL;
+    if (!(s = ndp_mempool_alloc(mem, port->node, sizeof(*s), NDP_CACHE_LINE)))
+        return NULL;
+
+    memset(s, 0, sizeof(*s));
+    s->port = port;
+    s->queue = queue;
+    ndp_hist_reset(&s->latency);
+    return s;
+}
+
+void ndp_sink_reset(struct ndp_sink *s)
+{
+    __atomic_store_n(&s->reset, true, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&s->reset, __ATOMIC_ACQUIRE))
+        sched_yield();
+}
+
+static bool sink_sig(const struct ndp_buf *b, struct ndp_pktgen_sig *sig)
+{
+    const uint8_t *p = ndp_buf_mtod(b, const uint8_t *);
+    const struct ndp_ipv4_hdr *ip = (const struct ndp_ipv4_hdr *)(p + NDP_ETHER_HDR_LEN);
+    uint16_t type, off;
+
+    if (b->data_len < NDP_ETHER_HDR_LEN + sizeof(*ip))
+        return false;
+    memcpy(&type, p + offsetof(struct ndp_ether_hdr, type), sizeof(type));
+    if (type != htons(NDP_ETHER_TYPE_IPV4))
+        return false;
+
+    off = NDP_ETHER_HDR_LEN + (ip->ver_ihl & 0xf) * 4 + l4_hdr_len(ip->proto);
+    if (b->data_len < off + sizeof(*sig))
+        return false;
+    memcpy(sig, p + off, sizeof(*sig));
+    return sig->magic == NDP_PKTGEN_MAGIC;
+}
+
+int ndp_sink_poll(void *arg)
+{
+    struct ndp_sink *s = arg;
+    struct ndp_buf *bufs[PKTGEN_MAX_BURST];
+    struct ndp_pktgen_sig sig;
+    uint16_t n;
+    uint64_t now;
+
+    if (__atomic_load_n(&s->reset, __ATOMIC_ACQUIRE)) {
+        s->packets = s->bytes = s->unsigned_pkts = s->seq_gaps = 0;
+        s->first_tsc = s->last_tsc = 0;
+        ndp_hist_reset(&s->latency);
+        __atomic_store_n(&s->reset, false, __ATOMIC_RELEASE);
+    }
+
+    if (!(n = ndp_port_rx_burst(s->port, s->queue, bufs, PKTGEN_MAX_BURST)))
+        return 0;
+
+    now = ndp_rdtsc();
+    if (!s->first_tsc)
+        s->first_tsc = now;
+    s->last_tsc = now;
+
+    for (uint16_t i = 0; i < n; i++) {
+        s->bytes += bufs[i]->pkt_len;
+        if (!sink_sig(bufs[i], &sig)) {
+            s->unsigned_pkts++;
+            continue;
+        }
+        ndp_hist_record(&s->latency, ndp_tsc_to_ns(now - sig.tsc));
+        if (s->packets && sig.seq != s->next_seq)
+            s->seq_gaps++;
+        s->next_seq = sig.seq + 1;
+    }
+    s->packets += n;
+    ndp_buf_free_bulk(bufs, n);
+    return n;
+}
+
+double ndp_sink_mpps(const struct ndp_sink *s)
+{
+    uint64_t span = s->last_tsc - s->first_tsc;
+
+    if (!span)
+        return 0.0;
+    return (double)s->packets * (double)ndp_tsc_hz() / (double)span / 1e6;
+}
+
+void ndp_sink_report(const struct ndp_sink *s, FILE *out)
+{
+    double secs = (double)(s->last_tsc - s->first_tsc) / (double)ndp_tsc_hz();
+
+    fprintf(out, "sink port %u queue %u: %lu pkts %.2f Mpps %.2f Gbit/s, %lu gaps, %lu foreign\n",
+            s->port->id, s->queue, s->packets, ndp_sink_mpps(s),
+            secs > 0 ? (double)s->bytes * 8 / secs / 1e9 : 0.0, s->seq_gaps, s->unsigned_pkts);
+    fprintf(out, "  latency ");
+    ndp_hist_report(&s->latency, out, "ns");
+}
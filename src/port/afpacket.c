@@ -0,0 +1,275 @@
+/*******************************************************************************
+ * @file               afpacket.c
+ * @brief              AF_PACKET port backend over mmapped TPACKET_V2 rings.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Every queue owns a packet socket bound to the interface
+ *                     with an rx and a tx ring mapped back to back.  Receive
+ *                     hands frames the kernel marked TP_STATUS_USER to the
+ *                     data path as copies in pool buffers and returns the
+ *                     slots at once; transmit copies (gathering chains) into
+ *                     free tx slots and kicks the socket once per burst.
+ *                     The kernel allocates the rings under the caller's
+ *                     memory policy, so they are created with the port's
+ *                     node preferred.
+ *
+ *                     Outgoing frames are not looped back to our own rx
+ *                     rings, and with qdisc bypass tx goes straight to the
+ *                     driver.  Both are best effort on older kernels.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "port.h"
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <net/if.h>
+
+#ifndef PACKET_IGNORE_OUTGOING
+#define PACKET_IGNORE_OUTGOING  23
+#endif
+
+#define AFP_FRAME_SIZE          2048
+#define AFP_BLOCK_SIZE          (1U << 16)
+#define AFP_RING_FRAMES         4096
+#define AFP_RING_SIZE           ((size_t)AFP_FRAME_SIZE * AFP_RING_FRAMES)
+#define AFP_TX_DATA             (TPACKET2_HDRLEN - sizeof(struct sockaddr_ll))
+
+struct afp_queue
+{
+    int fd;
+    uint8_t *map;               /* rx ring, then tx ring */
+    uint32_t rx_head;
+    uint32_t tx_head;
+} __ndp_cache_aligned;
+
+struct afpacket_priv
+{
+    int ifindex;
+    struct afp_queue queues[];
+};
+
+
+static inline struct tpacket2_hdr *afp_frame(uint8_t *ring, uint32_t idx)
+{
+    return (struct tpacket2_hdr *)(ring + (size_t)idx * AFP_FRAME_SIZE);
+}
+
+static inline uint32_t afp_next(uint32_t idx)
+{
+    return idx + 1 == AFP_RING_FRAMES ? 0 : idx + 1;
+}
+
+static uint16_t afpacket_rx(struct ndp_port *p, uint16_t q, struct ndp_buf **bufs, uint16_t n)
+{
+    struct afpacket_priv *ap = p->priv;
+    struct afp_queue *aq = &ap->queues[q];
+    uint32_t idx = aq->rx_head;
+    uint16_t ready = 0, got = 0;
+
+    // count what is ready first so the buffers come out of the pool in one go
+    while (ready < n) {
+        struct tpacket2_hdr *h = afp_frame(aq->map, idx);
+        if (!(__atomic_load_n(&h->tp_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+            break;
+        ready++;
+        idx = afp_next(idx);
+    }
+    if (!ready || !ndp_buf_alloc_bulk(p->pool, bufs, ready))
+        return 0;
+
+    for (uint16_t i = 0; i < ready; i++) {
+        struct tpacket2_hdr *h = afp_frame(aq->map, aq->rx_head);
+        struct ndp_buf *b = bufs[i];
+        uint8_t *data = ndp_buf_append(b, h->tp_snaplen);
+
+        if (ndp_likely(data && h->tp_snaplen == h->tp_len)) {
+            memcpy(data, (uint8_t *)h + h->tp_mac, h->tp_snaplen);
+            b->port = p->id;
+            bufs[got++] = b;
+        } else {
+            // larger than a buffer: drop rather than hand out a truncated frame
+            ndp_buf_free(b);
+            p->stats[q].ierrors++;
+        }
+        __atomic_store_n(&h->tp_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        aq->rx_head = afp_next(aq->rx_head);
+    }
+    return got;
+}
+
+static uint16_t afpacket_tx(struct ndp_port *p, uint16_t q, struct ndp_buf **bufs, uint16_t n)
+{
+    struct afpacket_priv *ap = p->priv;
+    struct afp_queue *aq = &ap->queues[q];
+    uint8_t *ring = aq->map + AFP_RING_SIZE;
+    uint16_t sent;
+
+    for (sent = 0; sent < n; sent++) {
+        struct tpacket2_hdr *h = afp_frame(ring, aq->tx_head);
+        uint32_t status = __atomic_load_n(&h->tp_status, __ATOMIC_ACQUIRE);
+        uint8_t *data = (uint8_t *)h + AFP_TX_DATA;
+        uint32_t off = 0;
+
+        if (status & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING))
+            break;
+        if (ndp_unlikely(bufs[sent]->pkt_len > AFP_FRAME_SIZE - AFP_TX_DATA))
+            break;
+
+        for (struct ndp_buf *seg = bufs[sent]; seg; seg = seg->next) {
+            memcpy(data + off, ndp_buf_mtod(seg, uint8_t *), seg->data_len);
+            off += seg->data_len;
+        }
+        h->tp_len = off;
+        __atomic_store_n(&h->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+        aq->tx_head = afp_next(aq->tx_head);
+    }
+
+    if (sent) {
+        ndp_buf_free_bulk(bufs, sent);
+        // a full socket buffer only delays the frames, they stay queued
+        if (sendto(aq->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0 &&
+            errno != EAGAIN && errno != ENOBUFS)
+            perror("afpacket sendto");
+    }
+    return sent;
+}
+
+static void afp_queue_close(struct afp_queue *aq)
+{
+    if (aq->map)
+        munmap(aq->map, 2 * AFP_RING_SIZE);
+    if (aq->fd >= 0)
+        close(aq->fd);
+    aq->map = NULL;
+    aq->fd = -1;
+}
+
+static void afpacket_close(struct ndp_port *p)
+{
+    struct afpacket_priv *ap = p->priv;
+
+    for (uint16_t q = 0; q < p->num_queues; q++)
+        afp_queue_close(&ap->queues[q]);
+}
+
+static const struct ndp_port_ops afpacket_ops = {
+    .kind = "afpacket",
+    .rx_burst = afpacket_rx,
+    .tx_burst = afpacket_tx,
+    .close = afpacket_close,
+};
+
+static int afp_queue_open(struct afp_queue *aq, int ifindex, int fanout)
+{
+    int version = TPACKET_V2, one = 1;
+    struct tpacket_req req = {
+        .tp_block_size = AFP_BLOCK_SIZE,
+        .tp_block_nr = AFP_RING_SIZE / AFP_BLOCK_SIZE,
+        .tp_frame_size = AFP_FRAME_SIZE,
+        .tp_frame_nr = AFP_RING_FRAMES,
+    };
+    struct sockaddr_ll sll = {
+        .sll_family = AF_PACKET,
+        .sll_protocol = htons(ETH_P_ALL),
+        .sll_ifindex = ifindex,
+    };
+
+    if ((aq->fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL))) < 0) {
+        perror("afpacket socket");
+        return -1;
+    }
+    if (setsockopt(aq->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) ||
+        setsockopt(aq->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) ||
+        setsockopt(aq->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req))) {
+        perror("afpacket rings");
+        return -1;
+    }
+    setsockopt(aq->fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one));
+    setsockopt(aq->fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+
+    aq->map = mmap(NULL, 2 * AFP_RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, aq->fd, 0);
+    if (aq->map == MAP_FAILED) {
+        aq->map = NULL;
+        perror("afpacket mmap");
+        return -1;
+    }
+    if (bind(aq->fd, (struct sockaddr *)&sll, sizeof(sll))) {
+        perror("afpacket bind");
+        return -1;
+    }
+    if (fanout && setsockopt(aq->fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout))) {
+        perror("afpacket fanout");
+        return -1;
+    }
+    return 0;
+}
+
+struct ndp_port *ndp_port_afpacket_create(struct mempool_sys *mem, struct ndp_buf_pool *pool,
+                                          const char *ifname, uint16_t num_queues)
+{
+    struct ndp_port *p = ndp_port_alloc(mem, pool->node, ifname, num_queues, &afpacket_ops);
+    struct afpacket_priv *ap;
+    int ifindex, fanout = 0;
+    uint16_t q;
+
+    if (!p)
+        return NULL;
+    if (!(ifindex = if_nametoindex(ifname))) {
+        fprintf(stderr, "afpacket: no interface %s\n", ifname);
+        return NULL;
+    }
+    ap = ndp_mempool_alloc(mem, pool->node, sizeof(*ap) + num_queues * sizeof(ap->queues[0]),
+                           NDP_CACHE_LINE);
+    if (!ap)
+        return NULL;
+
+    memset(ap, 0, sizeof(*ap) + num_queues * sizeof(ap->queues[0]));
+    ap->ifindex = ifindex;
+    ndp_dev_locality_netdev(ifname, &p->dev);
+    if (p->dev.node >= 0 && p->dev.node != pool->node)
+        fprintf(stderr, "afpacket: %s is on node %d, its buffers on node %d\n", ifname,
+                p->dev.node, pool->node);
+    for (q = 0; q < num_queues; q++)
+        ap->queues[q].fd = -1;
+    p->priv = ap;
+    p->pool = pool;
+
+    // one fanout group per port and process
+    if (num_queues > 1)
+        fanout = ((getpid() ^ (ifindex << 8)) & 0xffff) | (PACKET_FANOUT_HASH << 16);
+
+    numa_set_preferred(pool->node);
+    for (q = 0; q < num_queues; q++) {
+        if (afp_queue_open(&ap->queues[q], ifindex, fanout))
+            break;
+    }
+    numa_set_localalloc();
+
+    if (q < num_queues) {
+        afpacket_close(p);
+        return NULL;
+    }
+    return p;
+}
+
+struct ndp_port *ndp_port_afpacket_open(struct mempool_sys *mem, int node, const char *ifname,
+                                        uint16_t num_queues, uint16_t span, unsigned int count)
+{
+    struct ndp_buf_pool *pool;
+
+    if (node == NDP_PORT_NODE_DEVICE) {
+        int cpu = sched_getcpu();
+        node = ndp_dev_node(ifname, cpu >= 0 ? numa_node_of_cpu(cpu) : 0);
+        if (node < 0)
+            node = 0;
+    }
+    if (!(pool = ndp_buf_pool_create(mem, node, span, count)))
+        return NULL;
+    return ndp_port_afpacket_create(mem, pool, ifname, num_queues);
+}
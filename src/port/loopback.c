@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * @file               loopback.c
+ * @brief              In-process loopback port backend.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Each queue is a single-producer single-consumer ring:
+ *                     the thread driving tx on queue q of one port feeds the
+ *                     thread driving rx on queue q of its peer.  A full ring
+ *                     rejects the rest of the burst the way a full NIC tx
+ *                     ring would, so back-pressure is visible to the sender.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "port.h"
+
+struct loopback_priv
+{
+    struct ndp_port *peer;
+    struct ndp_ring *rings[NDP_PORT_MAX_QUEUES];
+};
+
+
+static uint16_t loopback_rx(struct ndp_port *p, uint16_t q, struct ndp_buf **bufs, uint16_t n)
+{
+    struct loopback_priv *lp = p->priv;
+
+    return ndp_ring_dequeue_burst(lp->rings[q], (void **)bufs, n);
+}
+
+static uint16_t loopback_tx(struct ndp_port *p, uint16_t q, struct ndp_buf **bufs, uint16_t n)
+{
+    struct loopback_priv *lp = p->priv;
+    struct loopback_priv *peer = lp->peer->priv;
+
+    if (ndp_unlikely(q >= lp->peer->num_queues))
+        return 0;
+    return ndp_ring_enqueue_burst(peer->rings[q], (void *const *)bufs, n);
+}
+
+/* drain what was sent to us and never received */
+static void loopback_close(struct ndp_port *p)
+{
+    struct loopback_priv *lp = p->priv;
+    struct ndp_buf *bufs[64];
+    unsigned int n;
+
+    for (uint16_t q = 0; q < p->num_queues; q++) {
+        while ((n = ndp_ring_dequeue_burst(lp->rings[q], (void **)bufs, 64)))
+            ndp_buf_free_bulk(bufs, n);
+    }
+}
+
+static const struct ndp_port_ops loopback_ops = {
+    .kind = "loopback",
+    .rx_burst = loopback_rx,
+    .tx_burst = loopback_tx,
+    .close = loopback_close,
+};
+
+struct ndp_port *ndp_port_loopback_create(struct mempool_sys *mem, int node, const char *name,
+                                          uint16_t num_queues, uint32_t ring_size)
+{
+    struct ndp_port *p = ndp_port_alloc(mem, node, name, num_queues, &loopback_ops);
+    struct loopback_priv *lp;
+
+    if (!p)
+        return NULL;
+    if (!(lp = ndp_mempool_alloc(mem, node, sizeof(*lp), NDP_CACHE_LINE)))
+        return NULL;
+
+    memset(lp, 0, sizeof(*lp));
+    lp->peer = p;
+    for (uint16_t q = 0; q < num_queues; q++) {
+        lp->rings[q] = ndp_ring_create(mem, node, ring_size,
+                                       NDP_RING_SP_ENQ | NDP_RING_SC_DEQ);
+        if (!lp->rings[q])
+            return NULL;
+    }
+    p->priv = lp;
+    return p;
+}
+
+int ndp_port_loopback_connect(struct ndp_port *a, struct ndp_port *b)
+{
+    if (a->ops != &loopback_ops || b->ops != &loopback_ops)
+        return -1;
+
+    ((struct loopback_priv *)a->priv)->peer = b;
+    ((struct loopback_priv *)b->priv)->peer = a;
+    return 0;
+}
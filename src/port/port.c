@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * @file               port.c
+ * @brief              Backend independent part of packet ports.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            A port is a set of rx/tx queue pairs behind a small ops
+ *                     table.  The data path calls the inline burst wrappers,
+ *                     which keep per-queue counters on their own cache lines
+ *                     so queues driven by different workers never share a
+ *                     line.  Backends only implement the raw bursts.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "port.h"
+
+
+struct ndp_port *ndp_port_alloc(struct mempool_sys *mem, int node, const char *name,
+                                uint16_t num_queues, const struct ndp_port_ops *ops)
+{
+    static uint16_t next_id;
+    struct ndp_port *p;
+
+    if (!num_queues || num_queues > NDP_PORT_MAX_QUEUES)
+        return NULL;
+    if (!(p = ndp_mempool_alloc(mem, node, sizeof(*p), NDP_CACHE_LINE)))
+        return NULL;
+
+    memset(p, 0, sizeof(*p));
+    p->ops = ops;
+    p->id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+    p->num_queues = num_queues;
+    p->node = node;
+    p->dev.node = -1;
+    snprintf(p->name, sizeof(p->name), "%s", name ? name : ops->kind);
+    return p;
+}
+
+void ndp_port_close(struct ndp_port *p)
+{
+    if (p && p->ops->close)
+        p->ops->close(p);
+}
+
+int ndp_port_worker_cpus(const struct ndp_port *p, const struct ndp_topology *topo, int *cpus,
+                         int max)
+{
+    struct ndp_dev_locality loc = p->dev;
+
+    if (!loc.num_cpus && loc.node < 0)
+        loc.node = p->node;
+    return ndp_topology_dev_cpus(topo, &loc, cpus, max);
+}
+
+uint16_t ndp_port_tx_burst_free(struct ndp_port *p, uint16_t q, struct ndp_buf **bufs,
+                                uint16_t n)
+{
+    uint16_t sent = ndp_port_tx_burst(p, q, bufs, n);
+
+    if (sent < n)
+        ndp_buf_free_bulk(bufs + sent, n - sent);
+    return sent;
+}
+
+void ndp_port_stats(const struct ndp_port *p, struct ndp_port_queue_stats *st)
+{
+    memset(st, 0, sizeof(*st));
+    for (uint16_t q = 0; q < p->num_queues; q++) {
+        st->ipackets += p->stats[q].ipackets;
+        st->ibytes += p->stats[q].ibytes;
+        st->ierrors += p->stats[q].ierrors;
+        st->opackets += p->stats[q].opackets;
+        st->obytes += p->stats[q].obytes;
+        st->oerrors += p->stats[q].oerrors;
+    }
+}
+
+void ndp_port_stats_report(const struct ndp_port *p, FILE *out)
+{
+    struct ndp_port_queue_stats st;
+
+    ndp_port_stats(p, &st);
+    fprintf(out, "port %u (%s, %s, node %d, %u queues)\n", p->id, p->name, p->ops->kind,
+            p->node, p->num_queues);
+    fprintf(out, "  rx %lu pkts %lu bytes, %lu dropped\n", st.ipackets, st.ibytes, st.ierrors);
+    fprintf(out, "  tx %lu pkts %lu bytes, %lu rejected\n", st.opackets, st.obytes, st.oerrors);
+}
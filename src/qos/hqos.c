@@ -0,0 +1,522 @@
+/*******************************************************************************
+ * @file               hqos.c
+ * @brief              Hierarchical QoS egress scheduler.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Pipes, queue slots and the active-queue bitmap share
+ *                     one huge-page region on the scheduler's node.  A
+ *                     pipe's 16 queues are 16 adjacent bitmap bits, so the
+ *                     scan for the next active pipe is a find-first-set
+ *                     over bm0 words, skipping empty words through bm1 (one
+ *                     bit per bm0 word): 64K pipes are 16 bm1 words.
+ *
+ *                     Token buckets refill lazily from the TSC in fixed
+ *                     point, as the policer does.  Traffic class caps are
+ *                     credits reset at the start of each tc period rather
+ *                     than accumulated, so an idle class cannot save up a
+ *                     burst beyond its period's share.  Round-robin inside
+ *                     a class picks the queue with the fewest weighted
+ *                     bytes sent; a queue waking up joins at the current
+ *                     minimum so idle time earns no credit.  A byte costs
+ *                     lcm(class weights) / weight, which keeps any weight
+ *                     ratio exact, and the class minimum is taken off its
+ *                     counters after every packet so they stay small.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "hqos.h"
+
+#define HQOS_IN_BURST           64
+
+
+static int tb_init(struct ndp_hqos_tb *tb, uint64_t rate_bps, uint64_t burst_bytes)
+{
+    unsigned __int128 units = (unsigned __int128)rate_bps
+                              << (NDP_HQOS_FRAC_BITS + NDP_HQOS_TICK_SHIFT);
+
+    if (!rate_bps || !burst_bytes || burst_bytes >= 1ULL << (62 - NDP_HQOS_FRAC_BITS))
+        return -1;
+    if (!(tb->rate = (uint64_t)(units / ndp_tsc_hz())))
+        return -1;
+    tb->burst = burst_bytes << NDP_HQOS_FRAC_BITS;
+    tb->cap = (tb->burst + tb->rate - 1) / tb->rate;
+    return 0;
+}
+
+static inline uint64_t tb_refill(const struct ndp_hqos_tb *tb, uint64_t tokens, uint64_t *stamp,
+                                 uint64_t now)
+{
+    uint64_t dt = now - *stamp;
+
+    if ((int64_t)dt <= 0)
+        return tokens;
+    *stamp = now;
+    if (dt > tb->cap)
+        dt = tb->cap;
+    tokens += dt * tb->rate;
+    return tokens < tb->burst ? tokens : tb->burst;
+}
+
+static inline uint64_t now_ticks(void)
+{
+    return ndp_rdtsc() >> NDP_HQOS_TICK_SHIFT;
+}
+
+static uint64_t period_ticks(uint32_t period_us)
+{
+    return ((uint64_t)period_us * ndp_tsc_hz() / 1000000) >> NDP_HQOS_TICK_SHIFT;
+}
+
+/* bytes a class may send per period; 0 means the parent rate */
+static uint64_t period_credits(const struct ndp_hqos *h, uint64_t tc_rate, uint64_t parent_rate,
+                               uint32_t period_us)
+{
+    uint64_t credits = (tc_rate ? tc_rate : parent_rate) * period_us / 1000000;
+
+    // less than a full frame per period would hold the queue's head forever
+    if (credits < h->max_frame + NDP_HQOS_FRAME_OVERHEAD)
+        credits = h->max_frame + NDP_HQOS_FRAME_OVERHEAD;
+    return credits;
+}
+
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+    while (b) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+struct ndp_hqos *ndp_hqos_create(struct mempool_sys *mem, int node,
+                                 const struct ndp_hqos_params *params)
+{
+    struct ndp_hqos *h;
+    uint64_t num_queues;
+    size_t pipes_size, slots_size, bm_size;
+    uint32_t max_frame = params->max_frame ? params->max_frame : NDP_HQOS_MAX_FRAME;
+    uint8_t *map;
+
+    // the port bucket below holds 64KB
+    if (!params->num_subports || params->num_subports > NDP_HQOS_MAX_SUBPORTS ||
+        !params->pipes_per_subport ||
+        (uint64_t)params->num_subports * params->pipes_per_subport > NDP_HQOS_MAX_PIPES ||
+        params->queue_size < 2 || params->queue_size > NDP_HQOS_MAX_QUEUE ||
+        (params->queue_size & (params->queue_size - 1)) ||
+        max_frame + NDP_HQOS_FRAME_OVERHEAD > 64 * 1024)
+        return NULL;
+
+    if (!(h = ndp_mempool_alloc(mem, node, sizeof(*h), NDP_CACHE_LINE)))
+        return NULL;
+    memset(h, 0, sizeof(*h));
+    if (tb_init(&h->port_tb, params->rate, 64 * 1024))
+        return NULL;
+
+    h->num_subports = params->num_subports;
+    h->pipes_per_subport = params->pipes_per_subport;
+    h->num_pipes = params->num_subports * params->pipes_per_subport;
+    h->queue_size = params->queue_size;
+    h->max_frame = max_frame;
+    h->node = node;
+    h->cur_pipe = -1;
+
+    num_queues = (uint64_t)h->num_pipes * NDP_HQOS_PIPE_QUEUES;
+    h->bm0_words = (num_queues + 63) / 64;
+    h->bm1_words = (h->bm0_words + 63) / 64;
+    pipes_size = (size_t)h->num_pipes * sizeof(struct ndp_hqos_pipe);
+    slots_size = num_queues * h->queue_size * sizeof(struct ndp_buf *);
+    bm_size = (size_t)(h->bm0_words + h->bm1_words) * sizeof(uint64_t);
+
+    h->map_size = pipes_size + slots_size + bm_size;
+    if (!(map = h->map = ndp_mempool_map_huge(h->map_size, node)))
+        return NULL;
+    h->pipes = (struct ndp_hqos_pipe *)map;
+    h->slots = (struct ndp_buf **)(map + pipes_size);
+    h->bm0 = (uint64_t *)(map + pipes_size + slots_size);
+    h->bm1 = h->bm0 + h->bm0_words;
+
+    // the region is zeroed: all pipes on profile 0 with empty queues
+    h->port_tokens = h->port_tb.burst;
+    h->port_stamp = now_ticks();
+    for (uint32_t s = 0; s < h->num_subports; s++) {
+        struct ndp_hqos_subport_params sp = { .rate = params->rate, .burst = 64 * 1024,
+                                              .tc_period_us = 10000 };
+        ndp_hqos_subport_config(h, s, &sp);
+    }
+    return h;
+}
+
+void ndp_hqos_destroy(struct ndp_hqos *h)
+{
+    struct ndp_buf *bufs[HQOS_IN_BURST];
+    uint16_t n;
+
+    if (!h)
+        return;
+    for (uint32_t p = 0; p < h->num_pipes; p++) {
+        for (int q = 0; q < NDP_HQOS_PIPE_QUEUES; q++) {
+            struct ndp_hqos_pipe *pipe = &h->pipes[p];
+            struct ndp_buf **slots = h->slots +
+                                     ((size_t)p * NDP_HQOS_PIPE_QUEUES + q) * h->queue_size;
+            while (pipe->head[q] != pipe->tail[q])
+                ndp_buf_free(slots[pipe->head[q]++ & (h->queue_size - 1)]);
+        }
+    }
+    if (h->in) {
+        while ((n = ndp_ring_dequeue_burst(h->in, (void **)bufs, HQOS_IN_BURST)))
+            ndp_buf_free_bulk(bufs, n);
+    }
+    if (h->num_hold)
+        ndp_buf_free_bulk(h->hold, h->num_hold);
+    ndp_mempool_unmap(h->map, h->map_size);
+}
+
+int ndp_hqos_subport_config(struct ndp_hqos *h, uint32_t id,
+                            const struct ndp_hqos_subport_params *params)
+{
+    struct ndp_hqos_subport *sp;
+
+    if (id >= h->num_subports || !params->tc_period_us ||
+        params->burst < h->max_frame + NDP_HQOS_FRAME_OVERHEAD)
+        return -1;
+
+    sp = &h->subports[id];
+    if (tb_init(&sp->tb, params->rate, params->burst))
+        return -1;
+    sp->tokens = sp->tb.burst;
+    sp->stamp = now_ticks();
+    sp->tc_period = period_ticks(params->tc_period_us);
+    for (int tc = 0; tc < NDP_HQOS_TCS; tc++) {
+        sp->tc_credits_per_period[tc] = period_credits(h, params->tc_rate[tc], params->rate,
+                                                       params->tc_period_us);
+        sp->tc_credits[tc] = sp->tc_credits_per_period[tc];
+    }
+    sp->tc_time = sp->stamp + sp->tc_period;
+    return 0;
+}
+
+int ndp_hqos_pipe_profile_add(struct ndp_hqos *h, const struct ndp_hqos_pipe_params *params)
+{
+    struct ndp_hqos_profile *prof;
+
+    if (h->num_profiles == NDP_HQOS_MAX_PROFILES || !params->tc_period_us ||
+        params->burst < h->max_frame + NDP_HQOS_FRAME_OVERHEAD)
+        return -1;
+
+    prof = &h->profiles[h->num_profiles];
+    if (tb_init(&prof->tb, params->rate, params->burst))
+        return -1;
+    prof->tc_period = period_ticks(params->tc_period_us);
+    for (int tc = 0; tc < NDP_HQOS_TCS; tc++) {
+        const uint8_t *w = &params->wrr_weights[tc * NDP_HQOS_TC_QUEUES];
+        uint64_t lcm = 1;
+
+        prof->tc_credits[tc] = period_credits(h, params->tc_rate[tc], params->rate,
+                                              params->tc_period_us);
+        // at most 255^4, so every cost fits in 32 bits
+        for (int i = 0; i < NDP_HQOS_TC_QUEUES; i++) {
+            uint64_t wi = w[i] ? w[i] : 1;
+            lcm = lcm / gcd(lcm, wi) * wi;
+        }
+        for (int i = 0; i < NDP_HQOS_TC_QUEUES; i++)
+            prof->wrr_cost[tc * NDP_HQOS_TC_QUEUES + i] = lcm / (w[i] ? w[i] : 1);
+    }
+    return h->num_profiles++;
+}
+
+int ndp_hqos_pipe_config(struct ndp_hqos *h, uint32_t subport, uint32_t pipe, uint32_t profile)
+{
+    struct ndp_hqos_pipe *p;
+
+    if (subport >= h->num_subports || pipe >= h->pipes_per_subport ||
+        profile >= h->num_profiles)
+        return -1;
+
+    p = &h->pipes[subport * h->pipes_per_subport + pipe];
+    p->profile = profile;
+    p->tokens = h->profiles[profile].tb.burst;
+    p->stamp = now_ticks();
+    memcpy(p->tc_credits, h->profiles[profile].tc_credits, sizeof(p->tc_credits));
+    p->tc_time = p->stamp + h->profiles[profile].tc_period;
+    return 0;
+}
+
+static inline void bm_set(struct ndp_hqos *h, uint32_t qid)
+{
+    h->bm0[qid / 64] |= 1ULL << (qid % 64);
+    h->bm1[qid / 4096] |= 1ULL << (qid / 64 % 64);
+}
+
+static inline void bm_clear(struct ndp_hqos *h, uint32_t qid)
+{
+    uint32_t w = qid / 64;
+
+    h->bm0[w] &= ~(1ULL << (qid % 64));
+    if (!h->bm0[w])
+        h->bm1[w / 64] &= ~(1ULL << (w % 64));
+}
+
+/* active queues of a pipe, bit q for queue q */
+static inline uint32_t bm_pipe(const struct ndp_hqos *h, uint32_t pipe)
+{
+    uint32_t qid = pipe * NDP_HQOS_PIPE_QUEUES;
+
+    return (h->bm0[qid / 64] >> (qid % 64)) & 0xffff;
+}
+
+/* first active queue at or after qid, wrapping around; -1 when all are empty */
+static int64_t bm_scan(const struct ndp_hqos *h, uint32_t qid)
+{
+    uint32_t w = qid / 64;
+    uint64_t bits = h->bm0[w] & (~0ULL << (qid % 64));
+    uint32_t from = w + 1;
+
+    if (bits)
+        return (int64_t)w * 64 + __builtin_ctzll(bits);
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t i = from / 64; i < h->bm1_words; i++) {
+            uint64_t l1 = h->bm1[i];
+            if (i == from / 64)
+                l1 &= from % 64 ? ~0ULL << (from % 64) : ~0ULL;
+            if (l1) {
+                uint32_t word = i * 64 + __builtin_ctzll(l1);
+                return (int64_t)word * 64 + __builtin_ctzll(h->bm0[word]);
+            }
+        }
+        from = 0;
+    }
+    return -1;
+}
+
+uint16_t ndp_hqos_enqueue(struct ndp_hqos *h, struct ndp_buf **bufs, uint16_t n)
+{
+    uint64_t num_queues = (uint64_t)h->num_pipes * NDP_HQOS_PIPE_QUEUES;
+    uint32_t mask = h->queue_size - 1;
+    uint16_t queued = 0;
+
+    for (uint16_t i = 0; i < n; i++) {
+        struct ndp_buf *b = bufs[i];
+        uint64_t qid = b->udata;
+        struct ndp_hqos_pipe *pipe;
+        uint32_t q;
+
+        if (i + 4 < n && bufs[i + 4]->udata < num_queues)
+            __builtin_prefetch(&h->pipes[bufs[i + 4]->udata / NDP_HQOS_PIPE_QUEUES], 1);
+
+        if (ndp_unlikely(qid >= num_queues || b->pkt_len > h->max_frame)) {
+            ndp_buf_free(b);
+            h->stats.drops++;
+            continue;
+        }
+        pipe = &h->pipes[qid / NDP_HQOS_PIPE_QUEUES];
+        q = qid % NDP_HQOS_PIPE_QUEUES;
+        if (pipe->tail[q] - pipe->head[q] == h->queue_size) {
+            ndp_buf_free(b);
+            h->stats.drops++;
+            continue;
+        }
+
+        if (pipe->tail[q] == pipe->head[q]) {
+            // join the class's round at its current minimum
+            uint32_t tc_bits = bm_pipe(h, qid / NDP_HQOS_PIPE_QUEUES) &
+                               (0xfU << (q & ~(NDP_HQOS_TC_QUEUES - 1)));
+            uint64_t min = UINT64_MAX;
+            for (; tc_bits; tc_bits &= tc_bits - 1) {
+                uint32_t o = __builtin_ctz(tc_bits);
+                if (pipe->wrr_tokens[o] < min)
+                    min = pipe->wrr_tokens[o];
+            }
+            if (min != UINT64_MAX)
+                pipe->wrr_tokens[q] = min;
+            bm_set(h, qid);
+        }
+        h->slots[qid * h->queue_size + (pipe->tail[q]++ & mask)] = b;
+        queued++;
+    }
+    h->stats.enq_pkts += queued;
+    return queued;
+}
+
+/* send from one pipe while it and everything above it has credits */
+static uint16_t pipe_serve(struct ndp_hqos *h, uint32_t p, uint64_t now, struct ndp_buf **bufs,
+                           uint16_t max)
+{
+    struct ndp_hqos_pipe *pipe = &h->pipes[p];
+    const struct ndp_hqos_profile *prof = &h->profiles[pipe->profile];
+    struct ndp_hqos_subport *sp = &h->subports[p / h->pipes_per_subport];
+    uint32_t active = bm_pipe(h, p);
+    uint32_t mask = h->queue_size - 1;
+    uint16_t k = 0;
+
+    sp->tokens = tb_refill(&sp->tb, sp->tokens, &sp->stamp, now);
+    if (now >= sp->tc_time) {
+        memcpy(sp->tc_credits, sp->tc_credits_per_period, sizeof(sp->tc_credits));
+        sp->tc_time = now + sp->tc_period;
+    }
+    pipe->tokens = tb_refill(&prof->tb, pipe->tokens, &pipe->stamp, now);
+    if (now >= pipe->tc_time) {
+        memcpy(pipe->tc_credits, prof->tc_credits, sizeof(pipe->tc_credits));
+        pipe->tc_time = now + prof->tc_period;
+    }
+
+    while (k < max && active) {
+        bool sent = false;
+
+        for (int tc = 0; tc < NDP_HQOS_TCS && !sent; tc++) {
+            uint32_t tc_bits = (active >> (tc * NDP_HQOS_TC_QUEUES)) & 0xf;
+            uint32_t tc_active = tc_bits;
+            uint32_t q = 0, qid;
+            uint64_t min = UINT64_MAX, len, units;
+            struct ndp_buf **slot;
+
+            if (!tc_bits)
+                continue;
+            for (; tc_bits; tc_bits &= tc_bits - 1) {
+                uint32_t o = tc * NDP_HQOS_TC_QUEUES + __builtin_ctz(tc_bits);
+                if (pipe->wrr_tokens[o] < min) {
+                    min = pipe->wrr_tokens[o];
+                    q = o;
+                }
+            }
+
+            qid = p * NDP_HQOS_PIPE_QUEUES + q;
+            slot = &h->slots[(size_t)qid * h->queue_size + (pipe->head[q] & mask)];
+            len = (*slot)->pkt_len + NDP_HQOS_FRAME_OVERHEAD;
+            units = len << NDP_HQOS_FRAC_BITS;
+
+            if (h->port_tokens < units) {
+                h->port_blocked = true;
+                return k;
+            }
+            // out of credit at some level: a lower class may still fit
+            if (sp->tokens < units || sp->tc_credits[tc] < len ||
+                pipe->tokens < units || pipe->tc_credits[tc] < len)
+                continue;
+
+            bufs[k++] = *slot;
+            pipe->head[q]++;
+            h->port_tokens -= units;
+            sp->tokens -= units;
+            sp->tc_credits[tc] -= len;
+            pipe->tokens -= units;
+            pipe->tc_credits[tc] -= len;
+            pipe->wrr_tokens[q] += len * prof->wrr_cost[q];
+            for (; tc_active; tc_active &= tc_active - 1)
+                pipe->wrr_tokens[tc * NDP_HQOS_TC_QUEUES + __builtin_ctz(tc_active)] -= min;
+            h->stats.tc_pkts[tc]++;
+            h->stats.tc_bytes[tc] += len - NDP_HQOS_FRAME_OVERHEAD;
+
+            if (pipe->head[q] == pipe->tail[q]) {
+                bm_clear(h, qid);
+                active &= ~(1U << q);
+            } else {
+                __builtin_prefetch(h->slots[(size_t)qid * h->queue_size + (pipe->head[q] & mask)]);
+            }
+            sent = true;
+        }
+        if (!sent)
+            break;
+    }
+    return k;
+}
+
+uint16_t ndp_hqos_dequeue(struct ndp_hqos *h, struct ndp_buf **bufs, uint16_t n)
+{
+    uint64_t now = now_ticks();
+    int64_t idle_from = -1;
+    uint16_t got = 0;
+
+    h->port_tokens = tb_refill(&h->port_tb, h->port_tokens, &h->port_stamp, now);
+    h->port_blocked = false;
+
+    while (got < n) {
+        uint16_t k, max;
+
+        if (h->cur_pipe < 0) {
+            int64_t qid = bm_scan(h, h->next_qid);
+            if (qid < 0)
+                break;
+            h->cur_pipe = qid / NDP_HQOS_PIPE_QUEUES;
+            h->cur_pkts = 0;
+            h->next_qid = (h->cur_pipe + 1) % h->num_pipes * NDP_HQOS_PIPE_QUEUES;
+            // every active pipe visited without anything sent
+            if (h->cur_pipe == idle_from)
+                break;
+        }
+
+        max = NDP_HQOS_PIPE_BURST - h->cur_pkts;
+        k = pipe_serve(h, h->cur_pipe, now, bufs + got, n - got < max ? n - got : max);
+        if (h->port_blocked) {
+            got += k;
+            break;
+        }
+        if (!k && idle_from < 0)
+            idle_from = h->cur_pipe;
+        else if (k)
+            idle_from = -1;
+
+        got += k;
+        h->cur_pkts += k;
+        if (!k || h->cur_pkts >= NDP_HQOS_PIPE_BURST || !bm_pipe(h, h->cur_pipe))
+            h->cur_pipe = -1;
+    }
+    return got;
+}
+
+int ndp_hqos_attach(struct ndp_hqos *h, struct ndp_ring *in, struct ndp_port *port, uint16_t queue)
+{
+    if (!in || queue >= port->num_queues)
+        return -1;
+
+    h->in = in;
+    h->port = port;
+    h->queue = queue;
+    return 0;
+}
+
+int ndp_hqos_poll(void *arg)
+{
+    struct ndp_hqos *h = arg;
+    struct ndp_buf *bufs[HQOS_IN_BURST];
+    unsigned int n;
+    uint16_t sent;
+    int work = 0;
+
+    if ((n = ndp_ring_dequeue_burst(h->in, (void **)bufs, HQOS_IN_BURST))) {
+        ndp_hqos_enqueue(h, bufs, n);
+        work += n;
+    }
+
+    // scheduled packets keep their order: the held ones leave first
+    if (h->num_hold) {
+        sent = ndp_port_tx_burst(h->port, h->queue, h->hold, h->num_hold);
+        h->num_hold -= sent;
+        memmove(h->hold, h->hold + sent, h->num_hold * sizeof(h->hold[0]));
+        work += sent;
+        if (h->num_hold)
+            return work;
+    }
+
+    if ((n = ndp_hqos_dequeue(h, h->hold, NDP_HQOS_HOLD))) {
+        sent = ndp_port_tx_burst(h->port, h->queue, h->hold, n);
+        h->num_hold = n - sent;
+        memmove(h->hold, h->hold + sent, h->num_hold * sizeof(h->hold[0]));
+        work += sent;
+    }
+    return work;
+}
+
+void ndp_hqos_stats_report(const struct ndp_hqos *h, FILE *out)
+{
+    fprintf(out, "hqos node %d: %u subports x %u pipes, queue %u, %lu enqueued, %lu dropped\n",
+            h->node, h->num_subports, h->pipes_per_subport, h->queue_size, h->stats.enq_pkts,
+            h->stats.drops);
+    for (int tc = 0; tc < NDP_HQOS_TCS; tc++)
+        fprintf(out, "  tc%d: %lu pkts %lu bytes\n", tc, h->stats.tc_pkts[tc],
+                h->stats.tc_bytes[tc]);
+}
@@ -0,0 +1,238 @@
+/*******************************************************************************
+ * @file               policer.c
+ * @brief              Per-flow token bucket policer.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Bucket state is 16 bytes per flow, four flows to a
+ *                     cache line, in a huge-page region bound to the
+ *                     policer's node, so millions of flows cost one line
+ *                     per policed packet.  Time is the TSC in ticks of 256
+ *                     cycles and tokens are fixed point, so a refill is one
+ *                     multiply with no fraction lost between packets.
+ *
+ *                     The AVX2 kernel polices four packets per step: two
+ *                     gathers fetch their flows' lines, three gathers their
+ *                     profiles from L1, and the refill, clamp and conform
+ *                     test run on all four lanes.  AVX2 has no scatter, so
+ *                     the results go back with lane extracts.  Lines are
+ *                     prefetched two steps ahead.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "policer.h"
+#include "cycles.h"
+
+#include <immintrin.h>
+
+#define POLICER_MAX_BURST       64
+#define POLICER_PREFETCH        8       /* packets ahead */
+
+static uint64_t burst_resolve(struct ndp_policer *, const uint32_t *, const uint32_t *,
+                              unsigned int, uint64_t);
+
+static uint64_t (*burst_impl)(struct ndp_policer *, const uint32_t *, const uint32_t *,
+                              unsigned int, uint64_t) = burst_resolve;
+
+
+struct ndp_policer *ndp_policer_create(struct mempool_sys *mem, int node, uint32_t num_flows)
+{
+    struct ndp_policer *pol;
+    uint32_t num_lines = (num_flows + NDP_POLICER_LINE_FLOWS - 1) / NDP_POLICER_LINE_FLOWS;
+
+    if (!num_flows || num_flows > NDP_POLICER_MAX_FLOWS)
+        return NULL;
+    if (!(pol = ndp_mempool_alloc(mem, node, sizeof(*pol), NDP_CACHE_LINE)))
+        return NULL;
+
+    memset(pol, 0, sizeof(*pol));
+    pol->num_flows = num_flows;
+    pol->node = node;
+    pol->map_size = (size_t)num_lines * sizeof(struct ndp_policer_line);
+    if (!(pol->lines = ndp_mempool_map_huge(pol->map_size, node)))
+        return NULL;
+
+    // profile 0 passes everything: refills far beyond any packet each tick
+    pol->rate[0] = UINT32_MAX;
+    pol->cap[0] = 1;
+    pol->burst[0] = 1ULL << 62;
+
+    // writing every line also faults the region in on its node
+    for (uint32_t i = 0; i < num_lines; i++) {
+        for (int l = 0; l < NDP_POLICER_LINE_FLOWS; l++)
+            pol->lines[i].tokens[l] = pol->burst[0];
+    }
+    return pol;
+}
+
+void ndp_policer_destroy(struct ndp_policer *pol)
+{
+    if (pol)
+        ndp_mempool_unmap(pol->lines, pol->map_size);
+}
+
+int ndp_policer_set_profile(struct ndp_policer *pol, uint32_t id, uint64_t rate_bps,
+                            uint64_t burst_bytes)
+{
+    unsigned __int128 units = (unsigned __int128)rate_bps
+                              << (NDP_POLICER_FRAC_BITS + NDP_POLICER_TICK_SHIFT);
+    uint64_t rate, burst, cap;
+
+    if (id >= NDP_POLICER_MAX_PROFILES || !burst_bytes ||
+        burst_bytes >= 1ULL << (62 - NDP_POLICER_FRAC_BITS))
+        return -1;
+
+    // the kernel multiplies 32 bit halves: rates must fit 32 bits per tick
+    rate = (uint64_t)(units / ndp_tsc_hz());
+    if (!rate || rate > UINT32_MAX)
+        return -1;
+    burst = burst_bytes << NDP_POLICER_FRAC_BITS;
+    cap = (burst + rate - 1) / rate;
+
+    pol->rate[id] = rate;
+    pol->cap[id] = cap < UINT32_MAX ? cap : UINT32_MAX;
+    pol->burst[id] = burst;
+    return 0;
+}
+
+int ndp_policer_set_flow(struct ndp_policer *pol, uint32_t flow, uint32_t profile, uint64_t tsc)
+{
+    struct ndp_policer_line *line;
+    uint32_t lane = flow % NDP_POLICER_LINE_FLOWS;
+
+    if (flow >= pol->num_flows || profile >= NDP_POLICER_MAX_PROFILES || !pol->burst[profile])
+        return -1;
+
+    line = &pol->lines[flow / NDP_POLICER_LINE_FLOWS];
+    line->tokens[lane] = pol->burst[profile];
+    line->meta[lane] = (uint64_t)profile << NDP_POLICER_STAMP_BITS |
+                       ((tsc >> NDP_POLICER_TICK_SHIFT) & NDP_POLICER_STAMP_MASK);
+    return 0;
+}
+
+uint64_t ndp_policer_burst_scalar(struct ndp_policer *pol, const uint32_t *flows,
+                                  const uint32_t *lens, unsigned int n, uint64_t tsc)
+{
+    uint64_t pass = 0;
+
+    for (unsigned int i = 0; i < n; i++) {
+        if (ndp_policer_check(pol, flows[i], lens[i], tsc))
+            pass |= 1ULL << i;
+    }
+    return pass;
+}
+
+__attribute__((target("avx2")))
+static uint64_t burst_avx2(struct ndp_policer *pol, const uint32_t *flows, const uint32_t *lens,
+                           unsigned int n, uint64_t tsc)
+{
+    const long long *base = (const long long *)pol->lines;
+    uint64_t *words = (uint64_t *)pol->lines;
+    const __m256i stamp_mask = _mm256_set1_epi64x(NDP_POLICER_STAMP_MASK);
+    const __m256i ahead = _mm256_set1_epi64x(NDP_POLICER_STAMP_MASK - NDP_POLICER_SKEW_TICKS);
+    const __m256i now = _mm256_set1_epi64x((tsc >> NDP_POLICER_TICK_SHIFT) &
+                                           NDP_POLICER_STAMP_MASK);
+    uint64_t pass = 0;
+    unsigned int i;
+
+    for (i = 0; i < n && i < POLICER_PREFETCH; i++)
+        __builtin_prefetch(&pol->lines[flows[i] / NDP_POLICER_LINE_FLOWS], 1);
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128i f = _mm_loadu_si128((const __m128i *)(flows + i));
+
+        for (unsigned int j = i + POLICER_PREFETCH; j < n && j < i + POLICER_PREFETCH + 4; j++)
+            __builtin_prefetch(&pol->lines[flows[j] / NDP_POLICER_LINE_FLOWS], 1);
+
+        // the same flow twice in a step would lose one charge: do it in order
+        __m128i r1 = _mm_shuffle_epi32(f, _MM_SHUFFLE(0, 3, 2, 1));
+        __m128i r2 = _mm_shuffle_epi32(f, _MM_SHUFFLE(1, 0, 3, 2));
+        if (ndp_unlikely(!_mm_testz_si128(_mm_or_si128(_mm_cmpeq_epi32(f, r1),
+                                                       _mm_cmpeq_epi32(f, r2)),
+                                          _mm_set1_epi32(-1)))) {
+            pass |= ndp_policer_burst_scalar(pol, flows + i, lens + i, 4, tsc) << i;
+            continue;
+        }
+
+        // word offsets: line * 8 + lane for tokens, + 4 for meta
+        __m128i off_tok = _mm_add_epi32(_mm_slli_epi32(_mm_srli_epi32(f, 2), 3),
+                                        _mm_and_si128(f, _mm_set1_epi32(3)));
+        __m128i off_meta = _mm_add_epi32(off_tok, _mm_set1_epi32(4));
+        __m256i tok = _mm256_i32gather_epi64(base, off_tok, 8);
+        __m256i meta = _mm256_i32gather_epi64(base, off_meta, 8);
+        __m256i prof = _mm256_srli_epi64(meta, NDP_POLICER_STAMP_BITS);
+        __m256i rate = _mm256_i64gather_epi64((const long long *)pol->rate, prof, 8);
+        __m256i cap = _mm256_i64gather_epi64((const long long *)pol->cap, prof, 8);
+        __m256i burst = _mm256_i64gather_epi64((const long long *)pol->burst, prof, 8);
+        __m256i old = _mm256_and_si256(meta, stamp_mask);
+        __m256i dt = _mm256_and_si256(_mm256_sub_epi64(now, old), stamp_mask);
+        __m256i back = _mm256_cmpgt_epi64(dt, ahead);
+        __m256i need, red, stamp;
+
+        dt = _mm256_andnot_si256(back, dt);
+        dt = _mm256_blendv_epi8(dt, cap, _mm256_cmpgt_epi64(dt, cap));
+        tok = _mm256_add_epi64(tok, _mm256_mul_epu32(dt, rate));
+        tok = _mm256_blendv_epi8(tok, burst, _mm256_cmpgt_epi64(tok, burst));
+
+        need = _mm256_slli_epi64(_mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(lens + i))),
+                                 NDP_POLICER_FRAC_BITS);
+        red = _mm256_cmpgt_epi64(need, tok);
+        tok = _mm256_sub_epi64(tok, _mm256_andnot_si256(red, need));
+        stamp = _mm256_blendv_epi8(now, old, back);
+        meta = _mm256_or_si256(_mm256_andnot_si256(stamp_mask, meta), stamp);
+
+        words[_mm_extract_epi32(off_tok, 0)] = _mm256_extract_epi64(tok, 0);
+        words[_mm_extract_epi32(off_tok, 1)] = _mm256_extract_epi64(tok, 1);
+        words[_mm_extract_epi32(off_tok, 2)] = _mm256_extract_epi64(tok, 2);
+        words[_mm_extract_epi32(off_tok, 3)] = _mm256_extract_epi64(tok, 3);
+        words[_mm_extract_epi32(off_meta, 0)] = _mm256_extract_epi64(meta, 0);
+        words[_mm_extract_epi32(off_meta, 1)] = _mm256_extract_epi64(meta, 1);
+        words[_mm_extract_epi32(off_meta, 2)] = _mm256_extract_epi64(meta, 2);
+        words[_mm_extract_epi32(off_meta, 3)] = _mm256_extract_epi64(meta, 3);
+
+        pass |= (uint64_t)(~_mm256_movemask_pd(_mm256_castsi256_pd(red)) & 0xf) << i;
+    }
+    if (i < n)
+        pass |= ndp_policer_burst_scalar(pol, flows + i, lens + i, n - i, tsc) << i;
+    return pass;
+}
+
+static uint64_t burst_resolve(struct ndp_policer *pol, const uint32_t *flows,
+                              const uint32_t *lens, unsigned int n, uint64_t tsc)
+{
+    burst_impl = __builtin_cpu_supports("avx2") ? burst_avx2 : ndp_policer_burst_scalar;
+    return burst_impl(pol, flows, lens, n, tsc);
+}
+
+uint64_t ndp_policer_burst(struct ndp_policer *pol, const uint32_t *flows, const uint32_t *lens,
+                           unsigned int n, uint64_t tsc)
+{
+    return burst_impl(pol, flows, lens, n > POLICER_MAX_BURST ? POLICER_MAX_BURST : n, tsc);
+}
+
+uint16_t ndp_policer_filter(struct ndp_policer *pol, struct ndp_buf **bufs, const uint32_t *flows,
+                            uint16_t n, uint64_t tsc)
+{
+    struct ndp_buf *drop[POLICER_MAX_BURST];
+    uint32_t lens[POLICER_MAX_BURST];
+    uint16_t kept = 0, num_drop = 0;
+    uint64_t pass;
+
+    if (n > POLICER_MAX_BURST)
+        n = POLICER_MAX_BURST;
+    for (uint16_t i = 0; i < n; i++)
+        lens[i] = bufs[i]->pkt_len;
+
+    pass = ndp_policer_burst(pol, flows, lens, n, tsc);
+    for (uint16_t i = 0; i < n; i++) {
+        if (pass >> i & 1)
+            bufs[kept++] = bufs[i];
+        else
+            drop[num_drop++] = bufs[i];
+    }
+    if (num_drop)
+        ndp_buf_free_bulk(drop, num_drop);
+    return kept;
+}
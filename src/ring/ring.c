@@ -0,0 +1,119 @@
+/*******************************************************************************
+ * @file               ring.c
+ * @brief              Lock-free bounded rings for passing buffers between threads.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Rings are the hand-off point between dispatchers and
+ *                     workers.  The layout follows the familiar DPDK design:
+ *                     producer and consumer each keep a head (reserved) and a
+ *                     tail (published) index on their own cache line, a burst
+ *                     is reserved with one CAS (or a plain store for a single
+ *                     producer/consumer), copied, and published in order.
+ *                     The slot array is allocated on the consumer's node, the
+ *                     side that reads every entry.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "ring.h"
+
+
+struct ndp_ring *ndp_ring_create(struct mempool_sys *mem, int node, uint32_t count,
+                                 unsigned int flags)
+{
+    struct ndp_ring *r;
+
+    if (count < 2 || (count & (count - 1)))
+        return NULL;
+
+    r = ndp_mempool_alloc(mem, node, ndp_ring_memsize(count), NDP_CACHE_LINE);
+    if (!r || ndp_ring_init(r, node, count, flags) != 0)
+        return NULL;
+    return r;
+}
+
+int ndp_ring_init(struct ndp_ring *r, int node, uint32_t count, unsigned int flags)
+{
+    if (count < 2 || (count & (count - 1)))
+        return -1;
+
+    memset(r, 0, sizeof(*r));
+    r->size = count;
+    r->mask = count - 1;
+    r->node = node;
+    r->prod.single = flags & NDP_RING_SP_ENQ;
+    r->cons.single = flags & NDP_RING_SC_DEQ;
+    return 0;
+}
+
+/**
+ *  reserve up to n entries on one side of the ring
+ *
+ *  @param ht    - the side being moved (prod for enqueue, cons for dequeue)
+ *  @param other - the opposite side, whose tail bounds the reservation
+ *  @param space - for enqueue the ring capacity, for dequeue 0
+ */
+static inline unsigned int ring_reserve(struct ndp_ring_headtail *ht,
+                                        const struct ndp_ring_headtail *other,
+                                        uint32_t space, unsigned int n, uint32_t *old)
+{
+    uint32_t head = __atomic_load_n(&ht->head, __ATOMIC_RELAXED);
+    unsigned int avail;
+
+    do {
+        uint32_t other_tail = __atomic_load_n(&other->tail, __ATOMIC_ACQUIRE);
+        avail = space + other_tail - head;
+        if (n > avail)
+            n = avail;
+        if (!n)
+            return 0;
+        if (ht->single) {
+            ht->head = head + n;
+            break;
+        }
+    } while (!__atomic_compare_exchange_n(&ht->head, &head, head + n, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    *old = head;
+    return n;
+}
+
+static inline void ring_publish(struct ndp_ring_headtail *ht, uint32_t old, unsigned int n)
+{
+    // earlier reservations publish first so tail only ever covers filled slots
+    if (!ht->single) {
+        while (__atomic_load_n(&ht->tail, __ATOMIC_RELAXED) != old)
+            __builtin_ia32_pause();
+    }
+    __atomic_store_n(&ht->tail, old + n, __ATOMIC_RELEASE);
+}
+
+unsigned int ndp_ring_enqueue_burst(struct ndp_ring *r, void *const *objs, unsigned int n)
+{
+    uint32_t head;
+
+    if (!(n = ring_reserve(&r->prod, &r->cons, r->mask, n, &head)))
+        return 0;
+
+    for (unsigned int i = 0; i < n; i++)
+        r->slots[(head + i) & r->mask] = objs[i];
+
+    ring_publish(&r->prod, head, n);
+    return n;
+}
+
+unsigned int ndp_ring_dequeue_burst(struct ndp_ring *r, void **objs, unsigned int n)
+{
+    uint32_t head;
+
+    if (!(n = ring_reserve(&r->cons, &r->prod, 0, n, &head)))
+        return 0;
+
+    for (unsigned int i = 0; i < n; i++)
+        objs[i] = r->slots[(head + i) & r->mask];
+
+    ring_publish(&r->cons, head, n);
+    return n;
+}
@@ -0,0 +1,333 @@
+/*******************************************************************************
+ * @file               balance.c
+ * @brief              Load-driven rebalancing of the software RETA.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Every period the balancer turns the cumulative worker
+ *                     and bucket counters into a smoothed load per worker
+ *                     and a packet rate per bucket.  A bucket's share of its
+ *                     worker's load is taken as its share of the worker's
+ *                     packets, which is enough to pick buckets that move
+ *                     roughly half the gap between two workers.
+ *
+ *                     Moving a bucket is done in three steps on the
+ *                     dispatcher's thread: the RETA entry is set to
+ *                     NDP_RSS_RETA_HOLD and the old worker's ring position
+ *                     is recorded; once the worker has consumed past it and
+ *                     completed the poll round that did, the migrate
+ *                     callback runs and the entry points at the new worker;
+ *                     then the held packets are dispatched again, ahead of
+ *                     anything that arrives later.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "rss.h"
+
+#define DRAIN_NONE              0
+#define DRAIN_RING              1       /* waiting for the ring to pass the fence */
+#define DRAIN_ROUND             2       /* waiting for the poll round to finish */
+
+
+void ndp_rss_bal_params_default(struct ndp_rss_bal_params *p)
+{
+    p->period_ms = 100;
+    p->settle = 3;
+    p->cooldown = 20;
+    p->max_moves = 8;
+    p->alpha = 0.5;
+    p->high = 0.80;
+    p->margin = 0.15;
+    p->cross_margin = 0.30;
+    p->depth_weight = 1.0;
+    p->cross_node = true;
+}
+
+struct ndp_rss_balancer *ndp_rss_balancer_create(struct mempool_sys *mem, int node,
+                                                 struct ndp_rss_dispatch *d,
+                                                 const struct ndp_rss_bal_params *p,
+                                                 ndp_rss_migrate_fn migrate, void *arg)
+{
+    struct ndp_rss_balancer *bal;
+
+    if (d->hold) {
+        fprintf(stderr, "rss: dispatcher already has a balancer\n");
+        return NULL;
+    }
+    if (!(bal = ndp_mempool_alloc(mem, node, sizeof(*bal), NDP_CACHE_LINE)))
+        return NULL;
+    memset(bal, 0, sizeof(*bal));
+    if (p)
+        bal->p = *p;
+    else
+        ndp_rss_bal_params_default(&bal->p);
+    if (!bal->p.max_moves || bal->p.max_moves > NDP_RSS_BAL_MAX_MOVES)
+        bal->p.max_moves = NDP_RSS_BAL_MAX_MOVES;
+    if (bal->p.alpha <= 0.0 || bal->p.alpha > 1.0)
+        bal->p.alpha = 1.0;
+
+    if (!(bal->burst = ndp_burst_create(mem, node)))
+        return NULL;
+    if (!(d->hold = ndp_ring_create(mem, node, NDP_RSS_HOLD_SIZE,
+                                    NDP_RING_SP_ENQ | NDP_RING_SC_DEQ)))
+        return NULL;
+
+    bal->d = d;
+    bal->migrate = migrate;
+    bal->arg = arg;
+    bal->period = ndp_ns_to_tsc((uint64_t)bal->p.period_ms * 1000000);
+    bal->last_tsc = ndp_rdtsc();
+    bal->next_tsc = bal->last_tsc + bal->period;
+    for (unsigned int w = 0; w < d->num_workers; w++) {
+        bal->last_busy[w] = __atomic_load_n(&d->workers[w]->stats.busy_cycles, __ATOMIC_RELAXED);
+        bal->last_idle[w] = __atomic_load_n(&d->workers[w]->stats.idle_cycles, __ATOMIC_RELAXED);
+    }
+    memcpy(bal->last_pkts, d->bucket_pkts, sizeof(bal->last_pkts));
+    return bal;
+}
+
+static void bal_sample(struct ndp_rss_balancer *bal, uint64_t now)
+{
+    struct ndp_rss_dispatch *d = bal->d;
+    double a = bal->p.alpha;
+    double per_sec = (double)ndp_tsc_hz() / (double)(now - bal->last_tsc);
+
+    for (unsigned int w = 0; w < d->num_workers; w++) {
+        uint64_t busy = __atomic_load_n(&d->workers[w]->stats.busy_cycles, __ATOMIC_RELAXED);
+        uint64_t idle = __atomic_load_n(&d->workers[w]->stats.idle_cycles, __ATOMIC_RELAXED);
+        uint64_t db = busy - bal->last_busy[w], di = idle - bal->last_idle[w];
+        double util = db + di ? (double)db / (double)(db + di) : 0.0;
+        double fill = (double)ndp_ring_count(d->rings[w]) / (double)d->rings[w]->mask;
+
+        bal->load[w] = a * (util + bal->p.depth_weight * fill) + (1.0 - a) * bal->load[w];
+        bal->last_busy[w] = busy;
+        bal->last_idle[w] = idle;
+    }
+    for (unsigned int b = 0; b < NDP_RSS_RETA_SIZE; b++) {
+        uint64_t pkts = d->bucket_pkts[b];
+
+        bal->rate[b] = a * (double)(pkts - bal->last_pkts[b]) * per_sec +
+                       (1.0 - a) * bal->rate[b];
+        bal->last_pkts[b] = pkts;
+    }
+    bal->last_tsc = now;
+}
+
+/* least loaded worker, on `node` unless it is -1 */
+static int bal_least(const struct ndp_rss_balancer *bal, const double *est, int node)
+{
+    int best = -1;
+
+    for (unsigned int w = 0; w < bal->d->num_workers; w++) {
+        if (node >= 0 && bal->d->workers[w]->node != node)
+            continue;
+        if (best < 0 || est[w] < est[best])
+            best = w;
+    }
+    return best;
+}
+
+static void bal_plan(struct ndp_rss_balancer *bal)
+{
+    struct ndp_rss_dispatch *d = bal->d;
+    double est[NDP_RSS_MAX_WORKERS], wrate[NDP_RSS_MAX_WORKERS] = { 0 };
+    bool moving[NDP_RSS_RETA_SIZE] = { false };
+    unsigned int src = 0;
+    int dst;
+
+    memcpy(est, bal->load, sizeof(est[0]) * d->num_workers);
+    for (unsigned int b = 0; b < NDP_RSS_RETA_SIZE; b++)
+        wrate[d->reta[b]] += bal->rate[b];
+    for (unsigned int w = 1; w < d->num_workers; w++) {
+        if (est[w] > est[src])
+            src = w;
+    }
+
+    // hysteresis: act on an imbalance only once it has lasted `settle` periods
+    dst = bal_least(bal, est, -1);
+    if (est[src] <= bal->p.high || est[src] - est[dst] <= bal->p.margin) {
+        bal->over = 0;
+        return;
+    }
+    if (++bal->over < bal->p.settle)
+        return;
+    bal->over = 0;
+    bal->stats.triggers++;
+
+    while (bal->num_moves < bal->p.max_moves) {
+        int local, best = -1;
+        double share, gap, best_load = 0.0;
+
+        src = 0;
+        for (unsigned int w = 1; w < d->num_workers; w++) {
+            if (est[w] > est[src])
+                src = w;
+        }
+        if (est[src] <= bal->p.high || wrate[src] <= 0.0)
+            break;
+
+        // stay on the node (no flow state changes sockets) unless only
+        // another node has room
+        local = bal_least(bal, est, d->workers[src]->node);
+        dst = bal_least(bal, est, -1);
+        if (local >= 0 && (unsigned int)local != src && est[src] - est[local] > bal->p.margin)
+            dst = local;
+        else if (!bal->p.cross_node || est[src] - est[dst] <= bal->p.cross_margin)
+            break;
+
+        // the largest bucket that moves at most half the gap
+        share = est[src] / wrate[src];
+        gap = (est[src] - est[dst]) / 2.0;
+        for (unsigned int b = 0; b < NDP_RSS_RETA_SIZE; b++) {
+            double l = bal->rate[b] * share;
+
+            if (d->reta[b] != src || moving[b] || bal->frozen_until[b] > bal->round)
+                continue;
+            if (l > 0.0 && l <= gap && l > best_load) {
+                best = b;
+                best_load = l;
+            }
+        }
+        if (best < 0)
+            break;
+
+        moving[best] = true;
+        bal->move_bucket[bal->num_moves] = best;
+        bal->move_from[bal->num_moves] = src;
+        bal->move_to[bal->num_moves] = dst;
+        bal->num_moves++;
+        est[src] -= best_load;
+        est[dst] += best_load;
+        wrate[src] -= bal->rate[best];
+        wrate[dst] += bal->rate[best];
+    }
+}
+
+static void bal_hold(struct ndp_rss_balancer *bal)
+{
+    struct ndp_rss_dispatch *d = bal->d;
+
+    for (uint32_t m = 0; m < bal->num_moves; m++) {
+        uint16_t w = bal->move_from[m];
+
+        d->reta[bal->move_bucket[m]] = NDP_RSS_RETA_HOLD;
+        // the dispatcher runs on this thread, so nothing of the bucket is
+        // enqueued to w after this point
+        bal->fence[w] = __atomic_load_n(&d->rings[w]->prod.tail, __ATOMIC_ACQUIRE);
+        bal->drain[w] = DRAIN_RING;
+    }
+}
+
+static bool bal_drained(struct ndp_rss_balancer *bal)
+{
+    struct ndp_rss_dispatch *d = bal->d;
+    bool done = true;
+
+    for (unsigned int w = 0; w < d->num_workers; w++) {
+        struct ndp_worker *wk = d->workers[w];
+
+        if (bal->drain[w] == DRAIN_RING) {
+            uint32_t cons = __atomic_load_n(&d->rings[w]->cons.tail, __ATOMIC_ACQUIRE);
+
+            if ((int32_t)(cons - bal->fence[w]) < 0 &&
+                __atomic_load_n(&wk->running, __ATOMIC_ACQUIRE)) {
+                done = false;
+                continue;
+            }
+            bal->fence_loops[w] = __atomic_load_n(&wk->loops, __ATOMIC_ACQUIRE);
+            bal->drain[w] = DRAIN_ROUND;
+        }
+        if (bal->drain[w] == DRAIN_ROUND) {
+            // the round that dequeued the last packets is over once the
+            // loop count moves or the worker has gone idle
+            if (__atomic_load_n(&wk->loops, __ATOMIC_ACQUIRE) == bal->fence_loops[w] &&
+                __atomic_load_n(&wk->state, __ATOMIC_ACQUIRE) == NDP_WORKER_RUNNING &&
+                __atomic_load_n(&wk->running, __ATOMIC_ACQUIRE)) {
+                done = false;
+                continue;
+            }
+            bal->drain[w] = DRAIN_NONE;
+        }
+    }
+    return done;
+}
+
+static void bal_release(struct ndp_rss_balancer *bal)
+{
+    struct ndp_rss_dispatch *d = bal->d;
+    void *bufs[NDP_BURST_MAX];
+    unsigned int n;
+
+    for (uint32_t m = 0; m < bal->num_moves; m++) {
+        uint16_t b = bal->move_bucket[m];
+        struct ndp_worker *from = d->workers[bal->move_from[m]];
+        struct ndp_worker *to = d->workers[bal->move_to[m]];
+
+        bal->frozen_until[b] = bal->round + bal->p.cooldown;
+        if (bal->migrate && bal->migrate(b, from, to, bal->arg) != 0) {
+            d->reta[b] = bal->move_from[m];
+            bal->stats.vetoed++;
+            continue;
+        }
+        d->reta[b] = bal->move_to[m];
+        d->bucket_node[b] = to->node;
+        bal->stats.moves++;
+        if (from->node != to->node)
+            bal->stats.cross_moves++;
+    }
+    bal->num_moves = 0;
+
+    // held packets were counted once already
+    while ((n = ndp_ring_dequeue_burst(d->hold, bufs, NDP_BURST_MAX))) {
+        for (unsigned int i = 0; i < n; i++)
+            d->bucket_pkts[ndp_rss_bucket(((struct ndp_buf *)bufs[i])->hash)]--;
+        ndp_burst_gather(bal->burst, (struct ndp_buf **)bufs, n);
+        ndp_rss_dispatch_burst(d, bal->burst);
+    }
+}
+
+int ndp_rss_balancer_poll(void *arg)
+{
+    struct ndp_rss_balancer *bal = arg;
+    uint64_t now;
+
+    if (bal->num_moves) {
+        if (!bal_drained(bal))
+            return 0;
+        bal_release(bal);
+        return 1;
+    }
+
+    now = ndp_rdtsc();
+    if (now < bal->next_tsc)
+        return 0;
+    bal->next_tsc = now + bal->period;
+    bal->round++;
+    bal->stats.rounds++;
+
+    bal_sample(bal, now);
+    bal_plan(bal);
+    if (bal->num_moves)
+        bal_hold(bal);
+    return 1;
+}
+
+void ndp_rss_balancer_stats_report(const struct ndp_rss_balancer *bal, FILE *out)
+{
+    const struct ndp_rss_bal_stats *s = &bal->stats;
+    const struct ndp_rss_dispatch *d = bal->d;
+
+    fprintf(out, "rss balancer: %lu rounds, %lu triggered, %lu moves (%lu across nodes), "
+            "%lu vetoed, %lu held, %lu dropped while held\n", s->rounds, s->triggers, s->moves,
+            s->cross_moves, s->vetoed, d->held, d->hold_dropped);
+    for (unsigned int w = 0; w < d->num_workers; w++) {
+        unsigned int buckets = 0;
+
+        for (unsigned int b = 0; b < NDP_RSS_RETA_SIZE; b++)
+            buckets += d->reta[b] == w;
+        fprintf(out, "  worker %d (node %d): load %.2f, %u buckets\n", d->workers[w]->id,
+                d->workers[w]->node, bal->load[w], buckets);
+    }
+}
@@ -0,0 +1,147 @@
+/*******************************************************************************
+ * @file               dispatch.c
+ * @brief              Flow-to-worker dispatch through a software RETA.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            The dispatcher plays the part of the NIC's redirection
+ *                     table for software ports.  Each packet's Toeplitz hash
+ *                     selects one of NDP_RSS_RETA_SIZE buckets and the bucket
+ *                     selects a worker.  Flow state is partitioned by the same
+ *                     buckets, with each partition living on one node; the
+ *                     RETA only ever points a bucket at a worker of that node,
+ *                     so per-flow state is never touched across sockets.
+ *
+ *                     Packets are sorted per worker and enqueued with one
+ *                     ring operation per worker and burst.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "rss.h"
+
+
+int ndp_rss_dispatch_init(struct ndp_rss_dispatch *d, const struct ndp_rss_key *key,
+                          struct ndp_worker **workers, struct ndp_ring **rings,
+                          unsigned int n, const int16_t *bucket_node)
+{
+    int nodes[NDP_RSS_MAX_WORKERS];
+    int num_nodes = 0;
+
+    if (!n || n > NDP_RSS_MAX_WORKERS)
+        return -1;
+
+    memset(d, 0, sizeof(*d));
+    d->key = key;
+    d->num_workers = n;
+    for (unsigned int i = 0; i < n; i++) {
+        d->workers[i] = workers[i];
+        d->rings[i] = rings[i];
+
+        bool seen = false;
+        for (int j = 0; j < num_nodes; j++)
+            seen |= nodes[j] == workers[i]->node;
+        if (!seen)
+            nodes[num_nodes++] = workers[i]->node;
+    }
+
+    for (unsigned int b = 0; b < NDP_RSS_RETA_SIZE; b++)
+        d->bucket_node[b] = bucket_node ? bucket_node[b] : nodes[b % num_nodes];
+
+    ndp_rss_dispatch_fill_reta(d);
+    return 0;
+}
+
+void ndp_rss_dispatch_fill_reta(struct ndp_rss_dispatch *d)
+{
+    unsigned int placed[NDP_RSS_MAX_WORKERS] = { 0 };
+
+    // give each bucket the least loaded worker of its node, which spreads
+    // a node's buckets evenly over its workers
+    for (unsigned int b = 0; b < NDP_RSS_RETA_SIZE; b++) {
+        int node = d->bucket_node[b];
+        int best = -1;
+
+        for (unsigned int w = 0; w < d->num_workers; w++) {
+            if (d->workers[w]->node != node)
+                continue;
+            if (best < 0 || placed[w] < placed[best])
+                best = w;
+        }
+
+        // a node without workers still needs its buckets served
+        if (best < 0)
+            best = b % d->num_workers;
+        d->reta[b] = best;
+        placed[best]++;
+    }
+}
+
+unsigned int ndp_rss_dispatch_burst(struct ndp_rss_dispatch *d, struct ndp_burst *b)
+{
+    void *sorted[NDP_BURST_MAX];
+    uint16_t owner[NDP_BURST_MAX];
+    uint16_t first[NDP_RSS_MAX_WORKERS + 2];
+    uint16_t fill[NDP_RSS_MAX_WORKERS + 1];
+    unsigned int nw = d->num_workers;
+    unsigned int sent = 0;
+    bool hashed = true;
+
+    if (!b->count)
+        return 0;
+
+    for (uint16_t i = 0; i < b->count && hashed; i++)
+        hashed = b->flags[i] & NDP_BUF_F_HASH;
+    if (!hashed)
+        ndp_rss_hash_burst(d->key, b);
+
+    // counting sort by worker keeps per-worker order and needs one pass;
+    // held buckets sort into an extra slot after the last worker
+    memset(first, 0, sizeof(first[0]) * (nw + 2));
+    for (uint16_t i = 0; i < b->count; i++) {
+        uint32_t bucket = ndp_rss_bucket(b->hash[i]);
+
+        owner[i] = d->reta[bucket] < nw ? d->reta[bucket] : nw;
+        first[owner[i] + 1]++;
+        d->bucket_pkts[bucket]++;
+        b->bufs[i]->hash = b->hash[i];
+        b->bufs[i]->flags = b->flags[i];
+    }
+    for (unsigned int w = 0; w <= nw; w++) {
+        first[w + 1] += first[w];
+        fill[w] = first[w];
+    }
+    for (uint16_t i = 0; i < b->count; i++)
+        sorted[fill[owner[i]]++] = b->bufs[i];
+
+    for (unsigned int w = 0; w < nw; w++) {
+        unsigned int cnt = first[w + 1] - first[w];
+        if (!cnt)
+            continue;
+
+        unsigned int n = ndp_ring_enqueue_burst(d->rings[w], &sorted[first[w]], cnt);
+        if (n < cnt) {
+            ndp_buf_free_bulk((struct ndp_buf **)&sorted[first[w] + n], cnt - n);
+            d->dropped[w] += cnt - n;
+        }
+        if (n) {
+            d->enqueued[w] += n;
+            ndp_worker_wake(d->workers[w]);
+        }
+        sent += n;
+    }
+
+    if (first[nw + 1] > first[nw]) {
+        unsigned int cnt = first[nw + 1] - first[nw];
+        unsigned int n = d->hold ? ndp_ring_enqueue_burst(d->hold, &sorted[first[nw]], cnt) : 0;
+
+        if (n < cnt) {
+            ndp_buf_free_bulk((struct ndp_buf **)&sorted[first[nw] + n], cnt - n);
+            d->hold_dropped += cnt - n;
+        }
+        d->held += n;
+        sent += n;
+    }
+    return sent;
+}
@@ -0,0 +1,170 @@
+/*******************************************************************************
+ * @file               toeplitz.c
+ * @brief              Software Toeplitz RSS hash, table driven and vectorised.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Software ports have no NIC to compute RSS, so flows are
+ *                     spread with the same Toeplitz hash in software.  The
+ *                     result is bit-compatible with hardware RSS for the same
+ *                     key and input, so a software and a hardware port agree
+ *                     on which bucket a flow belongs to.
+ *
+ *                     Instead of walking the input bit by bit, the key is
+ *                     expanded into one 256-entry table per input byte; the
+ *                     hash of a 12-byte IPv4 tuple is then 12 lookups.  The
+ *                     AVX2 path hashes 8 flows at once with one gather per
+ *                     input byte; the tables of an IPv4 tuple are 12 KiB and
+ *                     stay in L1.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "rss.h"
+
+#include <immintrin.h>
+
+
+const uint8_t ndp_rss_default_key[NDP_RSS_KEY_LEN] = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+    0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+    0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+    0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+    0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+static void hash_v4_resolve(const struct ndp_rss_key *, const struct ndp_rss_v4 *,
+                            uint32_t *, unsigned int);
+
+static void (*hash_v4_impl)(const struct ndp_rss_key *, const struct ndp_rss_v4 *,
+                            uint32_t *, unsigned int) = hash_v4_resolve;
+
+
+/* 32-bit window of the key starting at bit `bit` */
+static uint32_t key_window(const uint8_t *key, unsigned int bit)
+{
+    uint64_t w = 0;
+    unsigned int byte = bit / 8;
+
+    for (unsigned int i = 0; i < 5; i++)
+        w = (w << 8) | (byte + i < NDP_RSS_KEY_LEN ? key[byte + i] : 0);
+    return (uint32_t)(w >> (8 - bit % 8));
+}
+
+uint32_t ndp_toeplitz_ref(const uint8_t *key, const uint8_t *in, unsigned int len)
+{
+    uint32_t h = 0;
+
+    for (unsigned int i = 0; i < len * 8; i++) {
+        if (in[i / 8] & (0x80 >> (i % 8)))
+            h ^= key_window(key, i);
+    }
+    return h;
+}
+
+void ndp_rss_key_init(struct ndp_rss_key *k, const uint8_t *key)
+{
+    memcpy(k->key, key ? key : ndp_rss_default_key, NDP_RSS_KEY_LEN);
+
+    for (unsigned int p = 0; p < NDP_RSS_V6_LEN; p++) {
+        uint32_t bits[8];
+        for (unsigned int b = 0; b < 8; b++)
+            bits[b] = key_window(k->key, p * 8 + b);
+        for (unsigned int v = 0; v < 256; v++) {
+            uint32_t h = 0;
+            for (unsigned int b = 0; b < 8; b++) {
+                if (v & (0x80 >> b))
+                    h ^= bits[b];
+            }
+            k->tbl[p][v] = h;
+        }
+    }
+}
+
+static void hash_v4_scalar(const struct ndp_rss_key *k, const struct ndp_rss_v4 *t,
+                           uint32_t *hash, unsigned int n)
+{
+    for (unsigned int i = 0; i < n; i++)
+        hash[i] = ndp_toeplitz(k, (const uint8_t *)&t[i], NDP_RSS_V4_LEN);
+}
+
+/**
+ *  8 flows per iteration: load dword d of each tuple into a lane (gather
+ *  with a 12 byte stride), then for each of its 4 bytes gather the table
+ *  entry of that byte position and xor it into the lane's hash.
+ */
+__attribute__((target("avx2")))
+static void hash_v4_avx2(const struct ndp_rss_key *k, const struct ndp_rss_v4 *t,
+                         uint32_t *hash, unsigned int n)
+{
+    const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i byte = _mm256_set1_epi32(0xff);
+    unsigned int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const int *base = (const int *)&t[i];
+        __m256i h = _mm256_setzero_si256();
+
+        for (int d = 0; d < 3; d++) {
+            __m256i w = _mm256_i32gather_epi32(base + d, stride, 4);
+            for (int b = 0; b < 4; b++) {
+                __m256i v = _mm256_and_si256(_mm256_srli_epi32(w, 8 * b), byte);
+                __m256i e = _mm256_i32gather_epi32((const int *)k->tbl[d * 4 + b], v, 4);
+                h = _mm256_xor_si256(h, e);
+            }
+        }
+        _mm256_storeu_si256((__m256i *)&hash[i], h);
+    }
+    hash_v4_scalar(k, t + i, hash + i, n - i);
+}
+
+static void hash_v4_resolve(const struct ndp_rss_key *k, const struct ndp_rss_v4 *t,
+                            uint32_t *hash, unsigned int n)
+{
+    hash_v4_impl = __builtin_cpu_supports("avx2") ? hash_v4_avx2 : hash_v4_scalar;
+    hash_v4_impl(k, t, hash, n);
+}
+
+void ndp_rss_hash_v4_bulk(const struct ndp_rss_key *k, const struct ndp_rss_v4 *t,
+                          uint32_t *hash, unsigned int n)
+{
+    hash_v4_impl(k, t, hash, n);
+}
+
+void ndp_rss_hash_burst(const struct ndp_rss_key *k, struct ndp_burst *b)
+{
+    struct ndp_rss_v4 tuples[NDP_BURST_MAX];
+    uint32_t hash[NDP_BURST_MAX];
+    uint16_t idx[NDP_BURST_MAX];
+    uint16_t n = 0;
+
+    for (uint16_t i = 0; i < b->count; i++) {
+        if (!(b->flags[i] & NDP_BUF_F_IPV4)) {
+            b->hash[i] = 0;
+            continue;
+        }
+
+        // saddr and daddr are adjacent at offset 12 of the IPv4 header
+        const uint8_t *ip = b->data[i] + b->l3_off[i];
+        struct ndp_rss_v4 *t = &tuples[n];
+        memcpy(&t->src, ip + 12, 8);
+        if ((b->flags[i] & (NDP_BUF_F_TCP | NDP_BUF_F_UDP)) &&
+            !(b->flags[i] & NDP_BUF_F_FRAG)) {
+            memcpy(&t->sport, b->data[i] + b->l4_off[i], 4);
+        } else {
+            t->sport = 0;
+            t->dport = 0;
+        }
+        idx[n++] = i;
+    }
+
+    // zero ports add nothing to a Toeplitz hash, so the padded 12 byte
+    // input gives exactly the 8 byte 2-tuple hash a NIC would compute
+    ndp_rss_hash_v4_bulk(k, tuples, hash, n);
+
+    for (uint16_t j = 0; j < n; j++) {
+        b->hash[idx[j]] = hash[j];
+        b->flags[idx[j]] |= NDP_BUF_F_HASH;
+    }
+}
@@ -0,0 +1,321 @@
+/*******************************************************************************
+ * @file               merge.c
+ * @brief              Lock-free merge of worker sketches into a shared view.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Each period the merger takes every worker's idle bank
+ *                     (the one the worker acknowledged leaving), adds its
+ *                     counters into the sum eight at a time with saturating
+ *                     AVX2 adds, collects the keys of its table, clears it
+ *                     and asks the worker to switch.  Clearing happens here,
+ *                     off the data path.  The keys are then re-estimated
+ *                     against the sum, since a talker spread over workers
+ *                     by RSS is only heavy in total.
+ *
+ *                     The view is published under a sequence count; any
+ *                     process can map the segment read-only and copy a
+ *                     snapshot with ndp_hh_view_read().
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "sketch.h"
+
+#include <fcntl.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <immintrin.h>
+
+static void add_resolve(uint32_t *, const uint32_t *, size_t);
+
+static void (*add_impl)(uint32_t *, const uint32_t *, size_t) = add_resolve;
+
+
+static void cm_add_scalar(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint32_t v = dst[i] + src[i];
+        dst[i] = v | -(uint32_t)(v < src[i]);
+    }
+}
+
+__attribute__((target("avx2")))
+static void cm_add_avx2(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    const __m256i ones = _mm256_set1_epi32(-1);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)&dst[i]);
+        __m256i b = _mm256_loadu_si256((const __m256i *)&src[i]);
+        __m256i s = _mm256_add_epi32(a, b);
+        // no carry out iff s >= b, unsigned; saturate the lanes that carried
+        __m256i ok = _mm256_cmpeq_epi32(_mm256_max_epu32(s, b), s);
+        _mm256_storeu_si256((__m256i *)&dst[i], _mm256_or_si256(s, _mm256_xor_si256(ok, ones)));
+    }
+    cm_add_scalar(dst + i, src + i, n - i);
+}
+
+static void add_resolve(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    add_impl = __builtin_cpu_supports("avx2") ? cm_add_avx2 : cm_add_scalar;
+    add_impl(dst, src, n);
+}
+
+struct ndp_hh_merger *ndp_hh_merger_create(struct mempool_sys *mem, int node, const char *name,
+                                           uint32_t width, uint32_t k, uint32_t period_ms)
+{
+    const size_t max_cands = (size_t)NDP_HH_MAX_WORKERS * NDP_HH_MAX_TOP;
+    const size_t line = NDP_CACHE_LINE;
+    size_t cm_size = align_up((size_t)NDP_HH_ROWS * width * sizeof(uint32_t), line);
+    size_t cand_size = align_up(max_cands * sizeof(struct ndp_hh_cand), line);
+    struct ndp_hh_merger *m;
+    int fd = -1;
+
+    if (width < 64 || (width & (width - 1)) || !k || k > NDP_HH_MAX_TOP || !period_ms)
+        return NULL;
+    if (!(m = ndp_mempool_alloc(mem, node, sizeof(*m), NDP_CACHE_LINE)))
+        return NULL;
+
+    memset(m, 0, sizeof(*m));
+    m->width = width;
+    m->shift = __builtin_clz(width) + 1;
+    m->k = k;
+    m->node = node;
+    m->map_size = cm_size + cand_size + 2 * max_cands * sizeof(uint32_t);
+    if (!(m->map = ndp_mempool_map_huge(m->map_size, node)))
+        return NULL;
+    m->cm = m->map;
+    m->cands = (struct ndp_hh_cand *)((uint8_t *)m->map + cm_size);
+    m->cand_index = (uint32_t *)((uint8_t *)m->map + cm_size + cand_size);
+
+    m->view_size = sizeof(*m->view);
+    if (name) {
+        if ((fd = shm_open(name, O_CREAT | O_RDWR, 0644)) < 0 ||
+            ftruncate(fd, m->view_size)) {
+            perror("hh view");
+            goto err;
+        }
+        m->view = mmap(NULL, m->view_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+    } else {
+        m->view = mmap(NULL, m->view_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+    if (m->view == MAP_FAILED) {
+        perror("hh view mmap");
+        m->view = NULL;
+        goto err;
+    }
+
+    memset(m->view, 0, m->view_size);
+    m->view->magic = NDP_HH_VIEW_MAGIC;
+    m->period = ndp_ns_to_tsc((uint64_t)period_ms * 1000000);
+    m->last_tsc = ndp_rdtsc();
+    m->next_tsc = m->last_tsc + m->period;
+    return m;
+
+err:
+    if (fd >= 0)
+        close(fd);
+    ndp_mempool_unmap(m->map, m->map_size);
+    return NULL;
+}
+
+void ndp_hh_merger_destroy(struct ndp_hh_merger *m)
+{
+    if (!m)
+        return;
+    if (m->view)
+        munmap(m->view, m->view_size);
+    ndp_mempool_unmap(m->map, m->map_size);
+}
+
+int ndp_hh_merger_add(struct ndp_hh_merger *m, struct ndp_hh *hh)
+{
+    uint32_t size = 2;
+
+    if (m->num_workers == NDP_HH_MAX_WORKERS || hh->width != m->width)
+        return -1;
+    m->workers[m->num_workers++] = hh;
+
+    // candidate index at most half full with every table full
+    while (size < 2 * m->num_workers * NDP_HH_MAX_TOP)
+        size <<= 1;
+    m->cand_mask = size - 1;
+    return 0;
+}
+
+static void cand_add(struct ndp_hh_merger *m, uint32_t *num, const struct ndp_hh_entry *e)
+{
+    uint32_t i = e->hash & m->cand_mask;
+    uint32_t slot;
+
+    while ((slot = m->cand_index[i])) {
+        const struct ndp_hh_cand *c = &m->cands[slot - 1];
+        if (c->hash == e->hash && !memcmp(&c->key, &e->key, sizeof(c->key)))
+            return;
+        i = (i + 1) & m->cand_mask;
+    }
+    m->cands[*num].key = e->key;
+    m->cands[*num].hash = e->hash;
+    m->cand_index[i] = ++*num;
+}
+
+static int cand_cmp(const void *a, const void *b)
+{
+    const struct ndp_hh_cand *x = a, *y = b;
+
+    return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+int ndp_hh_merger_poll(void *arg)
+{
+    struct ndp_hh_merger *m = arg;
+    struct ndp_hh_view *v = m->view;
+    size_t cells = (size_t)NDP_HH_ROWS * m->width;
+    uint64_t now = ndp_rdtsc(), total = 0;
+    uint32_t num = 0, contributed = 0, seq;
+    struct timespec ts;
+
+    if (now < m->next_tsc)
+        return 0;
+    m->next_tsc = now + m->period;
+
+    memset(m->cm, 0, cells * sizeof(uint32_t));
+    memset(m->cand_index, 0, (m->cand_mask + 1) * sizeof(uint32_t));
+    for (unsigned int w = 0; w < m->num_workers; w++) {
+        struct ndp_hh *hh = m->workers[w];
+        uint32_t cur = __atomic_load_n(&hh->cur, __ATOMIC_ACQUIRE);
+        struct ndp_hh_bank *bk = &hh->banks[cur ^ 1];
+
+        // still on the bank of an earlier request: no burst since
+        if (cur != __atomic_load_n(&hh->req, __ATOMIC_RELAXED))
+            continue;
+
+        add_impl(m->cm, bk->cm, cells);
+        total += bk->total;
+        for (uint32_t i = 0; i < bk->num_top; i++)
+            cand_add(m, &num, &bk->top[i]);
+
+        memset(bk->cm, 0, cells * sizeof(uint32_t));
+        memset(bk->index, 0, sizeof(bk->index));
+        bk->num_top = 0;
+        bk->total = 0;
+        __atomic_store_n(&hh->req, cur ^ 1, __ATOMIC_RELEASE);
+        contributed++;
+    }
+
+    for (uint32_t c = 0; c < num; c++) {
+        uint32_t est = UINT32_MAX;
+        for (int d = 0; d < NDP_HH_ROWS; d++) {
+            uint32_t cnt = m->cm[(size_t)d * m->width + ndp_hh_row(m->cands[c].hash, d, m->shift)];
+            est = cnt < est ? cnt : est;
+        }
+        m->cands[c].bytes = est;
+    }
+    qsort(m->cands, num, sizeof(m->cands[0]), cand_cmp);
+    if (num > m->k)
+        num = m->k;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    seq = v->seq;
+    __atomic_store_n(&v->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    v->stamp_ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    v->window_ns = ndp_tsc_to_ns(now - m->last_tsc);
+    v->total = total;
+    v->num_workers = contributed;
+    v->num = num;
+    for (uint32_t i = 0; i < num; i++) {
+        v->top[i].key = m->cands[i].key;
+        v->top[i].bytes = m->cands[i].bytes;
+    }
+    __atomic_store_n(&v->seq, seq + 2, __ATOMIC_RELEASE);
+
+    m->last_tsc = now;
+    return 1;
+}
+
+const struct ndp_hh_view *ndp_hh_view_open(const char *name)
+{
+    struct ndp_hh_view *v;
+    int fd = shm_open(name, O_RDONLY, 0);
+
+    if (fd < 0) {
+        perror("hh view open");
+        return NULL;
+    }
+    v = mmap(NULL, sizeof(*v), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (v == MAP_FAILED) {
+        perror("hh view mmap");
+        return NULL;
+    }
+    if (v->magic != NDP_HH_VIEW_MAGIC) {
+        fprintf(stderr, "hh view %s: bad magic\n", name);
+        munmap(v, sizeof(*v));
+        return NULL;
+    }
+    return v;
+}
+
+void ndp_hh_view_close(const struct ndp_hh_view *v)
+{
+    if (v)
+        munmap((void *)v, sizeof(*v));
+}
+
+void ndp_hh_view_read(const struct ndp_hh_view *v, struct ndp_hh_view *out)
+{
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&v->seq, __ATOMIC_ACQUIRE);
+
+        if (seq & 1) {
+            __builtin_ia32_pause();
+            continue;
+        }
+        memcpy(out, v, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&v->seq, __ATOMIC_RELAXED) == seq)
+            return;
+    }
+}
+
+static void key_format(const struct ndp_hh_key *k, char *buf, size_t len)
+{
+    int af = k->version == 4 ? AF_INET : AF_INET6;
+    char src[INET6_ADDRSTRLEN], dst[INET6_ADDRSTRLEN];
+
+    inet_ntop(af, k->src, src, sizeof(src));
+    if (!k->proto) {
+        snprintf(buf, len, "%s", src);
+        return;
+    }
+    inet_ntop(af, k->dst, dst, sizeof(dst));
+    snprintf(buf, len, "%s:%u > %s:%u proto %u", src, ntohs(k->sport), dst, ntohs(k->dport),
+             k->proto);
+}
+
+void ndp_hh_view_report(const struct ndp_hh_view *v, unsigned int n, FILE *out)
+{
+    struct ndp_hh_view *snap = malloc(sizeof(*snap));
+    char key[128];
+    double secs;
+
+    if (!snap)
+        return;
+    ndp_hh_view_read(v, snap);
+    secs = snap->window_ns ? snap->window_ns / 1e9 : 1.0;
+    fprintf(out, "top talkers: %.1f ms window, %lu bytes from %u workers\n",
+            snap->window_ns / 1e6, snap->total, snap->num_workers);
+    for (uint32_t i = 0; i < snap->num && i < n; i++) {
+        key_format(&snap->top[i].key, key, sizeof(key));
+        fprintf(out, "  %-48s %12lu B %10.2f Mbit/s %5.1f%%\n", key, snap->top[i].bytes,
+                snap->top[i].bytes * 8 / secs / 1e6,
+                snap->total ? 100.0 * snap->top[i].bytes / snap->total : 0.0);
+    }
+    free(snap);
+}
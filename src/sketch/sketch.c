@@ -0,0 +1,340 @@
+/*******************************************************************************
+ * @file               sketch.c
+ * @brief              Per-worker count-min sketch and top-k table.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            A burst is counted in three passes: keys are pulled
+ *                     out of the parsed headers into a dense array, hashed
+ *                     (eight keys per step with AVX2: gathers over the key
+ *                     array, then the row hashes of all eight at once), and
+ *                     the counters updated with the rows of packets a few
+ *                     ahead prefetched.  Counters saturate instead of
+ *                     wrapping, so an estimate never goes down.
+ *
+ *                     The table is only touched for a packet whose estimate
+ *                     beats the smallest entry, which after warm-up is the
+ *                     heavy flows themselves and little else.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "sketch.h"
+#include "net.h"
+
+#include <immintrin.h>
+
+#define HH_KEY_WORDS            (sizeof(struct ndp_hh_key) / sizeof(uint32_t))
+#define HH_HASH_INIT            0x811c9dc5
+#define HH_HASH_MUL             0x9e3779b1
+#define HH_PREFETCH             8       /* packets ahead */
+#define HH_POS_MASK             0xffff
+
+static void hash_resolve(struct ndp_hh *, uint16_t);
+
+static void (*hash_impl)(struct ndp_hh *, uint16_t) = hash_resolve;
+
+
+static inline uint32_t key_hash(const struct ndp_hh_key *k)
+{
+    uint32_t w[HH_KEY_WORDS], h = HH_HASH_INIT;
+
+    memcpy(w, k, sizeof(w));
+    for (size_t i = 0; i < HH_KEY_WORDS; i++) {
+        h = (h ^ w[i]) * HH_HASH_MUL;
+        h ^= h >> 15;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    return h ^ (h >> 16);
+}
+
+void ndp_hh_hash_scalar(struct ndp_hh *hh, uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++) {
+        uint32_t h = key_hash(&hh->keys[i]);
+        hh->hashes[i] = h;
+        for (int d = 0; d < NDP_HH_ROWS; d++)
+            hh->rows[d][i] = ndp_hh_row(h, d, hh->shift);
+    }
+}
+
+__attribute__((target("avx2")))
+void ndp_hh_hash_avx2(struct ndp_hh *hh, uint16_t n)
+{
+    const __m256i stride = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                              _mm256_set1_epi32(HH_KEY_WORDS));
+    const __m256i mul = _mm256_set1_epi32(HH_HASH_MUL);
+    const __m128i shift = _mm_cvtsi32_si128(hh->shift);
+    const int *words = (const int *)hh->keys;
+    uint16_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i idx = _mm256_add_epi32(stride, _mm256_set1_epi32(i * HH_KEY_WORDS));
+        __m256i h = _mm256_set1_epi32(HH_HASH_INIT);
+
+        // word j of eight keys per gather
+        for (size_t j = 0; j < HH_KEY_WORDS; j++) {
+            __m256i w = _mm256_i32gather_epi32(words, idx, 4);
+            h = _mm256_mullo_epi32(_mm256_xor_si256(h, w), mul);
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+            idx = _mm256_add_epi32(idx, _mm256_set1_epi32(1));
+        }
+        h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+        h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x85ebca6b));
+        h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+        h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0xc2b2ae35));
+        h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+        _mm256_storeu_si256((__m256i *)&hh->hashes[i], h);
+
+        for (int d = 0; d < NDP_HH_ROWS; d++) {
+            __m256i r = _mm256_xor_si256(h, _mm256_set1_epi32(ndp_hh_seed[d]));
+            r = _mm256_mullo_epi32(r, _mm256_set1_epi32(ndp_hh_mul[d]));
+            _mm256_storeu_si256((__m256i *)&hh->rows[d][i], _mm256_srl_epi32(r, shift));
+        }
+    }
+    for (; i < n; i++) {
+        uint32_t h = key_hash(&hh->keys[i]);
+        hh->hashes[i] = h;
+        for (int d = 0; d < NDP_HH_ROWS; d++)
+            hh->rows[d][i] = ndp_hh_row(h, d, hh->shift);
+    }
+}
+
+static void hash_resolve(struct ndp_hh *hh, uint16_t n)
+{
+    hash_impl = __builtin_cpu_supports("avx2") ? ndp_hh_hash_avx2 : ndp_hh_hash_scalar;
+    hash_impl(hh, n);
+}
+
+struct ndp_hh *ndp_hh_create(struct mempool_sys *mem, int node, uint32_t width, uint32_t k,
+                             int mode)
+{
+    struct ndp_hh *hh;
+    size_t row_size = (size_t)NDP_HH_ROWS * width;
+
+    if (width < 64 || width > (1U << 24) || (width & (width - 1)) || !k || k > NDP_HH_MAX_TOP)
+        return NULL;
+    if (!(hh = ndp_mempool_alloc(mem, node, sizeof(*hh), NDP_CACHE_LINE)))
+        return NULL;
+
+    memset(hh, 0, sizeof(*hh));
+    hh->width = width;
+    hh->shift = __builtin_clz(width) + 1;
+    hh->k = k;
+    hh->mode = mode;
+    hh->node = node;
+    hh->map_size = 2 * row_size * sizeof(uint32_t);
+    if (!(hh->map = ndp_mempool_map_huge(hh->map_size, node)))
+        return NULL;
+
+    // zeroing faults both banks in on the node
+    memset(hh->map, 0, hh->map_size);
+    hh->banks[0].cm = hh->map;
+    hh->banks[1].cm = (uint32_t *)hh->map + row_size;
+    hh->bank = &hh->banks[0];
+    return hh;
+}
+
+void ndp_hh_destroy(struct ndp_hh *hh)
+{
+    if (hh)
+        ndp_mempool_unmap(hh->map, hh->map_size);
+}
+
+static bool key_of(const struct ndp_hh *hh, const struct ndp_burst *b, uint16_t i,
+                   struct ndp_hh_key *k)
+{
+    uint32_t f = b->flags[i];
+    const uint8_t *l3 = b->data[i] + b->l3_off[i];
+
+    memset(k, 0, sizeof(*k));
+    if (f & NDP_BUF_F_IPV4) {
+        const struct ndp_ipv4_hdr *ip = (const struct ndp_ipv4_hdr *)l3;
+        k->src[0] = ip->src;
+        k->dst[0] = ip->dst;
+        k->proto = ip->proto;
+        k->version = 4;
+    } else if (f & NDP_BUF_F_IPV6) {
+        const struct ndp_ipv6_hdr *ip = (const struct ndp_ipv6_hdr *)l3;
+        memcpy(k->src, ip->src, sizeof(k->src));
+        memcpy(k->dst, ip->dst, sizeof(k->dst));
+        k->proto = ip->proto;
+        k->version = 6;
+    } else {
+        return false;
+    }
+
+    if (hh->mode == NDP_HH_KEY_SRC) {
+        memset(k->dst, 0, sizeof(k->dst));
+        k->proto = 0;
+    } else if ((f & (NDP_BUF_F_TCP | NDP_BUF_F_UDP)) && !(f & NDP_BUF_F_FRAG)) {
+        // both headers start with the ports
+        const struct ndp_udp_hdr *l4 = (const struct ndp_udp_hdr *)(b->data[i] + b->l4_off[i]);
+        k->sport = l4->sport;
+        k->dport = l4->dport;
+    }
+    return true;
+}
+
+static int top_find(const struct ndp_hh_bank *bk, const struct ndp_hh_key *key, uint32_t hash)
+{
+    uint32_t i = hash & (NDP_HH_INDEX - 1);
+    uint32_t slot;
+
+    while ((slot = bk->index[i])) {
+        uint32_t pos = (slot & HH_POS_MASK) - 1;
+        if (!((slot ^ hash) & ~HH_POS_MASK) && !memcmp(&bk->top[pos].key, key, sizeof(*key)))
+            return pos;
+        i = (i + 1) & (NDP_HH_INDEX - 1);
+    }
+    return -1;
+}
+
+static void top_index_add(struct ndp_hh_bank *bk, uint32_t pos)
+{
+    uint32_t i = bk->top[pos].hash & (NDP_HH_INDEX - 1);
+
+    while (bk->index[i])
+        i = (i + 1) & (NDP_HH_INDEX - 1);
+    bk->index[i] = (bk->top[pos].hash & ~HH_POS_MASK) | (pos + 1);
+    bk->top[pos].slot = i;
+}
+
+/* backward-shift deletion, keeping the entries' slot numbers right */
+static void top_index_del(struct ndp_hh_bank *bk, uint32_t i)
+{
+    const uint32_t mask = NDP_HH_INDEX - 1;
+
+    bk->index[i] = 0;
+    for (uint32_t j = (i + 1) & mask; bk->index[j]; j = (j + 1) & mask) {
+        uint32_t pos = (bk->index[j] & HH_POS_MASK) - 1;
+        uint32_t home = bk->top[pos].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            bk->index[i] = bk->index[j];
+            bk->index[j] = 0;
+            bk->top[pos].slot = i;
+            i = j;
+        }
+    }
+}
+
+static inline void top_set_pos(struct ndp_hh_bank *bk, uint32_t pos)
+{
+    bk->index[bk->top[pos].slot] = (bk->top[pos].hash & ~HH_POS_MASK) | (pos + 1);
+}
+
+static void top_swap(struct ndp_hh_bank *bk, uint32_t a, uint32_t b)
+{
+    struct ndp_hh_entry tmp = bk->top[a];
+
+    bk->top[a] = bk->top[b];
+    bk->top[b] = tmp;
+    top_set_pos(bk, a);
+    top_set_pos(bk, b);
+}
+
+static void top_sift_down(struct ndp_hh_bank *bk, uint32_t pos)
+{
+    for (;;) {
+        uint32_t c = 2 * pos + 1, min = pos;
+        if (c < bk->num_top && bk->top[c].count < bk->top[min].count)
+            min = c;
+        if (c + 1 < bk->num_top && bk->top[c + 1].count < bk->top[min].count)
+            min = c + 1;
+        if (min == pos)
+            return;
+        top_swap(bk, pos, min);
+        pos = min;
+    }
+}
+
+static void top_sift_up(struct ndp_hh_bank *bk, uint32_t pos)
+{
+    while (pos && bk->top[(pos - 1) / 2].count > bk->top[pos].count) {
+        top_swap(bk, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+}
+
+static void top_update(struct ndp_hh *hh, struct ndp_hh_bank *bk, uint16_t i, uint32_t est)
+{
+    const struct ndp_hh_key *key = &hh->keys[i];
+    uint32_t hash = hh->hashes[i];
+    int pos;
+
+    // a key already in the table has at least the smallest count, so an
+    // estimate that does not beat it changes nothing either way
+    if (bk->num_top == hh->k && est <= bk->top[0].count)
+        return;
+
+    if ((pos = top_find(bk, key, hash)) >= 0) {
+        bk->top[pos].count = est;
+        top_sift_down(bk, pos);
+        return;
+    }
+    if (bk->num_top < hh->k) {
+        pos = bk->num_top++;
+    } else {
+        // evict the smallest
+        top_index_del(bk, bk->top[0].slot);
+        pos = 0;
+    }
+    bk->top[pos].key = *key;
+    bk->top[pos].hash = hash;
+    bk->top[pos].count = est;
+    top_index_add(bk, pos);
+    if (pos)
+        top_sift_up(bk, pos);
+    else
+        top_sift_down(bk, pos);
+}
+
+void ndp_hh_burst(struct ndp_hh *hh, const struct ndp_burst *b)
+{
+    uint32_t req = __atomic_load_n(&hh->req, __ATOMIC_ACQUIRE);
+    uint32_t lens[NDP_BURST_MAX];
+    struct ndp_hh_bank *bk;
+    uint16_t n = 0;
+
+    // the merger has drained the other bank and wants this one
+    if (ndp_unlikely(req != hh->cur)) {
+        hh->bank = &hh->banks[req];
+        __atomic_store_n(&hh->cur, req, __ATOMIC_RELEASE);
+    }
+    bk = hh->bank;
+
+    for (uint16_t i = 0; i < b->count; i++) {
+        if (key_of(hh, b, i, &hh->keys[n]))
+            lens[n++] = b->len[i];
+    }
+    if (!n)
+        return;
+    hash_impl(hh, n);
+
+    for (uint16_t i = 0; i < n && i < HH_PREFETCH; i++) {
+        for (int d = 0; d < NDP_HH_ROWS; d++)
+            __builtin_prefetch(&bk->cm[(size_t)d * hh->width + hh->rows[d][i]], 1);
+    }
+    for (uint16_t i = 0; i < n; i++) {
+        uint32_t est = UINT32_MAX;
+
+        if (i + HH_PREFETCH < n) {
+            for (int d = 0; d < NDP_HH_ROWS; d++)
+                __builtin_prefetch(&bk->cm[(size_t)d * hh->width +
+                                           hh->rows[d][i + HH_PREFETCH]], 1);
+        }
+        for (int d = 0; d < NDP_HH_ROWS; d++) {
+            uint32_t *c = &bk->cm[(size_t)d * hh->width + hh->rows[d][i]];
+            uint32_t v = *c + lens[i];
+            v |= -(uint32_t)(v < lens[i]);
+            *c = v;
+            est = v < est ? v : est;
+        }
+        bk->total += lens[i];
+        top_update(hh, bk, i, est);
+    }
+}
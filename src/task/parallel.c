@@ -0,0 +1,225 @@
+/*******************************************************************************
+ * @file               parallel.c
+ * @brief              Node-partitioned parallel_for and parallel_reduce.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            A parallel scan only runs at the aggregate bandwidth of
+ *                     all sockets when every thread reads the memory of its
+ *                     own node.  Instead of splitting the index space evenly,
+ *                     the array is sampled every NDP_PAR_SEGMENT bytes with
+ *                     move_pages() to learn which node backs it, adjacent
+ *                     segments on the same node are merged into runs, and each
+ *                     run is cut into tasks submitted to the workers of that
+ *                     node through the task scheduler's inject queues.
+ *
+ *                     Pages that are not faulted in yet have no node; they are
+ *                     given to the calling thread's node, which is where first
+ *                     touch would have put them.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "parallel.h"
+
+
+struct par_chunk
+{
+    size_t begin;
+    size_t end;
+    ndp_range_fn fn;
+    ndp_reduce_fn reduce;
+    void *partial;
+    void *arg;
+} __ndp_cache_aligned;
+
+
+static void par_chunk_run(void *args)
+{
+    struct par_chunk *c = args;
+
+    if (c->reduce)
+        c->reduce(c->begin, c->end, c->partial, c->arg);
+    else
+        c->fn(c->begin, c->end, c->arg);
+}
+
+int ndp_parallel_runs(const void *base, size_t elem_size, size_t n, struct ndp_par_run **out)
+{
+    uintptr_t start = (uintptr_t)base;
+    uintptr_t end = start + elem_size * n;
+    uintptr_t seg0 = start & ~(NDP_PAR_SEGMENT - 1);
+    size_t nseg = (end - seg0 + NDP_PAR_SEGMENT - 1) / NDP_PAR_SEGMENT;
+    int self = numa_node_of_cpu(sched_getcpu());
+    int nruns = 0;
+
+    if (!n || !elem_size)
+        return 0;
+
+    void **pages = malloc(sizeof(void *) * nseg);
+    int *status = malloc(sizeof(int) * nseg);
+    struct ndp_par_run *runs = malloc(sizeof(*runs) * nseg);
+    if (!pages || !status || !runs)
+        goto runs_fail;
+
+    for (size_t i = 0; i < nseg; i++) {
+        uintptr_t a = seg0 + i * NDP_PAR_SEGMENT;
+        pages[i] = (void *)(a < start ? start : a);
+    }
+
+    // with a NULL node list move_pages() only reports where each page is;
+    // without the syscall (no NUMA, seccomp) everything counts as local
+    if (move_pages(0, nseg, pages, NULL, status, 0) != 0) {
+        for (size_t i = 0; i < nseg; i++)
+            status[i] = -1;
+    }
+
+    for (size_t i = 0; i < nseg; i++) {
+        uintptr_t a = (uintptr_t)pages[i];
+        size_t idx = (a - start + elem_size - 1) / elem_size;
+        int node = status[i] < 0 ? self : status[i];
+
+        if (idx >= n)
+            break;
+        if (nruns && runs[nruns - 1].node == node)
+            continue;
+        if (nruns)
+            runs[nruns - 1].end = idx;
+        runs[nruns].begin = idx;
+        runs[nruns].node = node;
+        nruns++;
+    }
+    runs[nruns - 1].end = n;
+
+    free(pages);
+    free(status);
+    *out = runs;
+    return nruns;
+
+runs_fail:
+    free(pages);
+    free(status);
+    free(runs);
+    return -1;
+}
+
+static size_t run_grain(struct ndp_tsched *s, const struct ndp_par_run *r, size_t grain)
+{
+    size_t len = r->end - r->begin;
+    size_t workers = 1;
+
+    if (grain)
+        return grain;
+    if (r->node >= 0 && r->node < s->num_nodes && s->node_workers[r->node])
+        workers = s->node_workers[r->node];
+
+    // a few tasks per worker leaves room to balance within the node
+    grain = len / (workers * 4);
+    return grain ? grain : 1;
+}
+
+static int parallel_runs(struct ndp_tsched *s, const struct ndp_par_run *runs, int nruns,
+                         size_t grain, ndp_range_fn fn, ndp_reduce_fn reduce,
+                         void *result, size_t result_size, const void *identity,
+                         ndp_combine_fn combine, void *arg)
+{
+    struct ndp_task_group g = { 0 };
+    struct par_chunk *chunks;
+    uint8_t *partials = NULL;
+    size_t nchunks = 0, k = 0;
+    size_t stride = align_up(result_size, (size_t)NDP_CACHE_LINE);
+
+    for (int i = 0; i < nruns; i++) {
+        size_t gr = run_grain(s, &runs[i], grain);
+        nchunks += (runs[i].end - runs[i].begin + gr - 1) / gr;
+    }
+    // nothing to split: a reduction still yields its identity
+    if (!nchunks) {
+        if (reduce)
+            memcpy(result, identity, result_size);
+        return 0;
+    }
+
+    chunks = aligned_alloc(NDP_CACHE_LINE, sizeof(*chunks) * nchunks);
+    if (!chunks)
+        return -1;
+    if (reduce && !(partials = aligned_alloc(NDP_CACHE_LINE, stride * nchunks))) {
+        free(chunks);
+        return -1;
+    }
+
+    for (int i = 0; i < nruns; i++) {
+        size_t gr = run_grain(s, &runs[i], grain);
+        for (size_t b = runs[i].begin; b < runs[i].end; b += gr, k++) {
+            struct par_chunk *c = &chunks[k];
+            c->begin = b;
+            c->end = b + gr < runs[i].end ? b + gr : runs[i].end;
+            c->fn = fn;
+            c->reduce = reduce;
+            c->arg = arg;
+            c->partial = NULL;
+            if (reduce) {
+                c->partial = partials + k * stride;
+                memcpy(c->partial, identity, result_size);
+            }
+            ndp_task_submit(s, runs[i].node, &g, par_chunk_run, c);
+        }
+    }
+    ndp_task_group_wait(s, &g);
+
+    if (reduce) {
+        memcpy(result, identity, result_size);
+        for (k = 0; k < nchunks; k++)
+            combine(result, chunks[k].partial, arg);
+    }
+
+    free(partials);
+    free(chunks);
+    return 0;
+}
+
+int ndp_parallel_for_runs(struct ndp_tsched *s, const struct ndp_par_run *runs, int nruns,
+                          size_t grain, ndp_range_fn fn, void *arg)
+{
+    return parallel_runs(s, runs, nruns, grain, fn, NULL, NULL, 0, NULL, NULL, arg);
+}
+
+int ndp_parallel_reduce_runs(struct ndp_tsched *s, const struct ndp_par_run *runs, int nruns,
+                             size_t grain, void *result, size_t result_size,
+                             const void *identity, ndp_reduce_fn reduce,
+                             ndp_combine_fn combine, void *arg)
+{
+    return parallel_runs(s, runs, nruns, grain, NULL, reduce, result, result_size,
+                         identity, combine, arg);
+}
+
+int ndp_parallel_for(struct ndp_tsched *s, const void *base, size_t elem_size, size_t n,
+                     size_t grain, ndp_range_fn fn, void *arg)
+{
+    struct ndp_par_run *runs = NULL;
+    int nruns = ndp_parallel_runs(base, elem_size, n, &runs);
+
+    if (nruns < 0)
+        return -1;
+
+    int rc = ndp_parallel_for_runs(s, runs, nruns, grain, fn, arg);
+    free(runs);
+    return rc;
+}
+
+int ndp_parallel_reduce(struct ndp_tsched *s, const void *base, size_t elem_size, size_t n,
+                        size_t grain, void *result, size_t result_size, const void *identity,
+                        ndp_reduce_fn reduce, ndp_combine_fn combine, void *arg)
+{
+    struct ndp_par_run *runs = NULL;
+    int nruns = ndp_parallel_runs(base, elem_size, n, &runs);
+
+    if (nruns < 0)
+        return -1;
+
+    int rc = ndp_parallel_reduce_runs(s, runs, nruns, grain, result, result_size,
+                                      identity, reduce, combine, arg);
+    free(runs);
+    return rc;
+}
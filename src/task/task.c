@@ -0,0 +1,479 @@
+/*******************************************************************************
+ * @file               task.c
+ * @brief              NUMA-hierarchical work-stealing task scheduler.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Batch jobs (table rebuilds, exports) run on a pool of
+ *                     workers, one per physical core, each pinned with the
+ *                     topology module.  Every worker owns a Chase-Lev deque:
+ *                     it pushes and pops at the bottom without atomics in the
+ *                     common case, idle workers steal from the top.
+ *
+ *                     Stealing follows the memory hierarchy.  A thief first
+ *                     tries workers behind the same L3, then the rest of its
+ *                     node, and only then remote nodes ordered by SLIT
+ *                     distance, so a task migrates as short a distance as the
+ *                     load allows.  Task records come from the spawning
+ *                     worker's node pool, which keeps the task and the data
+ *                     it was spawned next to on the same node.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "task.h"
+
+
+#define IDLE_SPINS              256
+#define IDLE_SLEEP_NS           1000000
+
+static __thread struct ndp_tworker *tls_worker;
+
+
+static bool deque_push(struct ndp_deque *dq, struct ndp_task *t)
+{
+    long b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+    long top = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+
+    if (b - top > dq->mask)
+        return false;
+
+    __atomic_store_n(&dq->buf[b & dq->mask], t, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+static struct ndp_task *deque_take(struct ndp_deque *dq)
+{
+    long b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED) - 1;
+    struct ndp_task *t = NULL;
+
+    __atomic_store_n(&dq->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long top = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+
+    if (top <= b) {
+        t = __atomic_load_n(&dq->buf[b & dq->mask], __ATOMIC_RELAXED);
+        if (top == b) {
+            // last element, race the thieves for it
+            if (!__atomic_compare_exchange_n(&dq->top, &top, top + 1, false,
+                                             __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                t = NULL;
+            __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return t;
+}
+
+static struct ndp_task *deque_steal(struct ndp_deque *dq)
+{
+    long top = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long b = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= b)
+        return NULL;
+
+    struct ndp_task *t = __atomic_load_n(&dq->buf[top & dq->mask], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&dq->top, &top, top + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return NULL;
+    return t;
+}
+
+static struct ndp_task *inject_pop(struct ndp_tinject *q)
+{
+    struct ndp_task *t;
+
+    if (!__atomic_load_n(&q->head, __ATOMIC_RELAXED))
+        return NULL;
+
+    pthread_mutex_lock(&q->lock);
+    if ((t = q->head) && !(q->head = t->next))
+        q->tail = NULL;
+    pthread_mutex_unlock(&q->lock);
+    return t;
+}
+
+static void inject_push(struct ndp_tinject *q, struct ndp_task *t)
+{
+    t->next = NULL;
+    pthread_mutex_lock(&q->lock);
+    if (q->tail)
+        q->tail->next = t;
+    else
+        q->head = t;
+    q->tail = t;
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void sched_wake(struct ndp_tsched *s)
+{
+    if (!__atomic_load_n(&s->sleepers, __ATOMIC_RELAXED))
+        return;
+    pthread_mutex_lock(&s->idle_lock);
+    pthread_cond_signal(&s->idle_cond);
+    pthread_mutex_unlock(&s->idle_lock);
+}
+
+static inline void task_group_done(struct ndp_task_group *g)
+{
+    if (g)
+        __atomic_sub_fetch(&g->pending, 1, __ATOMIC_RELEASE);
+}
+
+static inline void task_group_add(struct ndp_task_group *g)
+{
+    if (g)
+        __atomic_add_fetch(&g->pending, 1, __ATOMIC_RELAXED);
+}
+
+static void task_run(struct ndp_task *t)
+{
+    struct ndp_task_group *g = t->group;
+
+    t->fn(t->arg);
+    ndp_objpool_put(t->owner, t);
+    task_group_done(g);
+}
+
+static struct ndp_task *task_alloc(struct ndp_tsched *s, int node,
+                                   struct ndp_task_group *g, ndp_task_fn fn, void *arg)
+{
+    struct ndp_task *t = ndp_objpool_get(s->task_pools[node]);
+    if (!t)
+        return NULL;
+
+    t->fn = fn;
+    t->arg = arg;
+    t->group = g;
+    t->owner = s->task_pools[node];
+    t->next = NULL;
+    return t;
+}
+
+static inline uint64_t xorshift64(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/**
+ *  walk the victim tiers in order; within a tier start at a random victim
+ *  so that thieves on the same cache do not all hammer the same deque.
+ */
+static struct ndp_task *worker_steal(struct ndp_tworker *w)
+{
+    struct ndp_tsched *s = w->s;
+    struct ndp_task *t;
+    int start = 0;
+
+    for (int tier = 0; tier < NDP_STEAL_TIERS; tier++) {
+        int n = w->tier_end[tier] - start;
+
+        if (n > 0) {
+            int first = (int)(xorshift64(&w->seed) % (uint64_t)n);
+            for (int i = 0; i < n; i++) {
+                int v = w->victims[start + (first + i) % n];
+                if ((t = deque_steal(&s->workers[v]->dq))) {
+                    w->steals[tier]++;
+                    return t;
+                }
+            }
+        }
+        start = w->tier_end[tier];
+    }
+    return NULL;
+}
+
+static struct ndp_task *worker_find(struct ndp_tworker *w)
+{
+    struct ndp_task *t = deque_take(&w->dq);
+
+    if (!t)
+        t = inject_pop(&w->s->inject[w->node]);
+    return t ? t : worker_steal(w);
+}
+
+static void *ndp_tworker_thread(void *args)
+{
+    struct ndp_tworker *w = args;
+    struct ndp_tsched *s = w->s;
+    unsigned int idle = 0;
+
+    if (ndp_bind_thread_to_cpu(w->cpu) < 0)
+        return NULL;
+    tls_worker = w;
+
+    while (__atomic_load_n(&s->running, __ATOMIC_ACQUIRE)) {
+        struct ndp_task *t = worker_find(w);
+        if (t) {
+            task_run(t);
+            w->executed++;
+            idle = 0;
+            continue;
+        }
+        if (++idle < IDLE_SPINS) {
+            __builtin_ia32_pause();
+            continue;
+        }
+
+        // timed sleep: spawns from other workers do not always signal, the
+        // timeout bounds how long such a task can sit unnoticed
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += IDLE_SLEEP_NS;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&s->idle_lock);
+        s->sleepers++;
+        if (__atomic_load_n(&s->running, __ATOMIC_ACQUIRE))
+            pthread_cond_timedwait(&s->idle_cond, &s->idle_lock, &ts);
+        s->sleepers--;
+        pthread_mutex_unlock(&s->idle_lock);
+        idle = 0;
+    }
+
+    tls_worker = NULL;
+    return NULL;
+}
+
+static int tier_of(const struct ndp_cpu *self, const struct ndp_cpu *other)
+{
+    if (self->node != other->node)
+        return NDP_STEAL_REMOTE;
+    return ndp_cpu_share_l3(self, other) ? NDP_STEAL_L3 : NDP_STEAL_NODE;
+}
+
+/**
+ *  build the victim list of worker `id`: group by tier, and order remote
+ *  victims by numa_distance() so that closer sockets are robbed first.
+ */
+static int build_victims(struct ndp_tsched *s, struct ndp_tworker *w)
+{
+    const struct ndp_cpu *self = ndp_topology_cpu(s->topo, w->cpu);
+    int n = 0;
+
+    w->victims = ndp_mempool_alloc(s->mem, w->node, sizeof(int) * s->num_workers, 0);
+    if (!w->victims)
+        return -1;
+
+    for (int tier = 0; tier < NDP_STEAL_TIERS; tier++) {
+        int first = n;
+        for (int v = 0; v < s->num_workers; v++) {
+            if (v == w->id)
+                continue;
+            const struct ndp_cpu *other = ndp_topology_cpu(s->topo, s->workers[v]->cpu);
+            if (tier_of(self, other) == tier)
+                w->victims[n++] = v;
+        }
+        if (tier == NDP_STEAL_REMOTE) {
+            for (int i = first + 1; i < n; i++) {
+                int v = w->victims[i], j = i;
+                int d = numa_distance(w->node, s->workers[v]->node);
+                while (j > first && numa_distance(w->node,
+                                   s->workers[w->victims[j - 1]]->node) > d) {
+                    w->victims[j] = w->victims[j - 1];
+                    j--;
+                }
+                w->victims[j] = v;
+            }
+        }
+        w->tier_end[tier] = n;
+    }
+    return 0;
+}
+
+int ndp_tsched_init(struct ndp_tsched *s, struct mempool_sys *mem,
+                    const struct ndp_topology *topo, unsigned int deque_size,
+                    unsigned int tasks_per_node)
+{
+    if (!deque_size || (deque_size & (deque_size - 1)))
+        return -1;
+
+    memset(s, 0, sizeof(*s));
+    s->mem = mem;
+    s->topo = topo;
+    s->num_nodes = mem->num_nodes;
+    s->workers = calloc(topo->num_cpus, sizeof(*s->workers));
+    s->inject = calloc(s->num_nodes, sizeof(*s->inject));
+    s->task_pools = calloc(s->num_nodes, sizeof(*s->task_pools));
+    s->node_workers = calloc(s->num_nodes, sizeof(*s->node_workers));
+    if (!s->workers || !s->inject || !s->task_pools || !s->node_workers)
+        goto init_fail;
+
+    pthread_mutex_init(&s->idle_lock, NULL);
+    pthread_cond_init(&s->idle_cond, NULL);
+
+    for (int node = 0; node < s->num_nodes; node++) {
+        pthread_mutex_init(&s->inject[node].lock, NULL);
+        s->task_pools[node] = ndp_objpool_create(mem, node, sizeof(struct ndp_task),
+                                                 tasks_per_node);
+        if (!s->task_pools[node])
+            goto init_fail;
+    }
+
+    for (int i = 0; i < topo->num_cpus; i++) {
+        const struct ndp_cpu *c = &topo->cpus[i];
+        if (!c->primary || c->node < 0 || c->node >= s->num_nodes)
+            continue;
+
+        struct ndp_tworker *w = ndp_mempool_alloc(mem, c->node, sizeof(*w), NDP_CACHE_LINE);
+        if (!w)
+            goto init_fail;
+        memset(w, 0, sizeof(*w));
+        w->dq.buf = ndp_mempool_alloc(mem, c->node, sizeof(struct ndp_task *) * deque_size,
+                                      NDP_CACHE_LINE);
+        if (!w->dq.buf)
+            goto init_fail;
+        w->dq.mask = deque_size - 1;
+        w->s = s;
+        w->id = s->num_workers;
+        w->cpu = c->cpu;
+        w->node = c->node;
+        w->seed = 0x9e3779b97f4a7c15ULL ^ (uint64_t)(c->cpu + 1);
+        s->workers[s->num_workers++] = w;
+        s->node_workers[c->node]++;
+    }
+
+    for (int i = 0; i < s->num_workers; i++) {
+        if (build_victims(s, s->workers[i]) < 0)
+            goto init_fail;
+    }
+
+    s->running = true;
+    for (int i = 0; i < s->num_workers; i++) {
+        if (pthread_create(&s->workers[i]->thread, NULL, ndp_tworker_thread,
+                           s->workers[i]) != 0) {
+            s->num_workers = i;
+            ndp_tsched_destroy(s);
+            return -1;
+        }
+    }
+    return 0;
+
+init_fail:
+    free(s->workers);
+    free(s->inject);
+    free(s->task_pools);
+    free(s->node_workers);
+    s->workers = NULL;
+    return -1;
+}
+
+void ndp_tsched_destroy(struct ndp_tsched *s)
+{
+    if (!s->workers)
+        return;
+
+    __atomic_store_n(&s->running, false, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&s->idle_lock);
+    pthread_cond_broadcast(&s->idle_cond);
+    pthread_mutex_unlock(&s->idle_lock);
+
+    for (int i = 0; i < s->num_workers; i++)
+        pthread_join(s->workers[i]->thread, NULL);
+
+    for (int node = 0; node < s->num_nodes; node++)
+        pthread_mutex_destroy(&s->inject[node].lock);
+    pthread_mutex_destroy(&s->idle_lock);
+    pthread_cond_destroy(&s->idle_cond);
+
+    free(s->workers);
+    free(s->inject);
+    free(s->task_pools);
+    free(s->node_workers);
+    s->workers = NULL;
+    s->num_workers = 0;
+}
+
+struct ndp_tworker *ndp_tworker_self(void)
+{
+    return tls_worker;
+}
+
+/**
+ *  nodes without workers (memory-only nodes, cpusets) cannot run their
+ *  inject queue; redirect to the closest node that can.
+ */
+static int sched_node(struct ndp_tsched *s, int node)
+{
+    int best = -1;
+
+    if (node >= 0 && node < s->num_nodes && s->node_workers[node])
+        return node;
+
+    for (int n = 0; n < s->num_nodes; n++) {
+        if (!s->node_workers[n])
+            continue;
+        if (best < 0 || (node >= 0 && numa_distance(node, n) < numa_distance(node, best)))
+            best = n;
+    }
+    return best < 0 ? 0 : best;
+}
+
+void ndp_task_submit(struct ndp_tsched *s, int node, struct ndp_task_group *g,
+                     ndp_task_fn fn, void *arg)
+{
+    node = sched_node(s, node);
+    struct ndp_task *t = task_alloc(s, node, g, fn, arg);
+
+    if (!t) {
+        fn(arg);
+        return;
+    }
+    task_group_add(g);
+    inject_push(&s->inject[node], t);
+    sched_wake(s);
+}
+
+void ndp_task_spawn(struct ndp_tsched *s, struct ndp_task_group *g,
+                    ndp_task_fn fn, void *arg)
+{
+    struct ndp_tworker *w = tls_worker;
+
+    if (!w || w->s != s) {
+        ndp_task_submit(s, numa_node_of_cpu(sched_getcpu()), g, fn, arg);
+        return;
+    }
+
+    // out of records or deque slots: run inline, which is what the
+    // worker would end up doing with the task anyway
+    struct ndp_task *t = task_alloc(s, w->node, g, fn, arg);
+    if (!t) {
+        fn(arg);
+        return;
+    }
+    task_group_add(g);
+    if (!deque_push(&w->dq, t)) {
+        task_run(t);
+        return;
+    }
+    sched_wake(s);
+}
+
+void ndp_task_group_wait(struct ndp_tsched *s, struct ndp_task_group *g)
+{
+    struct ndp_tworker *w = tls_worker;
+
+    while (__atomic_load_n(&g->pending, __ATOMIC_ACQUIRE)) {
+        if (w && w->s == s) {
+            struct ndp_task *t = worker_find(w);
+            if (t) {
+                task_run(t);
+                w->executed++;
+                continue;
+            }
+        }
+        sched_yield();
+    }
+}
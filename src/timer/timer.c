@@ -0,0 +1,205 @@
+/*******************************************************************************
+ * @file               timer.c
+ * @brief              Per-worker hierarchical timing wheel driven by the TSC.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            Flow aging, retransmission and rate-limit refills need
+ *                     millions of timers that are armed and cancelled far more
+ *                     often than they fire.  A heap makes both O(log n) and a
+ *                     shared heap needs a lock; timerfd needs a syscall.
+ *
+ *                     Each worker owns a cascading timing wheel in the style
+ *                     of the classic Linux timer base: a timer is linked into
+ *                     the slot of the level that covers its distance, so arm
+ *                     and cancel are a few pointer writes.  When the lowest
+ *                     level wraps, the next slot of the level above is
+ *                     re-distributed, so a timer moves at most once per level.
+ *                     Time is the TSC shifted down to the tick resolution and
+ *                     pooled timers come from the worker's node.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "timer.h"
+
+
+#define LEVEL_SHIFT(l)          ((l) * NDP_TIMER_BITS)
+#define LEVEL_INDEX(w, l)       (((w)->now >> LEVEL_SHIFT(l)) & NDP_TIMER_MASK)
+
+
+static inline uint64_t tsc_to_tick(const struct ndp_timer_wheel *w, uint64_t tsc)
+{
+    return (tsc - w->tsc_base) >> w->tick_shift;
+}
+
+static inline void slot_link(struct ndp_timer **head, struct ndp_timer *t)
+{
+    if ((t->next = *head))
+        t->next->pprev = &t->next;
+    *head = t;
+    t->pprev = head;
+}
+
+static inline void slot_unlink(struct ndp_timer *t)
+{
+    *t->pprev = t->next;
+    if (t->next)
+        t->next->pprev = t->pprev;
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+/**
+ *  pick the level whose slots span the distance to expiry; timers already
+ *  due go in the next slot to be run, timers past the wheel's range are
+ *  parked in the last slot of the top level and cascade down from there.
+ */
+static void wheel_add(struct ndp_timer_wheel *w, struct ndp_timer *t)
+{
+    uint64_t expires = t->expires;
+    int64_t delta = (int64_t)(expires - w->now);
+    struct ndp_timer **head;
+
+    if (delta < 0) {
+        head = &w->slots[0][w->now & NDP_TIMER_MASK];
+    } else if (delta < (1LL << LEVEL_SHIFT(1))) {
+        head = &w->slots[0][expires & NDP_TIMER_MASK];
+    } else if (delta < (1LL << LEVEL_SHIFT(2))) {
+        head = &w->slots[1][(expires >> LEVEL_SHIFT(1)) & NDP_TIMER_MASK];
+    } else if (delta < (1LL << LEVEL_SHIFT(3))) {
+        head = &w->slots[2][(expires >> LEVEL_SHIFT(2)) & NDP_TIMER_MASK];
+    } else {
+        if (delta >= (1LL << LEVEL_SHIFT(4)) - 1)
+            expires = w->now + (1ULL << LEVEL_SHIFT(4)) - 1;
+        head = &w->slots[3][(expires >> LEVEL_SHIFT(3)) & NDP_TIMER_MASK];
+    }
+    slot_link(head, t);
+}
+
+/* re-distribute one slot of `level` into the levels below */
+static unsigned int wheel_cascade(struct ndp_timer_wheel *w, int level)
+{
+    unsigned int idx = LEVEL_INDEX(w, level);
+    struct ndp_timer *t = w->slots[level][idx];
+
+    w->slots[level][idx] = NULL;
+    while (t) {
+        struct ndp_timer *next = t->next;
+        t->pprev = NULL;
+        wheel_add(w, t);
+        t = next;
+    }
+    return idx;
+}
+
+struct ndp_timer_wheel *ndp_timer_wheel_create(struct mempool_sys *mem, int node,
+                                               uint64_t tick_ns, unsigned int max_timers)
+{
+    struct ndp_timer_wheel *w = ndp_mempool_alloc(mem, node, sizeof(*w), NDP_CACHE_LINE);
+    uint64_t cycles = ndp_ns_to_tsc(tick_ns);
+
+    if (!w)
+        return NULL;
+
+    memset(w, 0, sizeof(*w));
+    w->node = node;
+    w->tick_shift = cycles > 1 ? 63 - __builtin_clzll(cycles) : 0;
+    w->tsc_base = ndp_rdtsc();
+
+    if (max_timers &&
+        !(w->pool = ndp_objpool_create(mem, node, sizeof(struct ndp_timer), max_timers)))
+        return NULL;
+    return w;
+}
+
+struct ndp_timer *ndp_timer_alloc(struct ndp_timer_wheel *w)
+{
+    struct ndp_timer *t = w->pool ? ndp_objpool_get(w->pool) : NULL;
+
+    if (t)
+        memset(t, 0, sizeof(*t));
+    return t;
+}
+
+void ndp_timer_free(struct ndp_timer_wheel *w, struct ndp_timer *t)
+{
+    ndp_timer_cancel(w, t);
+    ndp_objpool_put(w->pool, t);
+}
+
+void ndp_timer_arm(struct ndp_timer_wheel *w, struct ndp_timer *t, uint64_t delay,
+                   uint64_t period, ndp_timer_fn fn, void *arg)
+{
+    uint64_t now = tsc_to_tick(w, ndp_rdtsc());
+
+    ndp_timer_cancel(w, t);
+
+    // the wheel may lag the TSC between polls; expiry is relative to the
+    // wheel so a timer armed late is not considered overdue
+    t->expires = (now > w->now ? now : w->now) + (delay >> w->tick_shift);
+    t->period = period >> w->tick_shift;
+    if (period && !t->period)
+        t->period = 1;
+    t->fn = fn;
+    t->arg = arg;
+    wheel_add(w, t);
+    w->pending++;
+}
+
+void ndp_timer_cancel(struct ndp_timer_wheel *w, struct ndp_timer *t)
+{
+    if (!ndp_timer_pending(t))
+        return;
+    slot_unlink(t);
+    w->pending--;
+}
+
+int ndp_timer_wheel_advance(struct ndp_timer_wheel *w, uint64_t tsc)
+{
+    uint64_t target = tsc_to_tick(w, tsc);
+    int fired = 0;
+
+    // nothing armed: jump instead of walking every empty tick
+    if (!w->pending) {
+        if (target > w->now)
+            w->now = target;
+        return 0;
+    }
+
+    while (w->now <= target) {
+        unsigned int idx = w->now & NDP_TIMER_MASK;
+
+        if (!idx && !wheel_cascade(w, 1) && !wheel_cascade(w, 2))
+            wheel_cascade(w, 3);
+
+        // move the slot to a local list: callbacks may cancel timers that
+        // are still queued behind them, which must unlink from this list
+        struct ndp_timer *work = w->slots[0][idx], *t;
+        w->slots[0][idx] = NULL;
+        if (work)
+            work->pprev = &work;
+        w->now++;
+
+        while ((t = work)) {
+            slot_unlink(t);
+            w->pending--;
+            if (t->period) {
+                t->expires += t->period;
+                wheel_add(w, t);
+                w->pending++;
+            }
+            t->fn(t, t->arg);
+            fired++;
+        }
+    }
+
+    w->fired += fired;
+    return fired;
+}
+
+int ndp_timer_wheel_poll(void *arg)
+{
+    return ndp_timer_wheel_advance(arg, ndp_rdtsc());
+}
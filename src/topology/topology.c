@@ -0,0 +1,304 @@
+/*******************************************************************************
+ * @file               topology.c
+ * @brief              CPU, core and cache topology discovery.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            libnuma tells us which node a CPU belongs to, but the
+ *                     schedulers built on top of the pools also care about
+ *                     which CPUs share a core and which share a last level
+ *                     cache.  That information only lives in sysfs, so it is
+ *                     read once at start-up into a flat table indexed by cpu.
+ *
+ *                     Devices are placed the same way: a PCI function lists
+ *                     its node and local CPUs in sysfs, and a network
+ *                     interface links to its PCI function.  Every path is
+ *                     built under a root that defaults to /sys and can be
+ *                     pointed elsewhere for testing.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "topology.h"
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdarg.h>
+
+static char sysfs_root[PATH_MAX];
+
+
+void ndp_sysfs_set_root(const char *root)
+{
+    snprintf(sysfs_root, sizeof(sysfs_root), "%s", root && *root ? root : NDP_SYSFS_ROOT);
+}
+
+const char *ndp_sysfs_root(void)
+{
+    if (!sysfs_root[0])
+        ndp_sysfs_set_root(getenv("NDP_SYSFS_ROOT"));
+    return sysfs_root;
+}
+
+/* path of a sysfs file, fmt being relative to the root */
+static char *sysfs_path(char *path, size_t len, const char *fmt, ...)
+{
+    int n = snprintf(path, len, "%s/", ndp_sysfs_root());
+    va_list ap;
+
+    va_start(ap, fmt);
+    if (n >= 0 && (size_t)n < len)
+        vsnprintf(path + n, len - n, fmt, ap);
+    va_end(ap);
+    return path;
+}
+
+static int sysfs_read_int(const char *path, int fallback)
+{
+    FILE *f = fopen(path, "r");
+    int val;
+
+    if (!f)
+        return fallback;
+    if (fscanf(f, "%d", &val) != 1)
+        val = fallback;
+    fclose(f);
+    return val;
+}
+
+/* node of a cpu from its nodeN link, -1 when it has none */
+static int sysfs_cpu_node(int cpu)
+{
+    char path[PATH_MAX];
+    struct dirent *e;
+    int node = -1;
+    DIR *dir;
+
+    if (!(dir = opendir(sysfs_path(path, sizeof(path), NDP_SYSFS_CPU "/cpu%d", cpu))))
+        return -1;
+    while ((e = readdir(dir))) {
+        if (!strncmp(e->d_name, "node", 4) && e->d_name[4] >= '0' && e->d_name[4] <= '9') {
+            node = atoi(e->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+/**
+ *  find the cache index describing the L3 of a cpu and return its id; the
+ *  index number is not fixed across architectures, so match on `level`.
+ */
+static int cpu_l3_id(int cpu)
+{
+    char path[256];
+
+    for (int idx = 0; idx < 8; idx++) {
+        sysfs_path(path, sizeof(path), NDP_SYSFS_CPU "/cpu%d/cache/index%d/level", cpu, idx);
+        int level = sysfs_read_int(path, -1);
+        if (level < 0)
+            break;
+        if (level != 3)
+            continue;
+        sysfs_path(path, sizeof(path), NDP_SYSFS_CPU "/cpu%d/cache/index%d/id", cpu, idx);
+        return sysfs_read_int(path, -1);
+    }
+    return -1;
+}
+
+int ndp_topology_init(struct ndp_topology *topo)
+{
+    char path[256];
+    int ncpus = numa_num_configured_cpus();
+
+    if (numa_available() < 0 || ncpus <= 0)
+        return -1;
+
+    topo->cpus = calloc(ncpus, sizeof(*topo->cpus));
+    if (!topo->cpus)
+        return -1;
+    topo->num_cpus = 0;
+    topo->num_nodes = numa_max_node() + 1;
+
+    for (int cpu = 0; cpu < ncpus; cpu++) {
+        if (!numa_bitmask_isbitset(numa_all_cpus_ptr, cpu))
+            continue;
+
+        struct ndp_cpu *c = &topo->cpus[topo->num_cpus++];
+        c->cpu = cpu;
+        // read under the sysfs root like the device nodes it is compared with
+        if ((c->node = sysfs_cpu_node(cpu)) < 0)
+            c->node = numa_node_of_cpu(cpu);
+        sysfs_path(path, sizeof(path), NDP_SYSFS_CPU "/cpu%d/topology/physical_package_id", cpu);
+        c->pkg = sysfs_read_int(path, c->node);
+        sysfs_path(path, sizeof(path), NDP_SYSFS_CPU "/cpu%d/topology/core_id", cpu);
+        c->core = sysfs_read_int(path, cpu);
+        c->l3 = cpu_l3_id(cpu);
+
+        c->primary = true;
+        for (int i = 0; i < topo->num_cpus - 1; i++) {
+            if (topo->cpus[i].pkg == c->pkg && topo->cpus[i].core == c->core) {
+                c->primary = false;
+                break;
+            }
+        }
+    }
+    return topo->num_cpus ? 0 : -1;
+}
+
+void ndp_topology_destroy(struct ndp_topology *topo)
+{
+    free(topo->cpus);
+    topo->cpus = NULL;
+    topo->num_cpus = 0;
+}
+
+const struct ndp_cpu *ndp_topology_cpu(const struct ndp_topology *topo, int cpu)
+{
+    for (int i = 0; i < topo->num_cpus; i++) {
+        if (topo->cpus[i].cpu == cpu)
+            return &topo->cpus[i];
+    }
+    return NULL;
+}
+
+int ndp_bind_thread_to_cpu(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        perror("Failed to pin thread to cpu");
+        return -1;
+    }
+    return 0;
+}
+
+/* parse a cpu list ("0-3,8,10-11") into set; the number of cpus in it */
+static int parse_cpulist(const char *list, cpu_set_t *set)
+{
+    const char *p = list;
+
+    CPU_ZERO(set);
+    while (*p && *p != '\n') {
+        char *end;
+        long lo = strtol(p, &end, 10), hi = lo;
+
+        if (end == p)
+            break;
+        p = end;
+        if (*p == '-') {
+            hi = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long c = lo; c <= hi && c < CPU_SETSIZE; c++)
+            CPU_SET(c, set);
+        if (*p == ',')
+            p++;
+    }
+    return CPU_COUNT(set);
+}
+
+/* read numa_node and local_cpulist of the device directory dev */
+static void dev_locality_read(const char *dev, struct ndp_dev_locality *loc)
+{
+    char path[PATH_MAX], list[4096];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/numa_node", dev);
+    loc->node = sysfs_read_int(path, -1);
+
+    CPU_ZERO(&loc->cpus);
+    loc->num_cpus = 0;
+    snprintf(path, sizeof(path), "%s/local_cpulist", dev);
+    if ((f = fopen(path, "r"))) {
+        if (fgets(list, sizeof(list), f))
+            loc->num_cpus = parse_cpulist(list, &loc->cpus);
+        fclose(f);
+    }
+
+    // single-node firmware reports -1; the local cpus still tell
+    if (loc->node < 0) {
+        for (int c = 0; c < CPU_SETSIZE && loc->num_cpus; c++) {
+            if (CPU_ISSET(c, &loc->cpus)) {
+                loc->node = sysfs_cpu_node(c);
+                break;
+            }
+        }
+    }
+}
+
+int ndp_dev_locality_pci(const char *addr, struct ndp_dev_locality *loc)
+{
+    char dev[PATH_MAX];
+
+    memset(loc, 0, sizeof(*loc));
+    loc->node = -1;
+    sysfs_path(dev, sizeof(dev), "bus/pci/devices/%s", addr);
+    if (access(dev, F_OK) != 0)
+        return -1;
+    snprintf(loc->pci, sizeof(loc->pci), "%s", addr);
+    dev_locality_read(dev, loc);
+    return 0;
+}
+
+int ndp_dev_locality_netdev(const char *ifname, struct ndp_dev_locality *loc)
+{
+    char dev[PATH_MAX], link[PATH_MAX];
+    ssize_t n;
+
+    memset(loc, 0, sizeof(*loc));
+    loc->node = -1;
+    if (access(sysfs_path(dev, sizeof(dev), "class/net/%s", ifname), F_OK) != 0)
+        return -1;
+
+    // virtual interfaces have no device behind them
+    sysfs_path(dev, sizeof(dev), "class/net/%s/device", ifname);
+    if (access(dev, F_OK) != 0)
+        return 0;
+    if ((n = readlink(dev, link, sizeof(link) - 1)) > 0) {
+        const char *base;
+
+        link[n] = '\0';
+        base = strrchr(link, '/') ? strrchr(link, '/') + 1 : link;
+        if (strchr(base, ':'))
+            snprintf(loc->pci, sizeof(loc->pci), "%s", base);
+    }
+    dev_locality_read(dev, loc);
+    return 0;
+}
+
+int ndp_dev_node(const char *ifname, int fallback)
+{
+    struct ndp_dev_locality loc;
+
+    if (ndp_dev_locality_netdev(ifname, &loc) != 0 || loc.node < 0)
+        return fallback;
+    return loc.node;
+}
+
+int ndp_topology_dev_cpus(const struct ndp_topology *topo, const struct ndp_dev_locality *loc,
+                          int *cpus, int max)
+{
+    int n = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < topo->num_cpus && n < max; i++) {
+            const struct ndp_cpu *c = &topo->cpus[i];
+            bool local;
+
+            if (c->primary != !pass)
+                continue;
+            if (loc->num_cpus)
+                local = c->cpu < CPU_SETSIZE && CPU_ISSET(c->cpu, &loc->cpus);
+            else
+                local = loc->node < 0 || c->node == loc->node;
+            if (local)
+                cpus[n++] = c->cpu;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,344 @@
+/*******************************************************************************
+ * @file               worker.c
+ * @brief              Poll-mode worker runtime with adaptive idle back-off.
+ * @author             Maurice Green
+ * @date               October 18, 2026
+ * @copyright          (C) 2026 Trace Systems, LLC.  All rights reserved.
+ *
+ * @details            A worker is a thread pinned to one CPU that runs its
+ *                     poll hooks (ports, rings, timers, delegation servers)
+ *                     in a loop.  Spinning gives the lowest latency but burns
+ *                     a full core while traffic is idle, so an idle worker
+ *                     walks down a ladder of cheaper waits:
+ *
+ *                       spin     - poll back to back for a few iterations
+ *                       pause    - exponentially longer runs of pause
+ *                       umwait   - C0.1/C0.2 wait on the worker's state line,
+ *                                  only on CPUs with WAITPKG
+ *                       sleep    - block on an eventfd, bounded timeout
+ *
+ *                     Producers call ndp_worker_wake() after handing work to
+ *                     a worker.  While the worker is running that costs one
+ *                     load; otherwise the waker stamps the TSC and ends the
+ *                     umwait (by writing the monitored line) or the sleep (by
+ *                     writing the eventfd), and the worker records how long
+ *                     it took to come back.  The latency histogram is what
+ *                     operators use to tune the policy.
+ *
+ * @revision           October 18, 2026 - Maurice Green - init
+ ******************************************************************************/
+
+#include "worker.h"
+
+#include <cpuid.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+
+static bool cpu_has_waitpkg(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return false;
+    return ecx & (1u << 5);
+}
+
+__attribute__((target("waitpkg")))
+static void worker_umwait(struct ndp_worker *w, uint64_t deadline)
+{
+    _umonitor(&w->state);
+    // re-check after arming the monitor, a wake in between is not lost
+    if (__atomic_load_n(&w->state, __ATOMIC_ACQUIRE) == NDP_WORKER_UMWAIT)
+        _umwait(0, deadline);
+}
+
+void ndp_idle_policy_default(struct ndp_idle_policy *p)
+{
+    p->spin_polls = 64;
+    p->pause_max = 1024;
+    p->umwait_us = 20;
+    p->sleep_after_us = 1000;
+    p->sleep_max_us = 10000;
+    p->use_umwait = true;
+    p->never_sleep = false;
+}
+
+struct ndp_worker *ndp_worker_create(struct mempool_sys *mem, int id, int cpu,
+                                     const struct ndp_idle_policy *policy)
+{
+    int node = numa_node_of_cpu(cpu);
+    struct ndp_worker *w;
+
+    if (node < 0)
+        return NULL;
+    if (!(w = ndp_mempool_alloc(mem, node, sizeof(*w), NDP_CACHE_LINE)))
+        return NULL;
+
+    memset(w, 0, sizeof(*w));
+    w->id = id;
+    w->cpu = cpu;
+    w->node = node;
+    if (policy)
+        w->policy = *policy;
+    else
+        ndp_idle_policy_default(&w->policy);
+    if (!cpu_has_waitpkg())
+        w->policy.use_umwait = false;
+
+    w->umwait_cycles = ndp_ns_to_tsc((uint64_t)w->policy.umwait_us * 1000);
+    w->sleep_after_cycles = ndp_ns_to_tsc((uint64_t)w->policy.sleep_after_us * 1000);
+    w->stats.wake_min_ns = UINT64_MAX;
+
+    if ((w->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+        return NULL;
+    return w;
+}
+
+int ndp_worker_add_poll(struct ndp_worker *w, ndp_poll_fn fn, void *arg)
+{
+    if (w->num_polls >= NDP_WORKER_MAX_POLLS)
+        return -1;
+
+    w->polls[w->num_polls] = fn;
+    w->poll_args[w->num_polls] = arg;
+    w->num_polls++;
+    return 0;
+}
+
+void ndp_worker_wake_slow(struct ndp_worker *w)
+{
+    int state = __atomic_load_n(&w->state, __ATOMIC_ACQUIRE);
+    uint64_t now = ndp_rdtsc();
+
+    if (state != NDP_WORKER_UMWAIT && state != NDP_WORKER_SLEEPING)
+        return;
+
+    // only the waker that wins the transition stamps and signals
+    if (!__atomic_compare_exchange_n(&w->state, &state, NDP_WORKER_WAKING, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return;
+
+    __atomic_store_n(&w->wake_tsc, now, __ATOMIC_RELEASE);
+    if (state == NDP_WORKER_SLEEPING) {
+        uint64_t one = 1;
+        if (write(w->efd, &one, sizeof(one)) != sizeof(one))
+            perror("worker eventfd write");
+    }
+}
+
+static int worker_poll(struct ndp_worker *w)
+{
+    int work = 0;
+
+    for (int i = 0; i < w->num_polls; i++)
+        work += w->polls[i](w->poll_args[i]);
+    w->stats.polls++;
+
+    // hooks hold no table references between rounds
+    if (w->qsbr)
+        ndp_qsbr_quiescent(w->qsbr, w->qsbr_id);
+    return work;
+}
+
+static void worker_account_wake(struct ndp_worker *w)
+{
+    uint64_t stamp;
+
+    // the waker publishes wake_tsc right after winning the state CAS
+    while (!(stamp = __atomic_load_n(&w->wake_tsc, __ATOMIC_ACQUIRE)))
+        _mm_pause();
+
+    uint64_t ns = ndp_tsc_to_ns(ndp_rdtsc() - stamp);
+    int bucket = ns ? 63 - __builtin_clzll(ns) : 0;
+
+    w->stats.wakeups++;
+    w->stats.wake_sum_ns += ns;
+    if (ns < w->stats.wake_min_ns)
+        w->stats.wake_min_ns = ns;
+    if (ns > w->stats.wake_max_ns)
+        w->stats.wake_max_ns = ns;
+    w->stats.wake_hist[bucket < NDP_WAKE_BUCKETS ? bucket : NDP_WAKE_BUCKETS - 1]++;
+}
+
+/**
+ *  publish an idle state and poll once more before waiting: a producer
+ *  that enqueued before seeing the new state will not wake us, so its work
+ *  must be picked up here.
+ *
+ *  @return true when the worker went idle and has been resumed
+ */
+static bool worker_enter_idle(struct ndp_worker *w, int state)
+{
+    int expect = state;
+    int work;
+
+    __atomic_store_n(&w->wake_tsc, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&w->state, state, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if ((work = worker_poll(w))) {
+        w->stats.work += work;
+        if (!__atomic_compare_exchange_n(&w->state, &expect, NDP_WORKER_RUNNING, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            goto idle_woken;
+        return false;
+    }
+
+    // a waiting worker must not hold up table reclamation
+    if (w->qsbr)
+        ndp_qsbr_offline(w->qsbr, w->qsbr_id);
+
+    if (state == NDP_WORKER_UMWAIT) {
+        worker_umwait(w, ndp_rdtsc() + w->umwait_cycles);
+        w->stats.umwaits++;
+    } else {
+        struct pollfd pfd = { .fd = w->efd, .events = POLLIN };
+        int timeout_ms = (int)(w->policy.sleep_max_us / 1000);
+        poll(&pfd, 1, timeout_ms > 0 ? timeout_ms : 1);
+        w->stats.sleeps++;
+    }
+
+    if (w->qsbr)
+        ndp_qsbr_online(w->qsbr, w->qsbr_id);
+
+    if (__atomic_compare_exchange_n(&w->state, &expect, NDP_WORKER_RUNNING, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return true;
+
+idle_woken:
+    worker_account_wake(w);
+    if (state == NDP_WORKER_SLEEPING) {
+        uint64_t cnt;
+        if (read(w->efd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN)
+            perror("worker eventfd read");
+    }
+    __atomic_store_n(&w->state, NDP_WORKER_RUNNING, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void *ndp_worker_thread(void *args)
+{
+    struct ndp_worker *w = args;
+    uint64_t last = ndp_rdtsc();
+    uint64_t idle_since = 0;
+    uint32_t empty = 0, backoff = 1;
+
+    if (ndp_bind_thread_to_cpu(w->cpu) < 0)
+        return NULL;
+    if (w->qsbr)
+        ndp_qsbr_online(w->qsbr, w->qsbr_id);
+
+    while (__atomic_load_n(&w->running, __ATOMIC_ACQUIRE)) {
+        int work = worker_poll(w);
+        uint64_t now = ndp_rdtsc();
+
+        // release: a reader that sees the new count also sees the flow
+        // state this round wrote (the balancer's drain handshake)
+        __atomic_store_n(&w->loops, w->loops + 1, __ATOMIC_RELEASE);
+        if (work) {
+            w->stats.busy_cycles += now - last;
+            w->stats.work += work;
+            last = now;
+            empty = 0;
+            backoff = 1;
+            idle_since = 0;
+            continue;
+        }
+        w->stats.idle_cycles += now - last;
+        last = now;
+
+        if (++empty < w->policy.spin_polls)
+            continue;
+        if (!idle_since)
+            idle_since = now;
+
+        if (!w->policy.never_sleep && now - idle_since >= w->sleep_after_cycles) {
+            worker_enter_idle(w, NDP_WORKER_SLEEPING);
+        } else if (backoff >= w->policy.pause_max && w->policy.use_umwait) {
+            worker_enter_idle(w, NDP_WORKER_UMWAIT);
+        } else {
+            for (uint32_t i = 0; i < backoff; i++)
+                _mm_pause();
+            if (backoff < w->policy.pause_max)
+                backoff <<= 1;
+            continue;
+        }
+
+        // whatever woke us, go back to full speed polling
+        now = ndp_rdtsc();
+        w->stats.idle_cycles += now - last;
+        last = now;
+        empty = 0;
+        backoff = 1;
+        idle_since = 0;
+    }
+
+    if (w->qsbr)
+        ndp_qsbr_offline(w->qsbr, w->qsbr_id);
+    return NULL;
+}
+
+int ndp_worker_set_qsbr(struct ndp_worker *w, struct ndp_qsbr *q)
+{
+    int id = ndp_qsbr_register(q);
+
+    if (id < 0)
+        return -1;
+    // online again once the thread runs
+    ndp_qsbr_offline(q, id);
+    w->qsbr = q;
+    w->qsbr_id = id;
+    return 0;
+}
+
+int ndp_worker_start(struct ndp_worker *w)
+{
+    w->running = true;
+    if (pthread_create(&w->thread, NULL, ndp_worker_thread, w) != 0) {
+        w->running = false;
+        return -1;
+    }
+    return 0;
+}
+
+void ndp_worker_stop(struct ndp_worker *w)
+{
+    if (!w->running)
+        return;
+
+    __atomic_store_n(&w->running, false, __ATOMIC_RELEASE);
+    ndp_worker_wake(w);
+    pthread_join(w->thread, NULL);
+    close(w->efd);
+}
+
+double ndp_worker_utilization(const struct ndp_worker *w)
+{
+    uint64_t busy = __atomic_load_n(&w->stats.busy_cycles, __ATOMIC_RELAXED);
+    uint64_t idle = __atomic_load_n(&w->stats.idle_cycles, __ATOMIC_RELAXED);
+
+    return busy + idle ? (double)busy / (double)(busy + idle) : 0.0;
+}
+
+void ndp_worker_stats_report(const struct ndp_worker *w, FILE *out)
+{
+    const struct ndp_worker_stats *s = &w->stats;
+
+    fprintf(out, "worker %d (cpu %d, node %d): util %.1f%% polls %lu work %lu\n",
+            w->id, w->cpu, w->node, 100.0 * ndp_worker_utilization(w),
+            (unsigned long)s->polls, (unsigned long)s->work);
+    fprintf(out, "  idle: umwaits %lu sleeps %lu wakeups %lu\n",
+            (unsigned long)s->umwaits, (unsigned long)s->sleeps, (unsigned long)s->wakeups);
+    if (!s->wakeups)
+        return;
+
+    fprintf(out, "  wake latency ns: min %lu avg %lu max %lu\n",
+            (unsigned long)s->wake_min_ns, (unsigned long)(s->wake_sum_ns / s->wakeups),
+            (unsigned long)s->wake_max_ns);
+    for (int b = 0; b < NDP_WAKE_BUCKETS; b++) {
+        if (s->wake_hist[b])
+            fprintf(out, "    [%10lu, %10lu) %lu\n", 1UL << b, 2UL << b,
+                    (unsigned long)s->wake_hist[b]);
+    }
+}